@@ -15,6 +15,8 @@
 
 #include "modules/blinky/service.h"
 #include "modules/board/service.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/rpc_metrics/service.h"
 #include "pw_log/log.h"
 #include "pw_system/system.h"
 #include "system/system.h"
@@ -27,16 +29,20 @@ int main() {
   auto& monochrome_led = sense::system::MonochromeLed();
   auto& polychrome_led = sense::system::PolychromeLed();
 
+  static sense::RpcMetrics rpc_metrics;
+  static sense::RpcMetricsService rpc_metrics_service(rpc_metrics);
+  sense::RegisterService(rpc_server, rpc_metrics_service, rpc_metrics);
+
   static sense::BoardService board_service;
   board_service.Init(worker, sense::system::Board());
-  rpc_server.RegisterService(board_service);
+  sense::RegisterService(rpc_server, board_service, rpc_metrics);
 
   static sense::BlinkyService blinky_service;
   blinky_service.Init(pw::System().dispatcher(),
                       pw::System().allocator(),
                       monochrome_led,
                       polychrome_led);
-  rpc_server.RegisterService(blinky_service);
+  sense::RegisterService(rpc_server, blinky_service, rpc_metrics);
 
   PW_LOG_INFO("Started blinky app; waiting for RPCs...");
   sense::system::Start();
@@ -20,6 +20,8 @@
 #include "modules/board/service.h"
 #include "modules/proximity/manager.h"
 #include "modules/pubsub/service.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/rpc_metrics/service.h"
 #include "pw_log/log.h"
 #include "pw_system/system.h"
 #include "system/pubsub.h"
@@ -31,39 +33,45 @@ namespace {
 
 [[noreturn]] void InitializeApp() {
   system::Init();
+  auto& rpc_server = pw::System().rpc_server();
+
+  static RpcMetrics rpc_metrics;
+  static RpcMetricsService rpc_metrics_service(rpc_metrics);
+  RegisterService(rpc_server, rpc_metrics_service, rpc_metrics);
 
   static BoardService board_service;
   board_service.Init(system::GetWorker(), system::Board());
-  pw::System().rpc_server().RegisterService(board_service);
+  RegisterService(rpc_server, board_service, rpc_metrics);
 
   static PubSubService pubsub_service;
-  pubsub_service.Init(system::PubSub());
-  pw::System().rpc_server().RegisterService(pubsub_service);
+  pubsub_service.Init(system::PubSub(), system::GetWorker(), system::BootId());
+  RegisterService(rpc_server, pubsub_service, rpc_metrics);
 
   static sense::BlinkyService blinky_service;
   blinky_service.Init(pw::System().dispatcher(),
                       pw::System().allocator(),
                       system::MonochromeLed(),
                       system::PolychromeLed());
-  pw::System().rpc_server().RegisterService(blinky_service);
+  RegisterService(rpc_server, blinky_service, rpc_metrics);
 
   static AirSensor& air_sensor = system::AirSensor();
   static AirSensorService air_sensor_service;
-  air_sensor_service.Init(system::GetWorker(), air_sensor);
-  pw::System().rpc_server().RegisterService(air_sensor_service);
+  air_sensor_service.Init(
+      pw::System().dispatcher(), system::GetWorker(), air_sensor);
+  RegisterService(rpc_server, air_sensor_service, rpc_metrics);
 
   auto& button_manager = system::ButtonManager();
   button_manager.Init(system::PubSub(), system::GetWorker());
   button_manager.Stop();
 
-  FactoryService factory_service;
+  static FactoryService factory_service;
   factory_service.Init(system::Board(),
                        system::PubSub(),
                        button_manager,
                        system::ProximitySensor(),
                        system::AmbientLightSensor(),
                        air_sensor);
-  pw::System().rpc_server().RegisterService(factory_service);
+  RegisterService(rpc_server, factory_service, rpc_metrics);
 
   PW_LOG_INFO("Enviro+ Pack Diagnostics app");
   system::Start();
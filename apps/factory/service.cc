@@ -37,12 +37,14 @@ void FactoryService::Init(Board& board,
 
 pw::Status FactoryService::GetDeviceInfo(const pw_protobuf_Empty&,
                                          factory_DeviceInfo& response) {
+  auto call = get_device_info_metrics_.Measure();
   response.flash_id = board_->UniqueFlashId();
   return pw::OkStatus();
 }
 
 pw::Status FactoryService::StartTest(const factory_StartTestRequest& request,
                                      pw_protobuf_Empty&) {
+  auto call = start_test_metrics_.Measure();
   switch (request.test) {
     case factory_Test_Type_BUTTONS:
       PW_LOG_INFO("Configured for buttons test");
@@ -64,6 +66,7 @@ pw::Status FactoryService::StartTest(const factory_StartTestRequest& request,
 
 pw::Status FactoryService::EndTest(const factory_EndTestRequest& request,
                                    pw_protobuf_Empty&) {
+  auto call = end_test_metrics_.Measure();
   switch (request.test) {
     case factory_Test_Type_BUTTONS:
       button_manager_->Stop();
@@ -82,6 +85,7 @@ pw::Status FactoryService::EndTest(const factory_EndTestRequest& request,
 
 pw::Status FactoryService::SampleLtr559Prox(
     const pw_protobuf_Empty&, factory_Ltr559ProxSample& response) {
+  auto call = sample_ltr559_prox_metrics_.Measure();
   pw::Result<uint16_t> result = proximity_sensor_->ReadSample();
   PW_TRY(result);
 
@@ -91,6 +95,7 @@ pw::Status FactoryService::SampleLtr559Prox(
 
 pw::Status FactoryService::SampleLtr559Light(
     const pw_protobuf_Empty&, factory_Ltr559LightSample& response) {
+  auto call = sample_ltr559_light_metrics_.Measure();
   pw::Result<float> result = ambient_light_sensor_->ReadSampleLux();
   PW_TRY(result);
 
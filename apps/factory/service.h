@@ -19,6 +19,7 @@
 #include "modules/buttons/manager.h"
 #include "modules/light/sensor.h"
 #include "modules/proximity/sensor.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 
 namespace sense {
 
@@ -32,6 +33,8 @@ class FactoryService final
             AmbientLightSensor& ambient_light_sensor,
             AirSensor& air_sensor);
 
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
   pw::Status GetDeviceInfo(const pw_protobuf_Empty&,
                            factory_DeviceInfo& response);
 
@@ -53,6 +56,18 @@ class FactoryService final
   ProximitySensor* proximity_sensor_;
   AmbientLightSensor* ambient_light_sensor_;
   AirSensor* air_sensor_;
+
+  RpcServiceMetrics method_metrics_{"Factory"};
+  RpcMethodMetrics get_device_info_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(FactoryService, GetDeviceInfo)};
+  RpcMethodMetrics start_test_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(FactoryService, StartTest)};
+  RpcMethodMetrics end_test_metrics_{method_metrics_,
+                                     SENSE_RPC_METHOD(FactoryService, EndTest)};
+  RpcMethodMetrics sample_ltr559_prox_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(FactoryService, SampleLtr559Prox)};
+  RpcMethodMetrics sample_ltr559_light_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(FactoryService, SampleLtr559Light)};
 };
 
 }  // namespace sense
@@ -14,20 +14,26 @@
 
 #define PW_LOG_MODULE_NAME "MAIN"
 
-#include "apps/production/threads.h"
 #include "modules/air_sensor/service.h"
 #include "modules/board/service.h"
 #include "modules/event_timers/event_timers.h"
+#include "modules/history/service.h"
+#include "modules/i2c_bus/service.h"
 #include "modules/morse_code/encoder.h"
+#include "modules/proximity/config.h"
+#include "modules/proximity/interrupt_manager.h"
 #include "modules/proximity/manager.h"
 #include "modules/pubsub/service.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/rpc_metrics/service.h"
 #include "modules/sampling_thread/sampling_thread.h"
+#include "modules/sampling_thread/service.h"
 #include "modules/state_manager/service.h"
 #include "modules/state_manager/state_manager.h"
+#include "modules/telemetry/service.h"
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
 #include "pw_system/system.h"
-#include "pw_thread/detached_thread.h"
 #include "system/pubsub.h"
 #include "system/system.h"
 #include "system/worker.h"
@@ -35,10 +41,23 @@
 namespace sense {
 namespace {
 
+RpcMetrics& GetRpcMetrics() {
+  static RpcMetrics rpc_metrics;
+  return rpc_metrics;
+}
+
+void InitRpcMetricsService() {
+  static RpcMetricsService rpc_metrics_service(GetRpcMetrics());
+  RegisterService(
+      pw::System().rpc_server(), rpc_metrics_service, GetRpcMetrics());
+}
+
 void InitStateManager() {
   static StateManager state_manager(system::PubSub(), system::PolychromeLed());
-  static StateManagerService state_manager_service(system::PubSub());
-  pw::System().rpc_server().RegisterService(state_manager_service);
+  static StateManagerService state_manager_service(system::PubSub(),
+                                                   system::GetWorker());
+  RegisterService(
+      pw::System().rpc_server(), state_manager_service, GetRpcMetrics());
 }
 
 void InitEventTimers() {
@@ -52,7 +71,7 @@ void InitEventTimers() {
 void InitBoardService() {
   static BoardService board_service;
   board_service.Init(system::GetWorker(), system::Board());
-  pw::System().rpc_server().RegisterService(board_service);
+  RegisterService(pw::System().rpc_server(), board_service, GetRpcMetrics());
 }
 
 void InitMorseEncoder() {
@@ -75,10 +94,20 @@ void InitMorseEncoder() {
 
 void InitProximitySensor() {
   // Set up a proximity detector state machine.
-  constexpr uint16_t kInitialNearTheshold = 16384;
-  constexpr uint16_t kInitialFarTheshold = 512;
-  static ProximityManager proximity(
-      system::PubSub(), kInitialFarTheshold, kInitialNearTheshold);
+  constexpr uint16_t kInitialNearTheshold =
+      SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD;
+  constexpr uint16_t kInitialFarTheshold = SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD;
+  if constexpr (SENSE_PROXIMITY_CONFIG_INTERRUPT_DRIVEN) {
+    static ProximityInterruptManager proximity(system::PubSub(),
+                                               system::ProximitySensor(),
+                                               system::ProximityInterrupt(),
+                                               kInitialFarTheshold,
+                                               kInitialNearTheshold);
+    pw::System().dispatcher().Post(proximity);
+  } else {
+    static ProximityManager proximity(
+        system::PubSub(), kInitialFarTheshold, kInitialNearTheshold);
+  }
 
   // Log when proximity is detected.
   PW_CHECK(system::PubSub().SubscribeTo<ProximityStateChange>(
@@ -94,25 +123,55 @@ void InitProximitySensor() {
 void InitAirSensor() {
   static AirSensor& air_sensor = sense::system::AirSensor();
   static sense::AirSensorService air_sensor_service;
-  air_sensor_service.Init(system::GetWorker(), air_sensor);
-  pw::System().rpc_server().RegisterService(air_sensor_service);
+  air_sensor_service.Init(
+      pw::System().dispatcher(), system::GetWorker(), air_sensor);
+  RegisterService(
+      pw::System().rpc_server(), air_sensor_service, GetRpcMetrics());
+}
+
+void InitTelemetryService() {
+  static TelemetryService telemetry_service;
+  telemetry_service.Init(system::PubSub(),
+                         system::GetWorker(),
+                         system::AirSensor(),
+                         system::Board());
+  RegisterService(
+      pw::System().rpc_server(), telemetry_service, GetRpcMetrics());
+}
+
+void InitHistoryService() {
+  static HistoryService history_service;
+  history_service.Init(system::PubSub(), system::GetWorker(), system::Board());
+  RegisterService(pw::System().rpc_server(), history_service, GetRpcMetrics());
+}
+
+void InitI2cBusService() {
+  static I2cBusService i2c_bus_service(system::I2cBus());
+  RegisterService(pw::System().rpc_server(), i2c_bus_service, GetRpcMetrics());
 }
 
 [[noreturn]] void InitializeApp() {
   system::Init();
 
+  InitRpcMetricsService();
   InitStateManager();
   InitEventTimers();
   InitBoardService();
   InitMorseEncoder();
   InitProximitySensor();
   InitAirSensor();
+  InitTelemetryService();
+  InitHistoryService();
+  InitI2cBusService();
 
-  pw::thread::DetachedThread(SamplingThreadOptions(), SamplingLoop);
+  StartSampling(pw::System().dispatcher(), system::GetWorker());
+  static SamplingService sampling_service(GetSamplers());
+  RegisterService(
+      pw::System().rpc_server(), sampling_service, GetRpcMetrics());
 
   static PubSubService pubsub_service;
-  pubsub_service.Init(system::PubSub());
-  pw::System().rpc_server().RegisterService(pubsub_service);
+  pubsub_service.Init(system::PubSub(), system::GetWorker(), system::BootId());
+  RegisterService(pw::System().rpc_server(), pubsub_service, GetRpcMetrics());
 
   auto& button_manager = system::ButtonManager();
   button_manager.Init(system::PubSub(), system::GetWorker());
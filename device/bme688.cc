@@ -16,27 +16,26 @@
 
 #include "device/bme688.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <mutex>
 
 #include "bme68x.h"
 #include "pw_assert/check.h"
-#include "pw_bytes/endian.h"
-#include "pw_bytes/span.h"
 #include "pw_function/function.h"
 #include "pw_log/log.h"
 #include "pw_span/span.h"
-#include "pw_status/try.h"
+#include "pw_sync/thread_notification.h"
 #include "pw_thread/sleep.h"
 
 namespace sense {
 
 static constexpr pw::i2c::Address kAddress =
     pw::i2c::Address::SevenBit<BME68X_I2C_ADDR_HIGH>();
-static constexpr uint16_t kHeaterTemperature = 300;
-static constexpr uint16_t kHeaterDuration = 100;
-static constexpr auto kTimeout =
-    pw::chrono::SystemClock::for_at_least(std::chrono::seconds(1));
+static constexpr Bme688::HeaterStep kDefaultHeaterProfile[] = {
+    {.temperature_c = 300, .duration_ms = 100},
+};
 
 static int8_t Write(uint8_t reg_address,
                     const uint8_t* data,
@@ -47,13 +46,10 @@ static int8_t Write(uint8_t reg_address,
               static_cast<const void*>(data),
               length,
               context);
-  auto i2c_device = static_cast<pw::i2c::RegisterDevice*>(context);
+  auto registers = static_cast<Bme688RegisterCache*>(context);
 
-  std::array<std::byte, 16> write_buffer;
-  pw::span<const uint8_t> bytes(data, length);
-  auto status =
-      i2c_device->WriteRegisters8(reg_address, bytes, write_buffer, kTimeout);
-  PW_LOG_INFO("WriteRegisters8 returned %s", pw_StatusString(status));
+  auto status = registers->Write(reg_address, pw::span(data, length));
+  PW_LOG_INFO("Write returned %s", pw_StatusString(status));
   return status.ok() ? 0 : 1;
 }
 
@@ -66,32 +62,115 @@ static int8_t Read(uint8_t reg_address,
               static_cast<const void*>(data),
               length,
               context);
-  auto i2c_device = static_cast<pw::i2c::RegisterDevice*>(context);
+  auto registers = static_cast<Bme688RegisterCache*>(context);
 
-  pw::span<uint8_t> read_buffer(data, length);
-  auto status = i2c_device->ReadRegisters8(reg_address, read_buffer, kTimeout);
-  PW_LOG_INFO("ReadRegisters8 returned %s", pw_StatusString(status));
+  auto status = registers->Read(reg_address, pw::span(data, length));
+  PW_LOG_INFO("Read returned %s", pw_StatusString(status));
   return status.ok() ? 0 : 1;
 }
 
 static void Delay(uint32_t interval_us, void* context) {
   PW_LOG_INFO("Delay(interval_us=%u, context=%p)", interval_us, context);
+
+  // Writes must reach the sensor before waiting on it.
+  static_cast<Bme688RegisterCache*>(context)->Flush().IgnoreError();
+
   auto interval = pw::chrono::SystemClock::for_at_least(
       std::chrono::microseconds(interval_us));
   pw::this_thread::sleep_for(interval);
 }
 
-Bme688::Bme688(pw::i2c::Initiator& initiator, Worker& worker)
-    : AirSensor(),
+Bme688::Bme688(pw::i2c::Initiator& initiator, Worker& worker, Mode mode)
+    : AirSensor(mode),
       worker_(worker),
-      i2c_device_(initiator,
-                  kAddress,
-                  pw::endian::native,
-                  pw::i2c::RegisterAddressSize::k1Byte),
-      get_data_(pw::bind_member<&Bme688::GetDataCallback>(this)) {}
+      registers_(initiator, kAddress),
+      get_data_(pw::bind_member<&Bme688::GetDataCallback>(this)) {
+  PW_CHECK_OK(SetHeaterProfile(HeaterMode::kForced, kDefaultHeaterProfile));
+  TakeHeaterProfile();
+}
+
+Bme688::~Bme688() {
+  {
+    std::lock_guard lock(stop_lock_);
+    stopping_ = true;
+  }
+  get_data_.Cancel();
+
+  // The worker runs work in order, so once this runs, no work that uses the
+  // sensor is left.
+  pw::sync::ThreadNotification flushed;
+  worker_.RunOnce([&flushed]() { flushed.release(); });
+  flushed.acquire();
+}
+
+pw::Status Bme688::DoSetHeaterProfile(HeaterMode heater_mode,
+                                      pw::span<const HeaterStep> steps) {
+  if (steps.empty() || steps.size() > kMaxHeaterSteps ||
+      (heater_mode == HeaterMode::kForced && steps.size() != 1)) {
+    return pw::Status::InvalidArgument();
+  }
+
+  HeaterProfile profile = {
+      .mode = heater_mode, .steps = {}, .num_steps = steps.size()};
+  std::copy(steps.begin(), steps.end(), profile.steps.begin());
+  std::lock_guard lock(profile_lock_);
+  new_profile_ = profile;
+  return pw::OkStatus();
+}
+
+bool Bme688::TakeHeaterProfile() {
+  HeaterProfile profile;
+  {
+    std::lock_guard lock(profile_lock_);
+    if (!new_profile_.has_value()) {
+      return false;
+    }
+    profile = *new_profile_;
+    new_profile_.reset();
+  }
+
+  heater_mode_ = profile.mode;
+  min_heater_duration_ms_ = UINT16_MAX;
+  for (size_t i = 0; i < profile.num_steps; ++i) {
+    uint16_t duration_ms = profile.steps[i].duration_ms;
+    min_heater_duration_ms_ = std::min(min_heater_duration_ms_, duration_ms);
+    heater_temperatures_[i] = profile.steps[i].temperature_c;
+    if (heater_mode_ == HeaterMode::kParallel) {
+      // Parallel durations are given as a number of heating cycles.
+      heater_durations_[i] = static_cast<uint16_t>(std::max(
+          1, (duration_ms + kParallelCycleMs - 1) / kParallelCycleMs));
+    } else {
+      heater_durations_[i] = duration_ms;
+    }
+  }
+
+  heater_ = {};
+  heater_.enable = BME68X_ENABLE;
+  if (heater_mode_ == HeaterMode::kForced) {
+    heater_.heatr_temp = heater_temperatures_[0];
+    heater_.heatr_dur = heater_durations_[0];
+  } else {
+    heater_.heatr_temp_prof = heater_temperatures_.data();
+    heater_.heatr_dur_prof = heater_durations_.data();
+    heater_.profile_len = static_cast<uint8_t>(profile.num_steps);
+  }
+  scan_ = GasScan(profile.num_steps);
+  return true;
+}
+
+pw::Status Bme688::ConfigureHeater() {
+  if (heater_mode_ == HeaterMode::kParallel) {
+    // The heater runs for whatever part of each cycle is not spent measuring.
+    uint32_t measure_ms =
+        bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &config_, &bme688_) / 1000;
+    heater_.shared_heatr_dur = static_cast<uint16_t>(
+        kParallelCycleMs - std::min<uint32_t>(measure_ms, kParallelCycleMs));
+  }
+  return Check(bme68x_set_heatr_conf(OpMode(), &heater_, &bme688_));
+}
 
 pw::Status Bme688::DoInit() {
-  bme688_.intf_ptr = &i2c_device_;
+  bme688_.intf_ptr = &registers_;
   bme688_.intf = bme68x_intf::BME68X_I2C_INTF;
   bme688_.read = Read;
   bme688_.write = Write;
@@ -125,43 +204,241 @@ pw::Status Bme688::DoInit() {
   return pw::OkStatus();
 }
 
-pw::Status Bme688::DoMeasure(pw::sync::ThreadNotification& notification) {
-  get_data_.Cancel();
+pw::Status Bme688::DoMeasure() {
+  worker_.RunOnce([this]() { BeginMeasurement(); });
+  return pw::OkStatus();
+}
+
+void Bme688::BeginMeasurement() {
   {
-    std::lock_guard lock(lock_);
-    if (notification_ != nullptr) {
-      notification_->release();
+    std::lock_guard lock(stop_lock_);
+    if (stopping_) {
+      return;
     }
-    notification_ = &notification;
   }
+  TakeHeaterProfile();
+  scan_ = GasScan(scan_.num_steps());
+  if (!ConfigureHeater().ok() || !StartConversion().ok()) {
+    // Finish without a reading rather than leave the measurement waiting on a
+    // sensor that can't be started.
+    StopPipeline();
+    FinishMeasurement();
+    return;
+  }
+  get_data_.InvokeAfter(ConversionDuration());
+}
 
-  heater_.enable = BME68X_ENABLE;
-  heater_.heatr_temp = kHeaterTemperature;
-  heater_.heatr_dur = kHeaterDuration;
-  PW_TRY(Check(bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heater_, &bme688_)));
-  PW_TRY(Check(bme68x_set_op_mode(BME68X_FORCED_MODE, &bme688_)));
-
-  worker_.RunOnce([this]() {
-    uint32_t delay_us =
-        bme68x_get_meas_dur(BME68X_FORCED_MODE, &config_, &bme688_);
-    delay_us += (heater_.heatr_dur * 1000);
-    auto delay = pw::chrono::SystemClock::for_at_least(
-        std::chrono::microseconds(delay_us));
-    get_data_.InvokeAfter(delay);
-  });
+pw::Status Bme688::DoSetSamplePeriod(
+    pw::chrono::SystemClock::duration period) {
+  sample_period_.store(period.count());
   return pw::OkStatus();
 }
 
+void Bme688::DoLogMetrics() {
+  const Bme688RegisterCache::Stats& stats = registers_.stats();
+  i2c_transactions_.Set(stats.transactions);
+  i2c_bytes_.Set(stats.bytes);
+  i2c_bytes_saved_.Set(stats.bytes_saved());
+  if (num_measurements_ != 0) {
+    auto measurements = static_cast<float>(num_measurements_);
+    bytes_per_measurement_.Set(static_cast<float>(stats.bytes) /
+                               measurements);
+    bytes_saved_per_measurement_.Set(
+        static_cast<float>(stats.bytes_saved()) / measurements);
+  }
+  i2c_metrics_.Dump();
+}
+
+uint8_t Bme688::OpMode() const {
+  switch (heater_mode_) {
+    case HeaterMode::kForced:
+      return BME68X_FORCED_MODE;
+    case HeaterMode::kSequential:
+      return BME68X_SEQUENTIAL_MODE;
+    case HeaterMode::kParallel:
+      return BME68X_PARALLEL_MODE;
+  }
+  return BME68X_SLEEP_MODE;
+}
+
+pw::Status Bme688::StartConversion() {
+  return Check(bme68x_set_op_mode(OpMode(), &bme688_));
+}
+
+pw::chrono::SystemClock::duration Bme688::ConversionDuration() {
+  uint32_t delay_us = bme68x_get_meas_dur(OpMode(), &config_, &bme688_);
+  switch (heater_mode_) {
+    case HeaterMode::kForced:
+      delay_us += heater_.heatr_dur * 1000;
+      break;
+    case HeaterMode::kSequential:
+      delay_us += min_heater_duration_ms_ * 1000;
+      break;
+    case HeaterMode::kParallel:
+      delay_us += heater_.shared_heatr_dur * 1000;
+      break;
+  }
+  return pw::chrono::SystemClock::for_at_least(
+      std::chrono::microseconds(delay_us));
+}
+
+pw::chrono::SystemClock::duration Bme688::MeasurementDuration() {
+  if (heater_mode_ == HeaterMode::kForced) {
+    return ConversionDuration();
+  }
+  uint32_t measure_us = bme68x_get_meas_dur(OpMode(), &config_, &bme688_);
+  uint32_t delay_us = 0;
+  for (size_t i = 0; i < scan_.num_steps(); ++i) {
+    if (heater_mode_ == HeaterMode::kParallel) {
+      delay_us += uint32_t{heater_durations_[i]} * kParallelCycleMs * 1000;
+    } else {
+      delay_us += measure_us + uint32_t{heater_durations_[i]} * 1000;
+    }
+  }
+  return pw::chrono::SystemClock::for_at_least(
+      std::chrono::microseconds(delay_us));
+}
+
+pw::chrono::SystemClock::duration Bme688::RestDuration() {
+  pw::chrono::SystemClock::duration period(sample_period_.load());
+  return std::max(period - MeasurementDuration(),
+                  pw::chrono::SystemClock::duration::zero());
+}
+
+void Bme688::RestartPipeline() {
+  scan_ = GasScan(scan_.num_steps());
+  if (StartConversion().ok()) {
+    get_data_.InvokeAfter(ConversionDuration());
+  } else {
+    StopPipeline();
+  }
+}
+
+void Bme688::ContinuePipeline() {
+  // Forced conversions return to sleep by themselves, while scans keep
+  // running until stopped.
+  bool converting = heater_mode_ != HeaterMode::kForced;
+  if (TakeHeaterProfile()) {
+    converting = false;
+    if (!ConfigureHeater().ok()) {
+      StopPipeline();
+      return;
+    }
+  }
+
+  pw::chrono::SystemClock::duration rest = RestDuration();
+  if (rest > pw::chrono::SystemClock::duration::zero()) {
+    // A scan that rests is restarted from its first step when the next is due.
+    if (converting) {
+      Check(bme68x_set_op_mode(BME68X_SLEEP_MODE, &bme688_)).IgnoreError();
+    }
+    resting_ = true;
+    get_data_.InvokeAfter(rest);
+  } else if (converting) {
+    get_data_.InvokeAfter(ConversionDuration());
+  } else {
+    RestartPipeline();
+  }
+}
+
 void Bme688::GetDataCallback(pw::chrono::SystemClock::time_point) {
+  std::lock_guard lock(stop_lock_);
+  if (!stopping_) {
+    worker_.RunOnce([this]() { GetData(); });
+  }
+}
+
+void Bme688::GetData() {
+  {
+    std::lock_guard lock(stop_lock_);
+    if (stopping_) {
+      return;
+    }
+  }
+  if (resting_) {
+    resting_ = false;
+    RestartPipeline();
+    return;
+  }
+  if (heater_mode_ == HeaterMode::kForced) {
+    GetForcedData();
+  } else {
+    GetScanData();
+  }
+}
+
+void Bme688::GetForcedData() {
   bme68x_data data;
   uint8_t n;
   if (Check(bme68x_get_data(BME68X_FORCED_MODE, &data, &n, &bme688_)).ok() &&
       n != 0) {
     Update(data.temperature, data.pressure, data.humidity, data.gas_resistance);
+    ++num_measurements_;
+  }
+
+  // Unless the heater profile changes, its config is kept between
+  // conversions, so the next one only needs to be triggered.
+  if (mode() == Mode::kPipelined) {
+    ContinuePipeline();
+  }
+  FinishMeasurement();
+}
+
+void Bme688::GetScanData() {
+  std::array<bme68x_data, BME68X_N_FIELDS> fields;
+  uint8_t n = 0;
+  if (!Check(bme68x_get_data(OpMode(), fields.data(), &n, &bme688_)).ok()) {
+    // Stop rather than leave measurements waiting on a sensor that can't be
+    // read.
+    Check(bme68x_set_op_mode(BME68X_SLEEP_MODE, &bme688_)).IgnoreError();
+    StopPipeline();
+    FinishMeasurement();
+    return;
+  }
+
+  // Up to three steps are buffered by the sensor, so a read may finish a scan
+  // part way through its fields.
+  bool finished = false;
+  for (size_t i = 0; i < n; ++i) {
+    const bme68x_data& field = fields[i];
+    if ((field.status & BME68X_NEW_DATA_MSK) == 0) {
+      continue;
+    }
+    if ((field.status & BME68X_GASM_VALID_MSK) != 0 &&
+        (field.status & BME68X_HEAT_STAB_MSK) != 0 &&
+        field.gas_index < scan_.num_steps()) {
+      scan_.set_gas_resistance(field.gas_index, field.gas_resistance);
+    }
+    if (field.gas_index + 1u == scan_.num_steps()) {
+      FinishScan(field);
+      finished = true;
+    }
+  }
+
+  if (!finished) {
+    get_data_.InvokeAfter(ConversionDuration());
+  } else if (mode() == Mode::kOnDemand) {
+    Check(bme68x_set_op_mode(BME68X_SLEEP_MODE, &bme688_)).IgnoreError();
+  } else {
+    ContinuePipeline();
+  }
+  if (finished) {
+    FinishMeasurement();
+  }
+}
+
+void Bme688::FinishScan(const bme68x_data& field) {
+  ++num_measurements_;
+  if (scan_.has_gas_resistance(0)) {
+    Update(field.temperature,
+           field.pressure,
+           field.humidity,
+           scan_.gas_resistance(0));
+  }
+  if (scan_callback_ != nullptr) {
+    scan_callback_(scan_);
   }
-  std::lock_guard lock(lock_);
-  notification_->release();
-  notification_ = nullptr;
+  scan_ = GasScan(scan_.num_steps());
 }
 
 pw::Status Bme688::Check(int8_t result) {
@@ -13,38 +13,203 @@
 // the License.
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
 #include "bme68x_defs.h"
+#include "device/bme688_register_cache.h"
 #include "modules/air_sensor/air_sensor.h"
+#include "modules/pubsub/pubsub_events.h"
 #include "modules/worker/worker.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_chrono/system_timer.h"
+#include "pw_function/function.h"
 #include "pw_i2c/initiator.h"
-#include "pw_i2c/register_device.h"
+#include "pw_metric/metric.h"
+#include "pw_span/span.h"
 #include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
 
 namespace sense {
 
 class Bme688 : public AirSensor {
  public:
-  explicit Bme688(pw::i2c::Initiator& initiator, Worker& worker);
+  /// Length of each heating cycle in `HeaterMode::kParallel`. Step durations
+  /// are rounded up to a multiple of it.
+  static constexpr uint16_t kParallelCycleMs = 140;
+
+  explicit Bme688(pw::i2c::Initiator& initiator,
+                  Worker& worker,
+                  Mode mode = Mode::kOnDemand);
+
+  /// Stops reading the sensor, and waits for work already given to the worker
+  /// to finish. Must not be called from the worker.
+  ~Bme688() override;
+
+  /// Sets a callback to receive each completed multi-step scan.
+  ///
+  /// The callback is invoked from the worker, and must not block.
+  void SetScanCallback(pw::Function<void(const GasScan&)>&& callback) {
+    scan_callback_ = std::move(callback);
+  }
+
+  /// Returns the I2C traffic to the sensor so far, including how much was
+  /// saved by shadowing its registers.
+  const Bme688RegisterCache::Stats& i2c_stats() const {
+    return registers_.stats();
+  }
+
+  /// Returns the number of measurements read from the sensor. Each scan of a
+  /// multi-step heater profile counts once.
+  uint32_t num_measurements() const { return num_measurements_; }
 
  private:
   pw::Status DoInit() override;
 
-  pw::Status DoMeasure(pw::sync::ThreadNotification& notification) override;
+  /// Hands starting the measurement to the worker, since configuring the
+  /// heater and triggering a conversion wait on the bus and the sensor.
+  pw::Status DoMeasure() override;
+
+  /// Validates the profile, and leaves it to be applied between measurements
+  /// by `TakeHeaterProfile`.
+  pw::Status DoSetHeaterProfile(HeaterMode heater_mode,
+                                pw::span<const HeaterStep> steps) override
+      PW_LOCKS_EXCLUDED(profile_lock_);
+
+  /// Paces pipelined conversions to `period`.
+  ///
+  /// Converting back to back keeps the gas heater at its target temperature
+  /// almost continuously. That warms the sensor, which biases its temperature
+  /// and humidity readings, and feeds the score's statistics window far more
+  /// often than the window's length assumes. Resting between conversions keeps
+  /// the heater's duty cycle, and the rate of updates, the same as measuring
+  /// on demand at this period.
+  pw::Status DoSetSamplePeriod(
+      pw::chrono::SystemClock::duration period) override;
+
+  void DoLogMetrics() override;
+
+  /// Makes the most recently set heater profile current. Returns whether it
+  /// had changed.
+  bool TakeHeaterProfile() PW_LOCKS_EXCLUDED(profile_lock_);
+
+  /// Writes the current heater profile to the sensor, which puts it to sleep.
+  pw::Status ConfigureHeater();
+
+  /// Returns the bme68x operating mode for the heater mode.
+  uint8_t OpMode() const;
+
+  /// Triggers a conversion with the current heater config. In the scanning
+  /// modes, the sensor keeps converting until it is put to sleep.
+  pw::Status StartConversion();
+
+  /// Returns how long to wait between reads of the sensor's data: one forced
+  /// mode conversion including heating, or the shortest step of a scan.
+  pw::chrono::SystemClock::duration ConversionDuration();
+
+  /// Returns how long a full measurement takes: one forced mode conversion, or
+  /// a scan of every step of the heater profile.
+  pw::chrono::SystemClock::duration MeasurementDuration();
+
+  /// Returns how long a pipelined sensor should rest after a measurement, so
+  /// that the next completes one sample period after it. Zero if the next
+  /// should start immediately.
+  pw::chrono::SystemClock::duration RestDuration();
 
-  void GetDataCallback(pw::chrono::SystemClock::time_point);
+  /// Starts the next pipelined measurement after resting, or stops the
+  /// pipeline if it can't be started.
+  void RestartPipeline();
+
+  /// Continues pipelined measurements once one has been read. Applies any new
+  /// heater profile, and rests or starts the next measurement.
+  void ContinuePipeline();
+
+  /// Hands reading the sensor to the worker, so that the timer thread, which
+  /// is shared by every timer, never waits on the bus.
+  void GetDataCallback(pw::chrono::SystemClock::time_point)
+      PW_LOCKS_EXCLUDED(stop_lock_);
+
+  /// Applies the heater profile and starts a measurement requested by
+  /// `DoMeasure`, or finishes it if the sensor can't be started. Runs on the
+  /// worker.
+  void BeginMeasurement() PW_LOCKS_EXCLUDED(stop_lock_);
+
+  /// Reads the data due when `get_data_` fires, or ends a rest. Runs on the
+  /// worker.
+  void GetData() PW_LOCKS_EXCLUDED(stop_lock_);
+
+  /// Reads a forced-mode conversion and starts the next if pipelined.
+  void GetForcedData();
+
+  /// Reads the fields of a scan, finishing the measurement at the end of each
+  /// cycle of the heater profile.
+  void GetScanData();
+
+  /// Reports the scan ending with `field`, and starts a new one.
+  void FinishScan(const bme68x_data& field);
 
   pw::Status Check(int8_t result);
 
+  // The profile set by `SetHeaterProfile`, until it is taken.
+  struct HeaterProfile {
+    HeaterMode mode;
+    std::array<HeaterStep, kMaxHeaterSteps> steps;
+    size_t num_steps;
+  };
+  pw::sync::InterruptSpinLock profile_lock_;
+  std::optional<HeaterProfile> new_profile_ PW_GUARDED_BY(profile_lock_);
+
   bme68x_dev bme688_;
   bme68x_conf config_;
+
+  // The current heater profile. Only used by measurements, which are never in
+  // progress at the same time.
   bme68x_heatr_conf heater_;
+  HeaterMode heater_mode_ = HeaterMode::kForced;
+  std::array<uint16_t, kMaxHeaterSteps> heater_temperatures_;
+  std::array<uint16_t, kMaxHeaterSteps> heater_durations_;
+  uint16_t min_heater_duration_ms_ = 0;
   Worker& worker_;
-  pw::i2c::RegisterDevice i2c_device_;
+  Bme688RegisterCache registers_;
+
+  // Set by the sampler, and read on the worker.
+  std::atomic<pw::chrono::SystemClock::rep> sample_period_ = 0;
+
+  // Whether the pending `get_data_` callback ends a rest between pipelined
+  // measurements, rather than reading data. Only used on the worker.
+  bool resting_ = false;
+
+  GasScan scan_;
+  pw::Function<void(const GasScan&)> scan_callback_;
+  uint32_t num_measurements_ = 0;
+
+  // Updated from `i2c_stats()` when logged.
+  PW_METRIC_GROUP(i2c_metrics_, "bme688 i2c");
+  PW_METRIC(i2c_metrics_, i2c_transactions_, "transactions", 0u);
+  PW_METRIC(i2c_metrics_, i2c_bytes_, "bytes", 0u);
+  PW_METRIC(i2c_metrics_, i2c_bytes_saved_, "bytes saved", 0u);
+  PW_METRIC(i2c_metrics_,
+            bytes_per_measurement_,
+            "bytes per measurement",
+            0.f);
+  PW_METRIC(i2c_metrics_,
+            bytes_saved_per_measurement_,
+            "bytes saved per measurement",
+            0.f);
+
+  // Set once the sensor is being destroyed, after which the timer no longer
+  // gives the worker anything to do.
+  pw::sync::InterruptSpinLock stop_lock_;
+  bool stopping_ PW_GUARDED_BY(stop_lock_) = false;
+
+  // Declared last, so that it is destroyed first. Destroying the timer waits
+  // for a callback in progress.
   pw::chrono::SystemTimer get_data_;
-  pw::sync::InterruptSpinLock lock_;
-  pw::sync::ThreadNotification* notification_ PW_GUARDED_BY(lock_) = nullptr;
 };
 
 }  // namespace sense
@@ -0,0 +1,127 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/bme688_register_cache.h"
+
+#include <chrono>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_status/try.h"
+
+namespace sense {
+namespace {
+
+constexpr uint8_t kRegCtrlMeas = 0x74;
+constexpr uint8_t kRegSoftReset = 0xe0;
+constexpr uint8_t kModeMask = 0x03;
+
+constexpr auto kTimeout =
+    pw::chrono::SystemClock::for_at_least(std::chrono::seconds(1));
+
+}  // namespace
+
+pw::Status Bme688RegisterCache::Write(uint8_t reg_address,
+                                      pw::span<const uint8_t> data) {
+  ++stats_.uncached_transactions;
+  stats_.uncached_bytes += 1 + data.size();
+  if (data.empty()) {
+    return pw::Status::InvalidArgument();
+  }
+
+  pw::Status status = QueueWrite(reg_address, data[0]);
+  for (size_t i = 1; i + 1 < data.size() && status.ok(); i += 2) {
+    status = QueueWrite(data[i], data[i + 1]);
+  }
+  return status;
+}
+
+pw::Status Bme688RegisterCache::Read(uint8_t reg_address,
+                                     pw::span<uint8_t> data) {
+  ++stats_.uncached_transactions;
+  stats_.uncached_bytes += 1 + data.size();
+
+  bool cached = true;
+  for (size_t i = 0; i < data.size() && cached; ++i) {
+    auto address = static_cast<uint8_t>(reg_address + i);
+    cached = IsShadowed(address) && address != kRegCtrlMeas &&
+             known_[address - kFirstShadowed];
+  }
+  if (cached) {
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = values_[reg_address + i - kFirstShadowed];
+    }
+    return pw::OkStatus();
+  }
+
+  PW_TRY(Flush());
+  ++stats_.transactions;
+  stats_.bytes += 1 + data.size();
+  std::byte tx = static_cast<std::byte>(reg_address);
+  PW_TRY(device_.WriteReadFor(
+      pw::ConstByteSpan(&tx, 1), pw::as_writable_bytes(data), kTimeout));
+  for (size_t i = 0; i < data.size(); ++i) {
+    Shadow(static_cast<uint8_t>(reg_address + i), data[i]);
+  }
+  return pw::OkStatus();
+}
+
+pw::Status Bme688RegisterCache::Flush() {
+  if (queued_size_ == 0) {
+    return pw::OkStatus();
+  }
+  ++stats_.transactions;
+  stats_.bytes += queued_size_;
+  pw::Status status = device_.WriteFor(
+      pw::ConstByteSpan(queued_.data(), queued_size_), kTimeout);
+  queued_size_ = 0;
+  if (!status.ok()) {
+    // Some of the writes may not have landed.
+    Invalidate();
+  }
+  return status;
+}
+
+pw::Status Bme688RegisterCache::QueueWrite(uint8_t reg_address,
+                                           uint8_t value) {
+  if (IsShadowed(reg_address) && known_[reg_address - kFirstShadowed] &&
+      values_[reg_address - kFirstShadowed] == value) {
+    // Rewriting ctrl_meas in sleep mode is the only case that can be dropped,
+    // since the sensor only ever returns to sleep mode by itself.
+    if (reg_address != kRegCtrlMeas || (value & kModeMask) == 0) {
+      return pw::OkStatus();
+    }
+  }
+
+  if (queued_size_ == queued_.size()) {
+    PW_TRY(Flush());
+  }
+  queued_[queued_size_++] = static_cast<std::byte>(reg_address);
+  queued_[queued_size_++] = static_cast<std::byte>(value);
+
+  if (reg_address == kRegSoftReset) {
+    Invalidate();
+    return Flush();
+  }
+  Shadow(reg_address, value);
+  return reg_address == kRegCtrlMeas ? Flush() : pw::OkStatus();
+}
+
+void Bme688RegisterCache::Shadow(uint8_t reg_address, uint8_t value) {
+  if (IsShadowed(reg_address)) {
+    values_[reg_address - kFirstShadowed] = value;
+    known_[reg_address - kFirstShadowed] = true;
+  }
+}
+
+}  // namespace sense
@@ -0,0 +1,98 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "pw_bytes/span.h"
+#include "pw_i2c/address.h"
+#include "pw_i2c/device.h"
+#include "pw_i2c/initiator.h"
+#include "pw_span/span.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Shadows the BME688's configuration registers to reduce I2C traffic.
+///
+/// Sits under the bme68x library's read and write callbacks. Writes of values
+/// the sensor already holds are dropped, and the rest are queued and sent as
+/// a single transaction of address and value pairs before the next read from
+/// the sensor. Reads of shadowed registers whose values are known are served
+/// from memory.
+///
+/// Only registers that the sensor never changes by itself are shadowed, with
+/// the exception of `ctrl_meas`, whose mode bits clear when a forced
+/// conversion completes. It is always read from the sensor, and writes to it
+/// are sent immediately, since they start and stop conversions.
+class Bme688RegisterCache {
+ public:
+  /// I2C traffic sent through the cache, and the traffic the same calls would
+  /// have needed without it.
+  struct Stats {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t uncached_transactions;
+    uint32_t uncached_bytes;
+
+    uint32_t bytes_saved() const { return uncached_bytes - bytes; }
+  };
+
+  Bme688RegisterCache(pw::i2c::Initiator& initiator, pw::i2c::Address address)
+      : device_(initiator, address) {}
+
+  /// Writes registers, as requested by the bme68x write callback.
+  ///
+  /// `data` holds the value for `reg_address`, followed by any further pairs
+  /// of register addresses and values.
+  pw::Status Write(uint8_t reg_address, pw::span<const uint8_t> data);
+
+  /// Reads consecutive registers, as requested by the bme68x read callback.
+  pw::Status Read(uint8_t reg_address, pw::span<uint8_t> data);
+
+  /// Sends any queued writes.
+  pw::Status Flush();
+
+  /// Forgets the shadowed values, e.g. after a reset.
+  void Invalidate() { known_.fill(false); }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  static constexpr uint8_t kFirstShadowed = 0x50;  // idac_heat_0
+  static constexpr uint8_t kLastShadowed = 0x75;   // config
+  static constexpr size_t kNumShadowed = kLastShadowed - kFirstShadowed + 1;
+  static constexpr size_t kMaxQueuedWrites = 16;
+
+  static constexpr bool IsShadowed(uint8_t reg_address) {
+    return reg_address >= kFirstShadowed && reg_address <= kLastShadowed;
+  }
+
+  /// Queues a write unless the register already holds the value.
+  pw::Status QueueWrite(uint8_t reg_address, uint8_t value);
+
+  /// Records the value of a register, if it is shadowed.
+  void Shadow(uint8_t reg_address, uint8_t value);
+
+  pw::i2c::Device device_;
+  std::array<uint8_t, kNumShadowed> values_{};
+  std::array<bool, kNumShadowed> known_{};
+  std::array<std::byte, 2 * kMaxQueuedWrites> queued_;
+  size_t queued_size_ = 0;
+  Stats stats_ = {};
+};
+
+}  // namespace sense
@@ -0,0 +1,183 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/bme688_register_cache.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "device/bme688_simulator.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+// Test fixtures.
+
+class Bme688RegisterCacheTest : public ::testing::Test {
+ protected:
+  static constexpr uint8_t kRegGasWait0 = 0x64;
+  static constexpr uint8_t kRegCtrlGas1 = 0x71;
+  static constexpr uint8_t kRegCtrlHum = 0x72;
+  static constexpr uint8_t kRegCtrlMeas = 0x74;
+  static constexpr uint8_t kRegChipId = 0xd0;
+  static constexpr uint8_t kRegSoftReset = 0xe0;
+
+  pw::Status Write(uint8_t reg_address, uint8_t value) {
+    std::array<uint8_t, 1> data = {value};
+    return cache_.Write(reg_address, data);
+  }
+
+  /// Reads a register directly from the simulator, bypassing the cache.
+  uint8_t ReadSensor(uint8_t reg_address) {
+    std::array<std::byte, 1> tx = {static_cast<std::byte>(reg_address)};
+    std::array<std::byte, 1> rx = {};
+    pw::i2c::Initiator& initiator = simulator_;
+    EXPECT_EQ(initiator.WriteReadFor(Bme688Simulator::kAddress,
+                                     tx,
+                                     rx,
+                                     pw::chrono::SystemClock::for_at_least(
+                                         std::chrono::seconds(1))),
+              pw::OkStatus());
+    return static_cast<uint8_t>(rx[0]);
+  }
+
+  uint32_t transactions() const { return simulator_.counters().transactions; }
+
+  Bme688Simulator simulator_;
+  Bme688RegisterCache cache_{simulator_, Bme688Simulator::kAddress};
+};
+
+// Unit tests.
+
+TEST_F(Bme688RegisterCacheTest, QueuesWritesUntilRead) {
+  ASSERT_EQ(Write(kRegGasWait0, 0x59), pw::OkStatus());
+  ASSERT_EQ(Write(kRegCtrlGas1, 0x20), pw::OkStatus());
+  EXPECT_EQ(transactions(), 0u);
+
+  // Both writes are sent together before the read.
+  std::array<uint8_t, 1> chip_id;
+  ASSERT_EQ(cache_.Read(kRegChipId, chip_id), pw::OkStatus());
+  EXPECT_EQ(transactions(), 2u);
+  EXPECT_EQ(simulator_.counters().bytes_written, 5u);
+  EXPECT_EQ(ReadSensor(kRegGasWait0), 0x59);
+  EXPECT_EQ(ReadSensor(kRegCtrlGas1), 0x20);
+}
+
+TEST_F(Bme688RegisterCacheTest, CombinesInterleavedWrites) {
+  std::array<uint8_t, 3> data = {0x59, kRegCtrlGas1, 0x20};
+  ASSERT_EQ(cache_.Write(kRegGasWait0, data), pw::OkStatus());
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+
+  EXPECT_EQ(transactions(), 1u);
+  EXPECT_EQ(simulator_.counters().bytes_written, 6u);
+  EXPECT_EQ(ReadSensor(kRegCtrlHum), 0x05);
+}
+
+TEST_F(Bme688RegisterCacheTest, WritesFullHeaterProfile) {
+  // Every heater resistance and wait time of a ten-step profile, written
+  // interleaved. This is more than the cache can queue at once.
+  static constexpr uint8_t kRegResHeat0 = 0x5a;
+  static constexpr size_t kNumSteps = 10;
+  std::array<uint8_t, 4 * kNumSteps - 1> data;
+  for (size_t i = 0; i < 2 * kNumSteps; ++i) {
+    auto reg_address =
+        static_cast<uint8_t>(i < kNumSteps
+                                 ? kRegResHeat0 + i
+                                 : kRegGasWait0 + i - kNumSteps);
+    if (i != 0) {
+      data[2 * i - 1] = reg_address;
+    }
+    data[2 * i] = static_cast<uint8_t>(0x40 + i);
+  }
+  ASSERT_EQ(cache_.Write(kRegResHeat0, data), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+
+  for (size_t i = 0; i < kNumSteps; ++i) {
+    EXPECT_EQ(ReadSensor(static_cast<uint8_t>(kRegResHeat0 + i)), 0x40 + i);
+    EXPECT_EQ(ReadSensor(static_cast<uint8_t>(kRegGasWait0 + i)),
+              0x40 + kNumSteps + i);
+  }
+}
+
+TEST_F(Bme688RegisterCacheTest, ElidesUnchangedWrites) {
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+  EXPECT_EQ(transactions(), 1u);
+
+  const Bme688RegisterCache::Stats& stats = cache_.stats();
+  EXPECT_EQ(stats.uncached_transactions, 2u);
+  EXPECT_EQ(stats.uncached_bytes, 4u);
+  EXPECT_EQ(stats.bytes, 2u);
+  EXPECT_EQ(stats.bytes_saved(), 2u);
+}
+
+TEST_F(Bme688RegisterCacheTest, ServesShadowedReads) {
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+
+  std::array<uint8_t, 1> value;
+  ASSERT_EQ(cache_.Read(kRegCtrlHum, value), pw::OkStatus());
+  EXPECT_EQ(value[0], 0x05);
+  EXPECT_EQ(transactions(), 1u);
+
+  // Unknown values are read once, then shadowed.
+  ASSERT_EQ(cache_.Read(kRegGasWait0, value), pw::OkStatus());
+  ASSERT_EQ(cache_.Read(kRegGasWait0, value), pw::OkStatus());
+  EXPECT_EQ(transactions(), 2u);
+}
+
+TEST_F(Bme688RegisterCacheTest, AlwaysSendsModeChanges) {
+  constexpr uint8_t kForced = 0x01;
+  ASSERT_EQ(Write(kRegCtrlMeas, kForced), pw::OkStatus());
+  EXPECT_EQ(transactions(), 1u);
+  ASSERT_EQ(Write(kRegCtrlMeas, kForced), pw::OkStatus());
+  EXPECT_EQ(transactions(), 2u);
+
+  // The mode may have changed since, so reads aren't served from the shadow.
+  std::array<uint8_t, 1> value;
+  ASSERT_EQ(cache_.Read(kRegCtrlMeas, value), pw::OkStatus());
+  EXPECT_EQ(transactions(), 3u);
+}
+
+TEST_F(Bme688RegisterCacheTest, SoftResetForgetsValues) {
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(Write(kRegSoftReset, 0xb6), pw::OkStatus());
+  EXPECT_EQ(transactions(), 1u);
+  EXPECT_EQ(ReadSensor(kRegCtrlHum), 0x00);
+
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+  EXPECT_EQ(ReadSensor(kRegCtrlHum), 0x05);
+}
+
+TEST_F(Bme688RegisterCacheTest, FailedWriteForgetsValues) {
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  simulator_.set_unresponsive(true);
+  EXPECT_EQ(cache_.Flush(), pw::Status::Unavailable());
+  simulator_.set_unresponsive(false);
+
+  ASSERT_EQ(Write(kRegCtrlHum, 0x05), pw::OkStatus());
+  ASSERT_EQ(cache_.Flush(), pw::OkStatus());
+  EXPECT_EQ(ReadSensor(kRegCtrlHum), 0x05);
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,353 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/bme688_simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+namespace sense {
+namespace {
+
+// Register map. The data fields are each `kFieldLength` bytes long.
+constexpr uint8_t kRegField0 = 0x1d;
+constexpr uint8_t kFieldLength = 17;
+constexpr uint8_t kRegGasWait0 = 0x64;
+constexpr uint8_t kRegGasWaitShared = 0x6e;
+constexpr uint8_t kRegCtrlGas1 = 0x71;
+constexpr uint8_t kRegCtrlHum = 0x72;
+constexpr uint8_t kRegCtrlMeas = 0x74;
+constexpr uint8_t kRegChipId = 0xd0;
+constexpr uint8_t kRegSoftReset = 0xe0;
+constexpr uint8_t kRegVariantId = 0xf0;
+
+constexpr uint8_t kChipId = 0x61;
+constexpr uint8_t kVariantGasHigh = 0x01;
+constexpr uint8_t kSoftResetCommand = 0xb6;
+
+// Offsets within a data field.
+constexpr size_t kFieldStatus = 0;
+constexpr size_t kFieldMeasIndex = 1;
+constexpr size_t kFieldPressure = 2;
+constexpr size_t kFieldTemperature = 5;
+constexpr size_t kFieldHumidity = 8;
+constexpr size_t kFieldGasHigh = 15;
+
+constexpr uint8_t kNewData = 0x80;
+constexpr uint8_t kGasValid = 0x20;
+constexpr uint8_t kHeatStable = 0x10;
+
+constexpr uint8_t kModeMask = 0x03;
+constexpr uint8_t kSleepMode = 0;
+constexpr uint8_t kForcedMode = 1;
+constexpr uint8_t kParallelMode = 2;
+
+// Calibration coefficients. Only these are non-zero, which removes the
+// non-linear terms from compensation.
+constexpr uint16_t kParT1 = 26000;
+constexpr uint16_t kParT2 = 26000;
+constexpr uint16_t kParP1 = 36000;
+constexpr uint16_t kParH1 = 700;
+constexpr uint16_t kParH2 = 1000;
+
+/// Returns the heater duration encoded in a gas wait register, in units of
+/// the register's step size.
+uint32_t DecodeGasWait(uint8_t value) {
+  return static_cast<uint32_t>(value & 0x3f) << (2 * (value >> 6));
+}
+
+}  // namespace
+
+Bme688Simulator::Bme688Simulator() {
+  std::lock_guard lock(lock_);
+  Reset();
+}
+
+void Bme688Simulator::set_temperature(float celsius) {
+  std::lock_guard lock(lock_);
+  temperature_ = celsius;
+}
+
+void Bme688Simulator::set_pressure(float pascals) {
+  std::lock_guard lock(lock_);
+  pressure_ = pascals;
+}
+
+void Bme688Simulator::set_humidity(float percent) {
+  std::lock_guard lock(lock_);
+  humidity_ = percent;
+}
+
+void Bme688Simulator::set_gas_resistance(float ohms) {
+  std::lock_guard lock(lock_);
+  gas_resistance_ = ohms;
+}
+
+void Bme688Simulator::set_noise(bool enabled) {
+  std::lock_guard lock(lock_);
+  noise_ = enabled;
+}
+
+void Bme688Simulator::set_unresponsive(bool unresponsive) {
+  std::lock_guard lock(lock_);
+  unresponsive_ = unresponsive;
+}
+
+Bme688Simulator::Counters Bme688Simulator::counters() const {
+  std::lock_guard lock(lock_);
+  return counters_;
+}
+
+void Bme688Simulator::ResetCounters() {
+  std::lock_guard lock(lock_);
+  counters_ = {};
+  last_conversion_end_.reset();
+  min_conversion_interval_ = Clock::duration::max();
+}
+
+uint32_t Bme688Simulator::num_conversions() const {
+  std::lock_guard lock(lock_);
+  return num_conversions_;
+}
+
+bool Bme688Simulator::WaitForConversions(uint32_t count,
+                                         Clock::duration timeout) {
+  Clock::time_point deadline = Clock::TimePointAfterAtLeast(timeout);
+  while (num_conversions() < count) {
+    if (!conversion_completed_.try_acquire_until(deadline)) {
+      return num_conversions() >= count;
+    }
+  }
+  return true;
+}
+
+Bme688Simulator::Clock::duration Bme688Simulator::min_conversion_interval()
+    const {
+  std::lock_guard lock(lock_);
+  return min_conversion_interval_;
+}
+
+pw::Status Bme688Simulator::DoWriteReadFor(pw::i2c::Address device_address,
+                                           pw::ConstByteSpan tx_buffer,
+                                           pw::ByteSpan rx_buffer,
+                                           Clock::duration) {
+  std::lock_guard lock(lock_);
+  if (unresponsive_ ||
+      device_address.GetSevenBit() != kAddress.GetSevenBit()) {
+    return pw::Status::Unavailable();
+  }
+  ++counters_.transactions;
+  counters_.bytes_written += tx_buffer.size();
+  counters_.bytes_read += rx_buffer.size();
+
+  AdvanceTo(Clock::now());
+  if (!tx_buffer.empty()) {
+    Write(tx_buffer);
+  }
+  if (!rx_buffer.empty()) {
+    Read(rx_buffer);
+  }
+  return pw::OkStatus();
+}
+
+void Bme688Simulator::Reset() {
+  registers_.fill(0);
+  registers_[kRegChipId] = kChipId;
+  registers_[kRegVariantId] = kVariantGasHigh;
+
+  registers_[0x8a] = kParT2 & 0xff;
+  registers_[0x8b] = kParT2 >> 8;
+  registers_[0x8e] = kParP1 & 0xff;
+  registers_[0x8f] = kParP1 >> 8;
+  registers_[0xe1] = static_cast<uint8_t>(kParH2 >> 4);
+  registers_[0xe2] =
+      static_cast<uint8_t>(((kParH2 & 0xf) << 4) | (kParH1 & 0xf));
+  registers_[0xe3] = static_cast<uint8_t>(kParH1 >> 4);
+  registers_[0xe9] = kParT1 & 0xff;
+  registers_[0xea] = kParT1 >> 8;
+
+  address_ = 0;
+  mode_ = kSleepMode;
+  step_ = 0;
+  field_ = 0;
+  meas_index_ = 0;
+}
+
+void Bme688Simulator::Write(pw::ConstByteSpan tx_buffer) {
+  // A lone address sets up a read. Otherwise, the buffer holds pairs of
+  // register addresses and values.
+  for (size_t i = 0; i < tx_buffer.size(); i += 2) {
+    address_ = static_cast<uint8_t>(tx_buffer[i]);
+    if (i + 1 == tx_buffer.size()) {
+      break;
+    }
+    auto value = static_cast<uint8_t>(tx_buffer[i + 1]);
+    if (address_ == kRegSoftReset) {
+      if (value == kSoftResetCommand) {
+        Reset();
+      }
+      continue;
+    }
+    if (address_ == kRegChipId || address_ == kRegVariantId ||
+        address_ < kRegField0 + kNumFields * kFieldLength) {
+      continue;  // Read-only.
+    }
+    registers_[address_] = value;
+    if (address_ == kRegCtrlMeas) {
+      StartConversions(Clock::now());
+    }
+  }
+}
+
+void Bme688Simulator::Read(pw::ByteSpan rx_buffer) {
+  for (std::byte& byte : rx_buffer) {
+    byte = static_cast<std::byte>(registers_[address_]);
+
+    // New data flags are cleared once read.
+    if (address_ >= kRegField0 &&
+        address_ < kRegField0 + kNumFields * kFieldLength &&
+        (address_ - kRegField0) % kFieldLength == kFieldStatus) {
+      registers_[address_] &= static_cast<uint8_t>(~kNewData);
+    }
+    ++address_;
+  }
+}
+
+void Bme688Simulator::StartConversions(Clock::time_point now) {
+  mode_ = registers_[kRegCtrlMeas] & kModeMask;
+  step_ = 0;
+  if (mode_ == kForcedMode) {
+    field_ = 0;
+  }
+  if (mode_ != kSleepMode) {
+    step_end_ = now + StepDuration(step_);
+  }
+}
+
+void Bme688Simulator::AdvanceTo(Clock::time_point now) {
+  while (mode_ != kSleepMode && now >= step_end_) {
+    WriteField(step_);
+    ++num_conversions_;
+    if (last_conversion_end_.has_value()) {
+      min_conversion_interval_ =
+          std::min(min_conversion_interval_, step_end_ - *last_conversion_end_);
+    }
+    last_conversion_end_ = step_end_;
+    conversion_completed_.release();
+    if (mode_ == kForcedMode) {
+      // Forced conversions return to sleep once complete.
+      mode_ = kSleepMode;
+      registers_[kRegCtrlMeas] &= static_cast<uint8_t>(~kModeMask);
+      return;
+    }
+    step_ = (step_ + 1) % NumSteps();
+    step_end_ += StepDuration(step_);
+  }
+}
+
+Bme688Simulator::Clock::duration Bme688Simulator::StepDuration(
+    size_t step) const {
+  // Matches the durations used by `bme68x_get_meas_dur`.
+  static constexpr uint32_t kOversamplingCycles[] = {0, 1, 2, 4, 8, 16};
+  auto cycles = [](uint8_t oversampling) {
+    return kOversamplingCycles[std::min<size_t>(oversampling, 5)];
+  };
+  uint8_t ctrl_meas = registers_[kRegCtrlMeas];
+  uint32_t measure_us = (cycles(ctrl_meas >> 5) +
+                         cycles((ctrl_meas >> 2) & 0x7) +
+                         cycles(registers_[kRegCtrlHum] & 0x7)) *
+                        1963;
+  measure_us += 477 * 4 + 477 * 5;
+
+  uint8_t gas_wait = registers_[kRegGasWait0 + step];
+  uint32_t duration_us;
+  if (mode_ == kParallelMode) {
+    // Each step lasts a number of cycles, which heat for a shared duration in
+    // steps of 477 us.
+    uint32_t heat_us = DecodeGasWait(registers_[kRegGasWaitShared]) * 477;
+    duration_us = std::max<uint32_t>(gas_wait, 1) * (measure_us + heat_us);
+  } else {
+    duration_us = measure_us + 1000 + DecodeGasWait(gas_wait) * 1000;
+  }
+  return std::chrono::microseconds(duration_us);
+}
+
+size_t Bme688Simulator::NumSteps() const {
+  size_t num_steps = registers_[kRegCtrlGas1] & 0xf;
+  return std::clamp<size_t>(num_steps, 1, kMaxSteps);
+}
+
+void Bme688Simulator::WriteField(size_t step) {
+  uint8_t* field = &registers_[kRegField0 + field_ * kFieldLength];
+  if (mode_ != kForcedMode) {
+    field_ = (field_ + 1) % kNumFields;
+  }
+
+  // Invert the linear compensation formulas to find the raw readings.
+  float temperature = temperature_ + 0.05f * Noise();
+  float pressure = pressure_ + 5.f * Noise();
+  float humidity = humidity_ + 0.2f * Noise();
+  auto temperature_adc = static_cast<uint32_t>(std::lround(
+      16384.f * (temperature * 5120.f / kParT2 + kParT1 / 1024.f)));
+  auto pressure_adc = static_cast<uint32_t>(
+      std::lround(1048576.f - pressure * kParP1 / 6250.f));
+  auto humidity_adc = static_cast<uint16_t>(
+      std::lround(kParH1 * 16.f + humidity * 262144.f / kParH2));
+
+  field[kFieldStatus] = static_cast<uint8_t>(kNewData | (step & 0xf));
+  field[kFieldMeasIndex] = meas_index_++;
+  for (auto [offset, adc] : {std::pair(kFieldPressure, pressure_adc),
+                             std::pair(kFieldTemperature, temperature_adc)}) {
+    field[offset] = static_cast<uint8_t>(adc >> 12);
+    field[offset + 1] = static_cast<uint8_t>(adc >> 4);
+    field[offset + 2] = static_cast<uint8_t>(adc << 4);
+  }
+  field[kFieldHumidity] = static_cast<uint8_t>(humidity_adc >> 8);
+  field[kFieldHumidity + 1] = static_cast<uint8_t>(humidity_adc);
+
+  field[kFieldGasHigh] = 0;
+  field[kFieldGasHigh + 1] = 0;
+  if ((registers_[kRegCtrlGas1] & 0x30) == 0) {
+    return;  // Gas measurements are disabled.
+  }
+
+  // Find the smallest range that can represent the resistance.
+  float ohms = gas_resistance_ * std::pow(0.9f, static_cast<float>(step)) *
+               (1.f + 0.01f * Noise());
+  for (uint8_t range = 0; range < 16; ++range) {
+    float scale = 1e6f * static_cast<float>(262144u >> range);
+    long gas_adc = std::lround(512.f + (scale / ohms - 4096.f) / 3.f);
+    if (gas_adc >= 0 && gas_adc <= 1023) {
+      field[kFieldGasHigh] = static_cast<uint8_t>(gas_adc >> 2);
+      field[kFieldGasHigh + 1] = static_cast<uint8_t>(
+          ((gas_adc & 0x3) << 6) | kGasValid | kHeatStable | range);
+      return;
+    }
+  }
+}
+
+float Bme688Simulator::Noise() {
+  if (!noise_) {
+    return 0.f;
+  }
+  noise_state_ ^= noise_state_ << 13;
+  noise_state_ ^= noise_state_ >> 17;
+  noise_state_ ^= noise_state_ << 5;
+  return static_cast<float>(noise_state_) / 2147483648.f - 1.f;
+}
+
+}  // namespace sense
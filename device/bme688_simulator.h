@@ -0,0 +1,161 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_i2c/address.h"
+#include "pw_i2c/initiator.h"
+#include "pw_status/status.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+#include "pw_sync/timed_thread_notification.h"
+
+namespace sense {
+
+/// Simulates a BME688 at the register level, behind an I2C initiator.
+///
+/// This lets the real `Bme688` driver and the Bosch bme68x library run on
+/// host. Forced, sequential and parallel conversions complete after the same
+/// delays as on the sensor, and write their results to the data fields with a
+/// little noise. Every transaction is counted, so the traffic needed for each
+/// measurement can be measured.
+///
+/// The calibration coefficients are chosen so that the bme68x compensation
+/// formulas are linear, which lets the simulator produce raw readings for
+/// exact environmental conditions.
+class Bme688Simulator : public pw::i2c::Initiator {
+ public:
+  static constexpr pw::i2c::Address kAddress =
+      pw::i2c::Address::SevenBit<0x77>();
+
+  /// Default conditions. Pressure is in pascals, as reported by the bme68x
+  /// library.
+  static constexpr float kDefaultTemperature = 20.f;
+  static constexpr float kDefaultPressure = 100000.f;
+  static constexpr float kDefaultHumidity = 40.f;
+  static constexpr float kDefaultGasResistance = 50000.f;
+
+  struct Counters {
+    uint32_t transactions;
+    uint32_t bytes_written;
+    uint32_t bytes_read;
+  };
+
+  Bme688Simulator();
+
+  /// Sets the conditions reported by subsequent conversions.
+  void set_temperature(float celsius) PW_LOCKS_EXCLUDED(lock_);
+  void set_pressure(float pascals) PW_LOCKS_EXCLUDED(lock_);
+  void set_humidity(float percent) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Sets the gas resistance measured at the first heater step. Each later
+  /// step of a profile reads 10% lower than the one before.
+  void set_gas_resistance(float ohms) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Enables or disables noise on the reported conditions. Enabled by default.
+  void set_noise(bool enabled) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Makes every transaction fail as though the sensor did not acknowledge.
+  void set_unresponsive(bool unresponsive) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the traffic seen since construction or `ResetCounters`.
+  Counters counters() const PW_LOCKS_EXCLUDED(lock_);
+  void ResetCounters() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of conversions completed, as of the last transaction.
+  uint32_t num_conversions() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Waits until `num_conversions` reaches `count`, or `timeout` passes.
+  /// Returns whether it did. Only one thread may wait at a time.
+  bool WaitForConversions(uint32_t count,
+                          pw::chrono::SystemClock::duration timeout)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the shortest time between the ends of consecutive conversions
+  /// since construction or `ResetCounters`, or the maximum duration if there
+  /// have not been two.
+  pw::chrono::SystemClock::duration min_conversion_interval() const
+      PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  using Clock = pw::chrono::SystemClock;
+
+  static constexpr size_t kNumFields = 3;
+  static constexpr size_t kMaxSteps = 10;
+
+  pw::Status DoWriteReadFor(pw::i2c::Address device_address,
+                            pw::ConstByteSpan tx_buffer,
+                            pw::ByteSpan rx_buffer,
+                            Clock::duration timeout) override
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Restores the registers to their power-on values.
+  void Reset() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Handles a write of interleaved register addresses and values.
+  void Write(pw::ConstByteSpan tx_buffer) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Reads consecutive registers from the current register address.
+  void Read(pw::ByteSpan rx_buffer) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Starts conversions in the mode set in `ctrl_meas`.
+  void StartConversions(Clock::time_point now)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Completes the conversions that have finished by `now`.
+  void AdvanceTo(Clock::time_point now) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Returns how long the conversion for a heater step takes.
+  Clock::duration StepDuration(size_t step) const
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  size_t NumSteps() const PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Writes the results of a conversion at a heater step to the next field.
+  void WriteField(size_t step) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Returns a pseudo-random value between -1 and 1, or 0 without noise.
+  float Noise() PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  mutable pw::sync::Mutex lock_;
+  std::array<uint8_t, 256> registers_ PW_GUARDED_BY(lock_);
+  uint8_t address_ PW_GUARDED_BY(lock_) = 0;
+
+  uint8_t mode_ PW_GUARDED_BY(lock_) = 0;
+  size_t step_ PW_GUARDED_BY(lock_) = 0;
+  size_t field_ PW_GUARDED_BY(lock_) = 0;
+  uint8_t meas_index_ PW_GUARDED_BY(lock_) = 0;
+  Clock::time_point step_end_ PW_GUARDED_BY(lock_);
+  uint32_t num_conversions_ PW_GUARDED_BY(lock_) = 0;
+  std::optional<Clock::time_point> last_conversion_end_ PW_GUARDED_BY(lock_);
+  Clock::duration min_conversion_interval_ PW_GUARDED_BY(lock_) =
+      Clock::duration::max();
+  pw::sync::TimedThreadNotification conversion_completed_;
+
+  float temperature_ PW_GUARDED_BY(lock_) = kDefaultTemperature;
+  float pressure_ PW_GUARDED_BY(lock_) = kDefaultPressure;
+  float humidity_ PW_GUARDED_BY(lock_) = kDefaultHumidity;
+  float gas_resistance_ PW_GUARDED_BY(lock_) = kDefaultGasResistance;
+  bool noise_ PW_GUARDED_BY(lock_) = true;
+  uint32_t noise_state_ PW_GUARDED_BY(lock_) = 0x2545f491;
+  bool unresponsive_ PW_GUARDED_BY(lock_) = false;
+  Counters counters_ PW_GUARDED_BY(lock_) = {};
+};
+
+}  // namespace sense
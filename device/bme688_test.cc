@@ -0,0 +1,269 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/bme688.h"
+
+#include <chrono>
+#include <iterator>
+#include <optional>
+
+#include "device/bme688_simulator.h"
+#include "modules/worker/test_worker.h"
+#include "pw_log/log.h"
+#include "pw_sync/timed_thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Only reached if a test fails.
+constexpr auto kTimeout = 5s;
+
+// Test fixtures.
+
+class Bme688Test : public ::testing::Test {
+ protected:
+  void SetUp() override { simulator_.set_noise(false); }
+
+  void TearDown() override {
+    // Destroying the sensor cancels any pipelined conversions, and waits for
+    // one being read to finish.
+    sensor_.reset();
+    worker_.Stop();
+  }
+
+  Bme688& CreateSensor(AirSensor::Mode mode = AirSensor::Mode::kOnDemand) {
+    sensor_.emplace(simulator_, worker_, mode);
+    return *sensor_;
+  }
+
+  /// Returns the average number of transactions per conversion over
+  /// `num_measurements` measurements.
+  float TransactionsPerConversion(Bme688& sensor, size_t num_measurements) {
+    simulator_.ResetCounters();
+    uint32_t num_conversions = simulator_.num_conversions();
+    for (size_t i = 0; i < num_measurements; ++i) {
+      // A pipelined measurement returns the last conversion, so wait for the
+      // next to be read.
+      uint32_t count = simulator_.num_conversions() + 1;
+      EXPECT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+      EXPECT_TRUE(simulator_.WaitForConversions(count, kTimeout));
+    }
+    Bme688Simulator::Counters counters = simulator_.counters();
+    num_conversions = simulator_.num_conversions() - num_conversions;
+    PW_LOG_INFO("%u conversions: %u transactions, %u bytes written, %u read",
+                static_cast<unsigned>(num_conversions),
+                static_cast<unsigned>(counters.transactions),
+                static_cast<unsigned>(counters.bytes_written),
+                static_cast<unsigned>(counters.bytes_read));
+    EXPECT_NE(num_conversions, 0u);
+    return static_cast<float>(counters.transactions) /
+           static_cast<float>(num_conversions);
+  }
+
+  TestWorker<> worker_;
+  Bme688Simulator simulator_;
+  std::optional<Bme688> sensor_;
+
+  // Released by scan callbacks, which may outlive a test's body.
+  pw::sync::TimedThreadNotification scanned_;
+};
+
+// Unit tests.
+
+TEST_F(Bme688Test, InitFailsWithoutSensor) {
+  simulator_.set_unresponsive(true);
+  EXPECT_EQ(CreateSensor().Init(), pw::Status::Unavailable());
+}
+
+TEST_F(Bme688Test, MeasureForced) {
+  simulator_.set_temperature(23.5f);
+  simulator_.set_pressure(98000.f);
+  simulator_.set_humidity(55.f);
+  simulator_.set_gas_resistance(80000.f);
+
+  Bme688& sensor = CreateSensor();
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_NEAR(sensor.temperature(), 23.5f, 0.01f);
+  EXPECT_NEAR(sensor.pressure(), 98000.f, 1.f);
+  EXPECT_NEAR(sensor.humidity(), 55.f, 0.01f);
+  EXPECT_NEAR(sensor.gas_resistance(), 80000.f, 800.f);
+  EXPECT_EQ(simulator_.num_conversions(), 1u);
+}
+
+TEST_F(Bme688Test, MeasurePipelined) {
+  Bme688& sensor = CreateSensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+
+  // Conversions continue between measurements, which return the latest. Once
+  // a second conversion has been read, the first is sure to have been used.
+  simulator_.set_temperature(30.f);
+  ASSERT_TRUE(simulator_.WaitForConversions(simulator_.num_conversions() + 2,
+                                            kTimeout));
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_NEAR(sensor.temperature(), 30.f, 0.01f);
+  EXPECT_GT(simulator_.num_conversions(), 2u);
+}
+
+TEST_F(Bme688Test, PipelineRestsBetweenSamples) {
+  Bme688& sensor = CreateSensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(sensor.SetSamplePeriod(400ms), pw::OkStatus());
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+
+  // Conversions end at least a period apart, rather than back to back.
+  simulator_.ResetCounters();
+  ASSERT_TRUE(simulator_.WaitForConversions(simulator_.num_conversions() + 3,
+                                            kTimeout));
+  EXPECT_GE(simulator_.min_conversion_interval(), 400ms);
+}
+
+TEST_F(Bme688Test, MeasureSequentialScan) {
+  static constexpr Bme688::HeaterStep kProfile[] = {
+      {.temperature_c = 320, .duration_ms = 20},
+      {.temperature_c = 100, .duration_ms = 20},
+      {.temperature_c = 100, .duration_ms = 20},
+      {.temperature_c = 100, .duration_ms = 20},
+      {.temperature_c = 200, .duration_ms = 20},
+      {.temperature_c = 200, .duration_ms = 20},
+      {.temperature_c = 200, .duration_ms = 20},
+      {.temperature_c = 320, .duration_ms = 20},
+      {.temperature_c = 320, .duration_ms = 20},
+      {.temperature_c = 320, .duration_ms = 20},
+  };
+  static_assert(std::size(kProfile) == Bme688::kMaxHeaterSteps);
+
+  Bme688& sensor = CreateSensor();
+  std::optional<GasScan> scan;
+  sensor.SetScanCallback([&scan](const GasScan& result) { scan = result; });
+  ASSERT_EQ(sensor.SetHeaterProfile(Bme688::HeaterMode::kSequential, kProfile),
+            pw::OkStatus());
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+
+  // Each step reads lower than the one before.
+  ASSERT_TRUE(scan.has_value());
+  ASSERT_EQ(scan->num_steps(), Bme688::kMaxHeaterSteps);
+  float expected = Bme688Simulator::kDefaultGasResistance;
+  for (size_t i = 0; i < scan->num_steps(); ++i) {
+    ASSERT_TRUE(scan->has_gas_resistance(i));
+    EXPECT_NEAR(scan->gas_resistance(i), expected, expected * 0.02f);
+    expected *= 0.9f;
+  }
+  EXPECT_NEAR(sensor.gas_resistance(),
+              Bme688Simulator::kDefaultGasResistance,
+              Bme688Simulator::kDefaultGasResistance * 0.02f);
+}
+
+TEST_F(Bme688Test, MeasureParallelScan) {
+  static constexpr Bme688::HeaterStep kProfile[] = {
+      {.temperature_c = 320, .duration_ms = 140},
+      {.temperature_c = 200, .duration_ms = 280},
+      {.temperature_c = 100, .duration_ms = 140},
+  };
+
+  Bme688& sensor = CreateSensor();
+  std::optional<GasScan> scan;
+  sensor.SetScanCallback([&scan](const GasScan& result) { scan = result; });
+  ASSERT_EQ(sensor.SetHeaterProfile(Bme688::HeaterMode::kParallel, kProfile),
+            pw::OkStatus());
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+
+  ASSERT_TRUE(scan.has_value());
+  ASSERT_EQ(scan->num_steps(), std::size(kProfile));
+  float expected = Bme688Simulator::kDefaultGasResistance;
+  for (size_t i = 0; i < scan->num_steps(); ++i) {
+    ASSERT_TRUE(scan->has_gas_resistance(i));
+    EXPECT_NEAR(scan->gas_resistance(i), expected, expected * 0.02f);
+    expected *= 0.9f;
+  }
+}
+
+TEST_F(Bme688Test, ChangesHeaterProfileWhilePipelined) {
+  static constexpr Bme688::HeaterStep kProfile[] = {
+      {.temperature_c = 320, .duration_ms = 20},
+      {.temperature_c = 200, .duration_ms = 20},
+      {.temperature_c = 100, .duration_ms = 20},
+  };
+
+  Bme688& sensor = CreateSensor(AirSensor::Mode::kPipelined);
+  sensor.SetScanCallback([this](const GasScan&) { scanned_.release(); });
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_FALSE(scanned_.try_acquire());
+
+  // The running forced-mode pipeline switches to scanning the new profile.
+  ASSERT_EQ(sensor.SetHeaterProfile(Bme688::HeaterMode::kSequential, kProfile),
+            pw::OkStatus());
+  EXPECT_TRUE(scanned_.try_acquire_for(kTimeout));
+}
+
+TEST_F(Bme688Test, RejectsInvalidHeaterProfiles) {
+  static constexpr Bme688::HeaterStep kTwoSteps[] = {
+      {.temperature_c = 320, .duration_ms = 100},
+      {.temperature_c = 200, .duration_ms = 100},
+  };
+
+  Bme688& sensor = CreateSensor();
+  EXPECT_EQ(sensor.SetHeaterProfile(Bme688::HeaterMode::kForced, kTwoSteps),
+            pw::Status::InvalidArgument());
+  EXPECT_EQ(sensor.SetHeaterProfile(Bme688::HeaterMode::kSequential, {}),
+            pw::Status::InvalidArgument());
+}
+
+TEST_F(Bme688Test, RegisterCacheSavesTraffic) {
+  Bme688& sensor = CreateSensor();
+  ASSERT_EQ(sensor.Init(), pw::OkStatus());
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_EQ(sensor.MeasureSync().status(), pw::OkStatus());
+  }
+
+  // The cache's accounting matches the traffic the sensor saw.
+  const Bme688RegisterCache::Stats& stats = sensor.i2c_stats();
+  Bme688Simulator::Counters counters = simulator_.counters();
+  EXPECT_EQ(stats.transactions, counters.transactions);
+  EXPECT_EQ(stats.bytes, counters.bytes_written + counters.bytes_read);
+  EXPECT_LT(stats.transactions, stats.uncached_transactions);
+  EXPECT_GT(stats.bytes_saved(), 0u);
+
+  ASSERT_EQ(sensor.num_measurements(), 5u);
+  PW_LOG_INFO("Bytes per measurement: %u, saving %u",
+              static_cast<unsigned>(stats.bytes / 5),
+              static_cast<unsigned>(stats.bytes_saved() / 5));
+}
+
+// Benchmarks the I2C traffic needed for each conversion. Pipelining skips
+// reconfiguring the heater, so it should need fewer transactions.
+TEST_F(Bme688Test, TransactionsPerConversion) {
+  Bme688& on_demand = CreateSensor();
+  ASSERT_EQ(on_demand.Init(), pw::OkStatus());
+  float on_demand_transactions = TransactionsPerConversion(on_demand, 5);
+
+  Bme688& pipelined = CreateSensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(pipelined.Init(), pw::OkStatus());
+  float pipelined_transactions = TransactionsPerConversion(pipelined, 5);
+
+  PW_LOG_INFO("Transactions per conversion: %.1f on demand, %.1f pipelined",
+              static_cast<double>(on_demand_transactions),
+              static_cast<double>(pipelined_transactions));
+  EXPECT_LT(pipelined_transactions, on_demand_transactions);
+}
+
+}  // namespace
+}  // namespace sense
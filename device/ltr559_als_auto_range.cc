@@ -0,0 +1,56 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/ltr559_als_auto_range.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace sense {
+
+bool Ltr559AlsAutoRange::Update(uint16_t channel_1, uint16_t channel_0) {
+  const uint16_t counts = std::max(channel_1, channel_0);
+  const size_t previous = index_;
+
+  if (counts > kHighCounts) {
+    for (size_t i = index_; i > 0; --i) {
+      if (Allowed(i - 1)) {
+        index_ = i - 1;
+        break;
+      }
+    }
+  } else if (counts < kLowCounts) {
+    for (size_t i = index_ + 1; i < std::size(kRanges); ++i) {
+      if (Allowed(i)) {
+        index_ = i;
+        break;
+      }
+    }
+  }
+  return index_ != previous;
+}
+
+bool Ltr559AlsAutoRange::SetMaxIntegrationTime(uint16_t max_integration_ms) {
+  max_integration_ms_ = max_integration_ms;
+  const size_t previous = index_;
+
+  // Fall back to the most sensitive allowed range that is no more sensitive
+  // than the current one, so that readings don't saturate.
+  while (index_ > 0 && !Allowed(index_)) {
+    --index_;
+  }
+  return index_ != previous;
+}
+
+}  // namespace sense
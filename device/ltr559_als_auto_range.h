@@ -0,0 +1,79 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sense {
+
+/// Chooses the LTR559 ambient light sensor's gain and integration time from
+/// its raw channel counts.
+///
+/// Ranges are ordered from least to most sensitive. Bright readings step down
+/// a range before the ADC saturates, and dim readings step up a range to keep
+/// resolution. The thresholds are far enough apart that a step in either
+/// direction can't immediately be undone by the next reading.
+class Ltr559AlsAutoRange {
+ public:
+  struct Range {
+    uint8_t gain;
+    uint16_t integration_ms;
+  };
+
+  /// Ranges, each about twice as sensitive as the last.
+  static constexpr Range kRanges[] = {
+      {.gain = 1, .integration_ms = 50},
+      {.gain = 1, .integration_ms = 100},
+      {.gain = 2, .integration_ms = 100},
+      {.gain = 4, .integration_ms = 100},
+      {.gain = 8, .integration_ms = 100},
+      {.gain = 8, .integration_ms = 200},
+      {.gain = 48, .integration_ms = 100},
+      {.gain = 96, .integration_ms = 100},
+      {.gain = 96, .integration_ms = 200},
+      {.gain = 96, .integration_ms = 400},
+  };
+
+  /// Counts above which the next reading would risk saturating.
+  static constexpr uint16_t kHighCounts = 40000;
+
+  /// Counts below which the next range up is safe. The largest step between
+  /// ranges with the same maximum integration time is 6x, which keeps readings
+  /// between the thresholds after stepping either way.
+  static constexpr uint16_t kLowCounts = 5000;
+
+  /// Starts at the sensor's default range of 1x gain for 100 ms.
+  constexpr Ltr559AlsAutoRange() = default;
+
+  const Range& range() const { return kRanges[index_]; }
+
+  /// Steps the range if the channel counts call for it. Returns whether the
+  /// range changed.
+  bool Update(uint16_t channel_1, uint16_t channel_0);
+
+  /// Limits integration to at most `max_integration_ms`, so readings update
+  /// faster. Returns whether the range changed to fit.
+  bool SetMaxIntegrationTime(uint16_t max_integration_ms);
+
+ private:
+  bool Allowed(size_t index) const {
+    return kRanges[index].integration_ms <= max_integration_ms_;
+  }
+
+  size_t index_ = 1;
+  uint16_t max_integration_ms_ = 400;
+};
+
+}  // namespace sense
@@ -0,0 +1,123 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/ltr559_als_auto_range.h"
+
+#include <cstdint>
+#include <iterator>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+constexpr uint16_t kBright = Ltr559AlsAutoRange::kHighCounts + 1;
+constexpr uint16_t kDim = Ltr559AlsAutoRange::kLowCounts - 1;
+constexpr uint16_t kModerate = 20000;
+
+float Sensitivity(const Ltr559AlsAutoRange::Range& range) {
+  return range.gain * range.integration_ms / 100.f;
+}
+
+TEST(Ltr559AlsAutoRangeTest, StartsAtSensorDefault) {
+  Ltr559AlsAutoRange auto_range;
+  EXPECT_EQ(auto_range.range().gain, 1u);
+  EXPECT_EQ(auto_range.range().integration_ms, 100u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, RangesIncreaseInSensitivity) {
+  for (size_t i = 1; i < std::size(Ltr559AlsAutoRange::kRanges); ++i) {
+    EXPECT_GT(Sensitivity(Ltr559AlsAutoRange::kRanges[i]),
+              Sensitivity(Ltr559AlsAutoRange::kRanges[i - 1]));
+  }
+}
+
+TEST(Ltr559AlsAutoRangeTest, StepsUpWhenDim) {
+  Ltr559AlsAutoRange auto_range;
+  EXPECT_TRUE(auto_range.Update(0, kDim));
+  EXPECT_EQ(auto_range.range().gain, 2u);
+  EXPECT_EQ(auto_range.range().integration_ms, 100u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, StepsDownWhenBright) {
+  Ltr559AlsAutoRange auto_range;
+  // Either channel may saturate.
+  EXPECT_TRUE(auto_range.Update(kBright, 0));
+  EXPECT_EQ(auto_range.range().gain, 1u);
+  EXPECT_EQ(auto_range.range().integration_ms, 50u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, HoldsBetweenThresholds) {
+  Ltr559AlsAutoRange auto_range;
+  ASSERT_TRUE(auto_range.Update(0, kDim));
+  EXPECT_FALSE(auto_range.Update(kModerate, kModerate));
+  EXPECT_FALSE(auto_range.Update(0, Ltr559AlsAutoRange::kLowCounts));
+  EXPECT_FALSE(auto_range.Update(0, Ltr559AlsAutoRange::kHighCounts));
+  EXPECT_EQ(auto_range.range().gain, 2u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, StopsAtEitherEnd) {
+  Ltr559AlsAutoRange auto_range;
+  while (auto_range.Update(0, kDim)) {
+  }
+  EXPECT_EQ(auto_range.range().gain, 96u);
+  EXPECT_EQ(auto_range.range().integration_ms, 400u);
+
+  while (auto_range.Update(0, kBright)) {
+  }
+  EXPECT_EQ(auto_range.range().gain, 1u);
+  EXPECT_EQ(auto_range.range().integration_ms, 50u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, ShortensIntegrationWhenLimited) {
+  Ltr559AlsAutoRange auto_range;
+  while (auto_range.Update(0, kDim)) {
+  }
+  EXPECT_TRUE(auto_range.SetMaxIntegrationTime(200));
+  EXPECT_EQ(auto_range.range().gain, 96u);
+  EXPECT_EQ(auto_range.range().integration_ms, 200u);
+
+  EXPECT_FALSE(auto_range.SetMaxIntegrationTime(200));
+}
+
+TEST(Ltr559AlsAutoRangeTest, SkipsRangesOverMaxIntegrationTime) {
+  Ltr559AlsAutoRange auto_range;
+  ASSERT_FALSE(auto_range.SetMaxIntegrationTime(100));
+  while (auto_range.Update(0, kDim)) {
+    EXPECT_LE(auto_range.range().integration_ms, 100u);
+  }
+  EXPECT_EQ(auto_range.range().gain, 96u);
+  EXPECT_EQ(auto_range.range().integration_ms, 100u);
+
+  while (auto_range.Update(0, kBright)) {
+    EXPECT_LE(auto_range.range().integration_ms, 100u);
+  }
+  EXPECT_EQ(auto_range.range().integration_ms, 50u);
+}
+
+TEST(Ltr559AlsAutoRangeTest, StepsDoNotUndoEachOther) {
+  // A reading just past either threshold, rescaled to the new range, lands
+  // between the thresholds.
+  for (size_t i = 1; i < std::size(Ltr559AlsAutoRange::kRanges); ++i) {
+    const float ratio = Sensitivity(Ltr559AlsAutoRange::kRanges[i]) /
+                        Sensitivity(Ltr559AlsAutoRange::kRanges[i - 1]);
+    EXPECT_LT(Ltr559AlsAutoRange::kLowCounts * ratio,
+              Ltr559AlsAutoRange::kHighCounts);
+    EXPECT_GT(Ltr559AlsAutoRange::kHighCounts / ratio,
+              Ltr559AlsAutoRange::kLowCounts);
+  }
+}
+
+}  // namespace
+}  // namespace sense
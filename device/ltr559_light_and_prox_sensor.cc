@@ -17,7 +17,16 @@
 
 #include "device/ltr559_light_and_prox_sensor.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+
 #include "pw_log/log.h"
+#include "pw_span/span.h"
+#include "pw_status/try.h"
 
 namespace sense {
 namespace {
@@ -27,14 +36,91 @@ namespace {
 constexpr int kChannel0Constants[] = {17743, 42785, 5926, 0};
 constexpr int kChannel1Constants[] = {-11059, 19548, -1185, 0};
 
+// Register encodings of the ambient light sensor's settings.
+struct Setting {
+  uint16_t value;
+  uint8_t bits;
+};
+
+// ALS_CONTR bits 4:2.
+constexpr Setting kGains[] = {
+    {1, 0b000},
+    {2, 0b001},
+    {4, 0b010},
+    {8, 0b011},
+    {48, 0b110},
+    {96, 0b111},
+};
+
+// ALS_MEAS_RATE bits 5:3.
+constexpr Setting kIntegrationTimes[] = {
+    {50, 0b001},
+    {100, 0b000},
+    {150, 0b100},
+    {200, 0b010},
+    {250, 0b101},
+    {300, 0b110},
+    {350, 0b111},
+    {400, 0b011},
+};
+
+// ALS_MEAS_RATE bits 2:0, in ascending order.
+constexpr Setting kMeasurementRates[] = {
+    {50, 0b000},
+    {100, 0b001},
+    {200, 0b010},
+    {500, 0b011},
+    {1000, 0b100},
+    {2000, 0b101},
+};
+
+// PS_MEAS_RATE bits 3:0, in ascending order.
+constexpr Setting kProximityMeasurementRates[] = {
+    {10, 0b1000},
+    {50, 0b0000},
+    {70, 0b0001},
+    {100, 0b0010},
+    {200, 0b0011},
+    {500, 0b0100},
+    {1000, 0b0101},
+    {2000, 0b0110},
+};
+
+// Returns the slowest of the ascending `rates` that is at least as fast as
+// `period`, or the fastest if none is.
+uint16_t RateForPeriod(pw::span<const Setting> rates,
+                       pw::chrono::SystemClock::duration period) {
+  const auto period_ms = static_cast<uint16_t>(std::min<int64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(period).count(),
+      std::numeric_limits<uint16_t>::max()));
+  uint16_t rate_ms = rates[0].value;
+  for (const Setting& rate : rates) {
+    if (rate.value <= period_ms) {
+      rate_ms = rate.value;
+    }
+  }
+  return rate_ms;
+}
+
+std::optional<uint8_t> Encode(pw::span<const Setting> settings,
+                              uint16_t value) {
+  for (const Setting& setting : settings) {
+    if (setting.value == value) {
+      return setting.bits;
+    }
+  }
+  return std::nullopt;
+}
+
+uint8_t GainBits(uint8_t gain) { return *Encode(kGains, gain) << 2; }
+
 }  // namespace
 
 Ltr559LightAndProxSensor::Ltr559LightAndProxSensor(
-    pw::i2c::Initiator& i2c_initiator,
-    pw::chrono::SystemClock::duration timeout)
-    : i2c_initiator_(i2c_initiator),
-      device_(i2c_initiator_,
-              pw::i2c::Address::SevenBit<0x23>(),
+    I2cBusScheduler::Client& client, pw::chrono::SystemClock::duration timeout)
+    : client_(client),
+      device_(client_,
+              kAddress,
               pw::endian::little,
               pw::endian::little,
               pw::i2c::RegisterAddressSize::k1Byte),
@@ -42,17 +128,346 @@ Ltr559LightAndProxSensor::Ltr559LightAndProxSensor(
 
 pw::Result<uint16_t> Ltr559LightAndProxSensor::ReadProximitySample() {
   // 11-bit samples in PS_DATA_0 (0x8D) and PS_DATA_1 (0x8E), little-endian.
-  static constexpr uint8_t kPsData0 = 0x8D;
-  PW_TRY_ASSIGN(uint16_t sample, device_.ReadRegister16(kPsData0, timeout_));
-  return sample & 0x3FFu;  // mask to the 11-bit sample
+  PW_TRY_ASSIGN(uint16_t sample,
+                device_.ReadRegister16(kPsDataAddress, timeout_));
+  return ProximitySample(sample);
 }
 
 pw::Result<float> Ltr559LightAndProxSensor::ReadLightSampleLux() {
+  PW_TRY_ASSIGN(LightChannels channels, ReadLightChannels());
+  return LightSampleLux(channels);
+}
+
+pw::Result<Ltr559LightAndProxSensor::LightChannels>
+Ltr559LightAndProxSensor::ReadLightChannels() {
   uint16_t channels_1_0_samples[2] = {};
   const auto& [channel_1, channel_0] = channels_1_0_samples;
   PW_TRY(device_.ReadRegisters16(
       kAlsDataCh1Address, channels_1_0_samples, timeout_));
+  return LightChannels{.channel_1 = channel_1, .channel_0 = channel_0};
+}
+
+pw::Result<uint8_t> Ltr559LightAndProxSensor::LightMeasRate(
+    uint8_t gain, uint16_t integration_ms, uint16_t measurement_rate_ms) {
+  const std::optional<uint8_t> gain_bits = Encode(kGains, gain);
+  const std::optional<uint8_t> integration_bits =
+      Encode(kIntegrationTimes, integration_ms);
+  const std::optional<uint8_t> rate_bits =
+      Encode(kMeasurementRates, measurement_rate_ms);
+  if (!gain_bits.has_value() || !integration_bits.has_value() ||
+      !rate_bits.has_value() || measurement_rate_ms < integration_ms) {
+    return pw::Status::InvalidArgument();
+  }
+  return static_cast<uint8_t>(*integration_bits << 3 | *rate_bits);
+}
+
+pw::Status Ltr559LightAndProxSensor::SetLightRange(
+    uint8_t gain, uint16_t integration_ms, uint16_t measurement_rate_ms) {
+  PW_TRY_ASSIGN(uint8_t meas_rate,
+                LightMeasRate(gain, integration_ms, measurement_rate_ms));
+  PW_TRY(device_.WriteRegister(
+      kAlsMeasRateAddress, static_cast<std::byte>(meas_rate), timeout_));
+  light_meas_rate_ = meas_rate;
+  light_integration_ms_ = integration_ms;
+  if (gain != light_gain_) {
+    light_gain_ = gain;
+    PW_TRY(WriteLightControl(light_active_));
+  }
+  return pw::OkStatus();
+}
+
+pw::async2::Poll<pw::Status> Ltr559LightAndProxSensor::PendSetLightRange(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    uint8_t gain,
+    uint16_t integration_ms,
+    uint16_t measurement_rate_ms) {
+  const pw::Result<uint8_t> meas_rate =
+      LightMeasRate(gain, integration_ms, measurement_rate_ms);
+  if (!meas_rate.ok()) {
+    return pw::async2::Ready(meas_rate.status());
+  }
+
+  // Each write is skipped once it has been made, so the range is set across
+  // as many polls as it takes.
+  if (light_meas_rate_ != *meas_rate) {
+    pw::async2::Poll<pw::Status> status =
+        PendWriteRegister(cx, transfer, kAlsMeasRateAddress, *meas_rate);
+    if (status.IsPending() || !status->ok()) {
+      return status;
+    }
+    light_meas_rate_ = *meas_rate;
+    light_integration_ms_ = integration_ms;
+  }
+  if (gain != light_gain_) {
+    pw::async2::Poll<pw::Status> status = PendWriteRegister(
+        cx, transfer, kAlsContrAddress, LightControl(gain, light_active_));
+    if (status.IsPending() || !status->ok()) {
+      return status;
+    }
+    light_gain_ = gain;
+  }
+  return pw::async2::Ready(pw::OkStatus());
+}
+
+pw::Status Ltr559LightAndProxSensor::SetProximityMeasurementRate(
+    uint16_t measurement_rate_ms) {
+  const std::optional<uint8_t> rate_bits =
+      Encode(kProximityMeasurementRates, measurement_rate_ms);
+  if (!rate_bits.has_value()) {
+    return pw::Status::InvalidArgument();
+  }
+  return device_.WriteRegister(
+      kPsMeasRateAddress, static_cast<std::byte>(*rate_bits), timeout_);
+}
+
+pw::async2::Poll<pw::Status>
+Ltr559LightAndProxSensor::PendSetProximityMeasurementRate(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    uint16_t measurement_rate_ms) {
+  const std::optional<uint8_t> rate_bits =
+      Encode(kProximityMeasurementRates, measurement_rate_ms);
+  if (!rate_bits.has_value()) {
+    return pw::async2::Ready(pw::Status::InvalidArgument());
+  }
+  return PendWriteRegister(cx, transfer, kPsMeasRateAddress, *rate_bits);
+}
+
+uint8_t Ltr559LightAndProxSensor::LightControl(uint8_t gain,
+                                               bool active) const {
+  return static_cast<uint8_t>(GainBits(gain) | (active ? 0x01 : 0));
+}
+
+pw::Status Ltr559LightAndProxSensor::WriteLightControl(bool active) {
+  PW_TRY(device_.WriteRegister(kAlsContrAddress,
+                               static_cast<std::byte>(
+                                   LightControl(light_gain_, active)),
+                               timeout_));
+  light_active_ = active;
+  return pw::OkStatus();
+}
+
+pw::Result<Ltr559LightAndProxSensor::Readings>
+Ltr559LightAndProxSensor::ReadAll() {
+  // The light data, status and proximity data registers are contiguous, so
+  // they are read in one go.
+  uint8_t data[kAllDataSize] = {};
+  PW_TRY(device_.ReadRegisters8(kAlsDataCh1Address, data, timeout_));
+  return DecodeReadings(data);
+}
+
+pw::async2::Poll<pw::Result<Ltr559LightAndProxSensor::Readings>>
+Ltr559LightAndProxSensor::PendReadAll(pw::async2::Context& cx,
+                                      AsyncTransfer& transfer) {
+  static_assert(sizeof(transfer.rx_) >= kAllDataSize);
+  pw::async2::Poll<pw::Status> status =
+      PendReadRegisters(cx, transfer, kAlsDataCh1Address, kAllDataSize);
+  if (status.IsPending()) {
+    return pw::async2::Pending();
+  }
+  if (!status->ok()) {
+    return pw::async2::Ready(pw::Result<Readings>(*status));
+  }
+  return pw::async2::Ready(pw::Result<Readings>(
+      DecodeReadings(pw::span(transfer.rx_.data(), kAllDataSize))));
+}
+
+pw::async2::Poll<pw::Result<uint16_t>>
+Ltr559LightAndProxSensor::PendReadProximitySample(pw::async2::Context& cx,
+                                                  AsyncTransfer& transfer) {
+  pw::async2::Poll<pw::Status> status =
+      PendReadRegisters(cx, transfer, kPsDataAddress, 2);
+  if (status.IsPending()) {
+    return pw::async2::Pending();
+  }
+  if (!status->ok()) {
+    return pw::async2::Ready(pw::Result<uint16_t>(*status));
+  }
+  return pw::async2::Ready(
+      pw::Result<uint16_t>(ProximitySample(Read16(transfer.rx_, 0))));
+}
+
+pw::async2::Poll<pw::Result<Ltr559LightAndProxSensor::LightChannels>>
+Ltr559LightAndProxSensor::PendReadLightChannels(pw::async2::Context& cx,
+                                                AsyncTransfer& transfer) {
+  pw::async2::Poll<pw::Status> status =
+      PendReadRegisters(cx, transfer, kAlsDataCh1Address, 4);
+  if (status.IsPending()) {
+    return pw::async2::Pending();
+  }
+  if (!status->ok()) {
+    return pw::async2::Ready(pw::Result<LightChannels>(*status));
+  }
+  return pw::async2::Ready(pw::Result<LightChannels>(LightChannels{
+      .channel_1 = Read16(transfer.rx_, 0),
+      .channel_0 = Read16(transfer.rx_, 2),
+  }));
+}
+
+pw::async2::Poll<pw::Status> Ltr559LightAndProxSensor::PendTransfer(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    pw::ConstByteSpan tx,
+    size_t rx_size) {
+  while (true) {
+    if (!transfer.future_.has_value()) {
+      std::copy(tx.begin(), tx.end(), transfer.tx_.begin());
+      transfer.tx_size_ = tx.size();
+      transfer.rx_size_ = rx_size;
+      transfer.future_ = client_.WriteReadAsync(
+          kAddress,
+          pw::ConstByteSpan(transfer.tx_.data(), transfer.tx_size_),
+          pw::as_writable_bytes(pw::span(transfer.rx_.data(), rx_size)),
+          timeout_);
+    }
+    pw::async2::Poll<pw::Status> status = transfer.future_->Pend(cx);
+    if (status.IsPending()) {
+      return pw::async2::Pending();
+    }
+    transfer.future_.reset();
+    if (rx_size == transfer.rx_size_ &&
+        std::equal(tx.begin(),
+                   tx.end(),
+                   transfer.tx_.begin(),
+                   transfer.tx_.begin() + transfer.tx_size_)) {
+      return status;
+    }
+    // An access abandoned part way has finished, so start the one asked for.
+  }
+}
+
+pw::async2::Poll<pw::Status> Ltr559LightAndProxSensor::PendReadRegisters(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    uint8_t address,
+    size_t size) {
+  const std::byte tx[] = {std::byte{address}};
+  return PendTransfer(cx, transfer, tx, size);
+}
+
+pw::async2::Poll<pw::Status> Ltr559LightAndProxSensor::PendWriteRegister(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    uint8_t address,
+    uint8_t value) {
+  const std::byte tx[] = {std::byte{address}, std::byte{value}};
+  return PendTransfer(cx, transfer, tx, 0);
+}
+
+pw::async2::Poll<pw::Status> Ltr559LightAndProxSensor::PendWriteRegister16(
+    pw::async2::Context& cx,
+    AsyncTransfer& transfer,
+    uint8_t address,
+    uint16_t value) {
+  const std::byte tx[] = {std::byte{address},
+                          static_cast<std::byte>(value & 0xFF),
+                          static_cast<std::byte>(value >> 8)};
+  return PendTransfer(cx, transfer, tx, 0);
+}
+
+Ltr559LightAndProxSensor::Readings Ltr559LightAndProxSensor::DecodeReadings(
+    pw::span<const uint8_t> data) const {
+  // Offsets are from ALS_DATA_CH1.
+  static constexpr size_t kChannel1 = 0;
+  static constexpr size_t kChannel0 = 2;
+  static constexpr size_t kStatus = 4;
+  static constexpr size_t kPsData = kPsDataAddress - kAlsDataCh1Address;
+  static_assert(kPsData + 2 == kAllDataSize);
+
+  // ALS_PS_STATUS flags new light data in bit 2 and proximity data in bit 0.
+  const uint8_t status = data[kStatus];
+  const LightChannels channels = {
+      .channel_1 = Read16(data, kChannel1),
+      .channel_0 = Read16(data, kChannel0),
+  };
+  return Readings{
+      .light_lux = LightSampleLux(channels),
+      .light_channels = channels,
+      .new_light = (status & 0x04u) != 0,
+      .proximity = ProximitySample(Read16(data, kPsData)),
+      .new_proximity = (status & 0x01u) != 0,
+  };
+}
+
+uint16_t Ltr559LightAndProxSensor::Read16(pw::span<const uint8_t> data,
+                                          size_t offset) {
+  // Multi-byte values are little-endian.
+  return static_cast<uint16_t>(data[offset] | (data[offset + 1] << 8));
+}
+
+pw::Status Ltr559LightAndProxSensor::SetProximityThresholds(uint16_t lower,
+                                                           uint16_t upper) {
+  PW_TRY(device_.WriteRegister16(kPsThresholdUpAddress,
+                                 std::min(upper, kMaxProximityThreshold),
+                                 timeout_));
+  PW_TRY(device_.WriteRegister16(kPsThresholdLowAddress,
+                                 std::min(lower, kMaxProximityThreshold),
+                                 timeout_));
+  PW_TRY(device_.WriteRegister(
+      kInterruptAddress, std::byte{kProximityInterrupt}, timeout_));
+  // Reading the status register clears the interrupt.
+  return device_.ReadRegister8(kAlsPsStatusAddress, timeout_).status();
+}
+
+pw::async2::Poll<pw::Status>
+Ltr559LightAndProxSensor::PendSetProximityThresholds(pw::async2::Context& cx,
+                                                     AsyncTransfer& transfer,
+                                                     uint16_t lower,
+                                                     uint16_t upper) {
+  static constexpr uint8_t kSteps = 4;
 
+  // Each transfer is skipped once it has been made, so the thresholds are set
+  // across as many polls as it takes.
+  while (transfer.step_ < kSteps) {
+    pw::async2::Poll<pw::Status> status =
+        PendProximityThresholdsStep(cx, transfer, transfer.step_, lower, upper);
+    if (status.IsPending()) {
+      return status;
+    }
+    if (!status->ok()) {
+      transfer.step_ = 0;
+      return status;
+    }
+    ++transfer.step_;
+  }
+  transfer.step_ = 0;
+  return pw::async2::Ready(pw::OkStatus());
+}
+
+pw::async2::Poll<pw::Status>
+Ltr559LightAndProxSensor::PendProximityThresholdsStep(pw::async2::Context& cx,
+                                                      AsyncTransfer& transfer,
+                                                      uint8_t step,
+                                                      uint16_t lower,
+                                                      uint16_t upper) {
+  switch (step) {
+    case 0:
+      return PendWriteRegister16(cx,
+                                 transfer,
+                                 kPsThresholdUpAddress,
+                                 std::min(upper, kMaxProximityThreshold));
+    case 1:
+      return PendWriteRegister16(cx,
+                                 transfer,
+                                 kPsThresholdLowAddress,
+                                 std::min(lower, kMaxProximityThreshold));
+    case 2:
+      return PendWriteRegister(
+          cx, transfer, kInterruptAddress, kProximityInterrupt);
+    default:
+      // Reading the status register clears the interrupt.
+      return PendReadRegisters(cx, transfer, kAlsPsStatusAddress, 1);
+  }
+}
+
+uint16_t Ltr559LightAndProxSensor::ProximitySample(uint16_t ps_data) {
+  return ps_data & 0x7FFu;  // mask to the 11-bit sample
+}
+
+float Ltr559LightAndProxSensor::LightSampleLux(
+    const LightChannels& channels) const {
+  const auto [channel_1, channel_0] = channels;
   // Calculate the lux from the two channels based on a formula from the
   // manufacturer.
   const int ratio = (channel_1 + channel_0 == 0)
@@ -60,10 +475,12 @@ pw::Result<float> Ltr559LightAndProxSensor::ReadLightSampleLux() {
                         : (channel_1 * 100 / (channel_1 + channel_0));
   const int index = ratio < 45 ? 0 : ratio < 64 ? 1 : ratio < 85 ? 2 : 3;
 
-  float lux = channel_0 * kChannel0Constants[index] -
-              channel_1 * kChannel1Constants[index];
-  lux /= (kDefaultIntegrationTimeMillis / 100);
-  lux /= kDefaultGain;
+  // Full-scale counts overflow an int when multiplied by the constants.
+  const int64_t weighted = int64_t{channel_0} * kChannel0Constants[index] -
+                           int64_t{channel_1} * kChannel1Constants[index];
+  float lux = static_cast<float>(weighted);
+  lux /= light_integration_ms_ / 100.f;
+  lux /= light_gain_;
   lux /= 10000;
   return lux;
 }
@@ -74,14 +491,294 @@ pw::Result<Ltr559LightAndProxSensor::Info> Ltr559LightAndProxSensor::ReadIds() {
   return Info{.part_id = ids[0], .manufacturer_id = ids[1]};
 }
 
-pw::Result<uint16_t> Ltr559ProxAndLightSensorImpl::DoReadProxSample() {
+pw::Status Ltr559ProxAndLightSensorImpl::DoEnableProximitySensor() {
+  PW_TRY(sensor_.EnableProximity());
+  std::lock_guard lock(lock_);
+  proximity_enabled_ = true;
+  return pw::OkStatus();
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoDisableProximitySensor() {
+  {
+    std::lock_guard lock(lock_);
+    proximity_enabled_ = false;
+  }
+  return sensor_.DisableProximity();
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoEnableLightSensor() {
+  PW_TRY(sensor_.EnableLight());
+  std::lock_guard lock(lock_);
+  light_enabled_ = true;
+  return pw::OkStatus();
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoDisableLightSensor() {
+  {
+    std::lock_guard lock(lock_);
+    light_enabled_ = false;
+    light_channels_.reset();
+  }
+  last_lux_.reset();
+  return sensor_.DisableLight();
+}
+
+pw::Result<float> Ltr559ProxAndLightSensorImpl::DoReadLightSampleLux() {
+  std::optional<Ltr559LightAndProxSensor::LightChannels> channels =
+      TakeLightChannels();
+  if (!channels.has_value()) {
+    PW_TRY_ASSIGN(channels, sensor_.ReadLightChannels());
+  }
+  return HandleLightReading(*channels);
+}
+
+pw::async2::Poll<pw::Result<float>>
+Ltr559ProxAndLightSensorImpl::DoPendLightSampleLux(pw::async2::Context& cx) {
+  if (light_range_pending_) {
+    pw::async2::Poll<pw::Status> status = PendApplyLightRange(cx);
+    if (status.IsPending()) {
+      return pw::async2::Pending();
+    }
+    if (!status->ok()) {
+      return pw::async2::Ready(pw::Result<float>(*status));
+    }
+  }
+
+  if (!light_transfer_.active()) {
+    std::optional<Ltr559LightAndProxSensor::LightChannels> channels =
+        TakeLightChannels();
+    if (channels.has_value()) {
+      return pw::async2::Ready(
+          pw::Result<float>(ConvertLightReading(*channels)));
+    }
+  }
+  pw::async2::Poll<pw::Result<Ltr559LightAndProxSensor::LightChannels>>
+      channels = sensor_.PendReadLightChannels(cx, light_transfer_);
+  if (channels.IsPending()) {
+    return pw::async2::Pending();
+  }
+  if (!channels->ok()) {
+    return pw::async2::Ready(pw::Result<float>(channels->status()));
+  }
+  return pw::async2::Ready(pw::Result<float>(ConvertLightReading(**channels)));
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoSetLightSamplePeriod(
+    pw::chrono::SystemClock::duration period) {
+  // Measure as often as the samples are read, or as close to it as the sensor
+  // can, and integrate for no longer than that so that each sample is fresh.
+  const uint16_t rate_ms = RateForPeriod(kMeasurementRates, period);
+
+  const bool range_changed = auto_range_.SetMaxIntegrationTime(rate_ms);
+  if (!range_changed && rate_ms == measurement_rate_ms_) {
+    return pw::OkStatus();
+  }
+  // Written before the next light sample is read, rather than blocking on the
+  // bus here.
+  measurement_rate_ms_ = rate_ms;
+  light_range_pending_ = true;
+  return pw::OkStatus();
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoSetProxSamplePeriod(
+    pw::chrono::SystemClock::duration period) {
+  // Measure at least as often as the samples are read, so that consecutive
+  // samples are distinct measurements rather than repeats of the last one.
+  const uint16_t rate_ms = RateForPeriod(kProximityMeasurementRates, period);
+  if (rate_ms == proximity_rate_ms_) {
+    return pw::OkStatus();
+  }
+  // Written before the next proximity sample is read, rather than blocking on
+  // the bus here.
+  proximity_rate_ms_ = rate_ms;
+  proximity_rate_pending_ = true;
+  return pw::OkStatus();
+}
+
+float Ltr559ProxAndLightSensorImpl::ConvertLightReading(
+    const Ltr559LightAndProxSensor::LightChannels& channels) {
+  // Readings integrated partly with the previous range would be misscaled, so
+  // repeat the last good sample until the new range has taken effect.
+  if (last_lux_.has_value() &&
+      pw::chrono::SystemClock::now() < light_settled_at_) {
+    return *last_lux_;
+  }
+
+  const float lux = sensor_.LightSampleLux(channels);
+  last_lux_ = lux;
+  if (auto_range_.Update(channels.channel_1, channels.channel_0)) {
+    light_range_pending_ = true;
+  }
+  return lux;
+}
+
+pw::Result<float> Ltr559ProxAndLightSensorImpl::HandleLightReading(
+    const Ltr559LightAndProxSensor::LightChannels& channels) {
+  const float lux = ConvertLightReading(channels);
+  if (light_range_pending_) {
+    PW_TRY(ApplyLightRange());
+  }
+  return lux;
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::ApplyLightRange() {
+  const Ltr559AlsAutoRange::Range& range = auto_range_.range();
+  PW_LOG_DEBUG("LTR-559 light range: %ux gain, %u ms integration",
+               static_cast<unsigned>(range.gain),
+               static_cast<unsigned>(range.integration_ms));
+  PW_TRY(sensor_.SetLightRange(
+      range.gain, range.integration_ms, measurement_rate_ms_));
+  LightRangeApplied();
+  return pw::OkStatus();
+}
+
+pw::async2::Poll<pw::Status> Ltr559ProxAndLightSensorImpl::PendApplyLightRange(
+    pw::async2::Context& cx) {
+  const Ltr559AlsAutoRange::Range& range = auto_range_.range();
+  pw::async2::Poll<pw::Status> status =
+      sensor_.PendSetLightRange(cx,
+                                light_transfer_,
+                                range.gain,
+                                range.integration_ms,
+                                measurement_rate_ms_);
+  if (status.IsPending() || !status->ok()) {
+    return status;
+  }
+  PW_LOG_DEBUG("LTR-559 light range: %ux gain, %u ms integration",
+               static_cast<unsigned>(range.gain),
+               static_cast<unsigned>(range.integration_ms));
+  LightRangeApplied();
+  return status;
+}
+
+void Ltr559ProxAndLightSensorImpl::LightRangeApplied() {
+  const Ltr559AlsAutoRange::Range& range = auto_range_.range();
+  light_settled_at_ = pw::chrono::SystemClock::now() +
+                      pw::chrono::SystemClock::for_at_least(
+                          std::chrono::milliseconds(measurement_rate_ms_ +
+                                                    range.integration_ms));
+  light_range_pending_ = false;
+}
+
+bool Ltr559ProxAndLightSensorImpl::ReadsAll() {
+  std::lock_guard lock(lock_);
+  return light_enabled_ && proximity_enabled_;
+}
+
+uint16_t Ltr559ProxAndLightSensorImpl::HandleReadings(
+    const Ltr559LightAndProxSensor::Readings& readings) {
+  std::lock_guard lock(lock_);
+  light_channels_ = readings.light_channels;
+  light_read_at_ = pw::chrono::SystemClock::now();
+  return readings.proximity;
+}
+
+std::optional<Ltr559LightAndProxSensor::LightChannels>
+Ltr559ProxAndLightSensorImpl::TakeLightChannels() {
+  std::lock_guard lock(lock_);
+  if (!light_channels_.has_value() ||
+      pw::chrono::SystemClock::now() - light_read_at_ > kMaxLightReadingAge) {
+    return std::nullopt;
+  }
+  std::optional<Ltr559LightAndProxSensor::LightChannels> channels =
+      light_channels_;
+  light_channels_.reset();
+  return channels;
+}
+
+uint16_t Ltr559ProxAndLightSensorImpl::ScaleProximitySample(
+    uint16_t raw_sample) {
   // Readings are 11-bit unsigned integers. Scale them to 16 bits.
-  PW_TRY_ASSIGN(uint16_t raw_sample, sensor_.ReadProximitySample());
   PW_LOG_DEBUG("LTR-559 sample: %4hu (0x%4hx), scaled: %5u",
                raw_sample,
                raw_sample,
                (raw_sample << 5));
-  return raw_sample << 5;
+  return static_cast<uint16_t>(raw_sample << 5);
+}
+
+pw::Result<uint16_t> Ltr559ProxAndLightSensorImpl::DoReadProxSample() {
+  if (proximity_rate_pending_) {
+    PW_TRY(sensor_.SetProximityMeasurementRate(proximity_rate_ms_));
+    proximity_rate_pending_ = false;
+  }
+
+  uint16_t raw_sample;
+  if (ReadsAll()) {
+    PW_TRY_ASSIGN(Ltr559LightAndProxSensor::Readings readings,
+                  sensor_.ReadAll());
+    raw_sample = HandleReadings(readings);
+  } else {
+    PW_TRY_ASSIGN(raw_sample, sensor_.ReadProximitySample());
+  }
+  return ScaleProximitySample(raw_sample);
+}
+
+pw::async2::Poll<pw::Result<uint16_t>>
+Ltr559ProxAndLightSensorImpl::DoPendProxSample(pw::async2::Context& cx) {
+  if (proximity_rate_pending_) {
+    pw::async2::Poll<pw::Status> status =
+        sensor_.PendSetProximityMeasurementRate(
+            cx, proximity_transfer_, proximity_rate_ms_);
+    if (status.IsPending()) {
+      return pw::async2::Pending();
+    }
+    if (!status->ok()) {
+      return pw::async2::Ready(pw::Result<uint16_t>(*status));
+    }
+    proximity_rate_pending_ = false;
+  }
+
+  // Keep to the same kind of read until it finishes.
+  if (!proximity_transfer_.active()) {
+    proximity_reads_all_ = ReadsAll();
+  }
+
+  uint16_t raw_sample;
+  if (proximity_reads_all_) {
+    pw::async2::Poll<pw::Result<Ltr559LightAndProxSensor::Readings>> readings =
+        sensor_.PendReadAll(cx, proximity_transfer_);
+    if (readings.IsPending()) {
+      return pw::async2::Pending();
+    }
+    if (!readings->ok()) {
+      return pw::async2::Ready(pw::Result<uint16_t>(readings->status()));
+    }
+    raw_sample = HandleReadings(**readings);
+  } else {
+    pw::async2::Poll<pw::Result<uint16_t>> sample =
+        sensor_.PendReadProximitySample(cx, proximity_transfer_);
+    if (sample.IsPending()) {
+      return pw::async2::Pending();
+    }
+    if (!sample->ok()) {
+      return sample;
+    }
+    raw_sample = **sample;
+  }
+  return pw::async2::Ready(
+      pw::Result<uint16_t>(ScaleProximitySample(raw_sample)));
+}
+
+pw::Status Ltr559ProxAndLightSensorImpl::DoSetInterruptThresholds(
+    uint16_t lower, uint16_t upper) {
+  const auto [raw_lower, raw_upper] = RawThresholds(lower, upper);
+  return sensor_.SetProximityThresholds(raw_lower, raw_upper);
+}
+
+pw::async2::Poll<pw::Status>
+Ltr559ProxAndLightSensorImpl::DoPendSetInterruptThresholds(
+    pw::async2::Context& cx, uint16_t lower, uint16_t upper) {
+  const auto [raw_lower, raw_upper] = RawThresholds(lower, upper);
+  return sensor_.PendSetProximityThresholds(
+      cx, thresholds_transfer_, raw_lower, raw_upper);
+}
+
+std::pair<uint16_t, uint16_t> Ltr559ProxAndLightSensorImpl::RawThresholds(
+    uint16_t lower, uint16_t upper) {
+  // Samples are scaled up from 11 bits, so round the thresholds inwards to
+  // keep interrupting for exactly the same samples.
+  return {static_cast<uint16_t>((lower + 31u) >> 5),
+          static_cast<uint16_t>(upper >> 5)};
 }
 
 }  // namespace sense
@@ -13,21 +13,35 @@
 // the License.
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <utility>
 
+#include "device/ltr559_als_auto_range.h"
+#include "modules/i2c_bus/scheduler.h"
 #include "modules/light/sensor.h"
 #include "modules/proximity/sensor.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_bytes/span.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_i2c/address.h"
 #include "pw_i2c/initiator.h"
 #include "pw_i2c/register_device.h"
 #include "pw_result/result.h"
+#include "pw_span/span.h"
 #include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
 
 namespace sense {
 
 /// Basic driver for the LTR559 ambient light and proximity sensor.
+///
+/// The sensor is reached through a client of the shared I2C bus, so that
+/// tasks can also read it without blocking, with the `Pend` methods.
 class Ltr559LightAndProxSensor {
  public:
   // Minimum delay after power on.
@@ -37,18 +51,48 @@ class Ltr559LightAndProxSensor {
   static constexpr pw::chrono::SystemClock::duration kActiveModeDelay =
       pw::chrono::SystemClock::for_at_least(std::chrono::milliseconds(10));
 
-  Ltr559LightAndProxSensor(pw::i2c::Initiator& i2c_initiator,
+  /// A register access that a task waits on without blocking. It continues
+  /// across calls to the same `Pend` method. Each task accessing the sensor
+  /// asynchronously needs its own.
+  class AsyncTransfer {
+   public:
+    AsyncTransfer() = default;
+    AsyncTransfer(const AsyncTransfer&) = delete;
+    AsyncTransfer& operator=(const AsyncTransfer&) = delete;
+
+    /// Whether an access is in progress.
+    bool active() const { return future_.has_value(); }
+
+   private:
+    friend class Ltr559LightAndProxSensor;
+
+    // A register address, and up to two bytes to write to it.
+    std::array<std::byte, 3> tx_;
+    size_t tx_size_ = 0;
+    // Up to all of the data registers.
+    std::array<uint8_t, 7> rx_;
+    size_t rx_size_ = 0;
+    std::optional<I2cBusScheduler::TransferFuture> future_;
+    // How many transfers of an access made of several are done.
+    uint8_t step_ = 0;
+  };
+
+  Ltr559LightAndProxSensor(I2cBusScheduler::Client& client,
                            pw::chrono::SystemClock::duration timeout =
                                std::chrono::milliseconds(100));
 
   /// Enables the ambient light sensor.
-  pw::Status EnableLight() {
-    return device_.WriteRegister(kAlsContrAddress, std::byte{0x01}, timeout_);
-  }
+  pw::Status EnableLight() { return WriteLightControl(true); }
 
-  pw::Status DisableLight() {
-    return device_.WriteRegister(kAlsContrAddress, std::byte{0}, timeout_);
-  }
+  pw::Status DisableLight() { return WriteLightControl(false); }
+
+  /// Sets the ambient light sensor's gain, integration time, and how often it
+  /// measures. The measurement rate must be at least the integration time.
+  ///
+  /// Returns INVALID_ARGUMENT for values the sensor doesn't support.
+  pw::Status SetLightRange(uint8_t gain,
+                           uint16_t integration_ms,
+                           uint16_t measurement_rate_ms);
 
   /// Enables the proximity sensor.
   pw::Status EnableProximity() {
@@ -59,6 +103,18 @@ class Ltr559LightAndProxSensor {
     return device_.WriteRegister(kPsContrAddress, std::byte{0}, timeout_);
   }
 
+  /// Sets how often the proximity sensor measures: 10, 50, 70, 100, 200, 500,
+  /// 1000 or 2000 ms.
+  ///
+  /// Returns INVALID_ARGUMENT for values the sensor doesn't support.
+  pw::Status SetProximityMeasurementRate(uint16_t measurement_rate_ms);
+
+  /// Like `SetProximityMeasurementRate`, but without blocking.
+  pw::async2::Poll<pw::Status> PendSetProximityMeasurementRate(
+      pw::async2::Context& cx,
+      AsyncTransfer& transfer,
+      uint16_t measurement_rate_ms);
+
   struct Info {
     uint8_t part_id;
     uint8_t manufacturer_id;
@@ -70,9 +126,76 @@ class Ltr559LightAndProxSensor {
 
   pw::Result<float> ReadLightSampleLux();
 
+  /// Raw counts from the ambient light sensor's two ADC channels.
+  struct LightChannels {
+    uint16_t channel_1;
+    uint16_t channel_0;
+  };
+
+  pw::Result<LightChannels> ReadLightChannels();
+
+  /// Like `ReadProximitySample`, but without blocking.
+  pw::async2::Poll<pw::Result<uint16_t>> PendReadProximitySample(
+      pw::async2::Context& cx, AsyncTransfer& transfer);
+
+  /// Like `ReadLightChannels`, but without blocking.
+  pw::async2::Poll<pw::Result<LightChannels>> PendReadLightChannels(
+      pw::async2::Context& cx, AsyncTransfer& transfer);
+
+  /// Converts channel counts to lux, for the current gain and integration
+  /// time.
+  float LightSampleLux(const LightChannels& channels) const;
+
+  /// Data read from all of the sensor's data registers at once.
+  struct Readings {
+    /// Ambient light, in lux.
+    float light_lux;
+    /// Ambient light, as raw channel counts.
+    LightChannels light_channels;
+    /// Whether the ambient light data is new since it was last read.
+    bool new_light;
+    /// Proximity, as an 11-bit sample.
+    uint16_t proximity;
+    /// Whether the proximity data is new since it was last read.
+    bool new_proximity;
+  };
+
+  /// Reads both ambient light and proximity in a single transaction, which is
+  /// cheaper than reading each separately.
+  pw::Result<Readings> ReadAll();
+
+  /// Like `ReadAll`, but without blocking.
+  pw::async2::Poll<pw::Result<Readings>> PendReadAll(pw::async2::Context& cx,
+                                                     AsyncTransfer& transfer);
+
+  /// Like `SetLightRange`, but without blocking. Registers already holding
+  /// the values are not written again.
+  pw::async2::Poll<pw::Status> PendSetLightRange(pw::async2::Context& cx,
+                                                 AsyncTransfer& transfer,
+                                                 uint8_t gain,
+                                                 uint16_t integration_ms,
+                                                 uint16_t measurement_rate_ms);
+
+  /// Has the sensor signal its interrupt pin, active low, once a proximity
+  /// sample is below `lower` or above `upper`. Thresholds are 11-bit samples.
+  /// Clears any interrupt already signalled.
+  pw::Status SetProximityThresholds(uint16_t lower, uint16_t upper);
+
+  /// Like `SetProximityThresholds`, but without blocking.
+  pw::async2::Poll<pw::Status> PendSetProximityThresholds(
+      pw::async2::Context& cx,
+      AsyncTransfer& transfer,
+      uint16_t lower,
+      uint16_t upper);
+
  private:
+  static constexpr pw::i2c::Address kAddress =
+      pw::i2c::Address::SevenBit<0x23>();
+
   static constexpr uint8_t kAlsContrAddress = 0x80;
   static constexpr uint8_t kPsContrAddress = 0x81;
+  static constexpr uint8_t kPsMeasRateAddress = 0x84;
+  static constexpr uint8_t kAlsMeasRateAddress = 0x85;
 
   // 0x86: PART_ID
   // 0x87: MANUFAC_ID
@@ -80,45 +203,199 @@ class Ltr559LightAndProxSensor {
 
   // 0x88-89: ALS_DATA_CH1
   // 0x8A-8B: ALS_DATA_CH0
+  // 0x8C: ALS_PS_STATUS
+  // 0x8D-8E: PS_DATA
   static constexpr uint8_t kAlsDataCh1Address = 0x88;
+  static constexpr uint8_t kPsDataAddress = 0x8D;
+  static constexpr uint8_t kAlsPsStatusAddress = 0x8C;
+  static constexpr size_t kAllDataSize = 7;
+
+  static constexpr uint8_t kInterruptAddress = 0x8F;
+  // 0x90-91: PS_THRES_UP
+  // 0x92-93: PS_THRES_LOW
+  static constexpr uint8_t kPsThresholdUpAddress = 0x90;
+  static constexpr uint8_t kPsThresholdLowAddress = 0x92;
+  static constexpr uint16_t kMaxProximityThreshold = 0x7FF;
+  // Active low, for proximity only.
+  static constexpr uint8_t kProximityInterrupt = 0x01;
+
+  static uint16_t ProximitySample(uint16_t ps_data);
+
+  /// Returns the little-endian value at `offset` in `data`.
+  static uint16_t Read16(pw::span<const uint8_t> data, size_t offset);
+
+  /// Decodes all of the data registers, starting from ALS_DATA_CH1.
+  Readings DecodeReadings(pw::span<const uint8_t> data) const;
 
-  static constexpr int kDefaultIntegrationTimeMillis = 100;
-  static constexpr int kDefaultGain = 1;
+  /// Returns the value of ALS_CONTR for `gain`.
+  uint8_t LightControl(uint8_t gain, bool active) const;
 
-  pw::i2c::Initiator& i2c_initiator_;
+  /// Validates a light range, and returns the value of ALS_MEAS_RATE for it.
+  static pw::Result<uint8_t> LightMeasRate(uint8_t gain,
+                                           uint16_t integration_ms,
+                                           uint16_t measurement_rate_ms);
+
+  pw::Status WriteLightControl(bool active);
+
+  /// Performs an access that writes `tx` and reads `rx_size` bytes into
+  /// `transfer`. If `transfer` has a different access in progress, it is
+  /// finished first.
+  pw::async2::Poll<pw::Status> PendTransfer(pw::async2::Context& cx,
+                                            AsyncTransfer& transfer,
+                                            pw::ConstByteSpan tx,
+                                            size_t rx_size);
+
+  /// Reads `size` bytes of registers from `address` into `transfer`.
+  pw::async2::Poll<pw::Status> PendReadRegisters(pw::async2::Context& cx,
+                                                 AsyncTransfer& transfer,
+                                                 uint8_t address,
+                                                 size_t size);
+
+  /// Writes `value` to the register at `address`.
+  pw::async2::Poll<pw::Status> PendWriteRegister(pw::async2::Context& cx,
+                                                 AsyncTransfer& transfer,
+                                                 uint8_t address,
+                                                 uint8_t value);
+
+  /// Writes the little-endian `value` to the registers at `address`.
+  pw::async2::Poll<pw::Status> PendWriteRegister16(pw::async2::Context& cx,
+                                                   AsyncTransfer& transfer,
+                                                   uint8_t address,
+                                                   uint16_t value);
+
+  /// Performs transfer `step` of setting the proximity thresholds.
+  pw::async2::Poll<pw::Status> PendProximityThresholdsStep(
+      pw::async2::Context& cx,
+      AsyncTransfer& transfer,
+      uint8_t step,
+      uint16_t lower,
+      uint16_t upper);
+
+  I2cBusScheduler::Client& client_;
   pw::i2c::RegisterDevice device_;
   pw::chrono::SystemClock::duration timeout_;
+
+  // The sensor's defaults.
+  uint8_t light_gain_ = 1;
+  uint16_t light_integration_ms_ = 100;
+  bool light_active_ = false;
+  // The value last written to ALS_MEAS_RATE, if any.
+  std::optional<uint8_t> light_meas_rate_;
 };
 
 // LTR559 that implements the generic ProximitySensor and AmbientLightSensor
 // interfaces.
+//
+// While both sensors are enabled, proximity samples are read along with the
+// ambient light in a single transaction. Light samples then reuse that
+// reading if it is recent, rather than reading the sensor again.
+//
+// The ambient light sensor's gain and integration time are ranged
+// automatically by Ltr559AlsAutoRange, and integration is kept within the
+// sample period so that fast sampling sees fresh readings.
+//
+// Samples read asynchronously wait for the bus without blocking. Each sensor
+// has its own transfer, so a light and a proximity sample may be awaited at
+// the same time. A range change, whether called for by a light sample or by a
+// new sample period, is written before the next light sample is read.
 class Ltr559ProxAndLightSensorImpl final : public AmbientLightSensor,
                                            public ProximitySensor {
  public:
+  // The sensor only updates its light data every 500 ms by default, so a
+  // reading this recent is as good as a new one.
+  static constexpr pw::chrono::SystemClock::duration kMaxLightReadingAge =
+      pw::chrono::SystemClock::for_at_least(std::chrono::milliseconds(100));
+
   template <typename... Args>
   explicit Ltr559ProxAndLightSensorImpl(Args&&... args)
       : sensor_(std::forward<Args>(args)...) {}
 
  private:
-  pw::Status DoEnableProximitySensor() override {
-    return sensor_.EnableProximity();
-  }
+  pw::Status DoEnableProximitySensor() override;
+  pw::Status DoDisableProximitySensor() override;
+  pw::Status DoEnableLightSensor() override;
+  pw::Status DoDisableLightSensor() override;
 
-  pw::Status DoDisableProximitySensor() override {
-    return sensor_.DisableProximity();
-  }
+  pw::Result<uint16_t> DoReadProxSample() override;
+  pw::Result<float> DoReadLightSampleLux() override;
+  pw::async2::Poll<pw::Result<uint16_t>> DoPendProxSample(
+      pw::async2::Context& cx) override;
+  pw::async2::Poll<pw::Result<float>> DoPendLightSampleLux(
+      pw::async2::Context& cx) override;
+  pw::Status DoSetLightSamplePeriod(
+      pw::chrono::SystemClock::duration period) override;
+  pw::Status DoSetProxSamplePeriod(
+      pw::chrono::SystemClock::duration period) override;
+  pw::Status DoSetInterruptThresholds(uint16_t lower, uint16_t upper) override;
+  pw::async2::Poll<pw::Status> DoPendSetInterruptThresholds(
+      pw::async2::Context& cx, uint16_t lower, uint16_t upper) override;
 
-  pw::Status DoEnableLightSensor() override { return sensor_.EnableLight(); }
+  // Converts interrupt thresholds for scaled samples to 11-bit ones.
+  static std::pair<uint16_t, uint16_t> RawThresholds(uint16_t lower,
+                                                     uint16_t upper);
 
-  pw::Status DoDisableLightSensor() override { return sensor_.DisableLight(); }
+  // Returns whether light and proximity are read together.
+  bool ReadsAll() PW_LOCKS_EXCLUDED(lock_);
 
-  pw::Result<uint16_t> DoReadProxSample() override;
+  // Keeps the light channels read along with a proximity sample, and returns
+  // the proximity sample.
+  uint16_t HandleReadings(const Ltr559LightAndProxSensor::Readings& readings)
+      PW_LOCKS_EXCLUDED(lock_);
 
-  pw::Result<float> DoReadLightSampleLux() override {
-    return sensor_.ReadLightSampleLux();
-  }
+  // Returns the light channels kept from a recent proximity sample, if any.
+  std::optional<Ltr559LightAndProxSensor::LightChannels> TakeLightChannels()
+      PW_LOCKS_EXCLUDED(lock_);
+
+  // Scales a proximity sample to 16 bits.
+  static uint16_t ScaleProximitySample(uint16_t raw_sample);
+
+  // Converts a light reading to lux. Sets `light_range_pending_` if it calls
+  // for a range step.
+  float ConvertLightReading(
+      const Ltr559LightAndProxSensor::LightChannels& channels);
+
+  // Converts a light reading to lux, and steps the range if it calls for it.
+  pw::Result<float> HandleLightReading(
+      const Ltr559LightAndProxSensor::LightChannels& channels);
+
+  // Applies the current range and measurement rate.
+  pw::Status ApplyLightRange();
+
+  // Like `ApplyLightRange`, but without blocking.
+  pw::async2::Poll<pw::Status> PendApplyLightRange(pw::async2::Context& cx);
+
+  // Records that the current range has been applied.
+  void LightRangeApplied();
 
   Ltr559LightAndProxSensor sensor_;
+
+  pw::sync::InterruptSpinLock lock_;
+  bool light_enabled_ PW_GUARDED_BY(lock_) = false;
+  bool proximity_enabled_ PW_GUARDED_BY(lock_) = false;
+  std::optional<Ltr559LightAndProxSensor::LightChannels> light_channels_
+      PW_GUARDED_BY(lock_);
+  pw::chrono::SystemClock::time_point light_read_at_ PW_GUARDED_BY(lock_);
+
+  // Only used when reading samples asynchronously.
+  Ltr559LightAndProxSensor::AsyncTransfer proximity_transfer_;
+  bool proximity_reads_all_ = false;
+  Ltr559LightAndProxSensor::AsyncTransfer light_transfer_;
+  Ltr559LightAndProxSensor::AsyncTransfer thresholds_transfer_;
+
+  // Only used when reading light samples.
+  Ltr559AlsAutoRange auto_range_;
+  // Whether the range or measurement rate has changed since they were last
+  // applied.
+  bool light_range_pending_ = false;
+  uint16_t measurement_rate_ms_ = 500;
+  // Readings may have been integrated with the previous range until then.
+  pw::chrono::SystemClock::time_point light_settled_at_;
+  std::optional<float> last_lux_;
+
+  // Only used when setting the proximity sample period. A new rate is written
+  // before the next proximity sample is read.
+  uint16_t proximity_rate_ms_ = 100;
+  bool proximity_rate_pending_ = false;
 };
 
 }  // namespace sense
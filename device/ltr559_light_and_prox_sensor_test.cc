@@ -0,0 +1,474 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/ltr559_light_and_prox_sensor.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "modules/i2c_bus/scheduler.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_bytes/array.h"
+#include "pw_i2c/address.h"
+#include "pw_i2c/initiator_mock.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using ::pw::i2c::MockInitiator;
+using ::pw::i2c::Transaction;
+using ::pw::i2c::WriteTransaction;
+
+constexpr auto kAddress = pw::i2c::Address::SevenBit<0x23>();
+
+constexpr auto kEnableLight = pw::bytes::Array<0x80, 0x01>();
+constexpr auto kEnableProximity = pw::bytes::Array<0x81, 0x03>();
+constexpr auto kLightDataAddress = pw::bytes::Array<0x88>();
+constexpr auto kProximityDataAddress = pw::bytes::Array<0x8D>();
+
+// ALS_DATA_CH1 to PS_DATA, with new data flagged for both sensors. The light
+// is within the default light range.
+constexpr auto kAllData =
+    pw::bytes::Array<0x00, 0x10, 0x00, 0x20, 0x05, 0x34, 0x02>();
+constexpr auto kLightData = pw::bytes::Array<0x00, 0x10, 0x00, 0x20>();
+// Too dim for the default light range.
+constexpr auto kDimLightData = pw::bytes::Array<0x80, 0x00, 0x00, 0x01>();
+constexpr auto kProximityData = pw::bytes::Array<0x34, 0x02>();
+// Near full scale on both channels, for a ratio of 50.
+constexpr auto kBrightLightData = pw::bytes::Array<0x60, 0xEA, 0x60, 0xEA>();
+// The largest proximity count, with the saturation flag set.
+constexpr auto kFullProximityData = pw::bytes::Array<0xFF, 0x87>();
+
+// PS_THRES_UP = 0x1FF, PS_THRES_LOW = 0x011, little-endian.
+constexpr auto kThresholdUp = pw::bytes::Array<0x90, 0xFF, 0x01>();
+constexpr auto kThresholdLow = pw::bytes::Array<0x92, 0x11, 0x00>();
+constexpr auto kInterruptProximity = pw::bytes::Array<0x8F, 0x01>();
+constexpr auto kStatusAddress = pw::bytes::Array<0x8C>();
+constexpr auto kStatus = pw::bytes::Array<0x03>();
+
+// 200 ms integration, measured every 200 ms, at 2x gain.
+constexpr auto kLightMeasRate = pw::bytes::Array<0x85, 0x12>();
+constexpr auto kLightGain = pw::bytes::Array<0x80, 0x04>();
+// 100 ms integration, measured every 500 ms or 200 ms.
+constexpr auto kLightMeasRate500 = pw::bytes::Array<0x85, 0x03>();
+constexpr auto kLightMeasRate200 = pw::bytes::Array<0x85, 0x02>();
+// Proximity measured every 10 ms or 70 ms.
+constexpr auto kProximityMeasRate10 = pw::bytes::Array<0x84, 0x08>();
+constexpr auto kProximityMeasRate70 = pw::bytes::Array<0x84, 0x01>();
+// Enabled at 2x gain.
+constexpr auto kEnableLightGain2 = pw::bytes::Array<0x80, 0x05>();
+
+/// The sensor's connection to a mock bus.
+struct TestBus {
+  explicit TestBus(pw::i2c::Initiator& initiator) : scheduler(initiator) {}
+
+  I2cBusScheduler scheduler;
+  I2cBusScheduler::Client client{
+      scheduler, "ltr559", I2cBusScheduler::Priority::kNormal};
+};
+
+/// Reads a proximity and a light sample without blocking.
+class ReadSamplesTask : public pw::async2::Task {
+ public:
+  ReadSamplesTask(ProximitySensor& proximity, AmbientLightSensor& light)
+      : proximity_(proximity), light_(light) {}
+
+  const std::optional<pw::Result<uint16_t>>& proximity() const {
+    return proximity_sample_;
+  }
+  const std::optional<pw::Result<float>>& light() const {
+    return light_sample_;
+  }
+
+ private:
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) override {
+    if (!proximity_sample_.has_value()) {
+      if (!proximity_future_.has_value()) {
+        proximity_future_.emplace(proximity_.ReadSampleAsync());
+      }
+      pw::async2::Poll<pw::Result<uint16_t>> sample =
+          proximity_future_->Pend(cx);
+      if (sample.IsPending()) {
+        return pw::async2::Pending();
+      }
+      proximity_sample_ = *sample;
+    }
+    if (!light_future_.has_value()) {
+      light_future_.emplace(light_.ReadSampleLuxAsync());
+    }
+    pw::async2::Poll<pw::Result<float>> sample = light_future_->Pend(cx);
+    if (sample.IsPending()) {
+      return pw::async2::Pending();
+    }
+    light_sample_ = *sample;
+    return pw::async2::Ready();
+  }
+
+  ProximitySensor& proximity_;
+  AmbientLightSensor& light_;
+  std::optional<ProximitySampleFuture> proximity_future_;
+  std::optional<AmbientLightSampleFuture> light_future_;
+  std::optional<pw::Result<uint16_t>> proximity_sample_;
+  std::optional<pw::Result<float>> light_sample_;
+};
+
+/// Sets interrupt thresholds without blocking.
+class SetThresholdsTask : public pw::async2::Task {
+ public:
+  SetThresholdsTask(ProximitySensor& proximity, uint16_t lower, uint16_t upper)
+      : future_(proximity.SetInterruptThresholdsAsync(lower, upper)) {}
+
+  const std::optional<pw::Status>& status() const { return status_; }
+
+ private:
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) override {
+    pw::async2::Poll<pw::Status> status = future_.Pend(cx);
+    if (status.IsPending()) {
+      return pw::async2::Pending();
+    }
+    status_ = *status;
+    return pw::async2::Ready();
+  }
+
+  ProximityThresholdsFuture future_;
+  std::optional<pw::Status> status_;
+};
+
+TEST(Ltr559Test, ReadAllInOneTransaction) {
+  std::array transactions = {
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kAllData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  pw::Result<Ltr559LightAndProxSensor::Readings> readings = sensor.ReadAll();
+  ASSERT_EQ(readings.status(), pw::OkStatus());
+  EXPECT_EQ(readings->proximity, 0x234u);
+  EXPECT_TRUE(readings->new_proximity);
+  EXPECT_GT(readings->light_lux, 0.f);
+  EXPECT_TRUE(readings->new_light);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ReadAllMatchesSeparateReads) {
+  std::array transactions = {
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kAllData),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  pw::Result<Ltr559LightAndProxSensor::Readings> readings = sensor.ReadAll();
+  ASSERT_EQ(readings.status(), pw::OkStatus());
+  EXPECT_EQ(readings->light_lux, sensor.ReadLightSampleLux().value());
+  EXPECT_EQ(readings->proximity, sensor.ReadProximitySample().value());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, SharesReadsWhileBothSensorsAreEnabled) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableProximity),
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLight),
+      // The light sample reuses the reading taken with the proximity sample.
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kAllData),
+      // But only once.
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  ProximitySensor& proximity = sensor;
+  AmbientLightSensor& light = sensor;
+
+  ASSERT_EQ(proximity.Enable(), pw::OkStatus());
+  ASSERT_EQ(light.Enable(), pw::OkStatus());
+  EXPECT_EQ(proximity.ReadSample().value(), 0x234u << 5);
+  pw::Result<float> shared_lux = light.ReadSampleLux();
+  ASSERT_EQ(shared_lux.status(), pw::OkStatus());
+  EXPECT_EQ(light.ReadSampleLux().value(), *shared_lux);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ReadsSamplesWithoutBlocking) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableProximity),
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLight),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kAllData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  ProximitySensor& proximity = sensor;
+  AmbientLightSensor& light = sensor;
+  pw::async2::Dispatcher dispatcher;
+  ReadSamplesTask task(proximity, light);
+
+  ASSERT_EQ(proximity.Enable(), pw::OkStatus());
+  ASSERT_EQ(light.Enable(), pw::OkStatus());
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.proximity().has_value());
+  EXPECT_EQ(task.proximity()->value(), 0x234u << 5);
+  // The light sample reuses the reading taken with the proximity sample.
+  ASSERT_TRUE(task.light().has_value());
+  EXPECT_EQ(task.light()->status(), pw::OkStatus());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, RangesLightWithoutBlocking) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLight),
+      // Proximity is read alone while it is disabled.
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kDimLightData),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      // The step up to 2x gain is written before the next light sample.
+      WriteTransaction(pw::OkStatus(), kAddress, kLightMeasRate500),
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLightGain2),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kDimLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  AmbientLightSensor& light = sensor;
+  pw::async2::Dispatcher dispatcher;
+  ReadSamplesTask first(sensor, light);
+  ReadSamplesTask second(sensor, light);
+
+  ASSERT_EQ(light.Enable(), pw::OkStatus());
+  dispatcher.Post(first);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  dispatcher.Post(second);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(first.light().has_value());
+  ASSERT_TRUE(second.light().has_value());
+  // Until the new range takes effect, the last sample is repeated.
+  EXPECT_EQ(second.light()->value(), first.light()->value());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ReadsProximityAloneWhileLightIsDisabled) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableProximity),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  ProximitySensor& proximity = sensor;
+
+  ASSERT_EQ(proximity.Enable(), pw::OkStatus());
+  EXPECT_EQ(proximity.ReadSample().value(), 0x234u << 5);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ReadsFullScaleProximity) {
+  std::array transactions = {
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kFullProximityData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  EXPECT_EQ(sensor.ReadProximitySample().value(), 0x7FFu);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ReadsLuxNearFullScale) {
+  std::array transactions = {
+      Transaction(
+          pw::OkStatus(), kAddress, kLightDataAddress, kBrightLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  // 60000 counts on each channel: (60000 * 42785 - 60000 * 19548) / 10000.
+  EXPECT_FLOAT_EQ(sensor.ReadLightSampleLux().value(), 139422.f);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, ScalesLuxWithLightRange) {
+  std::array transactions = {
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+      WriteTransaction(pw::OkStatus(), kAddress, kLightMeasRate),
+      WriteTransaction(pw::OkStatus(), kAddress, kLightGain),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  pw::Result<float> default_lux = sensor.ReadLightSampleLux();
+  ASSERT_EQ(default_lux.status(), pw::OkStatus());
+  ASSERT_EQ(sensor.SetLightRange(2, 200, 200), pw::OkStatus());
+  // The same counts are four times less light with twice the gain and
+  // integration time.
+  EXPECT_FLOAT_EQ(sensor.ReadLightSampleLux().value(), *default_lux / 4);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, RejectsUnsupportedLightRange) {
+  MockInitiator initiator(pw::span<Transaction>{});
+  TestBus bus(initiator);
+  Ltr559LightAndProxSensor sensor(bus.client);
+
+  EXPECT_EQ(sensor.SetLightRange(3, 100, 500), pw::Status::InvalidArgument());
+  EXPECT_EQ(sensor.SetLightRange(1, 120, 500), pw::Status::InvalidArgument());
+  EXPECT_EQ(sensor.SetLightRange(1, 200, 100), pw::Status::InvalidArgument());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, RangesLightAutomatically) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLight),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kDimLightData),
+      // Steps up to 2x gain.
+      WriteTransaction(pw::OkStatus(), kAddress, kLightMeasRate500),
+      WriteTransaction(pw::OkStatus(), kAddress, kEnableLightGain2),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kDimLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  AmbientLightSensor& light = sensor;
+
+  ASSERT_EQ(light.Enable(), pw::OkStatus());
+  pw::Result<float> lux = light.ReadSampleLux();
+  ASSERT_EQ(lux.status(), pw::OkStatus());
+  // Until the new range takes effect, the last sample is repeated rather than
+  // misscaling the reading.
+  EXPECT_EQ(light.ReadSampleLux().value(), *lux);
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, MeasuresLightAsOftenAsItIsSampled) {
+  std::array transactions = {
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      // The new rate is written before the next light sample, rather than
+      // when the period is set.
+      WriteTransaction(pw::OkStatus(), kAddress, kLightMeasRate200),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  AmbientLightSensor& light = sensor;
+  pw::async2::Dispatcher dispatcher;
+  ReadSamplesTask first(sensor, light);
+  ReadSamplesTask second(sensor, light);
+
+  EXPECT_EQ(light.SetSamplePeriod(std::chrono::milliseconds(250)),
+            pw::OkStatus());
+  dispatcher.Post(first);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  // Unchanged, so not written again.
+  EXPECT_EQ(light.SetSamplePeriod(std::chrono::milliseconds(300)),
+            pw::OkStatus());
+  dispatcher.Post(second);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, MeasuresProximityAtLeastAsOftenAsItIsSampled) {
+  std::array transactions = {
+      // The new rate is written before the next proximity sample, rather
+      // than when the period is set.
+      WriteTransaction(pw::OkStatus(), kAddress, kProximityMeasRate10),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+      WriteTransaction(pw::OkStatus(), kAddress, kProximityMeasRate70),
+      Transaction(
+          pw::OkStatus(), kAddress, kProximityDataAddress, kProximityData),
+      Transaction(pw::OkStatus(), kAddress, kLightDataAddress, kLightData),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  ProximitySensor& proximity = sensor;
+  pw::async2::Dispatcher dispatcher;
+  ReadSamplesTask first(sensor, sensor);
+  ReadSamplesTask second(sensor, sensor);
+
+  // At 4x oversampling of 100 ms samples, every read must be a new
+  // measurement.
+  EXPECT_EQ(proximity.SetSamplePeriod(std::chrono::milliseconds(25)),
+            pw::OkStatus());
+  dispatcher.Post(first);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  EXPECT_EQ(proximity.SetSamplePeriod(std::chrono::milliseconds(99)),
+            pw::OkStatus());
+  // Unchanged, so not written again.
+  EXPECT_EQ(proximity.SetSamplePeriod(std::chrono::milliseconds(80)),
+            pw::OkStatus());
+  dispatcher.Post(second);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, SetsInterruptThresholdsForScaledSamples) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kThresholdUp),
+      WriteTransaction(pw::OkStatus(), kAddress, kThresholdLow),
+      WriteTransaction(pw::OkStatus(), kAddress, kInterruptProximity),
+      Transaction(pw::OkStatus(), kAddress, kStatusAddress, kStatus),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  ProximitySensor& proximity = sensor;
+
+  // Interrupt for scaled samples <= 0x200 or >= 0x4000.
+  EXPECT_EQ(proximity.SetInterruptThresholds(0x201, 0x3FFF), pw::OkStatus());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+TEST(Ltr559Test, SetsInterruptThresholdsWithoutBlocking) {
+  std::array transactions = {
+      WriteTransaction(pw::OkStatus(), kAddress, kThresholdUp),
+      WriteTransaction(pw::OkStatus(), kAddress, kThresholdLow),
+      WriteTransaction(pw::OkStatus(), kAddress, kInterruptProximity),
+      Transaction(pw::OkStatus(), kAddress, kStatusAddress, kStatus),
+  };
+  MockInitiator initiator(transactions);
+  TestBus bus(initiator);
+  Ltr559ProxAndLightSensorImpl sensor(bus.client);
+  pw::async2::Dispatcher dispatcher;
+  SetThresholdsTask task(sensor, 0x201, 0x3FFF);
+
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.status().has_value());
+  EXPECT_EQ(*task.status(), pw::OkStatus());
+  EXPECT_EQ(initiator.Finalize(), pw::OkStatus());
+}
+
+}  // namespace
+}  // namespace sense
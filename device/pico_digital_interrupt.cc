@@ -0,0 +1,115 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "device/pico_digital_interrupt.h"
+
+#include <utility>
+
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pw_assert/check.h"
+
+namespace sense {
+
+using ::pw::digital_io::InterruptHandler;
+using ::pw::digital_io::InterruptTrigger;
+using ::pw::digital_io::Polarity;
+using ::pw::digital_io::State;
+
+PicoDigitalInterrupt* PicoDigitalInterrupt::gpio_with_handler = nullptr;
+
+PicoDigitalInterrupt::PicoDigitalInterrupt(const GpioConfig& config)
+    : gpio_config_(config) {}
+
+pw::Status PicoDigitalInterrupt::DoEnable(bool enable) {
+  if (!enable) {
+    DisableIrq();
+    gpio_deinit(gpio_config_.pin);
+    return pw::OkStatus();
+  }
+  gpio_init(gpio_config_.pin);
+  gpio_set_dir(gpio_config_.pin, GPIO_IN);
+  if (gpio_config_.enable_pull_up) {
+    gpio_pull_up(gpio_config_.pin);
+  }
+  return pw::OkStatus();
+}
+
+pw::Status PicoDigitalInterrupt::DoSetInterruptHandler(
+    InterruptTrigger trigger, InterruptHandler&& handler) {
+  const bool active_low = gpio_config_.polarity == Polarity::kActiveLow;
+  const uint32_t activating =
+      active_low ? GPIO_IRQ_EDGE_FALL : GPIO_IRQ_EDGE_RISE;
+  const uint32_t deactivating =
+      active_low ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+  switch (trigger) {
+    case InterruptTrigger::kActivatingEdge:
+      events_ = activating;
+      break;
+    case InterruptTrigger::kDeactivatingEdge:
+      events_ = deactivating;
+      break;
+    case InterruptTrigger::kBothEdges:
+      events_ = activating | deactivating;
+      break;
+  }
+  handler_ = std::move(handler);
+  return pw::OkStatus();
+}
+
+pw::Status PicoDigitalInterrupt::DoEnableInterruptHandler(bool enable) {
+  if (!enable) {
+    DisableIrq();
+    return pw::OkStatus();
+  }
+  PW_CHECK(gpio_with_handler == nullptr || gpio_with_handler == this);
+  if (gpio_with_handler == nullptr) {
+    gpio_add_raw_irq_handler(gpio_config_.pin, &IrqHandler);
+  }
+  gpio_with_handler = this;
+
+  gpio_acknowledge_irq(gpio_config_.pin, events_);
+  gpio_set_irq_enabled(gpio_config_.pin, events_, true);
+  irq_set_enabled(IO_IRQ_BANK0, true);
+  return pw::OkStatus();
+}
+
+void PicoDigitalInterrupt::DisableIrq() const {
+  if (events_ != 0) {
+    gpio_set_irq_enabled(gpio_config_.pin, events_, false);
+  }
+}
+
+State PicoDigitalInterrupt::GetState() const {
+  const bool high = gpio_get(gpio_config_.pin);
+  const bool active_low = gpio_config_.polarity == Polarity::kActiveLow;
+  return high != active_low ? State::kActive : State::kInactive;
+}
+
+void PicoDigitalInterrupt::IrqHandler() {
+  PicoDigitalInterrupt* gpio = gpio_with_handler;
+  if (gpio == nullptr) {
+    return;
+  }
+  const uint32_t events = gpio_get_irq_event_mask(gpio->gpio_config_.pin);
+  if ((events & gpio->events_) == 0) {
+    return;
+  }
+  gpio_acknowledge_irq(gpio->gpio_config_.pin, events);
+  if (gpio->handler_ != nullptr) {
+    gpio->handler_(gpio->GetState());
+  }
+}
+
+}  // namespace sense
@@ -0,0 +1,53 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "pw_digital_io/digital_io.h"
+#include "pw_digital_io_rp2040/digital_io.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Digital input that calls its handler from the GPIO bank's interrupt.
+///
+/// The Pico SDK's raw GPIO handlers take no context, so only one of these may
+/// have its interrupt handler enabled at a time.
+class PicoDigitalInterrupt : public pw::digital_io::DigitalInterrupt {
+ public:
+  using GpioConfig = ::pw::digital_io::Rp2040Config;
+
+  PicoDigitalInterrupt(const GpioConfig& config);
+
+ private:
+  pw::Status DoEnable(bool enable) override;
+  pw::Status DoSetInterruptHandler(
+      pw::digital_io::InterruptTrigger trigger,
+      pw::digital_io::InterruptHandler&& handler) override;
+  pw::Status DoEnableInterruptHandler(bool enable) override;
+
+  void DisableIrq() const;
+  pw::digital_io::State GetState() const;
+
+  static void IrqHandler();
+
+  static PicoDigitalInterrupt* gpio_with_handler;
+
+  const GpioConfig& gpio_config_;
+  uint32_t events_ = 0;
+  pw::digital_io::InterruptHandler handler_;
+};
+
+}  // namespace sense
@@ -14,7 +14,7 @@
 
 #include "modules/air_sensor/air_sensor.h"
 
-#include <cmath>
+#include <algorithm>
 #include <mutex>
 
 #include "pw_assert/check.h"
@@ -23,8 +23,6 @@
 
 namespace sense {
 
-static constexpr float kHumidityFactor = 0.04f;
-
 LedValue AirSensor::GetLedValue(uint16_t score) {
   uint8_t red = 0;
   uint8_t green = 0;
@@ -45,36 +43,160 @@ LedValue AirSensor::GetLedValue(uint16_t score) {
   return LedValue(red, green, blue);
 }
 
-float AirSensor::temperature() const {
-  std::lock_guard lock(lock_);
-  return temperature_.value();
+pw::Result<uint16_t> AirSensor::MeasureSync() {
+  pw::sync::ThreadNotification notification;
+  PW_TRY(Measure(notification));
+  notification.acquire();
+  return score();
 }
 
-float AirSensor::pressure() const {
-  std::lock_guard lock(lock_);
-  return pressure_.value();
+pw::Status AirSensor::Measure(pw::sync::ThreadNotification& notification) {
+  return StartMeasurement(&notification).status();
 }
 
-float AirSensor::humidity() const {
-  std::lock_guard lock(lock_);
-  return humidity_.value();
+AirSensorMeasureFuture AirSensor::MeasureAsync() {
+  pw::Result<uint32_t> measurements_finished = StartMeasurement(nullptr);
+  return AirSensorMeasureFuture(
+      *this, measurements_finished.value_or(0), measurements_finished.status());
 }
 
-float AirSensor::gas_resistance() const {
-  std::lock_guard lock(lock_);
-  return gas_resistance_.value();
+pw::Result<uint32_t> AirSensor::StartMeasurement(
+    pw::sync::ThreadNotification* waiter) {
+  uint32_t measurements_finished;
+  bool completed = false;
+  {
+    std::lock_guard lock(lock_);
+    measurements_finished = measurements_finished_;
+    if (pipelined_ && !measuring_) {
+      // A pipelined sample has already completed, so use it.
+      completed = true;
+    } else {
+      if (waiter != nullptr) {
+        if (waiters_.full()) {
+          return pw::Status::ResourceExhausted();
+        }
+        waiters_.push_back(waiter);
+      }
+      if (measuring_) {
+        return measurements_finished;
+      }
+      measuring_ = true;
+      pipelined_ = mode_ == Mode::kPipelined;
+    }
+  }
+  if (completed) {
+    if (waiter != nullptr) {
+      waiter->release();
+    }
+    return measurements_finished - 1;
+  }
+
+  pw::Status status = DoMeasure();
+  if (status.ok()) {
+    return measurements_finished;
+  }
+
+  // Don't release this caller, since it is getting the error instead. Any
+  // others that joined in the meantime are released as though it finished.
+  {
+    std::lock_guard lock(lock_);
+    pipelined_ = false;
+    auto iter = std::find(waiters_.begin(), waiters_.end(), waiter);
+    if (iter != waiters_.end()) {
+      waiters_.erase(iter);
+    }
+  }
+  FinishMeasurement();
+  return status;
+}
+
+void AirSensor::FinishMeasurement() {
+  pw::Vector<pw::sync::ThreadNotification*, kMaxWaiters> waiters;
+  {
+    std::lock_guard lock(lock_);
+    measuring_ = false;
+    ++measurements_finished_;
+    waiters.assign(waiters_.begin(), waiters_.end());
+    waiters_.clear();
+
+    // Futures are woken with the lock held, since any of them may be destroyed
+    // as soon as it is unlisted. Waking only takes the dispatcher's lock.
+    while (!pending_futures_.empty()) {
+      AirSensorMeasureFuture& future = pending_futures_.front();
+      pending_futures_.pop_front();
+      future.pending_ = false;
+      std::move(future.waker_).Wake();
+    }
+  }
+  for (pw::sync::ThreadNotification* waiter : waiters) {
+    waiter->release();
+  }
 }
 
-uint16_t AirSensor::score() const {
+void AirSensor::StopPipeline() {
   std::lock_guard lock(lock_);
-  return score_.value();
+  pipelined_ = false;
 }
 
-pw::Result<uint16_t> AirSensor::MeasureSync() {
-  pw::sync::ThreadNotification notification;
-  PW_TRY(Measure(notification));
-  notification.acquire();
-  return score();
+AirSensorMeasureFuture::AirSensorMeasureFuture(AirSensorMeasureFuture&& other)
+    : air_sensor_(other.air_sensor_),
+      measurements_finished_(other.measurements_finished_),
+      status_(other.status_) {
+  TakePendingFrom(other);
+}
+
+AirSensorMeasureFuture& AirSensorMeasureFuture::operator=(
+    AirSensorMeasureFuture&& other) {
+  if (this != &other) {
+    StopPending();
+    air_sensor_ = other.air_sensor_;
+    measurements_finished_ = other.measurements_finished_;
+    status_ = other.status_;
+    TakePendingFrom(other);
+  }
+  return *this;
+}
+
+AirSensorMeasureFuture::~AirSensorMeasureFuture() { StopPending(); }
+
+pw::async2::Poll<pw::Result<uint16_t>> AirSensorMeasureFuture::Pend(
+    pw::async2::Context& cx) {
+  if (!status_.ok()) {
+    return pw::async2::Ready(pw::Result<uint16_t>(status_));
+  }
+  {
+    std::lock_guard lock(air_sensor_->lock_);
+    if (air_sensor_->measurements_finished_ == measurements_finished_) {
+      waker_ = cx.GetWaker(pw::async2::WaitReason::Unspecified());
+      if (!pending_) {
+        pending_ = true;
+        air_sensor_->pending_futures_.push_back(*this);
+      }
+      return pw::async2::Pending();
+    }
+  }
+  return pw::async2::Ready(pw::Result<uint16_t>(air_sensor_->score()));
+}
+
+void AirSensorMeasureFuture::TakePendingFrom(AirSensorMeasureFuture& other) {
+  std::lock_guard lock(air_sensor_->lock_);
+  if (!other.pending_) {
+    return;
+  }
+  air_sensor_->pending_futures_.remove(other);
+  other.pending_ = false;
+  waker_ = std::move(other.waker_);
+  pending_ = true;
+  air_sensor_->pending_futures_.push_back(*this);
+}
+
+void AirSensorMeasureFuture::StopPending() {
+  std::lock_guard lock(air_sensor_->lock_);
+  if (pending_) {
+    air_sensor_->pending_futures_.remove(*this);
+    pending_ = false;
+    waker_.Clear();
+  }
 }
 
 void AirSensor::Update(float temperature,
@@ -88,33 +210,42 @@ void AirSensor::Update(float temperature,
   humidity_.Set(humidity);
   gas_resistance_.Set(gas_resistance);
 
-  // Update the aggregate air qualities values.
-  count_.Increment();
-  float average = average_.value();
-  float quality = gas_resistance < 1.f
-                      ? 0.f
-                      : (std::log(gas_resistance) + kHumidityFactor * humidity);
-  float delta = quality - average;
-  average += delta / count_.value();
-  float sum_of_squares =
-      sum_of_squares_.value() + (delta * (quality - average));
-  average_.Set(average);
-  quality_.Set(quality);
-  sum_of_squares_.Set(sum_of_squares);
-
-  // Calculate the air quality score.
-  size_t count = count_.value();
-  if (count < 2) {
-    return;
-  }
-  float stddev = std::sqrt(sum_of_squares / (count - 1));
-  if (stddev == 0.f) {
-    score_.Set(kAverageScore);
-    return;
+  UpdateScore(humidity, gas_resistance);
+
+  snapshot_.Write({
+      .temperature = temperature,
+      .pressure = pressure,
+      .humidity = humidity,
+      .gas_resistance = gas_resistance,
+      .score = static_cast<uint16_t>(score_.value()),
+      .timestamp = pw::chrono::SystemClock::now(),
+  });
+}
+
+void AirSensor::UpdateScore(float humidity, float gas_resistance) {
+#if SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+  // Only the readings are converted; the scorer itself uses no floating point.
+  auto humidity_q16 = static_cast<int32_t>(humidity * 65536.f);
+  auto gas_resistance_ohms =
+      static_cast<uint32_t>(std::clamp(gas_resistance, 0.f, 4294967040.f));
+  uint16_t score = scorer_.Update(humidity_q16, gas_resistance_ohms);
+#else
+  uint16_t score = scorer_.Update(humidity, gas_resistance);
+#endif  // SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+
+  count_.Set(scorer_.count());
+  score_.Set(score);
+}
+
+void AirSensor::LogMetrics() {
+  {
+    std::lock_guard lock(lock_);
+    quality_.Set(scorer_.quality());
+    average_.Set(scorer_.average());
+    variance_.Set(scorer_.variance());
   }
-  float score = ((quality - average) / stddev) + 3.f;
-  score = std::min(std::max(score * 256.f, 0.f), static_cast<float>(kMaxScore));
-  score_.Set(static_cast<uint32_t>(score));
+  metrics_.Dump();
+  DoLogMetrics();
 }
 
 }  // namespace sense
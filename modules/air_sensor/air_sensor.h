@@ -13,9 +13,16 @@
 // the License.
 #pragma once
 
+#include "modules/air_sensor/score.h"
+#include "modules/air_sensor/seqlock.h"
 #include "modules/pubsub/pubsub_events.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_containers/intrusive_list.h"
+#include "pw_containers/vector.h"
 #include "pw_metric/metric.h"
 #include "pw_result/result.h"
+#include "pw_span/span.h"
 #include "pw_status/status.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
@@ -23,6 +30,8 @@
 
 namespace sense {
 
+class AirSensorMeasureFuture;
+
 class AirSensor {
  public:
   // Default starting values representing decent air quality.
@@ -31,6 +40,45 @@ class AirSensor {
   static constexpr float kDefaultHumidity = 40.f;
   static constexpr float kDefaultGasResistance = 50000.f;
 
+  /// Maximum number of threads that may wait on a measurement at once.
+  static constexpr size_t kMaxWaiters = 4;
+
+  /// How measurements are taken.
+  enum class Mode {
+    /// Each measurement starts a conversion and waits for it to complete.
+    kOnDemand,
+
+    /// The first measurement starts a conversion, and each conversion starts
+    /// the next once its result is read. Measurements then complete
+    /// immediately with the most recently completed sample.
+    ///
+    /// Unless `SetSamplePeriod` paces them, conversions run back to back,
+    /// which keeps the sensor converting continuously.
+    kPipelined,
+  };
+
+  static constexpr size_t kMaxHeaterSteps = GasScan::kMaxSteps;
+
+  /// How the steps of a gas sensor's heater profile are run.
+  enum class HeaterMode {
+    /// A single step, heated once for each forced-mode measurement.
+    kForced,
+
+    /// Each step is a full temperature, pressure, humidity and gas
+    /// measurement.
+    kSequential,
+
+    /// Gas is measured at each step while temperature, pressure and humidity
+    /// are measured in parallel. Step durations may be rounded up to the
+    /// sensor's heating cycle.
+    kParallel,
+  };
+
+  struct HeaterStep {
+    uint16_t temperature_c;
+    uint16_t duration_ms;
+  };
+
   /// Threshold presets for convenience.
   ///
   /// The AirSensor is not connected to any output directly, and thus the use of
@@ -53,6 +101,10 @@ class AirSensor {
 
   static constexpr uint16_t kMaxScore = static_cast<uint16_t>(Score::kBlue);
   static constexpr uint16_t kAverageScore = static_cast<uint16_t>(Score::kCyan);
+  static_assert(kMaxScore == AirQualityScorer::kMaxScore);
+  static_assert(kAverageScore == AirQualityScorer::kAverageScore);
+  static_assert(static_cast<uint16_t>(Score::kOrange) ==
+                AirQuality::kScoreBucketSize);
 
   /// Get the RGB values corresponding to an air quality score.
   static LedValue GetLedValue(uint16_t score);
@@ -60,22 +112,47 @@ class AirSensor {
     return GetLedValue(static_cast<uint16_t>(score));
   }
 
+  /// The readings and score from a single measurement.
+  struct Reading {
+    float temperature;
+    float pressure;
+    float humidity;
+    float gas_resistance;
+    uint16_t score;
+
+    /// When the measurement completed, or the epoch if none has.
+    pw::chrono::SystemClock::time_point timestamp;
+  };
+
   virtual ~AirSensor() = default;
 
+  /// Returns the readings and score from the most recent measurement.
+  ///
+  /// The values are always from the same measurement. This never blocks, and
+  /// never blocks measurements from being recorded.
+  Reading Snapshot() const { return snapshot_.Read(); }
+
   /// Returns the most recent temperature reading.
-  float temperature() const PW_LOCKS_EXCLUDED(lock_);
+  float temperature() const { return Snapshot().temperature; }
 
   /// Returns the most recent barometric pressure reading.
-  float pressure() const PW_LOCKS_EXCLUDED(lock_);
+  float pressure() const { return Snapshot().pressure; }
 
   /// Returns the most recent relative humidity reading.
-  float humidity() const PW_LOCKS_EXCLUDED(lock_);
+  float humidity() const { return Snapshot().humidity; }
 
   /// Returns the most recent gas resistance reading.
-  float gas_resistance() const PW_LOCKS_EXCLUDED(lock_);
+  float gas_resistance() const { return Snapshot().gas_resistance; }
 
   /// Returns a 10-bit air quality score from 0 (terrible) to 1023 (excellent).
-  uint16_t score() const PW_LOCKS_EXCLUDED(lock_);
+  uint16_t score() const { return Snapshot().score; }
+
+  /// Returns how long ago the most recent measurement completed.
+  pw::chrono::SystemClock::duration sample_age() const {
+    return pw::chrono::SystemClock::now() - Snapshot().timestamp;
+  }
+
+  Mode mode() const { return mode_; }
 
   /// Sets up the sensor.
   pw::Status Init() { return DoInit(); }
@@ -84,20 +161,72 @@ class AirSensor {
   ///
   /// When the measurement is complete, ``Update`` will be called and the
   /// given notification will be released.
+  ///
+  /// If a measurement is already in progress, no new one is started. Instead,
+  /// the notification is released when the current one completes. Returns
+  /// RESOURCE_EXHAUSTED if too many callers are already waiting.
+  ///
+  /// In `Mode::kPipelined`, once a sample has completed the notification is
+  /// released immediately, and `sample_age` reports how old the sample is.
   pw::Status Measure(pw::sync::ThreadNotification& notification)
-      PW_LOCKS_EXCLUDED(lock_) {
-    return DoMeasure(notification);
-  }
+      PW_LOCKS_EXCLUDED(lock_);
 
   /// Like `Measure`, but runs synchronously and returns the same score as
   /// `GetScore`.
   pw::Result<uint16_t> MeasureSync() PW_LOCKS_EXCLUDED(lock_);
 
+  /// Like `Measure`, but returns a future that completes with the score once
+  /// the measurement finishes. Joins any measurement already in progress.
+  ///
+  /// The future wakes the task pending on it instead of blocking a thread, so
+  /// the task can do other work while the sensor measures. Any number of
+  /// futures may wait on the same measurement.
+  AirSensorMeasureFuture MeasureAsync() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Tells the sensor how often it is measured.
+  ///
+  /// In `Mode::kPipelined`, the sensor can then rest between conversions so
+  /// that each completes about one period after the last, instead of
+  /// converting continuously. Returns UNIMPLEMENTED if the sensor is unable to.
+  pw::Status SetSamplePeriod(pw::chrono::SystemClock::duration period) {
+    return DoSetSamplePeriod(period);
+  }
+
+  /// Sets the heater profile used to measure gas resistance.
+  ///
+  /// `HeaterMode::kForced` takes exactly one step, and the other modes take up
+  /// to `kMaxHeaterSteps`. In the other modes, a measurement completes when a
+  /// full cycle of the profile has been scanned, and the gas resistance from
+  /// the first step is the one scored.
+  ///
+  /// May be called at any time. The profile is used from the next
+  /// measurement, and in `Mode::kPipelined`, conversions are stopped and
+  /// restarted with it once the current one completes. Returns UNIMPLEMENTED
+  /// if the sensor has no configurable heater.
+  pw::Status SetHeaterProfile(HeaterMode heater_mode,
+                              pw::span<const HeaterStep> steps) {
+    return DoSetHeaterProfile(heater_mode, steps);
+  }
+
   /// Writes the metrics to logs.
-  void LogMetrics() { metrics_.Dump(); }
+  void LogMetrics() PW_LOCKS_EXCLUDED(lock_);
 
  protected:
   AirSensor() = default;
+  explicit AirSensor(Mode mode) : mode_(mode) {}
+
+  /// Releases and wakes everything waiting on the current measurement.
+  ///
+  /// Implementations must call this each time a measurement requested by
+  /// `DoMeasure` finishes, whether or not it succeeded, after calling
+  /// `Update`. In `Mode::kPipelined`, this is called for every conversion.
+  void FinishMeasurement() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Records that pipelined conversions have stopped, e.g. after an error.
+  ///
+  /// The next measurement waits for `DoMeasure` to start them again. Must be
+  /// called before the `FinishMeasurement` call for the last conversion.
+  void StopPipeline() PW_LOCKS_EXCLUDED(lock_);
 
   /// Records the results of an air measurement.
   void Update(float temperature,
@@ -106,16 +235,81 @@ class AirSensor {
               float gas_resistance) PW_LOCKS_EXCLUDED(lock_);
 
  private:
+  friend class AirSensorMeasureFuture;
+
   /// @copydoc `AirSensor::Init`.
   ///
   /// By default, does nothing.
   virtual pw::Status DoInit() { return pw::OkStatus(); }
 
-  /// @copydoc `AirSensor::Measure`.
-  virtual pw::Status DoMeasure(pw::sync::ThreadNotification& notification)
-      PW_LOCKS_EXCLUDED(lock_) = 0;
+  /// @copydoc `AirSensor::SetSamplePeriod`.
+  ///
+  /// By default, returns UNIMPLEMENTED.
+  virtual pw::Status DoSetSamplePeriod(pw::chrono::SystemClock::duration) {
+    return pw::Status::Unimplemented();
+  }
+
+  /// @copydoc `AirSensor::SetHeaterProfile`.
+  ///
+  /// By default, returns UNIMPLEMENTED.
+  virtual pw::Status DoSetHeaterProfile(HeaterMode,
+                                        pw::span<const HeaterStep>) {
+    return pw::Status::Unimplemented();
+  }
+
+  /// Writes any implementation-specific metrics to logs.
+  ///
+  /// By default, does nothing.
+  virtual void DoLogMetrics() {}
+
+  /// Starts a measurement.
+  ///
+  /// Only called when no measurement is in progress. Implementations must call
+  /// `FinishMeasurement` when the measurement completes, unless this returns an
+  /// error.
+  ///
+  /// In `Mode::kPipelined`, this is only called to start conversions, and
+  /// implementations keep converting until they call `StopPipeline`.
+  virtual pw::Status DoMeasure() PW_LOCKS_EXCLUDED(lock_) = 0;
+
+  /// Starts a measurement unless one is in progress.
+  ///
+  /// `waiter` is added to the callers released on completion, and may be null.
+  /// Returns the value of `measurements_finished_` before the measurement that
+  /// satisfies the caller completes. For pipelined measurements, that one may
+  /// already have completed.
+  pw::Result<uint32_t> StartMeasurement(pw::sync::ThreadNotification* waiter)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Updates the score from a measurement.
+  void UpdateScore(float humidity, float gas_resistance)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const Mode mode_ = Mode::kOnDemand;
 
   mutable pw::sync::InterruptSpinLock lock_;
+  AirQualityScorer scorer_ PW_GUARDED_BY(lock_);
+
+  // Callers waiting on the current measurement. Asynchronous measurements are
+  // tracked by the number of finished measurements, and the futures pending on
+  // one are listed to be woken when it finishes.
+  bool measuring_ PW_GUARDED_BY(lock_) = false;
+  bool pipelined_ PW_GUARDED_BY(lock_) = false;
+  pw::Vector<pw::sync::ThreadNotification*, kMaxWaiters> waiters_
+      PW_GUARDED_BY(lock_);
+  uint32_t measurements_finished_ PW_GUARDED_BY(lock_) = 0;
+  pw::IntrusiveList<AirSensorMeasureFuture> pending_futures_
+      PW_GUARDED_BY(lock_);
+
+  // Only written with `lock_` held, which serializes writers.
+  SeqLock<Reading> snapshot_{Reading{
+      .temperature = kDefaultTemperature,
+      .pressure = kDefaultPressure,
+      .humidity = kDefaultHumidity,
+      .gas_resistance = kDefaultGasResistance,
+      .score = kAverageScore,
+      .timestamp = {},
+  }};
 
   // Thread safety: metric values should be atomic.
   //
@@ -130,12 +324,59 @@ class AirSensor {
   PW_METRIC(metrics_, humidity_, "relative humidity", kDefaultHumidity);
   PW_METRIC(metrics_, gas_resistance_, "gas resistance", kDefaultGasResistance);
 
-  // Derived values.
+  // Derived values. The scorer's air quality values are only copied to the
+  // metrics when they are logged.
   PW_METRIC(metrics_, count_, "number of measurements", 0u);
   PW_METRIC(metrics_, quality_, "current air quality", 0.f);
-  PW_METRIC(metrics_, average_, "average air quality", 0.f);
-  PW_METRIC(metrics_, sum_of_squares_, "aggregate air quality variance", 0.f);
+  PW_METRIC(metrics_, average_, "recent average air quality", 0.f);
+  PW_METRIC(metrics_, variance_, "recent air quality variance", 0.f);
   PW_METRIC(metrics_, score_, "air quality score", kAverageScore);
 };
 
+/// Future returned by `AirSensor::MeasureAsync`.
+///
+/// While pending, the future is listed by the air sensor, which wakes it when
+/// the measurement finishes. Moving the future moves its place in the list.
+class AirSensorMeasureFuture
+    : public pw::IntrusiveList<AirSensorMeasureFuture>::Item {
+ public:
+  AirSensorMeasureFuture(AirSensorMeasureFuture&& other)
+      PW_LOCKS_EXCLUDED(air_sensor_->lock_, other.air_sensor_->lock_);
+  AirSensorMeasureFuture& operator=(AirSensorMeasureFuture&& other)
+      PW_LOCKS_EXCLUDED(air_sensor_->lock_, other.air_sensor_->lock_);
+
+  ~AirSensorMeasureFuture() PW_LOCKS_EXCLUDED(air_sensor_->lock_);
+
+  /// Returns the air quality score once the measurement has finished, or the
+  /// error that prevented it from starting.
+  pw::async2::Poll<pw::Result<uint16_t>> Pend(pw::async2::Context& cx)
+      PW_LOCKS_EXCLUDED(air_sensor_->lock_);
+
+ private:
+  friend class AirSensor;
+
+  AirSensorMeasureFuture(AirSensor& air_sensor,
+                         uint32_t measurements_finished,
+                         pw::Status status)
+      : air_sensor_(&air_sensor),
+        measurements_finished_(measurements_finished),
+        status_(status) {}
+
+  /// Takes over `other`'s place among the pending futures, if it has one.
+  void TakePendingFrom(AirSensorMeasureFuture& other)
+      PW_LOCKS_EXCLUDED(air_sensor_->lock_);
+
+  /// Removes this future from the pending futures, if it is listed.
+  void StopPending() PW_LOCKS_EXCLUDED(air_sensor_->lock_);
+
+  AirSensor* air_sensor_;
+  uint32_t measurements_finished_;
+  pw::Status status_;
+
+  // Whether this future is in the air sensor's `pending_futures_`, and the
+  // waker of the task pending on it.
+  bool pending_ PW_GUARDED_BY(air_sensor_->lock_) = false;
+  pw::async2::Waker waker_ PW_GUARDED_BY(air_sensor_->lock_);
+};
+
 }  // namespace sense
@@ -13,16 +13,19 @@
 // the License.
 #pragma once
 
+#include <atomic>
+
 #include "modules/air_sensor/air_sensor.h"
-#include "pw_assert/assert.h"
 #include "pw_status/status.h"
-#include "pw_sync/thread_notification.h"
 
 namespace sense {
 
 class AirSensorFake : public AirSensor {
  public:
-  AirSensorFake() = default;
+  explicit AirSensorFake(Mode mode = Mode::kOnDemand) : AirSensor(mode) {}
+
+  /// Stops pipelined measurements, as though a conversion failed.
+  using AirSensor::StopPipeline;
 
   void set_autopublish(bool autopublish) { autopublish_ = autopublish; }
   void set_temperature(float temperature) { temperature_ = temperature; }
@@ -32,25 +35,21 @@ class AirSensorFake : public AirSensor {
     gas_resistance_ = gas_resistance;
   }
 
+  /// Returns how many measurements have been started.
+  size_t num_measurements() const { return num_measurements_; }
+
+  /// Completes a measurement. In `Mode::kPipelined`, this completes the
+  /// current conversion, as the sensor would between measurements.
   void Publish() {
     Update(temperature_, pressure_, humidity_, gas_resistance_);
-    {
-      std::lock_guard lock(lock_);
-      PW_ASSERT(notification_ != nullptr);
-      notification_->release();
-      notification_ = nullptr;
-    }
+    FinishMeasurement();
   }
 
  private:
-  pw::Status DoMeasure(pw::sync::ThreadNotification& notification) override {
-    {
-      std::lock_guard lock(lock_);
-      notification_ = &notification;
-    }
+  pw::Status DoMeasure() override {
+    ++num_measurements_;
     if (autopublish_) {
       Publish();
-    } else {
     }
     return pw::OkStatus();
   }
@@ -60,8 +59,7 @@ class AirSensorFake : public AirSensor {
   float pressure_ = AirSensor::kDefaultPressure;
   float humidity_ = AirSensor::kDefaultHumidity;
   float gas_resistance_ = AirSensor::kDefaultGasResistance;
-  pw::sync::InterruptSpinLock lock_;
-  pw::sync::ThreadNotification* notification_ PW_GUARDED_BY(lock_) = nullptr;
+  std::atomic<size_t> num_measurements_ = 0;
 };
 
 }  // namespace sense
@@ -14,7 +14,11 @@
 
 #include "modules/air_sensor/air_sensor.h"
 
+#include <array>
+#include <optional>
+
 #include "modules/air_sensor/air_sensor_fake.h"
+#include "pw_async2/dispatcher.h"
 #include "pw_sync/timed_thread_notification.h"
 #include "pw_thread/test_thread_context.h"
 #include "pw_thread/thread.h"
@@ -24,6 +28,31 @@ namespace sense {
 
 // Test fixtures.
 
+/// Task that pends on a single asynchronous measurement.
+class MeasureTask : public pw::async2::Task {
+ public:
+  explicit MeasureTask(AirSensor& air_sensor) : air_sensor_(air_sensor) {}
+
+  const std::optional<pw::Result<uint16_t>>& result() const { return result_; }
+
+ private:
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) override {
+    if (!future_.has_value()) {
+      future_ = air_sensor_.MeasureAsync();
+    }
+    pw::async2::Poll<pw::Result<uint16_t>> poll = future_->Pend(cx);
+    if (poll.IsPending()) {
+      return pw::async2::Pending();
+    }
+    result_ = *poll;
+    return pw::async2::Ready();
+  }
+
+  AirSensor& air_sensor_;
+  std::optional<AirSensorMeasureFuture> future_;
+  std::optional<pw::Result<uint16_t>> result_;
+};
+
 class AirSensorTest : public ::testing::Test {
  protected:
   using Score = AirSensor::Score;
@@ -56,6 +85,29 @@ TEST_F(AirSensorTest, GetScoreBeforeMeasuring) {
   EXPECT_EQ(air_sensor_.score(), AirSensor::kAverageScore);
 }
 
+TEST_F(AirSensorTest, SnapshotBeforeMeasuring) {
+  AirSensor::Reading reading = air_sensor_.Snapshot();
+  EXPECT_EQ(reading.temperature, AirSensor::kDefaultTemperature);
+  EXPECT_EQ(reading.pressure, AirSensor::kDefaultPressure);
+  EXPECT_EQ(reading.humidity, AirSensor::kDefaultHumidity);
+  EXPECT_EQ(reading.gas_resistance, AirSensor::kDefaultGasResistance);
+  EXPECT_EQ(reading.score, AirSensor::kAverageScore);
+}
+
+TEST_F(AirSensorTest, SnapshotMatchesLastMeasurement) {
+  MeasureRange();
+  air_sensor_.set_temperature(25.f);
+  air_sensor_.set_gas_resistance(20000.f);
+  pw::Result<uint16_t> score = air_sensor_.MeasureSync();
+  ASSERT_EQ(score.status(), pw::OkStatus());
+
+  AirSensor::Reading reading = air_sensor_.Snapshot();
+  EXPECT_EQ(reading.temperature, 25.f);
+  EXPECT_EQ(reading.gas_resistance, 20000.f);
+  EXPECT_EQ(reading.score, *score);
+  EXPECT_EQ(air_sensor_.score(), *score);
+}
+
 TEST_F(AirSensorTest, MeasureOnce) {
   pw::Result<uint16_t> score = air_sensor_.MeasureSync();
   ASSERT_EQ(score.status(), pw::OkStatus());
@@ -143,4 +195,179 @@ TEST_F(AirSensorTest, MeasureAsync) {
   thread.join();
 }
 
+TEST_F(AirSensorTest, MeasureJoinsMeasurementInProgress) {
+  air_sensor_.set_autopublish(false);
+  pw::sync::ThreadNotification first;
+  pw::sync::ThreadNotification second;
+  ASSERT_EQ(air_sensor_.Measure(first), pw::OkStatus());
+  ASSERT_EQ(air_sensor_.Measure(second), pw::OkStatus());
+
+  pw::async2::Dispatcher dispatcher;
+  MeasureTask task(air_sensor_);
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  EXPECT_EQ(air_sensor_.num_measurements(), 1u);
+
+  pw::thread::test::TestThreadContext context;
+  pw::thread::Thread thread(context.options(),
+                            [this]() { air_sensor_.Publish(); });
+  first.acquire();
+  second.acquire();
+  thread.join();
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  EXPECT_TRUE(task.result().has_value());
+
+  // The next request starts a new measurement.
+  ASSERT_EQ(air_sensor_.Measure(first), pw::OkStatus());
+  EXPECT_EQ(air_sensor_.num_measurements(), 2u);
+  air_sensor_.Publish();
+  first.acquire();
+}
+
+TEST_F(AirSensorTest, MeasureTooManyWaiters) {
+  air_sensor_.set_autopublish(false);
+  std::array<pw::sync::ThreadNotification, AirSensor::kMaxWaiters + 1>
+      notifications;
+  for (size_t i = 0; i < AirSensor::kMaxWaiters; ++i) {
+    ASSERT_EQ(air_sensor_.Measure(notifications[i]), pw::OkStatus());
+  }
+  EXPECT_EQ(air_sensor_.Measure(notifications.back()),
+            pw::Status::ResourceExhausted());
+
+  air_sensor_.Publish();
+  for (size_t i = 0; i < AirSensor::kMaxWaiters; ++i) {
+    notifications[i].acquire();
+  }
+  EXPECT_FALSE(notifications.back().try_acquire());
+}
+
+TEST_F(AirSensorTest, MeasureAsyncCompletesImmediately) {
+  pw::async2::Dispatcher dispatcher;
+  MeasureTask task(air_sensor_);
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  ASSERT_EQ(task.result()->status(), pw::OkStatus());
+  EXPECT_EQ(**task.result(), AirSensor::kAverageScore);
+}
+
+TEST_F(AirSensorTest, MeasureAsyncWakesOnPublish) {
+  MeasureRange();
+  air_sensor_.set_autopublish(false);
+  air_sensor_.set_gas_resistance(20000.f);
+
+  pw::async2::Dispatcher dispatcher;
+  MeasureTask task(air_sensor_);
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  EXPECT_FALSE(task.result().has_value());
+
+  // Nothing changes until the measurement finishes.
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+
+  pw::thread::test::TestThreadContext context;
+  pw::thread::Thread thread(context.options(),
+                            [this]() { air_sensor_.Publish(); });
+  thread.join();
+
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  ASSERT_EQ(task.result()->status(), pw::OkStatus());
+  EXPECT_LT(**task.result(), 256);
+  EXPECT_EQ(**task.result(), air_sensor_.score());
+}
+
+TEST_F(AirSensorTest, MeasureAsyncWakesEveryAwaiter) {
+  air_sensor_.set_autopublish(false);
+
+  pw::async2::Dispatcher dispatcher;
+  MeasureTask first(air_sensor_);
+  MeasureTask second(air_sensor_);
+  dispatcher.Post(first);
+  dispatcher.Post(second);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  EXPECT_EQ(air_sensor_.num_measurements(), 1u);
+
+  pw::thread::test::TestThreadContext context;
+  pw::thread::Thread thread(context.options(),
+                            [this]() { air_sensor_.Publish(); });
+  thread.join();
+
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(first.result().has_value());
+  ASSERT_TRUE(second.result().has_value());
+  EXPECT_EQ(**first.result(), air_sensor_.score());
+  EXPECT_EQ(**second.result(), air_sensor_.score());
+}
+
+TEST_F(AirSensorTest, MeasureRecordsSampleTime) {
+  auto before = pw::chrono::SystemClock::now();
+  ASSERT_EQ(air_sensor_.MeasureSync().status(), pw::OkStatus());
+  auto after = pw::chrono::SystemClock::now();
+
+  AirSensor::Reading reading = air_sensor_.Snapshot();
+  EXPECT_GE(reading.timestamp, before);
+  EXPECT_LE(reading.timestamp, after);
+  EXPECT_LE(air_sensor_.sample_age(), pw::chrono::SystemClock::now() - before);
+}
+
+TEST_F(AirSensorTest, PipelinedMeasureReturnsLatestSample) {
+  AirSensorFake air_sensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(air_sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_EQ(air_sensor.num_measurements(), 1u);
+
+  // Later conversions complete without being requested.
+  air_sensor.set_autopublish(false);
+  air_sensor.set_temperature(25.f);
+  air_sensor.Publish();
+
+  pw::sync::ThreadNotification notification;
+  ASSERT_EQ(air_sensor.Measure(notification), pw::OkStatus());
+  EXPECT_TRUE(notification.try_acquire());
+  EXPECT_EQ(air_sensor.temperature(), 25.f);
+  EXPECT_EQ(air_sensor.num_measurements(), 1u);
+}
+
+TEST_F(AirSensorTest, PipelinedMeasureWaitsForFirstSample) {
+  AirSensorFake air_sensor(AirSensor::Mode::kPipelined);
+  air_sensor.set_autopublish(false);
+
+  pw::sync::ThreadNotification first;
+  pw::sync::ThreadNotification second;
+  ASSERT_EQ(air_sensor.Measure(first), pw::OkStatus());
+  ASSERT_EQ(air_sensor.Measure(second), pw::OkStatus());
+  EXPECT_FALSE(first.try_acquire());
+  EXPECT_FALSE(second.try_acquire());
+
+  air_sensor.Publish();
+  EXPECT_TRUE(first.try_acquire());
+  EXPECT_TRUE(second.try_acquire());
+  EXPECT_EQ(air_sensor.num_measurements(), 1u);
+}
+
+TEST_F(AirSensorTest, PipelinedMeasureAsyncCompletesImmediately) {
+  AirSensorFake air_sensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(air_sensor.MeasureSync().status(), pw::OkStatus());
+  air_sensor.set_autopublish(false);
+
+  pw::async2::Dispatcher dispatcher;
+  MeasureTask task(air_sensor);
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  ASSERT_EQ(task.result()->status(), pw::OkStatus());
+  EXPECT_EQ(**task.result(), air_sensor.score());
+}
+
+TEST_F(AirSensorTest, PipelinedMeasureRestartsAfterStop) {
+  AirSensorFake air_sensor(AirSensor::Mode::kPipelined);
+  ASSERT_EQ(air_sensor.MeasureSync().status(), pw::OkStatus());
+  ASSERT_EQ(air_sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_EQ(air_sensor.num_measurements(), 1u);
+
+  air_sensor.StopPipeline();
+  ASSERT_EQ(air_sensor.MeasureSync().status(), pw::OkStatus());
+  EXPECT_EQ(air_sensor.num_measurements(), 2u);
+}
+
 }  // namespace sense
@@ -0,0 +1,34 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+/// When nonzero, air quality scores are computed using fixed-point arithmetic
+/// instead of floating point.
+///
+/// This avoids soft-float emulation of `log`, `sqrt` and division on cores
+/// without an FPU, such as the RP2040's Cortex-M0+.
+#ifndef SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+#define SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE 0
+#endif  // SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+
+/// The number of measurements that air quality scores are relative to.
+///
+/// Scores compare each measurement to the mean and variance of roughly this
+/// many recent measurements. The default covers about an hour when measuring
+/// every 250 ms.
+#ifndef SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW
+#define SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW 14400
+#endif  // SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW
+
+static_assert(SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW >= 2);
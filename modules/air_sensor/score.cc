@@ -0,0 +1,194 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/score.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace sense {
+namespace {
+
+constexpr float kHumidityFactor = 0.04f;
+
+// `kHumidityFactor` with 32 fractional bits.
+constexpr int64_t kHumidityFactorQ32 = 171798692;
+
+// ln(2) with 32 fractional bits.
+constexpr int64_t kLn2Q32 = 2977044472;
+
+// ln(1 + i / 128) for i in [0, 129], with 32 fractional bits. The extra entry
+// past ln(2) lets the last interval be interpolated quadratically too.
+constexpr int kLogTableBits = 7;
+constexpr std::array<uint32_t, (1 << kLogTableBits) + 2> kLogTable = {
+    0x00000000, 0x01fe02a7, 0x03f81516, 0x05ee46c2,
+    0x07e0a6c4, 0x09cf43dd, 0x0bba2c7b, 0x0da16eb9,
+    0x0f851860, 0x116536ef, 0x1341d796, 0x151b073f,
+    0x16f0d28b, 0x18c345d6, 0x1a926d3a, 0x1c5e548f,
+    0x1e27076e, 0x1fec9132, 0x21aefcfa, 0x236e55aa,
+    0x252aa5f0, 0x26e3f840, 0x289a56da, 0x2a4dcbc7,
+    0x2bfe60e1, 0x2dac1fce, 0x2f571204, 0x30ff40ca,
+    0x32a4b53a, 0x34477840, 0x35e7929d, 0x37850ce8,
+    0x391fef8f, 0x3ab842d7, 0x3c4e0edc, 0x3de15b98,
+    0x3f7230db, 0x41009653, 0x428c938a, 0x44162fe7,
+    0x459d72af, 0x47226306, 0x48a507ef, 0x4a25684f,
+    0x4ba38aec, 0x4d1f766a, 0x4e993156, 0x5010c21a,
+    0x51862f08, 0x52f97e56, 0x546ab61d, 0x55d9dc5d,
+    0x5746f6fd, 0x58b20bcb, 0x5a1b207a, 0x5b823aa9,
+    0x5ce75fdb, 0x5e4a957f, 0x5fabe0ee, 0x610b4768,
+    0x6268ce1b, 0x63c47a1d, 0x651e5071, 0x66765604,
+    0x67cc8fb3, 0x69210244, 0x6a73b26a, 0x6bc4a4c9,
+    0x6d13ddef, 0x6e61625a, 0x6fad3677, 0x70f75e9f,
+    0x723fdf1e, 0x7386bc2e, 0x74cbf9f8, 0x760f9c96,
+    0x7751a813, 0x7892206a, 0x79d10987, 0x7b0e6749,
+    0x7c4a3d7f, 0x7d848fea, 0x7ebd623e, 0x7ff4b821,
+    0x812a952d, 0x825efced, 0x8391f2e1, 0x84c37a7b,
+    0x85f39721, 0x87224c2f, 0x884f9cf1, 0x897b8cad,
+    0x8aa61e98, 0x8bcf55df, 0x8cf735a3, 0x8e1dc0fc,
+    0x8f42faf4, 0x9066e68d, 0x918986be, 0x92aade75,
+    0x93caf094, 0x94e9bff6, 0x96074f6a, 0x9723a1b7,
+    0x983eb99a, 0x995899c9, 0x9a7144ed, 0x9b88bdaa,
+    0x9c9f069b, 0x9db42250, 0x9ec81354, 0x9fdadc27,
+    0xa0ec7f42, 0xa1fcff18, 0xa30c5e11, 0xa41a9e8f,
+    0xa527c2ee, 0xa633cd7e, 0xa73ec08e, 0xa8489e60,
+    0xa9516933, 0xaa59233d, 0xab5fceae, 0xac656dae,
+    0xad6a0262, 0xae6d8ee3, 0xaf701549, 0xb07197a2,
+    0xb17217f8, 0xb271984d,
+};
+
+}  // namespace
+
+uint16_t FloatScorer::Update(float humidity, float gas_resistance) {
+  ++count_;
+  quality_ = gas_resistance < 1.f
+                 ? 0.f
+                 : (std::log(gas_resistance) + kHumidityFactor * humidity);
+  statistics_.Add(quality_);
+
+  if (statistics_.count() < 2) {
+    return score_;
+  }
+  float stddev = std::sqrt(statistics_.variance());
+  if (stddev == 0.f) {
+    score_ = kAverageScore;
+    return score_;
+  }
+  float score = (statistics_.Deviation(quality_) / stddev) + 3.f;
+  score = std::min(std::max(score * 256.f, 0.f), static_cast<float>(kMaxScore));
+  score_ = static_cast<uint16_t>(score);
+  return score_;
+}
+
+uint16_t FixedPointScorer::Update(float humidity, float gas_resistance) {
+  // Keep all of the floats' precision, which matters when the readings barely
+  // vary: the humidity with 24 fractional bits, and the gas resistance scaled
+  // up to use all 32 bits, with the scale taken back out of its logarithm.
+  auto humidity_q24 = static_cast<int64_t>(humidity * 16777216.f);
+  int64_t quality = 0;
+  if (gas_resistance >= 1.f) {
+    int exponent = 0;
+    float mantissa =
+        std::frexp(std::min(gas_resistance, 4294967040.f), &exponent);
+    auto scaled = static_cast<uint32_t>(std::ldexp(mantissa, 32));
+    quality = Log(scaled) - (32 - exponent) * kLn2Q32 +
+              ((humidity_q24 * kHumidityFactorQ32) >> 24);
+  }
+  return UpdateQuality(quality);
+}
+
+uint16_t FixedPointScorer::Update(int32_t humidity_q16,
+                                  uint32_t gas_resistance) {
+  return UpdateQuality(gas_resistance == 0
+                           ? 0
+                           : Log(gas_resistance) +
+                                 ((humidity_q16 * kHumidityFactorQ32) >> 16));
+}
+
+uint16_t FixedPointScorer::UpdateQuality(int64_t quality) {
+  ++count_;
+  quality_ = quality;
+  statistics_.Add(quality_);
+
+  if (statistics_.count() < 2) {
+    return score_;
+  }
+  int64_t variance = statistics_.variance_q48();
+  if (variance <= 0) {
+    score_ = kAverageScore;
+    return score_;
+  }
+
+  // The square root of the variance has 24 fractional bits.
+  int64_t stddev = Sqrt(static_cast<uint64_t>(variance));
+  if (stddev == 0) {
+    score_ = kAverageScore;
+    return score_;
+  }
+
+  // Both of these have 8 fractional bits.
+  int64_t score = (quality_ - statistics_.mean()) * 256 / stddev + (3 << 16);
+  score = std::clamp<int64_t>(score, 0, kMaxScore << 8);
+  score_ = static_cast<uint16_t>(score >> 8);
+  return score_;
+}
+
+int64_t FixedPointScorer::Log(uint32_t x) {
+  // Split x into 2^k * m, where m is in [1, 2). Then ln(x) is k * ln(2) +
+  // ln(m), and ln(m) is interpolated from the table using the bits of m.
+  int k = 31 - std::countl_zero(x);
+  uint32_t fraction = (x << (31 - k)) & 0x7fffffff;
+  constexpr int kRemainderBits = 31 - kLogTableBits;
+  uint32_t index = fraction >> kRemainderBits;
+  uint32_t remainder = fraction & ((1u << kRemainderBits) - 1);
+
+  // Newton's forward interpolation through the three entries from `index`,
+  // with t = remainder / 2^kRemainderBits:
+  //
+  //   f(t) = f0 + t * (f1 - f0) + t * (t - 1) / 2 * (f2 - 2 * f1 + f0)
+  //
+  // Linear interpolation alone is off by up to 8e-6, which is several score
+  // units when the readings barely vary.
+  int64_t f0 = kLogTable[index];
+  int64_t f1 = kLogTable[index + 1];
+  int64_t f2 = kLogTable[index + 2];
+  int64_t t = remainder;
+  int64_t half_t_t_minus_1 = (t * (t - (int64_t{1} << kRemainderBits))) >>
+                             (kRemainderBits + 1);
+  int64_t interpolated = f0 + (((f1 - f0) * t) >> kRemainderBits) +
+                         (((f2 - 2 * f1 + f0) * half_t_t_minus_1) >>
+                          kRemainderBits);
+  return k * kLn2Q32 + interpolated;
+}
+
+uint32_t FixedPointScorer::Sqrt(uint64_t x) {
+  uint64_t result = 0;
+  uint64_t bit = uint64_t{1} << 62;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (x >= result + bit) {
+      x -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return static_cast<uint32_t>(result);
+}
+
+}  // namespace sense
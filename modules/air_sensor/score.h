@@ -0,0 +1,131 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/air_sensor/config.h"
+#include "modules/air_sensor/statistics.h"
+
+namespace sense {
+
+/// Computes air quality scores from gas resistance and humidity readings.
+///
+/// Each reading is reduced to a single air quality value, and the score
+/// reflects how many standard deviations that value is from the mean of recent
+/// readings, as tracked by `WindowedStatistics`. The score ranges from 0
+/// (terrible) to 1023 (excellent), with the mean mapping to 768.
+///
+/// This implementation uses floating point arithmetic.
+class FloatScorer {
+ public:
+  static constexpr uint16_t kAverageScore = 768;
+  static constexpr uint16_t kMaxScore = 1023;
+  static constexpr uint32_t kDefaultWindow =
+      SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW;
+
+  explicit FloatScorer(uint32_t window = kDefaultWindow)
+      : statistics_(window) {}
+
+  /// Adds a reading and returns the updated score.
+  uint16_t Update(float humidity, float gas_resistance);
+
+  uint16_t score() const { return score_; }
+
+  /// Returns the total number of readings.
+  uint32_t count() const { return count_; }
+
+  float quality() const { return quality_; }
+  float average() const { return statistics_.mean(); }
+  float variance() const { return statistics_.variance(); }
+
+ private:
+  uint16_t score_ = kAverageScore;
+  uint32_t count_ = 0;
+  float quality_ = 0.f;
+  WindowedStatistics statistics_;
+};
+
+/// Like `FloatScorer`, but uses only integer arithmetic.
+///
+/// Air quality values and their statistics are kept with 32 fractional bits,
+/// the logarithm is interpolated quadratically from a table, and the standard
+/// deviation is found with an integer square root. Scores are within one unit
+/// of `FloatScorer`'s.
+class FixedPointScorer {
+ public:
+  static constexpr uint16_t kAverageScore = FloatScorer::kAverageScore;
+  static constexpr uint16_t kMaxScore = FloatScorer::kMaxScore;
+  static constexpr uint32_t kDefaultWindow = FloatScorer::kDefaultWindow;
+
+  explicit FixedPointScorer(uint32_t window = kDefaultWindow)
+      : statistics_(window) {}
+
+  /// Adds a reading and returns the updated score.
+  ///
+  /// Converts the readings with floating point arithmetic, keeping all of
+  /// their precision. Used to compare against `FloatScorer`.
+  uint16_t Update(float humidity, float gas_resistance);
+
+  /// @copydoc `FixedPointScorer::Update`
+  ///
+  /// Humidity is given in 1/65536ths of a percent, and gas resistance in ohms.
+  /// Uses only integer arithmetic; this is the overload `AirSensor` uses.
+  uint16_t Update(int32_t humidity_q16, uint32_t gas_resistance);
+
+  uint16_t score() const { return score_; }
+
+  /// @copydoc `FloatScorer::count`
+  uint32_t count() const { return count_; }
+
+  // Conversions for reporting only.
+  float quality() const { return ToFloat(quality_); }
+  float average() const { return ToFloat(statistics_.mean()); }
+  float variance() const { return ToFloat(statistics_.variance()); }
+
+  /// Returns the natural logarithm of `x`, which must be nonzero, with 32
+  /// fractional bits.
+  static int64_t Log(uint32_t x);
+
+  /// Returns the integer square root of `x`, rounded down.
+  static uint32_t Sqrt(uint64_t x);
+
+ private:
+  static constexpr int kFractionalBits = 32;
+
+  // Adds a reading's air quality value, which has `kFractionalBits`
+  // fractional bits, and returns the updated score.
+  uint16_t UpdateQuality(int64_t quality);
+
+  static float ToFloat(int64_t value) {
+    return static_cast<float>(value) / static_cast<float>(1ull << 32);
+  }
+
+  uint16_t score_ = kAverageScore;
+  uint32_t count_ = 0;
+
+  // Has `kFractionalBits` fractional bits, as do the statistics.
+  int64_t quality_ = 0;
+  FixedPointWindowedStatistics statistics_;
+};
+
+/// The scorer used by `AirSensor`, as selected by
+/// `SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE`.
+#if SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+using AirQualityScorer = FixedPointScorer;
+#else
+using AirQualityScorer = FloatScorer;
+#endif  // SENSE_AIR_SENSOR_CONFIG_FIXED_POINT_SCORE
+
+}  // namespace sense
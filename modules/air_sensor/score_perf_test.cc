@@ -0,0 +1,37 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/score.h"
+#include "pw_perf_test/perf_test.h"
+
+namespace {
+
+// Compares the cost of scoring a reading with each scorer. On targets without
+// an FPU, `FloatScorer` is dominated by soft-float `log`, `sqrt` and division.
+
+template <typename Scorer>
+void ScoreReadings(pw::perf_test::State& state) {
+  Scorer scorer;
+  float gas_resistance = 50000.f;
+  while (state.KeepRunning()) {
+    gas_resistance =
+        gas_resistance < 100000.f ? gas_resistance + 37.f : 50000.f;
+    scorer.Update(40.f, gas_resistance);
+  }
+}
+
+PW_PERF_TEST(FloatScorerUpdate, ScoreReadings<sense::FloatScorer>);
+PW_PERF_TEST(FixedPointScorerUpdate, ScoreReadings<sense::FixedPointScorer>);
+
+}  // namespace
@@ -0,0 +1,206 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/score.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "modules/air_sensor/test_noise.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+using sense::FixedPointScorer;
+using sense::FloatScorer;
+using sense::TestNoise;
+
+// Feeds the same readings to both scorers and checks that they agree.
+template <typename Generator>
+void ExpectScoresMatch(int num_readings,
+                       Generator&& generate,
+                       uint32_t window = FloatScorer::kDefaultWindow) {
+  FloatScorer float_scorer(window);
+  FixedPointScorer fixed_scorer(window);
+  for (int i = 0; i < num_readings; ++i) {
+    auto [humidity, gas_resistance] = generate(i);
+    int expected = float_scorer.Update(humidity, gas_resistance);
+    int actual = fixed_scorer.Update(humidity, gas_resistance);
+    ASSERT_LE(std::abs(expected - actual), 1)
+        << "reading " << i << ": humidity=" << humidity
+        << ", gas_resistance=" << gas_resistance;
+  }
+  EXPECT_EQ(float_scorer.count(), fixed_scorer.count());
+  EXPECT_NEAR(float_scorer.average(), fixed_scorer.average(), 1e-3f);
+}
+
+struct Reading {
+  float humidity;
+  float gas_resistance;
+};
+
+TEST(FixedPointScorerTest, LogMatchesFloat) {
+  for (uint32_t x : {1u, 2u, 3u, 10u, 1000u, 50000u, 123457u, 4000000000u}) {
+    float expected = std::log(static_cast<float>(x));
+    float actual = static_cast<float>(FixedPointScorer::Log(x)) /
+                   static_cast<float>(1ull << 32);
+    EXPECT_NEAR(expected, actual, 1e-4f) << "x=" << x;
+  }
+}
+
+TEST(FixedPointScorerTest, LogIsPrecise) {
+  // Far more precise than a float, since scores resolve small fractions of the
+  // spread of readings that barely vary.
+  for (uint32_t x = 1; x < 4000000000u; x += 1 + x / 997) {
+    double expected = std::log(static_cast<double>(x));
+    double actual = static_cast<double>(FixedPointScorer::Log(x)) /
+                    static_cast<double>(1ull << 32);
+    ASSERT_NEAR(expected, actual, 1e-7) << "x=" << x;
+  }
+}
+
+TEST(FixedPointScorerTest, SqrtRoundsDown) {
+  EXPECT_EQ(FixedPointScorer::Sqrt(0), 0u);
+  EXPECT_EQ(FixedPointScorer::Sqrt(1), 1u);
+  EXPECT_EQ(FixedPointScorer::Sqrt(15), 3u);
+  EXPECT_EQ(FixedPointScorer::Sqrt(16), 4u);
+  EXPECT_EQ(FixedPointScorer::Sqrt(1ull << 62), 1u << 31);
+  EXPECT_EQ(FixedPointScorer::Sqrt(UINT64_MAX), UINT32_MAX);
+}
+
+TEST(FixedPointScorerTest, StartsAtAverage) {
+  FixedPointScorer scorer;
+  EXPECT_EQ(scorer.score(), FloatScorer::kAverageScore);
+  EXPECT_EQ(scorer.Update(40.f, 50000.f), FloatScorer::kAverageScore);
+  EXPECT_EQ(scorer.Update(40.f, 50000.f), FloatScorer::kAverageScore);
+}
+
+TEST(FixedPointScorerTest, ZeroGasResistance) {
+  ExpectScoresMatch(100, [](int i) {
+    return Reading{40.f, i % 10 == 0 ? 0.f : 50000.f + i};
+  });
+}
+
+// The data sets below approximate traces from a BME688 in various indoor
+// conditions.
+
+TEST(FixedPointScorerTest, MatchesFloatWhenSteady) {
+  TestNoise noise(1);
+  ExpectScoresMatch(5000, [&noise](int) {
+    return Reading{45.f + noise.Next(), 80000.f + 2000.f * noise.Next()};
+  });
+}
+
+TEST(FixedPointScorerTest, MatchesFloatWhenWarmingUp) {
+  // The gas resistance climbs as the heater plate burns off contaminants.
+  TestNoise noise(2);
+  ExpectScoresMatch(3000, [&noise](int i) {
+    float settled = 1.f - std::exp(-static_cast<float>(i) / 500.f);
+    return Reading{38.f + 0.5f * noise.Next(),
+                   5000.f + 120000.f * settled + 1000.f * noise.Next()};
+  });
+}
+
+TEST(FixedPointScorerTest, MatchesFloatWithPollutionEvents) {
+  // Periodic drops in gas resistance, as from cooking or cleaning products.
+  TestNoise noise(3);
+  ExpectScoresMatch(5000, [&noise](int i) {
+    bool polluted = (i / 250) % 4 == 3;
+    float gas_resistance = polluted ? 12000.f : 95000.f;
+    return Reading{polluted ? 60.f : 42.f + 2.f * noise.Next(),
+                   gas_resistance * (1.f + 0.05f * noise.Next())};
+  });
+}
+
+TEST(FixedPointScorerTest, MatchesFloatWithHumiditySwings) {
+  TestNoise noise(4);
+  ExpectScoresMatch(5000, [&noise](int i) {
+    float humidity = 50.f + 30.f * std::sin(static_cast<float>(i) / 300.f);
+    return Reading{humidity + noise.Next(), 60000.f + 500.f * noise.Next()};
+  });
+}
+
+TEST(FixedPointScorerTest, MatchesFloatOverWideRange) {
+  TestNoise noise(5);
+  ExpectScoresMatch(2000, [&noise](int) {
+    return Reading{50.f + 50.f * noise.Next(),
+                   std::exp(12.f + 4.f * noise.Next())};
+  });
+}
+
+TEST(FixedPointScorerTest, MatchesFloatWithLowNoise) {
+  // With readings this steady, a score unit is a tiny fraction of the gas
+  // resistance, so both scorers need to preserve every bit of their inputs.
+  for (float noise_level : {0.0005f, 0.001f, 0.002f, 0.005f, 0.01f}) {
+    for (float gas_resistance : {20000.f, 100000.f, 250000.f}) {
+      TestNoise noise(8);
+      ExpectScoresMatch(5000, [&](int) {
+        return Reading{45.f + 0.05f * noise.Next(),
+                       gas_resistance * (1.f + noise_level * noise.Next())};
+      });
+    }
+  }
+}
+
+TEST(FixedPointScorerTest, MatchesFloatAfterWindowFills) {
+  TestNoise noise(6);
+  ExpectScoresMatch(
+      20000,
+      [&noise](int i) {
+        bool polluted = (i / 1000) % 4 == 3;
+        return Reading{45.f + noise.Next(),
+                       (polluted ? 20000.f : 80000.f) + 2000.f * noise.Next()};
+      },
+      /*window=*/500);
+}
+
+TEST(FixedPointScorerTest, IntegerReadingsMatchFloat) {
+  // As `AirSensor` feeds the fixed point scorer: humidity in 1/65536ths of a
+  // percent, and gas resistance in whole ohms.
+  for (float noise_level : {0.001f, 0.01f, 0.05f}) {
+    TestNoise noise(9);
+    FloatScorer float_scorer;
+    FixedPointScorer fixed_scorer;
+    for (int i = 0; i < 5000; ++i) {
+      auto humidity_q16 = static_cast<int32_t>((45.f + noise.Next()) * 65536.f);
+      auto gas_resistance =
+          static_cast<uint32_t>(80000.f * (1.f + noise_level * noise.Next()));
+      int expected = float_scorer.Update(
+          static_cast<float>(humidity_q16) / 65536.f,
+          static_cast<float>(gas_resistance));
+      int actual = fixed_scorer.Update(humidity_q16, gas_resistance);
+      ASSERT_LE(std::abs(expected - actual), 1)
+          << "reading " << i << ": noise_level=" << noise_level;
+    }
+  }
+}
+
+TEST(FloatScorerTest, ForgetsOldReadings) {
+  FloatScorer scorer(100);
+  TestNoise noise(7);
+  for (int i = 0; i < 100000; ++i) {
+    scorer.Update(40.f, 80000.f + 1000.f * noise.Next());
+  }
+  EXPECT_EQ(scorer.count(), 100000u);
+
+  // A sustained drop scores badly at first, then becomes the new normal.
+  EXPECT_LT(scorer.Update(40.f, 40000.f), 256);
+  for (int i = 0; i < 1000; ++i) {
+    scorer.Update(40.f, 40000.f + 1000.f * noise.Next());
+  }
+  EXPECT_GT(scorer.Update(40.f, 40000.f), 512);
+}
+
+}  // namespace
@@ -0,0 +1,95 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace sense {
+
+/// Holds a value that is written by one thread and read by many, without
+/// readers ever blocking the writer or each other.
+///
+/// The value is double buffered. Each write goes to the buffer readers are not
+/// directed to, which is then published by bumping a sequence number. Readers
+/// copy the published buffer and retry if a newer value was published in the
+/// meantime. Since the published buffer is never being written to, a reader
+/// that preempts a writer does not have to wait for it to finish, which would
+/// never happen on a single core.
+///
+/// The value is stored as 32-bit words so that only plain atomic loads and
+/// stores are needed, which the Cortex-M0+ supports.
+template <typename T>
+class SeqLock {
+ public:
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  constexpr SeqLock() = default;
+
+  explicit SeqLock(const T& value) { Write(value); }
+
+  /// Publishes a new value. Writes must not be made concurrently.
+  void Write(const T& value) {
+    std::array<uint32_t, kWords> words = {};
+    std::memcpy(words.data(), &value, sizeof(T));
+
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    auto& buffer = buffers_[(sequence + 1) % 2];
+
+    // Readers that see any of the stores below also see that the buffer they
+    // are copying is no longer the published one.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+      buffer[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 1, std::memory_order_release);
+  }
+
+  /// Returns the most recently published value.
+  T Read() const {
+    std::array<uint32_t, kWords> words;
+    uint32_t sequence = sequence_.load(std::memory_order_acquire);
+    while (true) {
+      const auto& buffer = buffers_[sequence % 2];
+      for (size_t i = 0; i < kWords; ++i) {
+        words[i] = buffer[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // Once a newer value is published, the buffer that was copied is the
+      // next to be overwritten, and may have been rewritten already.
+      uint32_t current = sequence_.load(std::memory_order_relaxed);
+      if (current == sequence) {
+        break;
+      }
+      sequence = sequence_.load(std::memory_order_acquire);
+    }
+
+    T value;
+    std::memcpy(&value, words.data(), sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + 3) / 4;
+
+  std::atomic<uint32_t> sequence_ = 0;
+  std::array<std::array<std::atomic<uint32_t>, kWords>, 2> buffers_ = {};
+};
+
+}  // namespace sense
@@ -0,0 +1,82 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/seqlock.h"
+
+#include <atomic>
+
+#include "pw_thread/test_thread_context.h"
+#include "pw_thread/thread.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+using sense::SeqLock;
+
+struct Triple {
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+};
+
+TEST(SeqLockTest, ReadDefault) {
+  SeqLock<Triple> seqlock;
+  Triple value = seqlock.Read();
+  EXPECT_EQ(value.a, 0u);
+  EXPECT_EQ(value.b, 0u);
+  EXPECT_EQ(value.c, 0u);
+}
+
+TEST(SeqLockTest, ReadInitialValue) {
+  SeqLock<Triple> seqlock(Triple{.a = 1, .b = 2, .c = 3});
+  Triple value = seqlock.Read();
+  EXPECT_EQ(value.a, 1u);
+  EXPECT_EQ(value.b, 2u);
+  EXPECT_EQ(value.c, 3u);
+}
+
+TEST(SeqLockTest, ReadLatestWrite) {
+  SeqLock<float> seqlock;
+  for (float f = 0.f; f < 10.f; f += 1.f) {
+    seqlock.Write(f);
+    EXPECT_EQ(seqlock.Read(), f);
+  }
+}
+
+TEST(SeqLockTest, ReadsAreNeverTorn) {
+  constexpr uint32_t kWrites = 100000;
+  SeqLock<Triple> seqlock;
+  std::atomic<bool> done = false;
+
+  pw::thread::test::TestThreadContext context;
+  pw::thread::Thread writer(context.options(), [&seqlock, &done]() {
+    for (uint32_t i = 1; i <= kWrites; ++i) {
+      seqlock.Write({.a = i, .b = i * 2, .c = ~i});
+    }
+    done = true;
+  });
+
+  uint32_t last = 0;
+  while (!done) {
+    Triple value = seqlock.Read();
+    ASSERT_EQ(value.b, value.a * 2);
+    ASSERT_EQ(value.c, value.a == 0 ? 0u : ~value.a);
+    ASSERT_GE(value.a, last);
+    last = value.a;
+  }
+  writer.join();
+  EXPECT_EQ(seqlock.Read().a, kWrites);
+}
+
+}  // namespace
@@ -14,30 +14,84 @@
 
 #include "modules/air_sensor/service.h"
 
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
+#include "pw_result/result.h"
+#include "pw_span/span.h"
+#include "pw_status/try.h"
 
 namespace sense {
+namespace {
+
+air_sensor_Measurement ToMeasurement(const AirSensor::Reading& reading) {
+  auto age = pw::chrono::SystemClock::now() - reading.timestamp;
+  return {
+      .temperature = reading.temperature,
+      .pressure = reading.pressure,
+      .humidity = reading.humidity,
+      .gas_resistance = reading.gas_resistance,
+      .score = reading.score,
+      .sample_age_ms = static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(age).count()),
+  };
+}
 
-void AirSensorService::Init(Worker& worker, AirSensor& air_sensor) {
+pw::Result<AirSensor::HeaterMode> FromProto(air_sensor_HeaterMode mode) {
+  switch (mode) {
+    case air_sensor_HeaterMode_HEATER_MODE_FORCED:
+      return AirSensor::HeaterMode::kForced;
+    case air_sensor_HeaterMode_HEATER_MODE_SEQUENTIAL:
+      return AirSensor::HeaterMode::kSequential;
+    case air_sensor_HeaterMode_HEATER_MODE_PARALLEL:
+      return AirSensor::HeaterMode::kParallel;
+  }
+  return pw::Status::InvalidArgument();
+}
+
+}  // namespace
+
+void AirSensorService::Init(pw::async2::Dispatcher& dispatcher,
+                            Worker& worker,
+                            AirSensor& air_sensor) {
   worker_ = &worker;
   air_sensor_ = &air_sensor;
+  dispatcher.Post(measure_task_);
 }
 
-pw::Status AirSensorService::Measure(const pw_protobuf_Empty&,
-                                     air_sensor_Measurement& response) {
-  PW_TRY(air_sensor_->Measure(notification_));
-  notification_.acquire();
-  response.temperature = air_sensor_->temperature();
-  response.pressure = air_sensor_->pressure();
-  response.humidity = air_sensor_->humidity();
-  response.gas_resistance = air_sensor_->gas_resistance();
-  return pw::OkStatus();
+void AirSensorService::Measure(const pw_protobuf_Empty&,
+                               MeasureResponder& responder) {
+  auto call = measure_metrics_.Measure();
+  pw::async2::Waker waker;
+  bool accepted = false;
+  {
+    std::lock_guard lock(lock_);
+    if (!pending_measures_.full()) {
+      pending_measures_.push_back(std::move(responder));
+      waker = std::move(measure_waker_);
+      accepted = true;
+    }
+  }
+  if (!accepted) {
+    if (const auto status =
+            responder.Finish({}, pw::Status::ResourceExhausted());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+  std::move(waker).Wake();
 }
 
 void AirSensorService::MeasureStream(
     const air_sensor_MeasureStreamRequest& request,
     ServerWriter<air_sensor_Measurement>& writer) {
+  auto call = measure_stream_metrics_.Measure();
   if (request.sample_interval_ms < 500) {
     if (const auto status = writer.Finish(pw::Status::InvalidArgument());
         !status.ok()) {
@@ -48,31 +102,46 @@ void AirSensorService::MeasureStream(
 
   sample_interval_ = pw::chrono::SystemClock::for_at_least(
       std::chrono::milliseconds(request.sample_interval_ms));
-  sample_writer_ = std::move(writer);
+  measure_stream_metrics_.OpenStream(sample_writer_, writer);
 
   ScheduleSample();
 }
 
 pw::Status AirSensorService::LogMetrics(const pw_protobuf_Empty&,
                                         pw_protobuf_Empty&) {
+  auto call = log_metrics_metrics_.Measure();
   air_sensor_->LogMetrics();
   return pw::OkStatus();
 }
 
+pw::Status AirSensorService::SetHeaterProfile(
+    const air_sensor_HeaterProfile& request, pw_protobuf_Empty&) {
+  auto call = set_heater_profile_metrics_.Measure();
+  pw::Result<AirSensor::HeaterMode> heater_mode = FromProto(request.mode);
+  PW_TRY(heater_mode.status());
+
+  static_assert(std::extent_v<decltype(request.steps)> ==
+                AirSensor::kMaxHeaterSteps);
+  std::array<AirSensor::HeaterStep, AirSensor::kMaxHeaterSteps> steps;
+  for (size_t i = 0; i < request.steps_count; ++i) {
+    const air_sensor_HeaterStep& step = request.steps[i];
+    if (step.temperature_c > UINT16_MAX || step.duration_ms > UINT16_MAX) {
+      return pw::Status::InvalidArgument();
+    }
+    steps[i] = {
+        .temperature_c = static_cast<uint16_t>(step.temperature_c),
+        .duration_ms = static_cast<uint16_t>(step.duration_ms),
+    };
+  }
+  return air_sensor_->SetHeaterProfile(
+      *heater_mode, pw::span(steps.data(), request.steps_count));
+}
+
 void AirSensorService::SampleCallback(pw::chrono::SystemClock::time_point) {
-  float temperature = air_sensor_->temperature();
-  float pressure = air_sensor_->pressure();
-  float humidity = air_sensor_->humidity();
-  float gas_resistance = air_sensor_->gas_resistance();
-  uint16_t score = air_sensor_->score();
-
-  pw::Status status = sample_writer_.Write({
-      .temperature = temperature,
-      .pressure = pressure,
-      .humidity = humidity,
-      .gas_resistance = gas_resistance,
-      .score = score,
-  });
+  air_sensor_Measurement measurement = ToMeasurement(air_sensor_->Snapshot());
+
+  pw::Status status = measure_stream_metrics_.Write(
+      sample_writer_, measurement, air_sensor_Measurement_fields);
   if (status.ok()) {
     ScheduleSample();
   } else {
@@ -84,4 +153,50 @@ void AirSensorService::ScheduleSample() {
   worker_->RunOnce([this]() { sample_timer_.InvokeAfter(sample_interval_); });
 }
 
+void AirSensorService::RespondToMeasures(pw::Status status) {
+  pw::Vector<MeasureResponder, kMaxPendingMeasures> responders;
+  {
+    std::lock_guard lock(lock_);
+    for (MeasureResponder& responder : pending_measures_) {
+      responders.push_back(std::move(responder));
+    }
+    pending_measures_.clear();
+  }
+
+  air_sensor_Measurement response = air_sensor_Measurement_init_default;
+  if (status.ok()) {
+    response = ToMeasurement(air_sensor_->Snapshot());
+  }
+  for (MeasureResponder& responder : responders) {
+    if (const auto finish_status = responder.Finish(response, status);
+        !finish_status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", finish_status.str());
+    }
+  }
+}
+
+pw::async2::Poll<> AirSensorService::MeasureTask::DoPend(
+    pw::async2::Context& cx) {
+  while (true) {
+    if (!future_.has_value()) {
+      {
+        std::lock_guard lock(service_.lock_);
+        if (service_.pending_measures_.empty()) {
+          service_.measure_waker_ =
+              cx.GetWaker(pw::async2::WaitReason::Unspecified());
+          return pw::async2::Pending();
+        }
+      }
+      future_ = service_.air_sensor_->MeasureAsync();
+    }
+
+    pw::async2::Poll<pw::Result<uint16_t>> score = future_->Pend(cx);
+    if (score.IsPending()) {
+      return pw::async2::Pending();
+    }
+    future_.reset();
+    service_.RespondToMeasures(score->status());
+  }
+}
+
 }  // namespace sense
@@ -13,14 +13,21 @@
 // the License.
 #pragma once
 
+#include <optional>
+
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/air_sensor/air_sensor.rpc.pb.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 #include "modules/worker/worker.h"
+#include "pw_async2/dispatcher.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_chrono/system_timer.h"
+#include "pw_containers/vector.h"
 #include "pw_function/function.h"
+#include "pw_rpc/nanopb/server_reader_writer.h"
 #include "pw_status/status.h"
-#include "pw_sync/thread_notification.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
 
 namespace sense {
 
@@ -28,31 +35,82 @@ class AirSensorService final
     : public ::air_sensor::pw_rpc::nanopb::AirSensor::Service<
           AirSensorService> {
  public:
+  /// Maximum number of `Measure` calls that may wait on a measurement.
+  static constexpr size_t kMaxPendingMeasures = 4;
+
+  using MeasureResponder =
+      pw::rpc::NanopbUnaryResponder<air_sensor_Measurement>;
+
   AirSensorService()
       : sample_timer_(
-            pw::bind_member<&AirSensorService::SampleCallback>(this)) {}
+            pw::bind_member<&AirSensorService::SampleCallback>(this)),
+        measure_task_(*this) {}
 
-  void Init(Worker& worker, AirSensor& air_sensor);
+  void Init(pw::async2::Dispatcher& dispatcher,
+            Worker& worker,
+            AirSensor& air_sensor);
 
-  pw::Status Measure(const pw_protobuf_Empty&,
-                     air_sensor_Measurement& response);
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  /// Responds with the results of the next air measurement.
+  ///
+  /// Calls made while a measurement is in progress, including one started by
+  /// another user of the sensor, share its results instead of starting another.
+  void Measure(const pw_protobuf_Empty&, MeasureResponder& responder);
 
   void MeasureStream(const air_sensor_MeasureStreamRequest& request,
                      ServerWriter<air_sensor_Measurement>& writer);
 
   pw::Status LogMetrics(const pw_protobuf_Empty&, pw_protobuf_Empty&);
 
+  pw::Status SetHeaterProfile(const air_sensor_HeaterProfile& request,
+                              pw_protobuf_Empty&);
+
  private:
+  /// Measures whenever `Measure` calls are pending, and responds to them.
+  class MeasureTask : public pw::async2::Task {
+   public:
+    explicit MeasureTask(AirSensorService& service) : service_(service) {}
+
+   private:
+    pw::async2::Poll<> DoPend(pw::async2::Context& cx) override;
+
+    AirSensorService& service_;
+    std::optional<AirSensorMeasureFuture> future_;
+  };
+
   void SampleCallback(pw::chrono::SystemClock::time_point);
 
   void ScheduleSample();
 
+  /// Finishes all pending `Measure` calls.
+  void RespondToMeasures(pw::Status status) PW_LOCKS_EXCLUDED(lock_);
+
   Worker* worker_ = nullptr;
   AirSensor* air_sensor_ = nullptr;
-  pw::sync::ThreadNotification notification_;
   pw::chrono::SystemTimer sample_timer_;
   pw::chrono::SystemClock::duration sample_interval_;
   ServerWriter<air_sensor_Measurement> sample_writer_;
+
+  MeasureTask measure_task_;
+
+  // Moving and destroying responders takes pw_rpc's lock, so they are guarded
+  // by a mutex rather than a spin lock. Responders are only finished once they
+  // have been taken out from under it.
+  pw::sync::Mutex lock_;
+  pw::Vector<MeasureResponder, kMaxPendingMeasures> pending_measures_
+      PW_GUARDED_BY(lock_);
+  pw::async2::Waker measure_waker_ PW_GUARDED_BY(lock_);
+
+  RpcServiceMetrics method_metrics_{"AirSensor"};
+  RpcMethodMetrics measure_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(AirSensorService, Measure)};
+  RpcMethodMetrics measure_stream_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(AirSensorService, MeasureStream)};
+  RpcMethodMetrics log_metrics_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(AirSensorService, LogMetrics)};
+  RpcMethodMetrics set_heater_profile_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(AirSensorService, SetHeaterProfile)};
 };
 
 }  // namespace sense
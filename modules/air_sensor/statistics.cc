@@ -0,0 +1,98 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/statistics.h"
+
+namespace sense {
+namespace {
+
+// Divides and rounds to the nearest integer.
+int64_t DivideRounded(int64_t dividend, int64_t divisor) {
+  int64_t half = divisor / 2;
+  return (dividend < 0 ? dividend - half : dividend + half) / divisor;
+}
+
+}  // namespace
+
+// With a weight of `a` for the new sample, the weighted mean and variance are
+// updated as:
+//
+//   mean' = mean + a * delta
+//   variance' = (1 - a) * (variance + a * delta^2)
+//
+// While `a` is 1 / count, these are the population mean and variance of every
+// sample, as in Welford's algorithm.
+
+void WindowedStatistics::Add(float value) {
+  if (count_ < window_) {
+    ++count_;
+  }
+  float delta = Deviation(value);
+
+  // Kahan summation of the mean's steps.
+  float step = (delta / count_) - mean_compensation_;
+  float mean = mean_ + step;
+  mean_compensation_ = (mean - mean_) - step;
+  mean_ = mean;
+
+  float variance = weighted_variance_ + (delta * delta / count_);
+  weighted_variance_ = variance - (variance / count_);
+}
+
+void WindowedStatistics::Reset() {
+  count_ = 0;
+  mean_ = 0.f;
+  mean_compensation_ = 0.f;
+  weighted_variance_ = 0.f;
+}
+
+float WindowedStatistics::variance() const {
+  if (count_ < 2) {
+    return 0.f;
+  }
+  return weighted_variance_ + (weighted_variance_ / (count_ - 1));
+}
+
+void FixedPointWindowedStatistics::Add(int64_t value) {
+  if (count_ < window_) {
+    ++count_;
+  }
+  int64_t delta = value - mean_;
+  mean_ += DivideRounded(delta, count_);
+
+  // Drop some precision from delta so its square fits in 64 bits.
+  int64_t delta_q24 = delta >> 8;
+  int64_t variance =
+      weighted_variance_ + DivideRounded(delta_q24 * delta_q24, count_);
+  weighted_variance_ = variance - DivideRounded(variance, count_);
+}
+
+void FixedPointWindowedStatistics::Reset() {
+  count_ = 0;
+  mean_ = 0;
+  weighted_variance_ = 0;
+}
+
+int64_t FixedPointWindowedStatistics::variance() const {
+  return DivideRounded(variance_q48(), int64_t{1} << 16);
+}
+
+int64_t FixedPointWindowedStatistics::variance_q48() const {
+  if (count_ < 2) {
+    return 0;
+  }
+  return weighted_variance_ + DivideRounded(weighted_variance_, count_ - 1);
+}
+
+}  // namespace sense
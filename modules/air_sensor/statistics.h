@@ -0,0 +1,111 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+namespace sense {
+
+/// Running mean and variance over a bounded window of recent samples.
+///
+/// Until `window` samples have been added, every sample is weighted equally,
+/// exactly as in Welford's algorithm. After that, each new sample is weighted
+/// by `1 / window` and older samples decay exponentially, so the statistics
+/// keep tracking changes no matter how long the device has been running.
+///
+/// Adding a sample takes constant time and memory regardless of the window.
+/// With a window of thousands of samples, each sample moves the mean by less
+/// than a float can resolve, so the mean is updated with Kahan summation; the
+/// compensation carries the low-order bits that a plain float mean would drop,
+/// and would stop following slow drifts without.
+class WindowedStatistics {
+ public:
+  /// @param window The number of samples the statistics approximately cover.
+  ///               Must be at least 2.
+  explicit constexpr WindowedStatistics(uint32_t window) : window_(window) {}
+
+  void Add(float value);
+
+  /// Forgets all samples.
+  void Reset();
+
+  uint32_t window() const { return window_; }
+
+  /// Returns the number of samples added, up to the window length.
+  uint32_t count() const { return count_; }
+
+  float mean() const { return mean_; }
+
+  /// Returns `value` minus the mean, including the mean's compensation.
+  float Deviation(float value) const {
+    return (value - mean_) + mean_compensation_;
+  }
+
+  /// Returns the sample variance, or 0 if fewer than 2 samples were added.
+  float variance() const;
+
+ private:
+  uint32_t window_;
+  uint32_t count_ = 0;
+  float mean_ = 0.f;
+
+  // What has been lost to rounding from `mean_`, negated: the mean is
+  // `mean_ - mean_compensation_`.
+  float mean_compensation_ = 0.f;
+
+  // Variance of the samples weighted by 1 / `count_`, before correcting for
+  // bias.
+  float weighted_variance_ = 0.f;
+};
+
+/// Like `WindowedStatistics`, but uses only integer arithmetic.
+///
+/// Samples, the mean and the variance are fixed-point values with 32 fractional
+/// bits. The variance is accumulated with 48 fractional bits, so that it stays
+/// precise when samples barely vary. Samples should differ from the mean by
+/// less than 2^7 for the variance to remain in range.
+class FixedPointWindowedStatistics {
+ public:
+  /// @copydoc `WindowedStatistics::WindowedStatistics`
+  explicit constexpr FixedPointWindowedStatistics(uint32_t window)
+      : window_(window) {}
+
+  void Add(int64_t value);
+
+  /// @copydoc `WindowedStatistics::Reset`
+  void Reset();
+
+  uint32_t window() const { return window_; }
+
+  /// @copydoc `WindowedStatistics::count`
+  uint32_t count() const { return count_; }
+
+  int64_t mean() const { return mean_; }
+
+  /// @copydoc `WindowedStatistics::variance`
+  int64_t variance() const;
+
+  /// Returns the variance with 48 fractional bits.
+  int64_t variance_q48() const;
+
+ private:
+  uint32_t window_;
+  uint32_t count_ = 0;
+  int64_t mean_ = 0;
+
+  // Has 48 fractional bits.
+  int64_t weighted_variance_ = 0;
+};
+
+}  // namespace sense
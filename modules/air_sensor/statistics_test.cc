@@ -0,0 +1,181 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/air_sensor/statistics.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "modules/air_sensor/config.h"
+#include "modules/air_sensor/test_noise.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+using sense::FixedPointWindowedStatistics;
+using sense::TestNoise;
+using sense::WindowedStatistics;
+
+constexpr float kScale = static_cast<float>(1ull << 32);
+
+int64_t ToFixed(float value) { return static_cast<int64_t>(value * kScale); }
+float ToFloat(int64_t value) { return static_cast<float>(value) / kScale; }
+
+// Roughly the range of air quality values seen in practice.
+constexpr float kMean = 11.f;
+constexpr float kAmplitude = 0.5f;
+constexpr float kVariance = kAmplitude * kAmplitude / 3.f;
+
+constexpr int kMillionsOfSamples = 2'000'000;
+
+TEST(WindowedStatisticsTest, Empty) {
+  WindowedStatistics statistics(16);
+  EXPECT_EQ(statistics.count(), 0u);
+  EXPECT_EQ(statistics.mean(), 0.f);
+  EXPECT_EQ(statistics.variance(), 0.f);
+
+  statistics.Add(kMean);
+  EXPECT_EQ(statistics.count(), 1u);
+  EXPECT_EQ(statistics.mean(), kMean);
+  EXPECT_EQ(statistics.variance(), 0.f);
+}
+
+TEST(WindowedStatisticsTest, MatchesSampleStatisticsBeforeWindowFills) {
+  WindowedStatistics statistics(1000);
+  TestNoise noise(1);
+  double sum = 0.;
+  double sum_of_squares = 0.;
+  for (int i = 0; i < 1000; ++i) {
+    float value = kMean + kAmplitude * noise.Next();
+    statistics.Add(value);
+    sum += value;
+    sum_of_squares += static_cast<double>(value) * value;
+  }
+  double mean = sum / 1000;
+  double variance = (sum_of_squares - sum * mean) / 999;
+  EXPECT_EQ(statistics.count(), 1000u);
+  EXPECT_NEAR(statistics.mean(), mean, 1e-4);
+  EXPECT_NEAR(statistics.variance(), variance, 1e-4);
+}
+
+TEST(WindowedStatisticsTest, CountStopsAtWindow) {
+  WindowedStatistics statistics(16);
+  for (int i = 0; i < 100; ++i) {
+    statistics.Add(kMean);
+  }
+  EXPECT_EQ(statistics.count(), 16u);
+  EXPECT_EQ(statistics.window(), 16u);
+}
+
+TEST(WindowedStatisticsTest, Reset) {
+  WindowedStatistics statistics(16);
+  statistics.Add(1.f);
+  statistics.Add(2.f);
+  statistics.Reset();
+  EXPECT_EQ(statistics.count(), 0u);
+  EXPECT_EQ(statistics.mean(), 0.f);
+  EXPECT_EQ(statistics.variance(), 0.f);
+}
+
+TEST(WindowedStatisticsTest, StableOverMillionsOfSamples) {
+  WindowedStatistics statistics(14400);
+  TestNoise noise(2);
+  for (int i = 0; i < kMillionsOfSamples; ++i) {
+    statistics.Add(kMean + kAmplitude * noise.Next());
+  }
+  EXPECT_NEAR(statistics.mean(), kMean, 0.01f);
+  EXPECT_NEAR(statistics.variance(), kVariance, kVariance * 0.05f);
+}
+
+TEST(WindowedStatisticsTest, TracksChangesAfterMillionsOfSamples) {
+  WindowedStatistics statistics(1000);
+  TestNoise noise(3);
+  for (int i = 0; i < kMillionsOfSamples; ++i) {
+    statistics.Add(kMean + kAmplitude * noise.Next());
+  }
+
+  // After a step change, the old samples decay by a factor of e for each
+  // window's worth of new samples.
+  for (int i = 0; i < 5000; ++i) {
+    statistics.Add(kMean + 1.f + kAmplitude * noise.Next());
+  }
+  EXPECT_NEAR(statistics.mean(), kMean + 1.f, 0.05f);
+
+  // The variance settles back down once the step has passed.
+  for (int i = 0; i < 10000; ++i) {
+    statistics.Add(kMean + 1.f + kAmplitude * noise.Next());
+  }
+  EXPECT_NEAR(statistics.variance(), kVariance, kVariance * 0.2f);
+}
+
+TEST(WindowedStatisticsTest, FollowsSlowDriftOverScoreWindow) {
+  constexpr uint32_t kWindow = SENSE_AIR_SENSOR_CONFIG_SCORE_WINDOW;
+  constexpr int kSamples = 100000;
+  constexpr float kStep = 0.005f / kSamples;
+  WindowedStatistics statistics(kWindow);
+
+  // Each sample moves the mean by far less than a float's resolution at 13.
+  float value = 0.f;
+  for (int i = 0; i < kSamples; ++i) {
+    value = 13.f + 0.005f * static_cast<float>(i) / kSamples;
+    statistics.Add(value);
+  }
+
+  // Once the window has filled, the mean trails a ramp by a window's worth of
+  // steps.
+  EXPECT_NEAR(statistics.mean(), value - kStep * (kWindow - 1), 2e-5f);
+}
+
+TEST(FixedPointWindowedStatisticsTest, Empty) {
+  FixedPointWindowedStatistics statistics(16);
+  EXPECT_EQ(statistics.count(), 0u);
+  EXPECT_EQ(statistics.mean(), 0);
+  EXPECT_EQ(statistics.variance(), 0);
+
+  statistics.Add(ToFixed(kMean));
+  EXPECT_EQ(statistics.count(), 1u);
+  EXPECT_EQ(statistics.mean(), ToFixed(kMean));
+  EXPECT_EQ(statistics.variance(), 0);
+}
+
+TEST(FixedPointWindowedStatisticsTest, Reset) {
+  FixedPointWindowedStatistics statistics(16);
+  statistics.Add(ToFixed(1.f));
+  statistics.Add(ToFixed(2.f));
+  statistics.Reset();
+  EXPECT_EQ(statistics.count(), 0u);
+  EXPECT_EQ(statistics.mean(), 0);
+  EXPECT_EQ(statistics.variance(), 0);
+}
+
+TEST(FixedPointWindowedStatisticsTest, MatchesFloatOverMillionsOfSamples) {
+  WindowedStatistics expected(1000);
+  FixedPointWindowedStatistics actual(1000);
+  TestNoise noise(4);
+  for (int i = 0; i < kMillionsOfSamples; ++i) {
+    // Drift slowly so that the window is always catching up.
+    float drift = std::sin(static_cast<float>(i) / 20000.f);
+    float value = kMean + drift + kAmplitude * noise.Next();
+    expected.Add(value);
+    actual.Add(ToFixed(value));
+    if (i % 1000 == 0) {
+      ASSERT_NEAR(ToFloat(actual.mean()), expected.mean(), 1e-3f) << i;
+      ASSERT_NEAR(ToFloat(actual.variance()), expected.variance(), 1e-3f)
+          << i;
+    }
+  }
+  EXPECT_NEAR(ToFloat(actual.variance()), kVariance, kVariance * 0.2f);
+}
+
+}  // namespace
@@ -13,12 +13,23 @@
 // the License.
 #pragma once
 
-#include "pw_thread/thread.h"
+#include <cstdint>
 
 namespace sense {
 
-/// Thread options to use for the sampling thread. Must be implemented by the
-/// target.
-const pw::thread::Options& SamplingThreadOptions();
+/// Deterministic pseudo-random numbers in [-1, 1), with a variance of 1/3, for
+/// simulating noisy sensor readings in tests.
+class TestNoise {
+ public:
+  explicit TestNoise(uint32_t seed) : state_(seed) {}
+
+  float Next() {
+    state_ = state_ * 1664525u + 1013904223u;
+    return static_cast<float>(state_ >> 8) / static_cast<float>(1u << 23) - 1.f;
+  }
+
+ private:
+  uint32_t state_;
+};
 
 }  // namespace sense
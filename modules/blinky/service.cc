@@ -30,24 +30,28 @@ void BlinkyService::Init(pw::async2::Dispatcher& dispatcher,
 
 pw::Status BlinkyService::ToggleLed(const pw_protobuf_Empty&,
                                     pw_protobuf_Empty&) {
+  auto call = toggle_led_metrics_.Measure();
   blinky_.Toggle();
   return pw::OkStatus();
 }
 
 pw::Status BlinkyService::SetLed(const blinky_SetLedRequest& request,
                                  pw_protobuf_Empty&) {
+  auto call = set_led_metrics_.Measure();
   blinky_.SetLed(request.on);
   return pw::OkStatus();
 }
 
 pw::Status BlinkyService::IsIdle(const pw_protobuf_Empty&,
                                  blinky_BlinkIdleResponse& response) {
+  auto call = is_idle_metrics_.Measure();
   response.is_idle = blinky_.IsIdle();
   return pw::OkStatus();
 }
 
 pw::Status BlinkyService::Blink(const blinky_BlinkRequest& request,
                                 pw_protobuf_Empty&) {
+  auto call = blink_metrics_.Measure();
   uint32_t interval_ms = request.interval_ms == 0 ? Blinky::kDefaultIntervalMs
                                                   : request.interval_ms;
   uint32_t blink_count = request.has_blink_count ? request.blink_count : 0;
@@ -56,6 +60,7 @@ pw::Status BlinkyService::Blink(const blinky_BlinkRequest& request,
 
 pw::Status BlinkyService::Pulse(const blinky_CycleRequest& request,
                                 pw_protobuf_Empty&) {
+  auto call = pulse_metrics_.Measure();
   uint32_t interval_ms = request.interval_ms == 0 ? 1000 : request.interval_ms;
   blinky_.Pulse(interval_ms);
   return pw::OkStatus();
@@ -63,6 +68,7 @@ pw::Status BlinkyService::Pulse(const blinky_CycleRequest& request,
 
 pw::Status BlinkyService::SetRgb(const blinky_RgbRequest& request,
                                  pw_protobuf_Empty&) {
+  auto call = set_rgb_metrics_.Measure();
   uint8_t red = static_cast<uint8_t>(request.hex >> 16);
   uint8_t green = static_cast<uint8_t>(request.hex >> 8);
   uint8_t blue = static_cast<uint8_t>(request.hex);
@@ -73,6 +79,7 @@ pw::Status BlinkyService::SetRgb(const blinky_RgbRequest& request,
 
 pw::Status BlinkyService::Rainbow(const blinky_CycleRequest& request,
                                   pw_protobuf_Empty&) {
+  auto call = rainbow_metrics_.Measure();
   uint32_t interval_ms = request.interval_ms == 0 ? 1000 : request.interval_ms;
   blinky_.Rainbow(interval_ms);
   return pw::OkStatus();
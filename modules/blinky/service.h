@@ -15,6 +15,7 @@
 
 #include "modules/blinky/blinky.h"
 #include "modules/blinky/blinky_pb/blinky.rpc.pb.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 #include "pw_allocator/allocator.h"
 #include "pw_async2/dispatcher.h"
 
@@ -28,6 +29,8 @@ class BlinkyService final
             MonochromeLed& monochrome_led,
             PolychromeLed& polychrome_led);
 
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
   pw::Status ToggleLed(const pw_protobuf_Empty&, pw_protobuf_Empty&);
 
   pw::Status SetLed(const blinky_SetLedRequest& request, pw_protobuf_Empty&);
@@ -45,6 +48,22 @@ class BlinkyService final
 
  private:
   Blinky blinky_;
+
+  RpcServiceMetrics method_metrics_{"Blinky"};
+  RpcMethodMetrics toggle_led_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(BlinkyService, ToggleLed)};
+  RpcMethodMetrics set_led_metrics_{method_metrics_,
+                                    SENSE_RPC_METHOD(BlinkyService, SetLed)};
+  RpcMethodMetrics blink_metrics_{method_metrics_,
+                                  SENSE_RPC_METHOD(BlinkyService, Blink)};
+  RpcMethodMetrics pulse_metrics_{method_metrics_,
+                                  SENSE_RPC_METHOD(BlinkyService, Pulse)};
+  RpcMethodMetrics set_rgb_metrics_{method_metrics_,
+                                    SENSE_RPC_METHOD(BlinkyService, SetRgb)};
+  RpcMethodMetrics rainbow_metrics_{method_metrics_,
+                                    SENSE_RPC_METHOD(BlinkyService, Rainbow)};
+  RpcMethodMetrics is_idle_metrics_{method_metrics_,
+                                    SENSE_RPC_METHOD(BlinkyService, IsIdle)};
 };
 
 }  // namespace sense
@@ -33,11 +33,13 @@ void BoardService::Init(Worker& worker, Board& board) {
 
 pw::Status BoardService::Reboot(const board_RebootRequest& request,
                                 pw_protobuf_Empty& /*response*/) {
+  auto call = reboot_metrics_.Measure();
   return board_->Reboot(request.reboot_type);
 }
 
 pw::Status BoardService::OnboardTemp(const pw_protobuf_Empty& /*request*/,
                                      board_OnboardTempResponse& response) {
+  auto call = onboard_temp_metrics_.Measure();
   response.temp = board_->ReadInternalTemperature();
   return pw::OkStatus();
 }
@@ -45,6 +47,7 @@ pw::Status BoardService::OnboardTemp(const pw_protobuf_Empty& /*request*/,
 void BoardService::OnboardTempStream(
     const board_OnboardTempStreamRequest& request,
     ServerWriter<board_OnboardTempResponse>& writer) {
+  auto call = onboard_temp_stream_metrics_.Measure();
   if (request.sample_interval_ms < 100) {
     if (const auto status = writer.Finish(pw::Status::InvalidArgument());
         !status.ok()) {
@@ -55,7 +58,7 @@ void BoardService::OnboardTempStream(
 
   temp_sample_interval_ = pw::chrono::SystemClock::for_at_least(
       std::chrono::milliseconds(request.sample_interval_ms));
-  temp_sample_writer_ = std::move(writer);
+  onboard_temp_stream_metrics_.OpenStream(temp_sample_writer_, writer);
 
   ScheduleTempSample();
 }
@@ -63,7 +66,10 @@ void BoardService::OnboardTempStream(
 void BoardService::TempSampleCallback() {
   float temp = board_->ReadInternalTemperature();
 
-  pw::Status status = temp_sample_writer_.Write({.temp = temp});
+  pw::Status status = onboard_temp_stream_metrics_.Write(
+      temp_sample_writer_,
+      board_OnboardTempResponse{.temp = temp},
+      board_OnboardTempResponse_fields);
   if (status.ok()) {
     ScheduleTempSample();
   } else {
@@ -15,6 +15,7 @@
 
 #include "modules/board/board.h"
 #include "modules/board/board.rpc.pb.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 #include "modules/worker/worker.h"
 #include "pw_chrono/system_timer.h"
 #include "pw_status/status.h"
@@ -28,6 +29,8 @@ class BoardService final
 
   void Init(Worker& worker, Board& board);
 
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
   pw::Status Reboot(const board_RebootRequest& request,
                     pw_protobuf_Empty& /*response*/);
 
@@ -47,6 +50,14 @@ class BoardService final
   pw::chrono::SystemTimer temp_sample_timer_;
   pw::chrono::SystemClock::duration temp_sample_interval_;
   ServerWriter<board_OnboardTempResponse> temp_sample_writer_;
+
+  RpcServiceMetrics method_metrics_{"Board"};
+  RpcMethodMetrics reboot_metrics_{method_metrics_,
+                                   SENSE_RPC_METHOD(BoardService, Reboot)};
+  RpcMethodMetrics onboard_temp_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(BoardService, OnboardTemp)};
+  RpcMethodMetrics onboard_temp_stream_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(BoardService, OnboardTempStream)};
 };
 
 }  // namespace sense
@@ -24,7 +24,8 @@ namespace sense {
 ///   - `PubSub`: Type of the PubSub object (`sense::GenericPubSub<EventType>`)
 ///   - `Sample`: The sample type (e.g. `uint16_t`).
 ///   - `SampleEvent`: Event type to subscribe to for samples.
-///   - `GetSample(SampleEvent)`: Returns the sample from the sample event.
+///   - `GetSamples(SampleEvent)`: Returns the samples in the sample event, as
+///     a range to be iterated in the order they were taken.
 ///   - `GetEvent(Edge)`: Returns event to publish when an edge is detected.
 template <typename PubSubSamplerMeta>
 class PubSubHysteresisEdgeDetector
@@ -41,7 +42,9 @@ class PubSubHysteresisEdgeDetector
         pubsub_(pubsub) {
     PW_ASSERT(
         pubsub_.template SubscribeTo<SampleEvent>([this](SampleEvent event) {
-          Update(PubSubSamplerMeta::GetSample(event));
+          for (Sample sample : PubSubSamplerMeta::GetSamples(event)) {
+            Update(sample);
+          }
         }));
   }
 
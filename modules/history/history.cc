@@ -0,0 +1,148 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/history/history.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sense {
+namespace {
+
+// Core temperatures are stored in hundredths of a degree, offset so that
+// temperatures down to -100 degrees remain positive.
+constexpr float kCoreTemperatureScale = 100.f;
+constexpr float kCoreTemperatureOffset = 100.f;
+
+// Ambient light spans from well below 1 lux indoors at night to tens of
+// thousands of lux in sunlight, so it is stored as log2(1 + lux) in 1/2048
+// steps: 0.03% of the reading, and never coarser than 0.0004 lux below 1 lux.
+constexpr float kAmbientLightScale = 2048.f;
+
+}  // namespace
+
+// The history is kept in RAM for the life of the device, which on the RP2040
+// is 264 KB shared with everything else.
+static_assert(sizeof(History) <= 13 * 1024);
+
+History::History() : ranges_{} {
+  for (auto& bucket : means_) {
+    bucket.fill(kEmpty);
+  }
+}
+
+void History::Add(Channel channel, float value, uint32_t now_s) {
+  AdvanceTo(now_s);
+  uint16_t encoded = Encode(channel, value);
+  for (TierState& state : tiers_) {
+    Accumulator& open = state.open[static_cast<size_t>(channel)];
+    open.sum += encoded;
+    ++open.count;
+    open.min = std::min(open.min, encoded);
+    open.max = std::max(open.max, encoded);
+  }
+}
+
+void History::AdvanceTo(uint32_t now_s) {
+  for (size_t tier = 0; tier < kTiers.size(); ++tier) {
+    TierState& state = tiers_[tier];
+    uint32_t index = now_s / kTiers[tier].bucket_s;
+    if (index <= state.open_index) {
+      continue;
+    }
+
+    // Close the open bucket, and any that passed without readings.
+    Store(tier, state.open_index, &state.open);
+    state.open.fill(Accumulator{});
+    uint32_t num_buckets = kTiers[tier].num_buckets;
+    uint32_t skipped = std::min(index - state.open_index - 1, num_buckets);
+    for (uint32_t i = 1; i <= skipped; ++i) {
+      Store(tier, state.open_index + i, nullptr);
+    }
+    state.num_closed = static_cast<uint16_t>(
+        std::min(state.num_closed + (index - state.open_index), num_buckets));
+    state.open_index = index;
+  }
+}
+
+void History::Store(size_t tier,
+                    uint32_t index,
+                    const std::array<Accumulator, kNumChannels>* open) {
+  auto& means = means_[Position(tier, index)];
+  for (size_t channel = 0; channel < kNumChannels; ++channel) {
+    means[channel] = kEmpty;
+    if (open != nullptr && (*open)[channel].count != 0) {
+      const Accumulator& accumulator = (*open)[channel];
+      means[channel] = static_cast<uint16_t>(
+          (accumulator.sum + accumulator.count / 2) / accumulator.count);
+    }
+  }
+  if (!kTiers[tier].keeps_range) {
+    return;
+  }
+  auto& ranges = ranges_[Position(tier, index, /*ranges=*/true)];
+  for (size_t channel = 0; channel < kNumChannels; ++channel) {
+    ranges[channel] = StoredRange{};
+    if (open != nullptr) {
+      ranges[channel] = StoredRange{.min = (*open)[channel].min,
+                                    .max = (*open)[channel].max};
+    }
+  }
+}
+
+History::Bucket History::GetBucket(size_t tier, uint32_t index) const {
+  const auto& means = means_[Position(tier, index)];
+  Bucket bucket = {.start_s = index * kTiers[tier].bucket_s, .channels = {}};
+  for (size_t i = 0; i < kNumChannels; ++i) {
+    if (means[i] == kEmpty) {
+      continue;
+    }
+    auto channel = static_cast<Channel>(i);
+    Summary summary = {.mean = Decode(channel, means[i]), .range = {}};
+    if (kTiers[tier].keeps_range) {
+      const StoredRange& range =
+          ranges_[Position(tier, index, /*ranges=*/true)][i];
+      summary.range = Range{.min = Decode(channel, range.min),
+                            .max = Decode(channel, range.max)};
+    }
+    bucket.channels[i] = summary;
+  }
+  return bucket;
+}
+
+uint16_t History::Encode(Channel channel, float value) {
+  if (channel == Channel::kCoreTemperature) {
+    value = (value + kCoreTemperatureOffset) * kCoreTemperatureScale;
+  } else if (channel == Channel::kAmbientLight && value > 0.f) {
+    value = std::log2(1.f + value) * kAmbientLightScale;
+  }
+  if (!(value > 0.f)) {
+    return 0;
+  }
+  return static_cast<uint16_t>(
+      std::min(std::round(value), static_cast<float>(kEmpty - 1)));
+}
+
+float History::Decode(Channel channel, uint16_t value) {
+  if (channel == Channel::kCoreTemperature) {
+    return static_cast<float>(value) / kCoreTemperatureScale -
+           kCoreTemperatureOffset;
+  }
+  if (channel == Channel::kAmbientLight) {
+    return std::exp2(static_cast<float>(value) / kAmbientLightScale) - 1.f;
+  }
+  return static_cast<float>(value);
+}
+
+}  // namespace sense
@@ -0,0 +1,192 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace sense {
+namespace internal {
+
+struct HistoryTier {
+  uint32_t bucket_s;
+  uint16_t num_buckets;
+  /// Whether buckets keep their minimum and maximum, as well as their mean.
+  bool keeps_range;
+};
+
+/// 1 s over 10 minutes, 5 minutes over 12 hours, and 1 hour over 7 days.
+///
+/// A 1 s bucket holds at most a few readings, so its minimum and maximum add
+/// little to its mean and are not kept.
+inline constexpr std::array<HistoryTier, 3> kHistoryTiers = {{
+    {.bucket_s = 1, .num_buckets = 600, .keeps_range = false},
+    {.bucket_s = 5 * 60, .num_buckets = 144, .keeps_range = true},
+    {.bucket_s = 60 * 60, .num_buckets = 168, .keeps_range = true},
+}};
+
+/// Returns the number of buckets before `tier`, counting only the tiers that
+/// keep ranges if `ranges` is set.
+constexpr size_t HistoryTierOffset(size_t tier, bool ranges) {
+  size_t offset = 0;
+  for (size_t i = 0; i < tier; ++i) {
+    if (!ranges || kHistoryTiers[i].keeps_range) {
+      offset += kHistoryTiers[i].num_buckets;
+    }
+  }
+  return offset;
+}
+
+}  // namespace internal
+
+/// Fixed-size, multi-resolution history of sensor readings.
+///
+/// Readings are summarized into buckets by their mean, and in the coarser
+/// tiers also by their minimum and maximum. Each tier is a ring of buckets
+/// covering a fixed span of time, with coarser buckets reaching further into
+/// the past. Every reading updates the open bucket of each tier directly, so
+/// adding one takes constant time, and the history never allocates.
+///
+/// Values are stored as 16-bit integers. Readings outside of a channel's range
+/// are clamped. All of the tiers together take 12 KiB.
+class History {
+ public:
+  enum class Channel : size_t {
+    /// Air quality score, from 0 to 1023.
+    kAirQuality,
+    /// Ambient light, in lux. Stored on a logarithmic scale, with a
+    /// resolution of 0.03% of the reading, so means are geometric.
+    kAmbientLight,
+    /// Proximity, in the unspecified units of `ProximitySampleBatch`.
+    kProximity,
+    /// Temperature of the microcontroller core, in degrees Celsius. Stored with
+    /// a resolution of 0.01 degrees.
+    kCoreTemperature,
+  };
+  static constexpr size_t kNumChannels = 4;
+
+  using Tier = internal::HistoryTier;
+
+  static constexpr std::array<Tier, internal::kHistoryTiers.size()> kTiers =
+      internal::kHistoryTiers;
+
+  struct Range {
+    float min;
+    float max;
+  };
+
+  struct Summary {
+    float mean;
+    /// Only in tiers that keep it.
+    std::optional<Range> range;
+  };
+
+  /// A closed bucket. Channels without readings in the bucket have no summary.
+  struct Bucket {
+    /// Start of the bucket, in seconds since boot.
+    uint32_t start_s;
+    std::array<std::optional<Summary>, kNumChannels> channels;
+  };
+
+  History();
+
+  /// Records a reading taken `now_s` seconds after boot.
+  ///
+  /// Times must not go backwards.
+  void Add(Channel channel, float value, uint32_t now_s);
+
+  /// Closes any buckets that ended before `now_s` seconds after boot.
+  ///
+  /// This is called by `Add`, but should also be called periodically so that
+  /// buckets are closed when readings stop.
+  void AdvanceTo(uint32_t now_s);
+
+  /// Returns the number of closed buckets in a tier.
+  size_t size(size_t tier) const { return tiers_[tier].num_closed; }
+
+  /// Calls `callback` with each closed bucket in a tier, oldest first, starting
+  /// with the first that begins at or after `since_s`. Stops early once
+  /// `callback` returns false.
+  ///
+  /// Takes time proportional to the number of buckets visited, so callers can
+  /// page through a tier by resuming from the last bucket they were given.
+  template <typename Callback>
+  void ForEach(size_t tier, uint32_t since_s, Callback&& callback) const {
+    const TierState& state = tiers_[tier];
+    uint32_t bucket_s = kTiers[tier].bucket_s;
+    uint32_t first = state.open_index - state.num_closed;
+    uint32_t since_index = since_s / bucket_s + (since_s % bucket_s != 0);
+    for (uint32_t i = std::max(first, since_index); i < state.open_index; ++i) {
+      if (!callback(GetBucket(tier, i))) {
+        return;
+      }
+    }
+  }
+
+ private:
+  /// Stored mean of a channel without readings. Readings are clamped below
+  /// it.
+  static constexpr uint16_t kEmpty = UINT16_MAX;
+
+  /// Stored form of a `Range`.
+  struct StoredRange {
+    uint16_t min;
+    uint16_t max;
+  };
+
+  /// Running summary of the open bucket of one tier.
+  struct Accumulator {
+    uint64_t sum = 0;
+    uint32_t count = 0;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0;
+  };
+
+  struct TierState {
+    /// Index of the open bucket, counting from boot.
+    uint32_t open_index = 0;
+    uint16_t num_closed = 0;
+    std::array<Accumulator, kNumChannels> open;
+  };
+
+  static constexpr size_t kTotalBuckets =
+      internal::HistoryTierOffset(kTiers.size(), /*ranges=*/false);
+  static constexpr size_t kTotalRangeBuckets =
+      internal::HistoryTierOffset(kTiers.size(), /*ranges=*/true);
+
+  static uint16_t Encode(Channel channel, float value);
+  static float Decode(Channel channel, uint16_t value);
+
+  static size_t Position(size_t tier, uint32_t index, bool ranges = false) {
+    return internal::HistoryTierOffset(tier, ranges) +
+           index % kTiers[tier].num_buckets;
+  }
+
+  /// Stores a closed bucket, or an empty one if `open` is null.
+  void Store(size_t tier,
+             uint32_t index,
+             const std::array<Accumulator, kNumChannels>* open);
+
+  Bucket GetBucket(size_t tier, uint32_t index) const;
+
+  std::array<TierState, kTiers.size()> tiers_;
+  std::array<std::array<uint16_t, kNumChannels>, kTotalBuckets> means_;
+  std::array<std::array<StoredRange, kNumChannels>, kTotalRangeBuckets>
+      ranges_;
+};
+
+}  // namespace sense
@@ -0,0 +1,203 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/history/history.h"
+
+#include <cstdint>
+
+#include "pw_containers/vector.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using Channel = History::Channel;
+
+constexpr size_t kAir = static_cast<size_t>(Channel::kAirQuality);
+constexpr size_t kLight = static_cast<size_t>(Channel::kAmbientLight);
+constexpr size_t kCore = static_cast<size_t>(Channel::kCoreTemperature);
+
+// Test fixtures.
+
+class HistoryTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kSeconds = 0;
+  static constexpr size_t kMinutes = 1;
+  static constexpr size_t kHours = 2;
+
+  pw::Vector<History::Bucket, 8> Collect(size_t tier, uint32_t since_s = 0) {
+    pw::Vector<History::Bucket, 8> buckets;
+    history_.ForEach(tier, since_s, [&buckets](const History::Bucket& bucket) {
+      buckets.push_back(bucket);
+      return !buckets.full();
+    });
+    return buckets;
+  }
+
+  History history_;
+};
+
+// Unit tests.
+
+TEST_F(HistoryTest, Empty) {
+  for (size_t tier = 0; tier < History::kTiers.size(); ++tier) {
+    EXPECT_EQ(history_.size(tier), 0u);
+    EXPECT_TRUE(Collect(tier).empty());
+  }
+}
+
+TEST_F(HistoryTest, OpenBucketIsNotReported) {
+  history_.Add(Channel::kAirQuality, 768.f, 0);
+  history_.Add(Channel::kAirQuality, 512.f, 0);
+  EXPECT_EQ(history_.size(kSeconds), 0u);
+}
+
+TEST_F(HistoryTest, SummarizesBucket) {
+  history_.Add(Channel::kAirQuality, 700.f, 0);
+  history_.Add(Channel::kAirQuality, 800.f, 0);
+  history_.Add(Channel::kAirQuality, 900.f, 0);
+  history_.Add(Channel::kAmbientLight, 120.f, 0);
+  history_.AdvanceTo(1);
+
+  auto buckets = Collect(kSeconds);
+  ASSERT_EQ(buckets.size(), 1u);
+  EXPECT_EQ(buckets[0].start_s, 0u);
+  ASSERT_TRUE(buckets[0].channels[kAir].has_value());
+  EXPECT_EQ(buckets[0].channels[kAir]->mean, 800.f);
+  // The finest tier only keeps means.
+  EXPECT_FALSE(buckets[0].channels[kAir]->range.has_value());
+  ASSERT_TRUE(buckets[0].channels[kLight].has_value());
+  EXPECT_NEAR(buckets[0].channels[kLight]->mean, 120.f, 0.05f);
+  EXPECT_FALSE(buckets[0].channels[kCore].has_value());
+}
+
+TEST_F(HistoryTest, SkippedBucketsAreEmpty) {
+  history_.Add(Channel::kAirQuality, 700.f, 0);
+  history_.Add(Channel::kAirQuality, 800.f, 3);
+  history_.AdvanceTo(4);
+
+  auto buckets = Collect(kSeconds);
+  ASSERT_EQ(buckets.size(), 4u);
+  EXPECT_TRUE(buckets[0].channels[kAir].has_value());
+  EXPECT_FALSE(buckets[1].channels[kAir].has_value());
+  EXPECT_FALSE(buckets[2].channels[kAir].has_value());
+  EXPECT_EQ(buckets[3].start_s, 3u);
+  EXPECT_EQ(buckets[3].channels[kAir]->mean, 800.f);
+}
+
+TEST_F(HistoryTest, CoarserTiersSummarizeEveryReading) {
+  for (uint32_t s = 0; s < 10 * 60; ++s) {
+    history_.Add(Channel::kAirQuality, static_cast<float>(s % 100), s);
+  }
+  history_.AdvanceTo(10 * 60);
+
+  auto buckets = Collect(kMinutes);
+  ASSERT_EQ(buckets.size(), 2u);
+  EXPECT_EQ(buckets[1].start_s, 5u * 60);
+  ASSERT_TRUE(buckets[1].channels[kAir].has_value());
+  ASSERT_TRUE(buckets[1].channels[kAir]->range.has_value());
+  EXPECT_EQ(buckets[1].channels[kAir]->range->min, 0.f);
+  EXPECT_EQ(buckets[1].channels[kAir]->range->max, 99.f);
+  EXPECT_EQ(buckets[1].channels[kAir]->mean, 50.f);
+  EXPECT_EQ(history_.size(kHours), 0u);
+}
+
+TEST_F(HistoryTest, RingKeepsMostRecentBuckets) {
+  constexpr uint32_t kNumBuckets = History::kTiers[kSeconds].num_buckets;
+  for (uint32_t s = 0; s < kNumBuckets * 3; ++s) {
+    history_.Add(Channel::kProximity, static_cast<float>(s), s);
+  }
+  history_.AdvanceTo(kNumBuckets * 3);
+  EXPECT_EQ(history_.size(kSeconds), kNumBuckets);
+
+  auto buckets = Collect(kSeconds);
+  ASSERT_FALSE(buckets.empty());
+  EXPECT_EQ(buckets[0].start_s, kNumBuckets * 2);
+}
+
+TEST_F(HistoryTest, LongGapClearsTier) {
+  history_.Add(Channel::kAirQuality, 700.f, 0);
+  history_.AdvanceTo(24 * 60 * 60);
+  EXPECT_EQ(history_.size(kSeconds), History::kTiers[kSeconds].num_buckets);
+  auto buckets = Collect(kSeconds);
+  for (const auto& bucket : buckets) {
+    EXPECT_FALSE(bucket.channels[kAir].has_value());
+  }
+}
+
+TEST_F(HistoryTest, Since) {
+  for (uint32_t s = 0; s < 10; ++s) {
+    history_.Add(Channel::kAirQuality, 700.f, s);
+  }
+  history_.AdvanceTo(10);
+  auto buckets = Collect(kSeconds, 7);
+  ASSERT_EQ(buckets.size(), 3u);
+  EXPECT_EQ(buckets[0].start_s, 7u);
+}
+
+TEST_F(HistoryTest, ForEachStopsWhenCallbackReturnsFalse) {
+  for (uint32_t s = 0; s < 10; ++s) {
+    history_.Add(Channel::kAirQuality, 700.f, s);
+  }
+  history_.AdvanceTo(10);
+
+  uint32_t calls = 0;
+  uint32_t last_start_s = 0;
+  history_.ForEach(kSeconds, 2, [&](const History::Bucket& bucket) {
+    last_start_s = bucket.start_s;
+    return ++calls < 3;
+  });
+  EXPECT_EQ(calls, 3u);
+  EXPECT_EQ(last_start_s, 4u);
+}
+
+TEST_F(HistoryTest, ValuesAreQuantizedAndClamped) {
+  history_.Add(Channel::kCoreTemperature, 27.123f, 0);
+  history_.Add(Channel::kAirQuality, -5.f, 0);
+  history_.Add(Channel::kAirQuality, 100000.f, 0);
+  history_.AdvanceTo(5 * 60);
+
+  auto buckets = Collect(kMinutes);
+  ASSERT_EQ(buckets.size(), 1u);
+  EXPECT_NEAR(buckets[0].channels[kCore]->mean, 27.12f, 0.001f);
+  ASSERT_TRUE(buckets[0].channels[kAir]->range.has_value());
+  EXPECT_EQ(buckets[0].channels[kAir]->range->min, 0.f);
+  // The largest value is reserved to mark channels without readings.
+  EXPECT_EQ(buckets[0].channels[kAir]->range->max, 65534.f);
+}
+
+TEST_F(HistoryTest, AmbientLightKeepsResolutionAcrossItsRange) {
+  history_.Add(Channel::kAmbientLight, 0.2f, 0);
+  history_.Add(Channel::kAmbientLight, 100000.f, 0);
+  history_.AdvanceTo(5 * 60);
+
+  auto buckets = Collect(kMinutes);
+  ASSERT_EQ(buckets.size(), 1u);
+  ASSERT_TRUE(buckets[0].channels[kLight]->range.has_value());
+  EXPECT_NEAR(buckets[0].channels[kLight]->range->min, 0.2f, 0.001f);
+  EXPECT_NEAR(buckets[0].channels[kLight]->range->max, 100000.f, 40.f);
+}
+
+TEST_F(HistoryTest, DarknessIsStoredAsZeroLux) {
+  history_.Add(Channel::kAmbientLight, -5.f, 0);
+  history_.Add(Channel::kAmbientLight, 0.f, 0);
+  history_.AdvanceTo(1);
+
+  auto buckets = Collect(kSeconds);
+  ASSERT_EQ(buckets.size(), 1u);
+  EXPECT_EQ(buckets[0].channels[kLight]->mean, 0.f);
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,186 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "HISTORY"
+
+#include "modules/history/service.h"
+
+#include <chrono>
+#include <mutex>
+
+#include "pw_assert/check.h"
+#include "pw_log/log.h"
+
+namespace sense {
+namespace {
+
+void ToProto(const History::Bucket& bucket,
+             History::Channel channel,
+             bool& has_proto,
+             history_Summary& proto) {
+  const auto& summary = bucket.channels[static_cast<size_t>(channel)];
+  has_proto = summary.has_value();
+  if (has_proto) {
+    proto.mean = summary->mean;
+    proto.has_min = summary->range.has_value();
+    proto.has_max = summary->range.has_value();
+    if (summary->range.has_value()) {
+      proto.min = summary->range->min;
+      proto.max = summary->range->max;
+    }
+  }
+}
+
+}  // namespace
+
+void HistoryService::Init(PubSub& pubsub, Worker& worker, Board& board) {
+  worker_ = &worker;
+  board_ = &board;
+  PW_CHECK(pubsub.Subscribe([this](Event event) { HandleEvent(event); }));
+  sample_timer_.InvokeAfter(kSampleInterval);
+}
+
+void HistoryService::GetHistory(const history_GetHistoryRequest& request,
+                                ServerWriter<history_HistoryBatch>& writer) {
+  auto call = get_history_metrics_.Measure();
+  if (request.tier >= History::kTiers.size()) {
+    if (const auto status = writer.Finish(pw::Status::InvalidArgument());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+
+  std::lock_guard writer_lock(writer_lock_);
+  get_history_metrics_.OpenStream(writer_, writer);
+  tier_ = request.tier;
+  since_s_ = request.since_s;
+  retries_ = 0;
+  if (!sending_) {
+    sending_ = true;
+    worker_->RunOnce([this]() { SendBatch(); });
+  }
+}
+
+void HistoryService::SendBatch() {
+  std::lock_guard writer_lock(writer_lock_);
+
+  // Copy out one batch at a time, so that readings are not held up while
+  // the batch is written. Each batch resumes after the last bucket of the
+  // previous one, and stops as soon as it is full.
+  const uint32_t bucket_s = History::kTiers[tier_].bucket_s;
+  history_HistoryBatch batch = history_HistoryBatch_init_default;
+  batch.bucket_s = bucket_s;
+  batch.uptime_s = NowSeconds();
+  {
+    std::lock_guard lock(lock_);
+    history_.ForEach(tier_, since_s_, [&batch](const History::Bucket& bucket) {
+      constexpr size_t kMaxBuckets =
+          sizeof(batch.buckets) / sizeof(batch.buckets[0]);
+      history_Bucket& proto = batch.buckets[batch.buckets_count++];
+      proto.start_s = bucket.start_s;
+      ToProto(bucket,
+              History::Channel::kAirQuality,
+              proto.has_air_quality,
+              proto.air_quality);
+      ToProto(bucket,
+              History::Channel::kAmbientLight,
+              proto.has_ambient_light,
+              proto.ambient_light);
+      ToProto(bucket,
+              History::Channel::kProximity,
+              proto.has_proximity,
+              proto.proximity);
+      ToProto(bucket,
+              History::Channel::kCoreTemperature,
+              proto.has_core_temperature,
+              proto.core_temperature);
+      return batch.buckets_count < kMaxBuckets;
+    });
+  }
+  if (batch.buckets_count == 0) {
+    sending_ = false;
+    writer_.Finish().IgnoreError();
+    return;
+  }
+
+  const pw::Status status =
+      get_history_metrics_.Write(writer_, batch, history_HistoryBatch_fields);
+  if ((status.IsResourceExhausted() || status.IsUnavailable()) &&
+      retries_ < kMaxRetries) {
+    // The transport is backed up, so give it time to drain.
+    ++retries_;
+    retry_timer_.InvokeAfter(kRetryInterval);
+    return;
+  }
+  if (!status.ok()) {
+    PW_LOG_ERROR("Failed to write history: %s", status.str());
+    sending_ = false;
+    return;
+  }
+  retries_ = 0;
+  since_s_ = batch.buckets[batch.buckets_count - 1].start_s + bucket_s;
+  worker_->RunOnce([this]() { SendBatch(); });
+}
+
+void HistoryService::RetryCallback(pw::chrono::SystemClock::time_point) {
+  worker_->RunOnce([this]() { SendBatch(); });
+}
+
+uint32_t HistoryService::NowSeconds() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          pw::chrono::SystemClock::now().time_since_epoch())
+          .count());
+}
+
+void HistoryService::HandleEvent(const Event& event) {
+  History::Channel channel;
+  float value;
+  if (std::holds_alternative<AirQuality>(event)) {
+    channel = History::Channel::kAirQuality;
+    value = std::get<AirQuality>(event).score;
+  } else if (std::holds_alternative<AmbientLightSample>(event)) {
+    channel = History::Channel::kAmbientLight;
+    value = std::get<AmbientLightSample>(event).sample_lux;
+  } else if (std::holds_alternative<ProximitySampleBatch>(event)) {
+    // Batched samples are recorded as of their arrival rather than when each
+    // was taken, as the history's times must not go backwards.
+    const uint32_t now_s = NowSeconds();
+    std::lock_guard lock(lock_);
+    for (uint16_t sample : std::get<ProximitySampleBatch>(event)) {
+      history_.Add(History::Channel::kProximity, sample, now_s);
+    }
+    return;
+  } else {
+    return;
+  }
+  std::lock_guard lock(lock_);
+  history_.Add(channel, value, NowSeconds());
+}
+
+void HistoryService::SampleCallback(pw::chrono::SystemClock::time_point) {
+  // The history is guarded by a mutex, so it is updated from the worker
+  // rather than the timer callback.
+  worker_->RunOnce([this]() { SampleCoreTemperature(); });
+  sample_timer_.InvokeAfter(kSampleInterval);
+}
+
+void HistoryService::SampleCoreTemperature() {
+  float temperature = board_->ReadInternalTemperature();
+  std::lock_guard lock(lock_);
+  history_.Add(History::Channel::kCoreTemperature, temperature, NowSeconds());
+}
+
+}  // namespace sense
@@ -0,0 +1,99 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/board/board.h"
+#include "modules/history/history.h"
+#include "modules/history/history.rpc.pb.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+
+namespace sense {
+
+/// Records sensor readings in a `History` and serves them over RPC.
+///
+/// Air quality, ambient light and proximity are recorded as they are
+/// published. The core temperature is read once per second, which also closes
+/// buckets when no other readings arrive.
+///
+/// History is streamed one batch at a time from the worker, so that a long
+/// tier neither holds up the RPC thread nor floods the transport. A batch that
+/// the transport has no room for is retried shortly after.
+class HistoryService final
+    : public ::history::pw_rpc::nanopb::History::Service<HistoryService> {
+ public:
+  HistoryService()
+      : sample_timer_(pw::bind_member<&HistoryService::SampleCallback>(this)),
+        retry_timer_(pw::bind_member<&HistoryService::RetryCallback>(this)) {}
+
+  void Init(PubSub& pubsub, Worker& worker, Board& board);
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  void GetHistory(const history_GetHistoryRequest& request,
+                  ServerWriter<history_HistoryBatch>& writer);
+
+ private:
+  static constexpr pw::chrono::SystemClock::duration kSampleInterval =
+      pw::chrono::SystemClock::for_at_least(std::chrono::seconds(1));
+  static constexpr pw::chrono::SystemClock::duration kRetryInterval =
+      pw::chrono::SystemClock::for_at_least(std::chrono::milliseconds(50));
+  static constexpr uint32_t kMaxRetries = 20;
+
+  /// Returns the number of whole seconds since boot.
+  static uint32_t NowSeconds();
+
+  void HandleEvent(const Event& event) PW_LOCKS_EXCLUDED(lock_);
+
+  void SampleCallback(pw::chrono::SystemClock::time_point);
+
+  void SampleCoreTemperature() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Sends the next batch of the open stream, and queues the one after, or
+  /// finishes the stream once there are no more. Runs on the worker.
+  void SendBatch() PW_LOCKS_EXCLUDED(writer_lock_, lock_);
+
+  void RetryCallback(pw::chrono::SystemClock::time_point);
+
+  Worker* worker_ = nullptr;
+  Board* board_ = nullptr;
+  pw::chrono::SystemTimer sample_timer_;
+  pw::chrono::SystemTimer retry_timer_;
+
+  // Opening a stream replaces the one being sent, which continues from the
+  // new request's position.
+  pw::sync::Mutex writer_lock_;
+  ServerWriter<history_HistoryBatch> writer_ PW_GUARDED_BY(writer_lock_);
+  uint32_t tier_ PW_GUARDED_BY(writer_lock_) = 0;
+  uint32_t since_s_ PW_GUARDED_BY(writer_lock_) = 0;
+  uint32_t retries_ PW_GUARDED_BY(writer_lock_) = 0;
+  // Whether a batch is queued on the worker or waiting to be retried.
+  bool sending_ PW_GUARDED_BY(writer_lock_) = false;
+
+  pw::sync::Mutex lock_;
+  History history_ PW_GUARDED_BY(lock_);
+
+  RpcServiceMetrics method_metrics_{"History"};
+  RpcMethodMetrics get_history_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(HistoryService, GetHistory)};
+};
+
+}  // namespace sense
@@ -0,0 +1,120 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/history/service.h"
+
+#include <chrono>
+
+#include "modules/board/board_fake.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_rpc/nanopb/test_method_context.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread/sleep.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+class HistoryServiceTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kMaxEvents = 4;
+  static constexpr size_t kMaxSubscribers = 4;
+  using PubSub =
+      sense::GenericPubSubBuffer<sense::Event, kMaxEvents, kMaxSubscribers>;
+
+  HistoryServiceTest() : ::testing::Test(), pubsub_(worker_) {}
+
+  void TearDown() override { worker_.Stop(); }
+
+  /// Publishes an event and waits until subscribers have handled it.
+  void PublishAndWait(sense::Event event) {
+    auto token = pubsub_.Subscribe([this](sense::Event) {
+      notification_.release();
+    });
+    ASSERT_TRUE(token.has_value());
+    EXPECT_TRUE(pubsub_.Publish(event));
+    notification_.acquire();
+    pubsub_.Unsubscribe(*token);
+  }
+
+  /// Waits until the worker has finished everything queued so far.
+  void Flush() {
+    worker_.RunOnce([this]() { notification_.release(); });
+    notification_.acquire();
+  }
+
+  sense::TestWorker<> worker_;
+  PubSub pubsub_;
+  sense::BoardFake board_;
+  pw::sync::ThreadNotification notification_;
+};
+
+TEST_F(HistoryServiceTest, RejectsUnknownTier) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::HistoryService, GetHistory) ctx;
+  ctx.service().Init(pubsub_, worker_, board_);
+  ctx.call({.tier = sense::History::kTiers.size()});
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::Status::InvalidArgument());
+}
+
+TEST_F(HistoryServiceTest, StreamsClosedBuckets) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::HistoryService, GetHistory) ctx;
+  ctx.service().Init(pubsub_, worker_, board_);
+  board_.set_internal_temperature(27.5f);
+  sense::ProximitySampleBatch proximity(0, 100);
+  proximity.push_back(1000);
+  proximity.push_back(1468);
+  PublishAndWait(proximity);
+
+  // Wait for the core temperature to be sampled and the first buckets to
+  // close.
+  pw::this_thread::sleep_for(std::chrono::milliseconds(2500));
+  ctx.call({.tier = 0});
+  // Batches are sent from the worker, each queueing the next.
+  while (!ctx.done()) {
+    Flush();
+  }
+
+  EXPECT_EQ(ctx.status(), pw::OkStatus());
+  ASSERT_FALSE(ctx.responses().empty());
+  const history_HistoryBatch& batch = ctx.responses()[0];
+  EXPECT_EQ(batch.bucket_s, 1u);
+  ASSERT_GT(batch.buckets_count, 0u);
+
+  bool found_proximity = false;
+  bool found_core_temperature = false;
+  for (const history_HistoryBatch& response : ctx.responses()) {
+    for (pb_size_t i = 0; i < response.buckets_count; ++i) {
+      const history_Bucket& bucket = response.buckets[i];
+      EXPECT_FALSE(bucket.has_air_quality);
+      EXPECT_FALSE(bucket.has_ambient_light);
+      if (bucket.has_proximity) {
+        found_proximity = true;
+        EXPECT_EQ(bucket.proximity.mean, 1234.f);
+        // The finest tier only keeps means.
+        EXPECT_FALSE(bucket.proximity.has_min);
+        EXPECT_FALSE(bucket.proximity.has_max);
+      }
+      if (bucket.has_core_temperature) {
+        found_core_temperature = true;
+        EXPECT_EQ(bucket.core_temperature.mean, 27.5f);
+      }
+    }
+  }
+  EXPECT_TRUE(found_proximity);
+  EXPECT_TRUE(found_core_temperature);
+}
+
+}  // namespace
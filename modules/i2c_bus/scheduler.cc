@@ -0,0 +1,340 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/i2c_bus/scheduler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include "pw_status/try.h"
+
+namespace sense {
+
+I2cBusScheduler::I2cBusScheduler(pw::i2c::Initiator& bus,
+                                 pw::chrono::VirtualSystemClock& clock)
+    : bus_(bus), clock_(clock), created_(clock.now()) {}
+
+std::optional<I2cBusScheduler::ClientStats> I2cBusScheduler::GetClientStats(
+    size_t index) {
+  Clock::time_point now = clock_.now();
+  std::lock_guard lock(lock_);
+  for (const Client& client : clients_) {
+    if (index-- != 0) {
+      continue;
+    }
+    Clock::duration elapsed = now - created_;
+    return ClientStats{
+        .name = client.name(),
+        .priority = client.priority(),
+        .stats = client.stats_,
+        .utilization =
+            elapsed > Clock::duration::zero()
+                ? static_cast<float>(client.stats_.bus_time.count()) /
+                      static_cast<float>(elapsed.count())
+                : 0.f,
+    };
+  }
+  return std::nullopt;
+}
+
+size_t I2cBusScheduler::QueueLength() {
+  std::lock_guard lock(lock_);
+  return queue_.size();
+}
+
+pw::Status I2cBusScheduler::Acquire(Transaction& transaction) {
+  pw::sync::TimedThreadNotification granted;
+  {
+    std::lock_guard lock(lock_);
+    if (!busy_) {
+      busy_ = true;
+      return pw::OkStatus();
+    }
+    transaction.notification = &granted;
+    queue_.push_back(transaction);
+  }
+  // Whoever releases the bus sets the status, then hands it over.
+  if (granted.try_acquire_for(transaction.deadline - clock_.now())) {
+    return transaction.status;
+  }
+
+  {
+    std::lock_guard lock(lock_);
+    if (!transaction.handed_over) {
+      queue_.remove(transaction);
+      RecordMiss(transaction, clock_.now());
+      return pw::Status::DeadlineExceeded();
+    }
+  }
+  // The bus was handed over just as the wait timed out, so the notification
+  // has already been released.
+  granted.acquire();
+  return transaction.status;
+}
+
+pw::Status I2cBusScheduler::Perform(Transaction& transaction,
+                                    pw::i2c::Address device_address,
+                                    pw::ConstByteSpan tx_buffer,
+                                    pw::ByteSpan rx_buffer) {
+  // Perform the transaction with whatever time remains before its deadline.
+  const Clock::time_point start = clock_.now();
+  if (start >= transaction.deadline) {
+    transaction.status = pw::Status::DeadlineExceeded();
+  } else {
+    transaction.status = bus_.WriteReadFor(
+        device_address, tx_buffer, rx_buffer, transaction.deadline - start);
+  }
+  const Clock::time_point end = clock_.now();
+  Release(transaction, start, end);
+  return transaction.status;
+}
+
+void I2cBusScheduler::Release(Transaction& transaction,
+                              Clock::time_point start,
+                              Clock::time_point end) {
+  const Clock::time_point now = clock_.now();
+  std::lock_guard lock(lock_);
+  Stats& stats = transaction.client->stats_;
+  stats.max_wait = std::max(stats.max_wait, start - transaction.queued);
+  if (start >= transaction.deadline) {
+    ++stats.deadline_misses;
+  } else {
+    ++stats.transactions;
+    if (!transaction.status.ok()) {
+      ++stats.failures;
+    }
+    stats.bus_time += end - start;
+  }
+  HandOverNext(now);
+}
+
+void I2cBusScheduler::HandOverNext(Clock::time_point now) {
+  // Fail the transactions that waited too long, and hand the bus straight to
+  // the next one, so that no other caller can take it out of turn.
+  while (Transaction* next = Dequeue(now)) {
+    if (next->deadline <= now) {
+      RecordMiss(*next, now);
+      HandOver(*next, pw::Status::DeadlineExceeded());
+      continue;
+    }
+    HandOver(*next, pw::OkStatus());
+    return;
+  }
+  busy_ = false;
+}
+
+void I2cBusScheduler::RecordMiss(Transaction& transaction,
+                                 Clock::time_point now) {
+  Stats& stats = transaction.client->stats_;
+  stats.max_wait = std::max(stats.max_wait, now - transaction.queued);
+  ++stats.deadline_misses;
+}
+
+void I2cBusScheduler::HandOver(Transaction& transaction, pw::Status status) {
+  transaction.status = status;
+  transaction.handed_over = true;
+  // A task may be woken with the lock held, since waking only takes the
+  // dispatcher's lock.
+  if (transaction.notification != nullptr) {
+    transaction.notification->release();
+  } else {
+    std::move(transaction.waker).Wake();
+  }
+}
+
+I2cBusScheduler::Transaction* I2cBusScheduler::Dequeue(Clock::time_point now) {
+  Transaction* next = nullptr;
+  bool next_expired = false;
+  for (Transaction& transaction : queue_) {
+    bool expired = transaction.deadline <= now;
+    if (next == nullptr) {
+      next = &transaction;
+      next_expired = expired;
+      continue;
+    }
+    if (expired != next_expired) {
+      if (expired) {
+        next = &transaction;
+        next_expired = true;
+      }
+      continue;
+    }
+    Priority priority = transaction.client->priority();
+    Priority next_priority = next->client->priority();
+    if (priority > next_priority ||
+        (priority == next_priority && transaction.deadline < next->deadline)) {
+      next = &transaction;
+    }
+  }
+  if (next != nullptr) {
+    queue_.remove(*next);
+  }
+  return next;
+}
+
+I2cBusScheduler::Client::Client(I2cBusScheduler& scheduler,
+                                const char* name,
+                                Priority priority)
+    : scheduler_(scheduler), name_(name), priority_(priority) {
+  std::lock_guard lock(scheduler_.lock_);
+  scheduler_.clients_.push_back(*this);
+}
+
+I2cBusScheduler::Client::~Client() {
+  std::lock_guard lock(scheduler_.lock_);
+  scheduler_.clients_.remove(*this);
+}
+
+I2cBusScheduler::Stats I2cBusScheduler::Client::stats() const {
+  std::lock_guard lock(scheduler_.lock_);
+  return stats_;
+}
+
+I2cBusScheduler::TransferFuture I2cBusScheduler::Client::WriteReadAsync(
+    pw::i2c::Address device_address,
+    pw::ConstByteSpan tx_buffer,
+    pw::ByteSpan rx_buffer,
+    Clock::duration timeout) {
+  return TransferFuture(*this, device_address, tx_buffer, rx_buffer, timeout);
+}
+
+pw::Status I2cBusScheduler::Client::DoWriteReadFor(
+    pw::i2c::Address device_address,
+    pw::ConstByteSpan tx_buffer,
+    pw::ByteSpan rx_buffer,
+    Clock::duration timeout) {
+  Transaction transaction;
+  transaction.client = this;
+  transaction.queued = scheduler_.clock_.now();
+  transaction.deadline = transaction.queued + timeout;
+  PW_TRY(scheduler_.Acquire(transaction));
+  return scheduler_.Perform(transaction, device_address, tx_buffer, rx_buffer);
+}
+
+I2cBusScheduler::TransferFuture::TransferFuture(Client& client,
+                                                pw::i2c::Address device_address,
+                                                pw::ConstByteSpan tx_buffer,
+                                                pw::ByteSpan rx_buffer,
+                                                Clock::duration timeout)
+    : scheduler_(&client.scheduler_),
+      device_address_(device_address),
+      tx_buffer_(tx_buffer),
+      rx_buffer_(rx_buffer) {
+  transaction_.client = &client;
+  transaction_.queued = scheduler_->clock_.now();
+  transaction_.deadline = transaction_.queued + timeout;
+}
+
+I2cBusScheduler::TransferFuture::TransferFuture(TransferFuture&& other)
+    : scheduler_(other.scheduler_),
+      device_address_(other.device_address_),
+      tx_buffer_(other.tx_buffer_),
+      rx_buffer_(other.rx_buffer_) {
+  TakeFrom(other);
+}
+
+I2cBusScheduler::TransferFuture& I2cBusScheduler::TransferFuture::operator=(
+    TransferFuture&& other) {
+  if (this != &other) {
+    Cancel();
+    scheduler_ = other.scheduler_;
+    device_address_ = other.device_address_;
+    tx_buffer_ = other.tx_buffer_;
+    rx_buffer_ = other.rx_buffer_;
+    TakeFrom(other);
+  }
+  return *this;
+}
+
+I2cBusScheduler::TransferFuture::~TransferFuture() { Cancel(); }
+
+pw::async2::Poll<pw::Status> I2cBusScheduler::TransferFuture::Pend(
+    pw::async2::Context& cx) {
+  {
+    std::lock_guard lock(scheduler_->lock_);
+    switch (state_) {
+      case State::kDone:
+        return pw::async2::Ready(transaction_.status);
+
+      case State::kIdle:
+        if (!scheduler_->busy_) {
+          scheduler_->busy_ = true;
+          break;
+        }
+        state_ = State::kQueued;
+        scheduler_->queue_.push_back(transaction_);
+        [[fallthrough]];
+
+      case State::kQueued: {
+        if (transaction_.handed_over) {
+          if (transaction_.status.ok()) {
+            break;
+          }
+          state_ = State::kDone;
+          return pw::async2::Ready(transaction_.status);
+        }
+        const Clock::time_point now = scheduler_->clock_.now();
+        if (now >= transaction_.deadline) {
+          scheduler_->queue_.remove(transaction_);
+          scheduler_->RecordMiss(transaction_, now);
+          transaction_.status = pw::Status::DeadlineExceeded();
+          state_ = State::kDone;
+          return pw::async2::Ready(transaction_.status);
+        }
+        transaction_.waker = cx.GetWaker(pw::async2::WaitReason::Unspecified());
+        return pw::async2::Pending();
+      }
+    }
+  }
+
+  // The bus is this transaction's, so perform it without waiting.
+  state_ = State::kDone;
+  return pw::async2::Ready(scheduler_->Perform(
+      transaction_, device_address_, tx_buffer_, rx_buffer_));
+}
+
+void I2cBusScheduler::TransferFuture::TakeFrom(TransferFuture& other) {
+  std::lock_guard lock(scheduler_->lock_);
+  transaction_.client = other.transaction_.client;
+  transaction_.queued = other.transaction_.queued;
+  transaction_.deadline = other.transaction_.deadline;
+  transaction_.status = other.transaction_.status;
+  transaction_.handed_over = other.transaction_.handed_over;
+  transaction_.waker = std::move(other.transaction_.waker);
+  state_ = other.state_;
+  if (state_ == State::kQueued && !transaction_.handed_over) {
+    scheduler_->queue_.remove(other.transaction_);
+    scheduler_->queue_.push_back(transaction_);
+  }
+  // Leave nothing for the moved-from future to withdraw.
+  other.state_ = State::kDone;
+}
+
+void I2cBusScheduler::TransferFuture::Cancel() {
+  if (state_ != State::kQueued) {
+    return;
+  }
+  state_ = State::kDone;
+  std::lock_guard lock(scheduler_->lock_);
+  transaction_.waker.Clear();
+  if (!transaction_.handed_over) {
+    scheduler_->queue_.remove(transaction_);
+  } else if (transaction_.status.ok()) {
+    // The bus was handed over, but never used.
+    scheduler_->HandOverNext(scheduler_->clock_.now());
+  }
+}
+
+}  // namespace sense
@@ -0,0 +1,255 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "pw_async2/dispatcher.h"
+#include "pw_bytes/span.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/virtual_clock.h"
+#include "pw_containers/intrusive_list.h"
+#include "pw_i2c/address.h"
+#include "pw_i2c/initiator.h"
+#include "pw_status/status.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+#include "pw_sync/timed_thread_notification.h"
+
+namespace sense {
+
+/// Shares an I2C bus between the drivers of several devices.
+///
+/// Each driver is given its own `Client`, which it uses as its
+/// `pw::i2c::Initiator`. Transactions are performed on the calling thread, one
+/// at a time. While the bus is in use, callers wait their turn, highest
+/// priority first and earliest deadline first within a priority, so a caller
+/// is held up by at most one lower priority transaction. A transaction's
+/// deadline is the end of its timeout; one still waiting at its deadline fails
+/// with `DEADLINE_EXCEEDED` without using the bus.
+///
+/// Tasks can instead wait their turn without blocking, with
+/// `Client::WriteReadAsync`.
+class I2cBusScheduler {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  enum class Priority : uint8_t {
+    kLow,
+    kNormal,
+    kHigh,
+  };
+
+  struct Stats {
+    uint32_t transactions;
+    uint32_t failures;
+    uint32_t deadline_misses;
+    /// Time spent performing the client's transactions.
+    Clock::duration bus_time;
+    /// Longest a transaction has waited for the bus.
+    Clock::duration max_wait;
+  };
+
+  struct ClientStats {
+    const char* name;
+    Priority priority;
+    Stats stats;
+    /// Fraction of the time since the scheduler was created that the bus
+    /// has spent on the client's transactions.
+    float utilization;
+  };
+
+  class Client;
+  class TransferFuture;
+
+  explicit I2cBusScheduler(pw::i2c::Initiator& bus,
+                           pw::chrono::VirtualSystemClock& clock =
+                               pw::chrono::VirtualSystemClock::RealClock());
+
+  I2cBusScheduler(const I2cBusScheduler&) = delete;
+  I2cBusScheduler& operator=(const I2cBusScheduler&) = delete;
+
+  /// Returns the stats of the client at `index`, in the order they were
+  /// created, or nothing if there are not that many clients.
+  std::optional<ClientStats> GetClientStats(size_t index)
+      PW_LOCKS_EXCLUDED(lock_);
+
+  /// Returns the number of transactions waiting for the bus.
+  size_t QueueLength() PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Transaction : public pw::IntrusiveList<Transaction>::Item {
+    Client* client;
+    Clock::time_point queued;
+    Clock::time_point deadline;
+    pw::Status status;
+    // Set once the transaction has been taken off the queue and given its
+    // status. Guarded by `lock_`.
+    bool handed_over = false;
+    // How the transaction is woken when it is handed over: a blocked thread is
+    // notified, and a pending task is woken.
+    pw::sync::TimedThreadNotification* notification = nullptr;
+    pw::async2::Waker waker;
+  };
+
+  /// Waits until `transaction` may use the bus. Returns `DEADLINE_EXCEEDED`
+  /// if its deadline passes first, in which case the bus was not acquired.
+  ///
+  /// The wait lasts for whatever remains of the transaction's timeout by the
+  /// scheduler's clock.
+  pw::Status Acquire(Transaction& transaction) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Performs `transaction`, which has acquired the bus, then releases it.
+  pw::Status Perform(Transaction& transaction,
+                     pw::i2c::Address device_address,
+                     pw::ConstByteSpan tx_buffer,
+                     pw::ByteSpan rx_buffer) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Records a transaction performed between `start` and `end`, and hands the
+  /// bus to the next transaction waiting for it.
+  void Release(Transaction& transaction,
+               Clock::time_point start,
+               Clock::time_point end) PW_LOCKS_EXCLUDED(lock_);
+
+  /// Hands the bus to the next transaction waiting for it, failing any that
+  /// have passed their deadline, or frees the bus if there are none.
+  void HandOverNext(Clock::time_point now) PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Records that `transaction` waited until its deadline without using the
+  /// bus.
+  void RecordMiss(Transaction& transaction, Clock::time_point now)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Wakes a transaction taken off the queue, which uses the bus if `status`
+  /// is OK.
+  void HandOver(Transaction& transaction, pw::Status status)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  /// Removes and returns the transaction to run next, or null if there are
+  /// none. Transactions past their deadline come first, so they are failed
+  /// promptly.
+  Transaction* Dequeue(Clock::time_point now)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  pw::i2c::Initiator& bus_;
+  pw::chrono::VirtualSystemClock& clock_;
+  const Clock::time_point created_;
+
+  pw::sync::Mutex lock_;
+  pw::IntrusiveList<Transaction> queue_ PW_GUARDED_BY(lock_);
+  pw::IntrusiveList<Client> clients_ PW_GUARDED_BY(lock_);
+  bool busy_ PW_GUARDED_BY(lock_) = false;
+};
+
+/// A device's connection to a shared bus.
+///
+/// Transactions may be issued from any thread, including several at once.
+/// They wait behind the transactions of higher priority clients, which is why
+/// each call's timeout includes the time spent waiting for the bus.
+class I2cBusScheduler::Client : public pw::i2c::Initiator,
+                                public pw::IntrusiveList<Client>::Item {
+ public:
+  Client(I2cBusScheduler& scheduler, const char* name, Priority priority);
+  ~Client();
+
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  const char* name() const { return name_; }
+  Priority priority() const { return priority_; }
+
+  Stats stats() const PW_LOCKS_EXCLUDED(scheduler_.lock_);
+
+  /// Like `WriteReadFor`, but returns a future that completes with the
+  /// transaction's status, so that a task can wait for the bus without
+  /// blocking its dispatcher.
+  ///
+  /// The transaction joins the queue when the future is first polled, and is
+  /// performed by the task polling the future once the bus is handed to it.
+  /// The buffers must outlive the future. A future destroyed before it
+  /// completes gives up its place, or hands the bus on if it was given it.
+  ///
+  /// A future still waiting at its deadline fails when it is next polled, or
+  /// when the bus is next handed over, whichever comes first.
+  TransferFuture WriteReadAsync(pw::i2c::Address device_address,
+                                pw::ConstByteSpan tx_buffer,
+                                pw::ByteSpan rx_buffer,
+                                Clock::duration timeout);
+
+ private:
+  friend class I2cBusScheduler;
+  friend class TransferFuture;
+
+  pw::Status DoWriteReadFor(pw::i2c::Address device_address,
+                            pw::ConstByteSpan tx_buffer,
+                            pw::ByteSpan rx_buffer,
+                            Clock::duration timeout) override
+      PW_LOCKS_EXCLUDED(scheduler_.lock_);
+
+  I2cBusScheduler& scheduler_;
+  const char* const name_;
+  const Priority priority_;
+  Stats stats_ PW_GUARDED_BY(scheduler_.lock_) = {};
+};
+
+/// Future returned by `I2cBusScheduler::Client::WriteReadAsync`.
+///
+/// Moving the future moves its place in the queue.
+class I2cBusScheduler::TransferFuture {
+ public:
+  TransferFuture(TransferFuture&& other)
+      PW_LOCKS_EXCLUDED(scheduler_->lock_, other.scheduler_->lock_);
+  TransferFuture& operator=(TransferFuture&& other)
+      PW_LOCKS_EXCLUDED(scheduler_->lock_, other.scheduler_->lock_);
+
+  ~TransferFuture() PW_LOCKS_EXCLUDED(scheduler_->lock_);
+
+  /// Returns the status of the transaction once it has been performed, or
+  /// `DEADLINE_EXCEEDED` if it was not given the bus in time.
+  pw::async2::Poll<pw::Status> Pend(pw::async2::Context& cx)
+      PW_LOCKS_EXCLUDED(scheduler_->lock_);
+
+ private:
+  friend class Client;
+
+  enum class State {
+    kIdle,
+    kQueued,
+    kDone,
+  };
+
+  TransferFuture(Client& client,
+                 pw::i2c::Address device_address,
+                 pw::ConstByteSpan tx_buffer,
+                 pw::ByteSpan rx_buffer,
+                 Clock::duration timeout);
+
+  /// Takes over `other`'s transaction, including its place in the queue.
+  void TakeFrom(TransferFuture& other) PW_LOCKS_EXCLUDED(scheduler_->lock_);
+
+  /// Withdraws the transaction if it has not been performed, handing the bus
+  /// on if it was given it.
+  void Cancel() PW_LOCKS_EXCLUDED(scheduler_->lock_);
+
+  I2cBusScheduler* scheduler_;
+  Transaction transaction_;
+  State state_ = State::kIdle;
+  pw::i2c::Address device_address_;
+  pw::ConstByteSpan tx_buffer_;
+  pw::ByteSpan rx_buffer_;
+};
+
+}  // namespace sense
@@ -0,0 +1,446 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/i2c_bus/scheduler.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/simulated_system_clock.h"
+#include "pw_containers/vector.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_thread/id.h"
+#include "pw_thread/test_thread_context.h"
+#include "pw_thread/thread.h"
+#include "pw_thread/yield.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using Clock = pw::chrono::SystemClock;
+using Priority = I2cBusScheduler::Priority;
+using std::chrono::milliseconds;
+
+constexpr Clock::duration kTransferTime = Clock::for_at_least(milliseconds(1));
+constexpr Clock::duration kTimeout = Clock::for_at_least(milliseconds(100));
+
+constexpr pw::i2c::Address kAddressA = pw::i2c::Address::SevenBit<0x10>();
+constexpr pw::i2c::Address kAddressB = pw::i2c::Address::SevenBit<0x20>();
+constexpr pw::i2c::Address kAddressC = pw::i2c::Address::SevenBit<0x30>();
+constexpr pw::i2c::Address kAddressD = pw::i2c::Address::SevenBit<0x40>();
+
+// Test fixtures.
+
+/// Bus that takes `kTransferTime` of simulated time per transaction, and
+/// echoes what it is sent.
+class FakeBus : public pw::i2c::Initiator {
+ public:
+  explicit FakeBus(pw::chrono::SimulatedSystemClock& clock) : clock_(clock) {}
+
+  /// Makes the next transaction wait for `Release`, so that others queue up
+  /// behind it. Returns once it has started.
+  void HoldNextTransaction() { hold_ = true; }
+  void WaitUntilHeld() { held_.acquire(); }
+  void Release() { release_.release(); }
+
+  /// Seven-bit addresses of the transactions performed, in order.
+  const pw::Vector<uint8_t, 16>& addresses() const { return addresses_; }
+
+  /// The thread that performed the last transaction.
+  pw::thread::Id last_thread() const { return last_thread_; }
+
+ private:
+  pw::Status DoWriteReadFor(pw::i2c::Address device_address,
+                            pw::ConstByteSpan tx_buffer,
+                            pw::ByteSpan rx_buffer,
+                            Clock::duration) override {
+    addresses_.push_back(device_address.GetSevenBit());
+    last_thread_ = pw::this_thread::get_id();
+    for (size_t i = 0; i < rx_buffer.size() && i < tx_buffer.size(); ++i) {
+      rx_buffer[i] = tx_buffer[i];
+    }
+    if (hold_) {
+      hold_ = false;
+      held_.release();
+      release_.acquire();
+    }
+    clock_.AdvanceTime(kTransferTime);
+    return pw::OkStatus();
+  }
+
+  pw::chrono::SimulatedSystemClock& clock_;
+  pw::Vector<uint8_t, 16> addresses_;
+  pw::thread::Id last_thread_;
+  bool hold_ = false;
+  pw::sync::ThreadNotification held_;
+  pw::sync::ThreadNotification release_;
+};
+
+/// Performs an empty transaction on a thread of its own.
+class Caller {
+ public:
+  Caller(I2cBusScheduler::Client& client,
+         pw::i2c::Address address,
+         Clock::duration timeout = kTimeout)
+      : client_(client), address_(address), timeout_(timeout) {
+    thread_ = pw::Thread(context_.options(), [this] {
+      pw::i2c::Initiator& initiator = client_;
+      status_ = initiator.WriteReadFor(address_, {}, {}, timeout_);
+    });
+  }
+
+  /// Waits for the transaction to finish, and returns its result.
+  pw::Status Join() {
+    thread_.join();
+    return status_;
+  }
+
+ private:
+  I2cBusScheduler::Client& client_;
+  const pw::i2c::Address address_;
+  const Clock::duration timeout_;
+  pw::Status status_;
+  pw::thread::test::TestThreadContext context_;
+  pw::Thread thread_;
+};
+
+/// Performs an empty transaction without blocking.
+class TransferTask : public pw::async2::Task {
+ public:
+  TransferTask(I2cBusScheduler::Client& client,
+               pw::i2c::Address address,
+               Clock::duration timeout = kTimeout)
+      : client_(client), address_(address), timeout_(timeout) {}
+
+  const std::optional<pw::Status>& result() const { return result_; }
+
+  /// Destroys the transaction's future before it completes.
+  void Drop() {
+    future_.reset();
+    dropped_ = true;
+  }
+
+ private:
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) override {
+    if (dropped_) {
+      return pw::async2::Ready();
+    }
+    if (!future_.has_value()) {
+      future_ = client_.WriteReadAsync(address_, {}, {}, timeout_);
+    }
+    pw::async2::Poll<pw::Status> status = future_->Pend(cx);
+    if (status.IsPending()) {
+      return pw::async2::Pending();
+    }
+    result_ = *status;
+    return pw::async2::Ready();
+  }
+
+  I2cBusScheduler::Client& client_;
+  const pw::i2c::Address address_;
+  const Clock::duration timeout_;
+  std::optional<I2cBusScheduler::TransferFuture> future_;
+  std::optional<pw::Status> result_;
+  bool dropped_ = false;
+};
+
+class I2cBusSchedulerTest : public ::testing::Test {
+ protected:
+  I2cBusSchedulerTest() : bus_(clock_), scheduler_(bus_, clock_) {}
+
+  /// Waits until `count` transactions are waiting for the bus.
+  void WaitUntilQueued(size_t count) {
+    while (scheduler_.QueueLength() < count) {
+      pw::this_thread::yield();
+    }
+  }
+
+  pw::chrono::SimulatedSystemClock clock_;
+  FakeBus bus_;
+  I2cBusScheduler scheduler_;
+};
+
+// Unit tests.
+
+TEST_F(I2cBusSchedulerTest, BlockingTransaction) {
+  I2cBusScheduler::Client client(scheduler_, "a", Priority::kNormal);
+  std::array<std::byte, 2> tx = {std::byte{0x12}, std::byte{0x34}};
+  std::array<std::byte, 2> rx = {};
+
+  pw::i2c::Initiator& initiator = client;
+  EXPECT_EQ(initiator.WriteReadFor(kAddressA, tx, rx, kTimeout),
+            pw::OkStatus());
+  EXPECT_EQ(rx, tx);
+  ASSERT_EQ(bus_.addresses().size(), 1u);
+  EXPECT_EQ(bus_.addresses()[0], kAddressA.GetSevenBit());
+
+  I2cBusScheduler::Stats stats = client.stats();
+  EXPECT_EQ(stats.transactions, 1u);
+  EXPECT_EQ(stats.failures, 0u);
+  EXPECT_EQ(stats.bus_time, kTransferTime);
+}
+
+TEST_F(I2cBusSchedulerTest, RunsOnCallersThread) {
+  I2cBusScheduler::Client client(scheduler_, "a", Priority::kNormal);
+  pw::i2c::Initiator& initiator = client;
+
+  EXPECT_EQ(initiator.WriteReadFor(kAddressA, {}, {}, kTimeout),
+            pw::OkStatus());
+  EXPECT_EQ(bus_.last_thread(), pw::this_thread::get_id());
+}
+
+TEST_F(I2cBusSchedulerTest, HighestPriorityFirst) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kLow);
+  I2cBusScheduler::Client low(scheduler_, "low", Priority::kLow);
+  I2cBusScheduler::Client normal(scheduler_, "normal", Priority::kNormal);
+  I2cBusScheduler::Client high(scheduler_, "high", Priority::kHigh);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  Caller waiting_low(low, kAddressB);
+  Caller waiting_normal(normal, kAddressC);
+  Caller waiting_high(high, kAddressD);
+  WaitUntilQueued(3);
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting_low.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting_normal.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting_high.Join(), pw::OkStatus());
+
+  ASSERT_EQ(bus_.addresses().size(), 4u);
+  EXPECT_EQ(bus_.addresses()[0], kAddressA.GetSevenBit());
+  EXPECT_EQ(bus_.addresses()[1], kAddressD.GetSevenBit());
+  EXPECT_EQ(bus_.addresses()[2], kAddressC.GetSevenBit());
+  EXPECT_EQ(bus_.addresses()[3], kAddressB.GetSevenBit());
+}
+
+TEST_F(I2cBusSchedulerTest, EarliestDeadlineFirstWithinPriority) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kNormal);
+  I2cBusScheduler::Client relaxed(scheduler_, "relaxed", Priority::kNormal);
+  I2cBusScheduler::Client urgent(scheduler_, "urgent", Priority::kNormal);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  Caller waiting_relaxed(relaxed, kAddressB, kTimeout);
+  Caller waiting_urgent(urgent, kAddressC, kTimeout / 2);
+  WaitUntilQueued(2);
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting_relaxed.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting_urgent.Join(), pw::OkStatus());
+
+  ASSERT_EQ(bus_.addresses().size(), 3u);
+  EXPECT_EQ(bus_.addresses()[1], kAddressC.GetSevenBit());
+  EXPECT_EQ(bus_.addresses()[2], kAddressB.GetSevenBit());
+}
+
+TEST_F(I2cBusSchedulerTest, MissedDeadlineSkipsBus) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kHigh);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kLow);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  Caller waiting(client, kAddressB, kTimeout);
+  WaitUntilQueued(1);
+  // Expires by the scheduler's clock while the held transaction finishes.
+  clock_.AdvanceTime(kTimeout);
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_EQ(waiting.Join(), pw::Status::DeadlineExceeded());
+
+  EXPECT_EQ(bus_.addresses().size(), 1u);
+  EXPECT_EQ(client.stats().deadline_misses, 1u);
+  EXPECT_EQ(client.stats().transactions, 0u);
+}
+
+TEST_F(I2cBusSchedulerTest, WaiterFailsAtItsDeadline) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kHigh);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kLow);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  // Gives up while the bus is still held, rather than once it is released.
+  Caller waiting(client, kAddressB, kTransferTime);
+  EXPECT_EQ(waiting.Join(), pw::Status::DeadlineExceeded());
+  EXPECT_EQ(scheduler_.QueueLength(), 0u);
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+
+  EXPECT_EQ(bus_.addresses().size(), 1u);
+  EXPECT_EQ(client.stats().deadline_misses, 1u);
+  EXPECT_EQ(client.stats().transactions, 0u);
+}
+
+TEST_F(I2cBusSchedulerTest, AsyncTransaction) {
+  I2cBusScheduler::Client client(scheduler_, "a", Priority::kNormal);
+  pw::async2::Dispatcher dispatcher;
+  TransferTask task(client, kAddressA);
+
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  EXPECT_EQ(*task.result(), pw::OkStatus());
+  ASSERT_EQ(bus_.addresses().size(), 1u);
+  EXPECT_EQ(bus_.addresses()[0], kAddressA.GetSevenBit());
+  EXPECT_EQ(bus_.last_thread(), pw::this_thread::get_id());
+  EXPECT_EQ(client.stats().transactions, 1u);
+}
+
+TEST_F(I2cBusSchedulerTest, AsyncTransactionWaitsWithoutBlocking) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kNormal);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kNormal);
+  pw::async2::Dispatcher dispatcher;
+  TransferTask task(client, kAddressB);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  EXPECT_EQ(scheduler_.QueueLength(), 1u);
+
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  EXPECT_EQ(*task.result(), pw::OkStatus());
+  ASSERT_EQ(bus_.addresses().size(), 2u);
+  EXPECT_EQ(bus_.addresses()[1], kAddressB.GetSevenBit());
+}
+
+TEST_F(I2cBusSchedulerTest, AsyncTransactionMissesDeadline) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kHigh);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kLow);
+  pw::async2::Dispatcher dispatcher;
+  TransferTask task(client, kAddressB);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  clock_.AdvanceTime(kTimeout);
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsReady());
+  ASSERT_TRUE(task.result().has_value());
+  EXPECT_EQ(*task.result(), pw::Status::DeadlineExceeded());
+
+  EXPECT_EQ(bus_.addresses().size(), 1u);
+  EXPECT_EQ(client.stats().deadline_misses, 1u);
+}
+
+TEST_F(I2cBusSchedulerTest, DroppedAsyncTransactionLeavesQueue) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kNormal);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kNormal);
+  pw::async2::Dispatcher dispatcher;
+  TransferTask task(client, kAddressB);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  task.Drop();
+  EXPECT_EQ(scheduler_.QueueLength(), 0u);
+
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  EXPECT_EQ(bus_.addresses().size(), 1u);
+}
+
+TEST_F(I2cBusSchedulerTest, DroppedAsyncTransactionHandsBusOn) {
+  I2cBusScheduler::Client holder(scheduler_, "holder", Priority::kNormal);
+  I2cBusScheduler::Client client(scheduler_, "client", Priority::kNormal);
+  pw::async2::Dispatcher dispatcher;
+  TransferTask task(client, kAddressB);
+
+  bus_.HoldNextTransaction();
+  Caller holding(holder, kAddressA);
+  bus_.WaitUntilHeld();
+  dispatcher.Post(task);
+  EXPECT_TRUE(dispatcher.RunUntilStalled().IsPending());
+  // The bus is handed to the task, which gives it up without using it.
+  bus_.Release();
+  EXPECT_EQ(holding.Join(), pw::OkStatus());
+  task.Drop();
+
+  pw::i2c::Initiator& initiator = holder;
+  EXPECT_EQ(initiator.WriteReadFor(kAddressC, {}, {}, kTimeout),
+            pw::OkStatus());
+  ASSERT_EQ(bus_.addresses().size(), 2u);
+  EXPECT_EQ(bus_.addresses()[1], kAddressC.GetSevenBit());
+}
+
+TEST_F(I2cBusSchedulerTest, ConcurrentBlockingTransactions) {
+  static constexpr int kTransactions = 8;
+  I2cBusScheduler::Client first(scheduler_, "first", Priority::kNormal);
+  I2cBusScheduler::Client second(scheduler_, "second", Priority::kNormal);
+
+  auto run = [](I2cBusScheduler::Client& client, pw::i2c::Address address) {
+    pw::i2c::Initiator& initiator = client;
+    for (int i = 0; i < kTransactions; ++i) {
+      EXPECT_EQ(initiator.WriteReadFor(address, {}, {}, kTimeout),
+                pw::OkStatus());
+    }
+  };
+  pw::thread::test::TestThreadContext context;
+  pw::Thread thread(context.options(),
+                    [&run, &second] { run(second, kAddressB); });
+  run(first, kAddressA);
+  thread.join();
+
+  EXPECT_EQ(first.stats().transactions, static_cast<uint32_t>(kTransactions));
+  EXPECT_EQ(second.stats().transactions, static_cast<uint32_t>(kTransactions));
+  EXPECT_EQ(bus_.addresses().size(), 2u * kTransactions);
+}
+
+TEST_F(I2cBusSchedulerTest, ClientStats) {
+  I2cBusScheduler::Client busy(scheduler_, "busy", Priority::kHigh);
+  I2cBusScheduler::Client idle(scheduler_, "idle", Priority::kNormal);
+  pw::i2c::Initiator& initiator = busy;
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(initiator.WriteReadFor(kAddressA, {}, {}, kTimeout),
+              pw::OkStatus());
+  }
+  clock_.AdvanceTime(kTransferTime * 7);
+
+  std::optional<I2cBusScheduler::ClientStats> first =
+      scheduler_.GetClientStats(0);
+  ASSERT_TRUE(first.has_value());
+  EXPECT_STREQ(first->name, "busy");
+  EXPECT_EQ(first->priority, Priority::kHigh);
+  EXPECT_EQ(first->stats.transactions, 3u);
+  EXPECT_FLOAT_EQ(first->utilization, 0.3f);
+
+  std::optional<I2cBusScheduler::ClientStats> second =
+      scheduler_.GetClientStats(1);
+  ASSERT_TRUE(second.has_value());
+  EXPECT_STREQ(second->name, "idle");
+  EXPECT_FLOAT_EQ(second->utilization, 0.f);
+
+  EXPECT_FALSE(scheduler_.GetClientStats(2).has_value());
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,79 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "I2C"
+
+#include "modules/i2c_bus/service.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "pw_log/log.h"
+#include "pw_string/util.h"
+
+namespace sense {
+namespace {
+
+template <typename Duration>
+int64_t Microseconds(Duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+i2c_bus_Priority ToProto(I2cBusScheduler::Priority priority) {
+  switch (priority) {
+    case I2cBusScheduler::Priority::kLow:
+      return i2c_bus_Priority_PRIORITY_LOW;
+    case I2cBusScheduler::Priority::kNormal:
+      return i2c_bus_Priority_PRIORITY_NORMAL;
+    case I2cBusScheduler::Priority::kHigh:
+      return i2c_bus_Priority_PRIORITY_HIGH;
+  }
+  return i2c_bus_Priority_PRIORITY_NORMAL;
+}
+
+}  // namespace
+
+void I2cBusService::GetClientStats(const pw_protobuf_Empty&,
+                                   ServerWriter<i2c_bus_ClientStats>& writer) {
+  auto call = get_client_stats_metrics_.Measure();
+  for (size_t i = 0;; ++i) {
+    std::optional<I2cBusScheduler::ClientStats> client =
+        scheduler_.GetClientStats(i);
+    if (!client.has_value()) {
+      break;
+    }
+    const I2cBusScheduler::Stats& stats = client->stats;
+    i2c_bus_ClientStats response = i2c_bus_ClientStats_init_default;
+    pw::string::Copy(client->name, response.name).IgnoreError();
+    response.priority = ToProto(client->priority);
+    response.transactions = stats.transactions;
+    response.failures = stats.failures;
+    response.deadline_misses = stats.deadline_misses;
+    response.bus_time_us = static_cast<uint64_t>(Microseconds(stats.bus_time));
+    response.max_wait_us = static_cast<uint32_t>(Microseconds(stats.max_wait));
+    response.utilization = client->utilization;
+
+    if (const auto status = get_client_stats_metrics_.Write(
+            writer, response, i2c_bus_ClientStats_fields);
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write I2C client stats: %s", status.str());
+      return;
+    }
+  }
+  writer.Finish().IgnoreError();
+}
+
+}  // namespace sense
@@ -0,0 +1,41 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/i2c_bus/i2c_bus.rpc.pb.h"
+#include "modules/i2c_bus/scheduler.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+
+namespace sense {
+
+/// Reports how much of a shared I2C bus each device is using.
+class I2cBusService final
+    : public ::i2c_bus::pw_rpc::nanopb::I2cBus::Service<I2cBusService> {
+ public:
+  explicit I2cBusService(I2cBusScheduler& scheduler) : scheduler_(scheduler) {}
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  void GetClientStats(const pw_protobuf_Empty&,
+                      ServerWriter<i2c_bus_ClientStats>& writer);
+
+ private:
+  I2cBusScheduler& scheduler_;
+
+  RpcServiceMetrics method_metrics_{"I2cBus"};
+  RpcMethodMetrics get_client_stats_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(I2cBusService, GetClientStats)};
+};
+
+}  // namespace sense
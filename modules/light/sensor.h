@@ -14,10 +14,15 @@
 // the License.
 #pragma once
 
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/system_clock.h"
 #include "pw_result/result.h"
+#include "pw_status/status.h"
 
 namespace sense {
 
+class AmbientLightSampleFuture;
+
 /// Represents an ambient light sensor.
 class AmbientLightSensor {
  public:
@@ -31,14 +36,64 @@ class AmbientLightSensor {
   /// Reads an ambient light sample in lux.
   virtual pw::Result<float> ReadSampleLux() { return DoReadLightSampleLux(); }
 
+  /// Like `ReadSampleLux`, but returns a future that completes with the
+  /// sample, so that a task can wait for the sensor without blocking its
+  /// dispatcher.
+  ///
+  /// Only one sample may be awaited at a time. A read left unfinished by a
+  /// dropped future is finished by the next one.
+  AmbientLightSampleFuture ReadSampleLuxAsync();
+
+  /// Tells the sensor how often samples are read, so that it can trade
+  /// sensitivity for fresher samples when they are read quickly.
+  ///
+  /// Returns UNIMPLEMENTED if the sensor is unable to.
+  pw::Status SetSamplePeriod(pw::chrono::SystemClock::duration period) {
+    return DoSetLightSamplePeriod(period);
+  }
+
  protected:
   // Prohibit polymorphic destruction for now.
   ~AmbientLightSensor() = default;
 
  private:
+  friend class AmbientLightSampleFuture;
+
   virtual pw::Status DoEnableLightSensor() = 0;
   virtual pw::Status DoDisableLightSensor() = 0;
   virtual pw::Result<float> DoReadLightSampleLux() = 0;
+  virtual pw::Status DoSetLightSamplePeriod(
+      pw::chrono::SystemClock::duration) {
+    return pw::Status::Unimplemented();
+  }
+
+  /// Continues reading a sample for `ReadSampleLuxAsync`.
+  ///
+  /// By default, reads it with `DoReadLightSampleLux`.
+  virtual pw::async2::Poll<pw::Result<float>> DoPendLightSampleLux(
+      pw::async2::Context&) {
+    return pw::async2::Ready(DoReadLightSampleLux());
+  }
 };
 
+/// Future returned by `AmbientLightSensor::ReadSampleLuxAsync`.
+class AmbientLightSampleFuture {
+ public:
+  pw::async2::Poll<pw::Result<float>> Pend(pw::async2::Context& cx) {
+    return sensor_->DoPendLightSampleLux(cx);
+  }
+
+ private:
+  friend class AmbientLightSensor;
+
+  explicit AmbientLightSampleFuture(AmbientLightSensor& sensor)
+      : sensor_(&sensor) {}
+
+  AmbientLightSensor* sensor_;
+};
+
+inline AmbientLightSampleFuture AmbientLightSensor::ReadSampleLuxAsync() {
+  return AmbientLightSampleFuture(*this);
+}
+
 }  // namespace sense
@@ -15,6 +15,7 @@
 
 #include "modules/morse_code/encoder.h"
 #include "modules/morse_code/morse_code.rpc.pb.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 #include "pw_rpc/server.h"
 #include "pw_status/status.h"
 
@@ -28,11 +29,17 @@ class MorseCodeService final
 
   void Init(Worker& worker, Encoder::OutputFunction&& output);
 
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
   pw::Status Send(const morse_code_SendRequest& request,
                   pw_protobuf_Empty& response);
 
  private:
   Encoder encoder_;
+
+  RpcServiceMetrics method_metrics_{"MorseCode"};
+  RpcMethodMetrics send_metrics_{method_metrics_,
+                                 SENSE_RPC_METHOD(MorseCodeService, Send)};
 };
 
 }  // namespace sense
@@ -0,0 +1,40 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+/// Whether proximity state changes are driven by the sensor's interrupt.
+///
+/// When set, the sensor compares its samples to the near and far thresholds
+/// itself and interrupts on a change, so it is no longer polled and proximity
+/// samples are no longer published. Otherwise, the proximity sensor is polled
+/// by the sampling thread.
+#ifndef SENSE_PROXIMITY_CONFIG_INTERRUPT_DRIVEN
+#define SENSE_PROXIMITY_CONFIG_INTERRUPT_DRIVEN 0
+#endif  // SENSE_PROXIMITY_CONFIG_INTERRUPT_DRIVEN
+
+/// The proximity sample at or above which something is considered near.
+///
+/// Samples are in unspecified units ranging from 0 (farthest) to 65535
+/// (nearest).
+#ifndef SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD
+#define SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD 16384
+#endif  // SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD
+
+/// The proximity sample at or below which nothing is considered near.
+#ifndef SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD
+#define SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD 512
+#endif  // SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD
+
+static_assert(SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD <
+              SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD);
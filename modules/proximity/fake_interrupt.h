@@ -0,0 +1,65 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <utility>
+
+#include "pw_digital_io/digital_io.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+/// Fake interrupt line, such as a proximity sensor's interrupt pin, which
+/// is triggered explicitly rather than by hardware.
+class FakeDigitalInterrupt final : public pw::digital_io::DigitalInterrupt {
+ public:
+  FakeDigitalInterrupt() = default;
+
+  /// Returns whether a handler is set and enabled.
+  bool handler_enabled() const { return enabled_ && handler_enabled_; }
+
+  /// Invokes the handler as an interrupt on the line would, if it is enabled.
+  /// Returns whether it was.
+  bool Trigger() {
+    if (!handler_enabled()) {
+      return false;
+    }
+    handler_(pw::digital_io::State::kActive);
+    return true;
+  }
+
+ private:
+  pw::Status DoEnable(bool enable) override {
+    enabled_ = enable;
+    return pw::OkStatus();
+  }
+
+  pw::Status DoSetInterruptHandler(
+      pw::digital_io::InterruptTrigger,
+      pw::digital_io::InterruptHandler&& handler) override {
+    handler_ = std::move(handler);
+    return pw::OkStatus();
+  }
+
+  pw::Status DoEnableInterruptHandler(bool enable) override {
+    handler_enabled_ = enable && handler_ != nullptr;
+    return pw::OkStatus();
+  }
+
+  pw::digital_io::InterruptHandler handler_;
+  bool enabled_ = false;
+  bool handler_enabled_ = false;
+};
+
+}  // namespace sense
@@ -28,6 +28,18 @@ class FakeProximitySensor final : public ProximitySensor {
     sample_ = pw::Result<uint16_t>(error);
   }
 
+  /// Returns the interrupt thresholds last set, if any.
+  uint16_t lower_threshold() const { return lower_threshold_; }
+  uint16_t upper_threshold() const { return upper_threshold_; }
+  bool has_thresholds() const { return has_thresholds_; }
+
+  /// Returns whether the sample is outside of the interrupt thresholds, so
+  /// that a real sensor would signal an interrupt.
+  bool interrupt_pending() const {
+    return has_thresholds_ && sample_.ok() &&
+           (*sample_ < lower_threshold_ || *sample_ > upper_threshold_);
+  }
+
  private:
   pw::Status DoEnableProximitySensor() override { return pw::OkStatus(); }
 
@@ -35,7 +47,18 @@ class FakeProximitySensor final : public ProximitySensor {
 
   pw::Result<uint16_t> DoReadProxSample() override { return sample_; }
 
+  pw::Status DoSetInterruptThresholds(uint16_t lower,
+                                      uint16_t upper) override {
+    lower_threshold_ = lower;
+    upper_threshold_ = upper;
+    has_thresholds_ = true;
+    return pw::OkStatus();
+  }
+
   pw::Result<uint16_t> sample_;
+  uint16_t lower_threshold_ = 0;
+  uint16_t upper_threshold_ = 0;
+  bool has_thresholds_ = false;
 };
 
 }  // namespace sense
@@ -0,0 +1,152 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "PROX"
+
+#include "modules/proximity/interrupt_manager.h"
+
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#include "pw_assert/check.h"
+#include "pw_log/log.h"
+#include "pw_status/try.h"
+
+namespace sense {
+
+using ::pw::async2::Context;
+using ::pw::async2::Pending;
+using ::pw::async2::Poll;
+using ::pw::async2::Ready;
+
+ProximityInterruptManager::ProximityInterruptManager(
+    PubSub& pubsub,
+    ProximitySensor& sensor,
+    pw::digital_io::DigitalInterrupt& interrupt,
+    uint16_t inactive_threshold,
+    uint16_t active_threshold)
+    : pubsub_(pubsub),
+      sensor_(sensor),
+      interrupt_(interrupt),
+      inactive_threshold_(inactive_threshold),
+      active_threshold_(active_threshold) {
+  PW_CHECK(inactive_threshold_ < active_threshold_);
+}
+
+Poll<> ProximityInterruptManager::DoPend(Context& cx) {
+  if (!started_) {
+    if (const pw::Status status = Start(); !status.ok()) {
+      PW_LOG_ERROR("Failed to start proximity interrupts: %s", status.str());
+      return Ready();
+    }
+    started_ = true;
+    arming_.emplace(Arm());
+  }
+
+  while (true) {
+    if (reading_.has_value()) {
+      Poll<pw::Result<uint16_t>> sample = reading_->Pend(cx);
+      if (sample.IsPending()) {
+        return Pending();
+      }
+      reading_.reset();
+      Service(*sample);
+      // Rearming clears the interrupt, so this is done even if nothing
+      // changed.
+      arming_.emplace(Arm());
+    }
+
+    if (arming_.has_value()) {
+      Poll<pw::Status> status = arming_->Pend(cx);
+      if (status.IsPending()) {
+        return Pending();
+      }
+      arming_.reset();
+      if (!status->ok()) {
+        if (!armed_) {
+          PW_LOG_ERROR("Failed to start proximity interrupts: %s",
+                       status->str());
+          return Ready();
+        }
+        PW_LOG_WARN("Failed to rearm proximity sensor: %s", status->str());
+      }
+      armed_ = true;
+    }
+
+    {
+      std::lock_guard lock(lock_);
+      if (!interrupted_) {
+        waker_ = cx.GetWaker(pw::async2::WaitReason::Unspecified());
+        return Pending();
+      }
+      interrupted_ = false;
+    }
+    reading_.emplace(sensor_.ReadSampleAsync());
+  }
+}
+
+pw::Status ProximityInterruptManager::Start() {
+  // The sensor holds its interrupt line active until it is rearmed, so only
+  // the activating edge is of interest.
+  PW_TRY(interrupt_.SetInterruptHandler(
+      pw::digital_io::InterruptTrigger::kActivatingEdge,
+      [this](pw::digital_io::State) { OnInterrupt(); }));
+  PW_TRY(interrupt_.Enable());
+  return interrupt_.EnableInterruptHandler();
+}
+
+void ProximityInterruptManager::Service(const pw::Result<uint16_t>& sample) {
+  if (!sample.ok()) {
+    PW_LOG_WARN("Failed to read proximity sensor sample: %s",
+                sample.status().str());
+  } else if (*sample >= active_threshold_ && proximity_ != true) {
+    if (proximity_.has_value()) {
+      PW_CHECK(pubsub_.Publish(ProximityStateChange{.proximity = true}));
+    }
+    proximity_ = true;
+  } else if (*sample <= inactive_threshold_ && proximity_ != false) {
+    if (proximity_.has_value()) {
+      PW_CHECK(pubsub_.Publish(ProximityStateChange{.proximity = false}));
+    }
+    proximity_ = false;
+  }
+}
+
+ProximityThresholdsFuture ProximityInterruptManager::Arm() {
+  // The sensor interrupts for samples strictly outside of its thresholds,
+  // whereas these thresholds are inclusive.
+  constexpr uint16_t kMax = std::numeric_limits<uint16_t>::max();
+  const uint16_t near = active_threshold_ - 1;
+  const uint16_t far = inactive_threshold_ + 1;
+  if (!proximity_.has_value()) {
+    return sensor_.SetInterruptThresholdsAsync(far, near);
+  }
+  if (*proximity_) {
+    return sensor_.SetInterruptThresholdsAsync(far, kMax);
+  }
+  return sensor_.SetInterruptThresholdsAsync(0, near);
+}
+
+void ProximityInterruptManager::OnInterrupt() {
+  pw::async2::Waker waker;
+  {
+    std::lock_guard lock(lock_);
+    interrupted_ = true;
+    waker = std::move(waker_);
+  }
+  std::move(waker).Wake();
+}
+
+}  // namespace sense
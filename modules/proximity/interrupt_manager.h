@@ -0,0 +1,85 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "modules/proximity/sensor.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_digital_io/digital_io.h"
+#include "pw_result/result.h"
+#include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Reports near/far proximity events through PubSub, like
+/// `ProximityManager`, but without polling the sensor.
+///
+/// The sensor compares its samples to the thresholds in hardware, and
+/// signals an interrupt once one is past the threshold for the opposite
+/// state. The manager then reads the sample, publishes the change, and has
+/// the sensor watch for the next one. Until the first interrupt the state is
+/// unknown, and is learned without publishing a change, as
+/// `ProximityManager` does.
+///
+/// This is a task, which must be posted to a dispatcher to service the
+/// interrupt. The sample and the thresholds are awaited without blocking the
+/// dispatcher.
+class ProximityInterruptManager final : public pw::async2::Task {
+ public:
+  /// Uses the provided thresholds, which are in unspecified units ranging from
+  /// 0 (farthest) to 65535 (nearest), and are inclusive.
+  ProximityInterruptManager(PubSub& pubsub,
+                            ProximitySensor& sensor,
+                            pw::digital_io::DigitalInterrupt& interrupt,
+                            uint16_t inactive_threshold,
+                            uint16_t active_threshold);
+
+ private:
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) override;
+
+  /// Installs the interrupt handler.
+  pw::Status Start();
+
+  /// Updates the state from the sample that raised the interrupt.
+  void Service(const pw::Result<uint16_t>& sample);
+
+  /// Has the sensor watch for a sample past the threshold for the opposite
+  /// state, or either threshold if the state is unknown.
+  ProximityThresholdsFuture Arm();
+
+  /// Called from the interrupt.
+  void OnInterrupt() PW_LOCKS_EXCLUDED(lock_);
+
+  PubSub& pubsub_;
+  ProximitySensor& sensor_;
+  pw::digital_io::DigitalInterrupt& interrupt_;
+  const uint16_t inactive_threshold_;
+  const uint16_t active_threshold_;
+  bool started_ = false;
+  bool armed_ = false;
+  std::optional<bool> proximity_;
+  std::optional<ProximitySampleFuture> reading_;
+  std::optional<ProximityThresholdsFuture> arming_;
+
+  pw::sync::InterruptSpinLock lock_;
+  bool interrupted_ PW_GUARDED_BY(lock_) = false;
+  pw::async2::Waker waker_ PW_GUARDED_BY(lock_);
+};
+
+}  // namespace sense
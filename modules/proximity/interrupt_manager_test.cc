@@ -0,0 +1,133 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/proximity/interrupt_manager.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "modules/proximity/fake_interrupt.h"
+#include "modules/proximity/fake_sensor.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+// Test fixtures.
+
+class ProximityInterruptManagerTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kMaxEvents = 4;
+  static constexpr size_t kMaxSubscribers = 4;
+  using PubSub = GenericPubSubBuffer<Event, kMaxEvents, kMaxSubscribers>;
+
+  static constexpr uint16_t kFar = 512;
+  static constexpr uint16_t kNear = 16384;
+  static constexpr uint16_t kMax = std::numeric_limits<uint16_t>::max();
+
+  ProximityInterruptManagerTest()
+      : pubsub_(worker_), manager_(pubsub_, sensor_, interrupt_, kFar, kNear) {}
+
+  void SetUp() override {
+    ASSERT_TRUE(pubsub_.SubscribeTo<ProximityStateChange>(
+        [this](ProximityStateChange change) {
+          proximity_ = change.proximity;
+          ++changes_;
+          notification_.release();
+        }));
+    dispatcher_.Post(manager_);
+    dispatcher_.RunUntilStalled().IgnorePoll();
+  }
+
+  void TearDown() override {
+    manager_.Deregister();
+    worker_.Stop();
+  }
+
+  /// Sets the sensor's sample, and signals an interrupt if the sensor would.
+  void SetSample(uint16_t sample) {
+    sensor_.set_sample(sample);
+    if (sensor_.interrupt_pending()) {
+      EXPECT_TRUE(interrupt_.Trigger());
+    }
+    dispatcher_.RunUntilStalled().IgnorePoll();
+  }
+
+  TestWorker<> worker_;
+  PubSub pubsub_;
+  FakeProximitySensor sensor_;
+  FakeDigitalInterrupt interrupt_;
+  pw::async2::Dispatcher dispatcher_;
+  ProximityInterruptManager manager_;
+
+  pw::sync::ThreadNotification notification_;
+  bool proximity_ = false;
+  int changes_ = 0;
+};
+
+// Unit tests.
+
+TEST_F(ProximityInterruptManagerTest, ArmsForEitherStateAtFirst) {
+  EXPECT_TRUE(interrupt_.handler_enabled());
+  ASSERT_TRUE(sensor_.has_thresholds());
+  EXPECT_EQ(sensor_.lower_threshold(), kFar + 1);
+  EXPECT_EQ(sensor_.upper_threshold(), kNear - 1);
+}
+
+TEST_F(ProximityInterruptManagerTest, PublishesStateChanges) {
+  // The initial state is learned without publishing a change.
+  SetSample(100);
+  EXPECT_EQ(sensor_.lower_threshold(), 0u);
+  EXPECT_EQ(sensor_.upper_threshold(), kNear - 1);
+
+  SetSample(kNear);
+  notification_.acquire();
+  EXPECT_EQ(changes_, 1);
+  EXPECT_TRUE(proximity_);
+  EXPECT_EQ(sensor_.lower_threshold(), kFar + 1);
+  EXPECT_EQ(sensor_.upper_threshold(), kMax);
+
+  // Samples between the thresholds don't interrupt.
+  SetSample(kFar + 1000);
+
+  SetSample(kFar);
+  notification_.acquire();
+  EXPECT_EQ(changes_, 2);
+  EXPECT_FALSE(proximity_);
+  EXPECT_EQ(sensor_.lower_threshold(), 0u);
+  EXPECT_EQ(sensor_.upper_threshold(), kNear - 1);
+}
+
+TEST_F(ProximityInterruptManagerTest, RearmsAfterSpuriousInterrupt) {
+  SetSample(100);
+
+  // The sample is back between the thresholds by the time it is read.
+  sensor_.set_sample(kFar + 1000);
+  EXPECT_TRUE(interrupt_.Trigger());
+  dispatcher_.RunUntilStalled().IgnorePoll();
+  EXPECT_EQ(sensor_.lower_threshold(), 0u);
+  EXPECT_EQ(sensor_.upper_threshold(), kNear - 1);
+
+  SetSample(kNear);
+  notification_.acquire();
+  EXPECT_EQ(changes_, 1);
+  EXPECT_TRUE(proximity_);
+}
+
+}  // namespace
+}  // namespace sense
@@ -31,9 +31,11 @@ class ProximityManager {
   struct ProxSamplerPubSub {
     using PubSub = sense::PubSub;
     using Sample = uint16_t;
-    using SampleEvent = ProximitySample;
+    using SampleEvent = ProximitySampleBatch;
 
-    static uint16_t GetSample(SampleEvent event) { return event.sample; }
+    static const SampleEvent& GetSamples(const SampleEvent& event) {
+      return event;
+    }
 
     static ProximityStateChange GetEvent(Edge edge) {
       return {edge == Edge::kRising};
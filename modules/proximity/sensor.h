@@ -13,10 +13,15 @@
 // the License.
 #pragma once
 
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/system_clock.h"
 #include "pw_result/result.h"
 
 namespace sense {
 
+class ProximitySampleFuture;
+class ProximityThresholdsFuture;
+
 /// Represents a proximity sensor.
 class ProximitySensor {
  public:
@@ -36,14 +41,116 @@ class ProximitySensor {
   /// case to understand these values.
   virtual pw::Result<uint16_t> ReadSample() { return DoReadProxSample(); }
 
+  /// Like `ReadSample`, but returns a future that completes with the sample,
+  /// so that a task can wait for the sensor without blocking its dispatcher.
+  ///
+  /// Only one sample may be awaited at a time. A read left unfinished by a
+  /// dropped future is finished by the next one.
+  ProximitySampleFuture ReadSampleAsync();
+
+  /// Tells the sensor how often samples are read, so that it can measure at
+  /// least that often and each sample is a new measurement.
+  ///
+  /// Returns UNIMPLEMENTED if the sensor is unable to.
+  pw::Status SetSamplePeriod(pw::chrono::SystemClock::duration period) {
+    return DoSetProxSamplePeriod(period);
+  }
+
+  /// Has the sensor compare its samples to thresholds in hardware, and signal
+  /// an interrupt once a sample is below `lower` or above `upper`. Thresholds
+  /// are in the same units as samples. Clears any interrupt already signalled.
+  ///
+  /// Returns UNIMPLEMENTED if the sensor is unable to.
+  pw::Status SetInterruptThresholds(uint16_t lower, uint16_t upper) {
+    return DoSetInterruptThresholds(lower, upper);
+  }
+
+  /// Like `SetInterruptThresholds`, but returns a future that completes once
+  /// the thresholds are set, so that a task can wait for the sensor without
+  /// blocking its dispatcher.
+  ///
+  /// Only one change may be awaited at a time. A change left unfinished by a
+  /// dropped future is finished by the next one.
+  ProximityThresholdsFuture SetInterruptThresholdsAsync(uint16_t lower,
+                                                        uint16_t upper);
+
  protected:
   // Prohibit polymorphic destruction for now.
   ~ProximitySensor() = default;
 
  private:
+  friend class ProximitySampleFuture;
+  friend class ProximityThresholdsFuture;
+
   virtual pw::Status DoEnableProximitySensor() = 0;
   virtual pw::Status DoDisableProximitySensor() = 0;
   virtual pw::Result<uint16_t> DoReadProxSample() = 0;
+  virtual pw::Status DoSetProxSamplePeriod(pw::chrono::SystemClock::duration) {
+    return pw::Status::Unimplemented();
+  }
+  virtual pw::Status DoSetInterruptThresholds(uint16_t, uint16_t) {
+    return pw::Status::Unimplemented();
+  }
+
+  /// Continues reading a sample for `ReadSampleAsync`.
+  ///
+  /// By default, reads it with `DoReadProxSample`.
+  virtual pw::async2::Poll<pw::Result<uint16_t>> DoPendProxSample(
+      pw::async2::Context&) {
+    return pw::async2::Ready(DoReadProxSample());
+  }
+
+  /// Continues setting thresholds for `SetInterruptThresholdsAsync`.
+  ///
+  /// By default, sets them with `DoSetInterruptThresholds`.
+  virtual pw::async2::Poll<pw::Status> DoPendSetInterruptThresholds(
+      pw::async2::Context&, uint16_t lower, uint16_t upper) {
+    return pw::async2::Ready(DoSetInterruptThresholds(lower, upper));
+  }
+};
+
+/// Future returned by `ProximitySensor::ReadSampleAsync`.
+class ProximitySampleFuture {
+ public:
+  pw::async2::Poll<pw::Result<uint16_t>> Pend(pw::async2::Context& cx) {
+    return sensor_->DoPendProxSample(cx);
+  }
+
+ private:
+  friend class ProximitySensor;
+
+  explicit ProximitySampleFuture(ProximitySensor& sensor) : sensor_(&sensor) {}
+
+  ProximitySensor* sensor_;
 };
 
+/// Future returned by `ProximitySensor::SetInterruptThresholdsAsync`.
+class ProximityThresholdsFuture {
+ public:
+  pw::async2::Poll<pw::Status> Pend(pw::async2::Context& cx) {
+    return sensor_->DoPendSetInterruptThresholds(cx, lower_, upper_);
+  }
+
+ private:
+  friend class ProximitySensor;
+
+  ProximityThresholdsFuture(ProximitySensor& sensor,
+                            uint16_t lower,
+                            uint16_t upper)
+      : sensor_(&sensor), lower_(lower), upper_(upper) {}
+
+  ProximitySensor* sensor_;
+  uint16_t lower_;
+  uint16_t upper_;
+};
+
+inline ProximitySampleFuture ProximitySensor::ReadSampleAsync() {
+  return ProximitySampleFuture(*this);
+}
+
+inline ProximityThresholdsFuture ProximitySensor::SetInterruptThresholdsAsync(
+    uint16_t lower, uint16_t upper) {
+  return ProximityThresholdsFuture(*this, lower, upper);
+}
+
 }  // namespace sense
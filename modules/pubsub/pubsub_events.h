@@ -13,6 +13,11 @@
 // the License.
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <variant>
 
 #include "modules/pubsub/pubsub.h"
@@ -55,11 +60,47 @@ struct ProximityStateChange {
   bool proximity;
 };
 
-/// New proximity sample.
-struct ProximitySample {
-  /// Unspecified proximity units where 0 is the minimum (farthest) and 65535 is
-  /// the maximum (nearest) value reported by the sensor.
-  uint16_t sample;
+/// Batch of proximity samples taken at a regular interval.
+///
+/// Samples are in unspecified proximity units where 0 is the minimum
+/// (farthest) and 65535 is the maximum (nearest) value reported by the sensor.
+class ProximitySampleBatch {
+ public:
+  static constexpr size_t kMaxSamples = 8;
+
+  constexpr ProximitySampleBatch() = default;
+
+  /// @param start_ms    When the first sample was taken, in milliseconds since
+  ///                    boot.
+  /// @param interval_ms Time between consecutive samples, in milliseconds.
+  constexpr ProximitySampleBatch(uint32_t start_ms, uint16_t interval_ms)
+      : start_ms_(start_ms), interval_ms_(interval_ms) {}
+
+  constexpr uint32_t start_ms() const { return start_ms_; }
+  constexpr uint16_t interval_ms() const { return interval_ms_; }
+
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr bool full() const { return size_ == kMaxSamples; }
+
+  constexpr uint16_t operator[](size_t i) const { return samples_[i]; }
+  constexpr uint16_t back() const { return samples_[size_ - 1]; }
+  constexpr const uint16_t* begin() const { return samples_.data(); }
+  constexpr const uint16_t* end() const { return samples_.data() + size_; }
+
+  /// Returns when sample `i` was taken, in milliseconds since boot.
+  constexpr uint32_t sample_ms(size_t i) const {
+    return start_ms_ + static_cast<uint32_t>(i) * interval_ms_;
+  }
+
+  /// Appends a sample. The batch must not be full.
+  constexpr void push_back(uint16_t sample) { samples_[size_++] = sample; }
+
+ private:
+  uint32_t start_ms_ = 0;
+  uint16_t interval_ms_ = 0;
+  uint8_t size_ = 0;
+  std::array<uint16_t, kMaxSamples> samples_ = {};
 };
 
 /// New ambient light sample in lux.
@@ -69,10 +110,55 @@ struct AmbientLightSample {
 
 /// Air quality score that combines relative humidity and gas resistance values.
 struct AirQuality {
+  /// Width of the bands that scores are grouped into for display, from the
+  /// lowest (0-127) to the highest (896-1023).
+  static constexpr uint16_t kScoreBucketSize = 128;
+
   /// 10 bit value ranging from 0 (very poor) to 1023 (excellent).
   uint16_t score;
 };
 
+/// Gas resistances measured over one cycle of an air sensor's heater profile.
+class GasScan {
+ public:
+  static constexpr size_t kMaxSteps = 10;
+
+  constexpr GasScan() = default;
+  explicit constexpr GasScan(size_t num_steps)
+      : num_steps_(static_cast<uint8_t>(num_steps)) {}
+
+  constexpr size_t num_steps() const { return num_steps_; }
+
+  /// Returns whether a valid reading was taken at `step`.
+  constexpr bool has_gas_resistance(size_t step) const {
+    return (valid_steps_ & (1u << step)) != 0;
+  }
+
+  /// Returns the gas resistance in ohms measured at `step`, or 0 if none was.
+  float gas_resistance(size_t step) const {
+    if (!has_gas_resistance(step)) {
+      return 0.f;
+    }
+    return std::exp2(static_cast<float>(log2_ohms_[step]) / kLog2Scale);
+  }
+
+  void set_gas_resistance(size_t step, float ohms) {
+    float log2_ohms = std::round(std::log2(std::max(ohms, 1.f)) * kLog2Scale);
+    log2_ohms_[step] = static_cast<uint16_t>(std::min(log2_ohms, 65535.f));
+    valid_steps_ |= static_cast<uint16_t>(1u << step);
+  }
+
+ private:
+  // Resistances are stored as log2(ohms) in unsigned 5.11 fixed point, which
+  // is precise to about 0.02%, so that a full scan is no larger than the
+  // largest other event.
+  static constexpr float kLog2Scale = 2048.f;
+
+  uint8_t num_steps_ = 0;
+  uint16_t valid_steps_ = 0;
+  std::array<uint16_t, kMaxSteps> log2_ohms_ = {};
+};
+
 class LedValue {
  public:
   explicit constexpr LedValue(uint8_t r, uint8_t g, uint8_t b)
@@ -136,9 +222,10 @@ using Event = std::variant<ButtonA,
                            TimerRequest,
                            TimerExpired,
                            ProximityStateChange,
-                           ProximitySample,
+                           ProximitySampleBatch,
                            AmbientLightSample,
                            AirQuality,
+                           GasScan,
                            MorseEncodeRequest,
                            MorseCodeValue,
                            SenseState,
@@ -153,9 +240,10 @@ enum EventType : size_t {
   kTimerRequest,
   kTimerExpired,
   kProximityStateChange,
-  kProximitySample,
+  kProximitySampleBatch,
   kAmbientLightSample,
   kAirQuality,
+  kGasScan,
   kMorseEncodeRequest,
   kMorseCodeValue,
   kSenseState,
@@ -100,4 +100,49 @@ TEST_F(PubSubEventsTest, SubscribeTo) {
   EXPECT_EQ(total_score_, 1024u);
 }
 
+TEST(GasScanTest, StoresResistances) {
+  sense::GasScan scan(3);
+  scan.set_gas_resistance(0, 1500.f);
+  scan.set_gas_resistance(2, 2.5e6f);
+
+  EXPECT_EQ(scan.num_steps(), 3u);
+  EXPECT_TRUE(scan.has_gas_resistance(0));
+  EXPECT_FALSE(scan.has_gas_resistance(1));
+  EXPECT_TRUE(scan.has_gas_resistance(2));
+  EXPECT_NEAR(scan.gas_resistance(0), 1500.f, 1500.f * 2e-4f);
+  EXPECT_EQ(scan.gas_resistance(1), 0.f);
+  EXPECT_NEAR(scan.gas_resistance(2), 2.5e6f, 2.5e6f * 2e-4f);
+}
+
+TEST(GasScanTest, FitsInEvent) {
+  EXPECT_LE(sizeof(sense::GasScan), sizeof(sense::MorseEncodeRequest));
+}
+
+TEST(ProximitySampleBatchTest, StoresSamples) {
+  sense::ProximitySampleBatch batch(1000, 100);
+  EXPECT_TRUE(batch.empty());
+  for (uint16_t i = 0; i < sense::ProximitySampleBatch::kMaxSamples; ++i) {
+    EXPECT_FALSE(batch.full());
+    batch.push_back(i * 10);
+  }
+
+  EXPECT_TRUE(batch.full());
+  EXPECT_EQ(batch.size(), sense::ProximitySampleBatch::kMaxSamples);
+  EXPECT_EQ(batch[2], 20u);
+  EXPECT_EQ(batch.back(), 70u);
+  EXPECT_EQ(batch.sample_ms(0), 1000u);
+  EXPECT_EQ(batch.sample_ms(3), 1300u);
+
+  uint32_t total = 0;
+  for (uint16_t sample : batch) {
+    total += sample;
+  }
+  EXPECT_EQ(total, 280u);
+}
+
+TEST(ProximitySampleBatchTest, FitsInEvent) {
+  EXPECT_LE(sizeof(sense::ProximitySampleBatch),
+            sizeof(sense::MorseEncodeRequest));
+}
+
 }  // namespace
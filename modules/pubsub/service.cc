@@ -15,6 +15,9 @@
 
 #include "modules/pubsub/service.h"
 
+#include <algorithm>
+#include <mutex>
+
 #include "modules/state_manager/state_manager.h"
 #include "pw_assert/check.h"
 #include "pw_log/log.h"
@@ -23,6 +26,18 @@
 namespace sense {
 namespace {
 
+static_assert(sizeof(pubsub_CompactFrame::data.bytes) >=
+                  SampleFrameEncoder::kFrameSize,
+              "pubsub.options must allow a full compact frame");
+static_assert(sizeof(pubsub_GasScan::gas_resistance) /
+                      sizeof(pubsub_GasScan::gas_resistance[0]) >=
+                  GasScan::kMaxSteps,
+              "pubsub.options must allow a full gas scan");
+static_assert(sizeof(pubsub_ProximitySamples::samples) /
+                      sizeof(pubsub_ProximitySamples::samples[0]) >=
+                  ProximitySampleBatch::kMaxSamples,
+              "pubsub.options must allow a full proximity sample batch");
+
 pubsub_Event EventToProto(const Event& event) {
   pubsub_Event proto = pubsub_Event_init_default;
 
@@ -50,9 +65,14 @@ pubsub_Event EventToProto(const Event& event) {
   } else if (std::holds_alternative<ProximityStateChange>(event)) {
     proto.which_type = pubsub_Event_proximity_tag;
     proto.type.proximity = std::get<ProximityStateChange>(event).proximity;
-  } else if (std::holds_alternative<ProximitySample>(event)) {
-    proto.which_type = pubsub_Event_proximity_level_tag;
-    proto.type.proximity_level = std::get<ProximitySample>(event).sample;
+  } else if (std::holds_alternative<ProximitySampleBatch>(event)) {
+    proto.which_type = pubsub_Event_proximity_samples_tag;
+    const auto& batch = std::get<ProximitySampleBatch>(event);
+    auto& samples = proto.type.proximity_samples;
+    samples.start_ms = batch.start_ms();
+    samples.interval_ms = batch.interval_ms();
+    samples.samples_count = static_cast<pb_size_t>(batch.size());
+    std::copy(batch.begin(), batch.end(), samples.samples);
   } else if (std::holds_alternative<AmbientLightSample>(event)) {
     proto.which_type = pubsub_Event_ambient_light_lux_tag;
     proto.type.ambient_light_lux =
@@ -60,6 +80,14 @@ pubsub_Event EventToProto(const Event& event) {
   } else if (std::holds_alternative<AirQuality>(event)) {
     proto.which_type = pubsub_Event_air_quality_tag;
     proto.type.air_quality = std::get<AirQuality>(event).score;
+  } else if (std::holds_alternative<GasScan>(event)) {
+    proto.which_type = pubsub_Event_gas_scan_tag;
+    const auto& scan = std::get<GasScan>(event);
+    auto& gas_scan = proto.type.gas_scan;
+    gas_scan.gas_resistance_count = scan.num_steps();
+    for (size_t i = 0; i < scan.num_steps(); ++i) {
+      gas_scan.gas_resistance[i] = scan.gas_resistance(i);
+    }
   } else if (std::holds_alternative<MorseEncodeRequest>(event)) {
     proto.which_type = pubsub_Event_morse_encode_request_tag;
     const auto& morse = std::get<MorseEncodeRequest>(event);
@@ -170,17 +198,111 @@ pw::Result<Event> ProtoToEvent(const pubsub_Event& proto) {
 
 }  // namespace
 
-void PubSubService::Init(PubSub& pubsub) {
+PubSubService::PubSubService(
+    pw::chrono::SystemClock::duration max_compact_frame_age)
+    : max_compact_frame_age_(max_compact_frame_age),
+      ambient_light_compact_{
+          .encoder = SampleFrameEncoder(
+              SampleChannel::kAmbientLight,
+              [this](pw::ConstByteSpan frame) { WriteCompactFrame(frame); }),
+      },
+      proximity_compact_{
+          .encoder = SampleFrameEncoder(
+              SampleChannel::kProximity,
+              [this](pw::ConstByteSpan frame) { WriteCompactFrame(frame); }),
+      },
+      air_quality_compact_{
+          .encoder = SampleFrameEncoder(
+              SampleChannel::kAirQuality,
+              [this](pw::ConstByteSpan frame) { WriteCompactFrame(frame); }),
+      },
+      compact_flush_timer_(
+          pw::bind_member<&PubSubService::FlushCallback>(this)) {}
+
+void PubSubService::Init(PubSub& pubsub, Worker& worker, uint32_t boot_id) {
   pubsub_ = &pubsub;
+  worker_ = &worker;
+  boot_id_ = boot_id;
 
   PW_CHECK(pubsub_->Subscribe([this](Event event) {
-    // Writing to an unopened stream is okay here, so we IgnoreError.
-    stream_.Write(EventToProto(event)).IgnoreError();
+    HandleEvent(event);
+    EncodeCompact(event);
   }));
 }
 
+void PubSubService::HandleEvent(const Event& event) {
+  std::lock_guard lock(stream_lock_);
+  uint32_t seq = next_seq_++;
+
+  // Morse encode requests refer to strings owned by the publisher, which may
+  // no longer be valid by the time the event would be replayed.
+  if (!std::holds_alternative<MorseEncodeRequest>(event)) {
+    if (backlog_.full()) {
+      backlog_.pop_front();
+    }
+    backlog_.push_back({.seq = seq, .event = event});
+  }
+
+  pubsub_Event proto = EventToProto(event);
+  proto.seq = seq;
+  proto.boot_id = boot_id_;
+  // Writing to an unopened stream is okay here, so we IgnoreError.
+  subscribe_metrics_.Write(stream_, proto, pubsub_Event_fields).IgnoreError();
+}
+
+void PubSubService::ReplayLocked(const pubsub_SubscribeRequest& request) {
+  // The last event the subscriber has seen. Compared directly rather than
+  // with the next one it wants, which would wrap at the largest sequence
+  // number.
+  const uint32_t last_seen = request.resume_from_seq;
+  const uint32_t oldest = backlog_.empty() ? next_seq_ : backlog_.front().seq;
+
+  // Subscribers that don't report the boot they resume from can still be
+  // seen to be from an earlier boot if they have seen more events than this
+  // boot has published.
+  const bool restarted = request.has_resume_boot_id
+                             ? request.resume_boot_id != boot_id_
+                             : last_seen >= next_seq_;
+
+  pubsub_Event gap = pubsub_Event_init_default;
+  gap.which_type = pubsub_Event_gap_tag;
+  gap.boot_id = boot_id_;
+  bool has_gap = false;
+  if (restarted) {
+    has_gap = true;
+    gap.type.gap.first_missing_seq = 1;
+    gap.type.gap.missed_count = 0;
+  } else if (last_seen < oldest && oldest - last_seen > 1) {
+    // `last_seen` is below `oldest`, so the next sequence number can't wrap.
+    has_gap = true;
+    gap.type.gap.first_missing_seq = last_seen + 1;
+    gap.type.gap.missed_count = oldest - last_seen - 1;
+  }
+  if (has_gap) {
+    PW_LOG_WARN("Unable to replay events starting at %u",
+                static_cast<unsigned>(gap.type.gap.first_missing_seq));
+    subscribe_metrics_.Write(stream_, gap, pubsub_Event_fields).IgnoreError();
+  }
+
+  size_t replayed = 0;
+  for (const BacklogEntry& entry : backlog_) {
+    if (!restarted && entry.seq <= last_seen) {
+      continue;
+    }
+    pubsub_Event proto = EventToProto(entry.event);
+    proto.seq = entry.seq;
+    proto.boot_id = boot_id_;
+    if (!subscribe_metrics_.Write(stream_, proto, pubsub_Event_fields).ok()) {
+      return;
+    }
+    ++replayed;
+  }
+  PW_LOG_INFO("Replayed %zu pubsub events", replayed);
+}
+
 pw::Status PubSubService::Publish(const pubsub_Event& request,
                                   pw_protobuf_Empty& /*response*/) {
+  auto call = publish_metrics_.Measure();
   pw::Result<Event> maybe_event = ProtoToEvent(request);
   if (!maybe_event.ok()) {
     return maybe_event.status();
@@ -195,11 +317,93 @@ pw::Status PubSubService::Publish(const pubsub_Event& request,
   return pw::OkStatus();
 }
 
-void PubSubService::Subscribe(const pw_protobuf_Empty&,
+void PubSubService::Subscribe(const pubsub_SubscribeRequest& request,
                               ServerWriter<pubsub_Event>& writer) {
+  auto call = subscribe_metrics_.Measure();
   PW_LOG_INFO("Streaming pubsub events over RPC channel %u",
               writer.channel_id());
-  stream_ = std::move(writer);
+  std::lock_guard lock(stream_lock_);
+  subscribe_metrics_.OpenStream(stream_, writer);
+  if (request.has_resume_from_seq) {
+    ReplayLocked(request);
+  }
+}
+
+void PubSubService::SubscribeCompact(
+    const pw_protobuf_Empty&, ServerWriter<pubsub_CompactFrame>& writer) {
+  auto call = subscribe_compact_metrics_.Measure();
+  PW_LOG_INFO("Streaming compact samples over RPC channel %u",
+              writer.channel_id());
+  {
+    std::lock_guard lock(compact_lock_);
+    ambient_light_compact_.encoder.Reset();
+    proximity_compact_.encoder.Reset();
+    air_quality_compact_.encoder.Reset();
+    subscribe_compact_metrics_.OpenStream(compact_stream_, writer);
+  }
+  compact_flush_timer_.InvokeAfter(max_compact_frame_age_ / 2);
+}
+
+void PubSubService::EncodeCompact(const Event& event) {
+  std::lock_guard lock(compact_lock_);
+  if (!compact_stream_.active()) {
+    return;
+  }
+
+  if (std::holds_alternative<AmbientLightSample>(event)) {
+    AddCompactSample(ambient_light_compact_,
+                     std::get<AmbientLightSample>(event).sample_lux);
+  } else if (std::holds_alternative<ProximitySampleBatch>(event)) {
+    for (uint16_t sample : std::get<ProximitySampleBatch>(event)) {
+      AddCompactSample(proximity_compact_, sample);
+    }
+  } else if (std::holds_alternative<AirQuality>(event)) {
+    AddCompactSample(air_quality_compact_, std::get<AirQuality>(event).score);
+  }
+}
+
+template <typename T>
+void PubSubService::AddCompactSample(CompactChannel& channel, T sample) {
+  channel.encoder.Add(sample);
+  if (channel.encoder.pending_samples() == 1) {
+    channel.frame_started = pw::chrono::SystemClock::now();
+  }
+}
+
+void PubSubService::FlushCallback(pw::chrono::SystemClock::time_point now) {
+  // Flushing writes RPC frames, which is too slow for the timer thread.
+  worker_->RunOnce([this, now]() { FlushStaleFrames(now); });
+}
+
+void PubSubService::FlushStaleFrames(pw::chrono::SystemClock::time_point now) {
+  // Frames are checked twice as often as they may age, so none waits more
+  // than one and a half times the maximum.
+  {
+    std::lock_guard lock(compact_lock_);
+    if (!compact_stream_.active()) {
+      return;
+    }
+    for (CompactChannel* channel : {&ambient_light_compact_,
+                                    &proximity_compact_,
+                                    &air_quality_compact_}) {
+      if (channel->encoder.pending_samples() != 0 &&
+          now - channel->frame_started >= max_compact_frame_age_) {
+        channel->encoder.Flush();
+      }
+    }
+  }
+  compact_flush_timer_.InvokeAt(now + max_compact_frame_age_ / 2);
+}
+
+void PubSubService::WriteCompactFrame(pw::ConstByteSpan frame) {
+  pubsub_CompactFrame proto = pubsub_CompactFrame_init_default;
+  proto.data.size = static_cast<pb_size_t>(frame.size());
+  std::copy(frame.begin(),
+            frame.end(),
+            reinterpret_cast<std::byte*>(proto.data.bytes));
+  subscribe_compact_metrics_
+      .Write(compact_stream_, proto, pubsub_CompactFrame_fields)
+      .IgnoreError();
 }
 
 }  // namespace sense
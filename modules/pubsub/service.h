@@ -13,22 +13,119 @@
 // the License.
 #pragma once
 
+#include <chrono>
+
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/pubsub/pubsub_pb/pubsub.rpc.pb.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/sample_codec/sample_codec.h"
+#include "modules/worker/worker.h"
+#include "pw_bytes/span.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
+#include "pw_containers/inline_deque.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
 
 namespace sense {
 
 class PubSubService final
     : public ::pubsub::pw_rpc::nanopb::PubSub::Service<PubSubService> {
  public:
-  void Init(PubSub& pubsub);
+  /// Number of recent events retained for replay to reconnecting subscribers.
+  static constexpr size_t kBacklogSize = 32;
+
+  /// Longest that a sample waits in a partially filled compact frame before
+  /// the frame is sent anyway, so that slow channels still arrive promptly.
+  static constexpr pw::chrono::SystemClock::duration kMaxCompactFrameAge =
+      pw::chrono::SystemClock::for_at_least(std::chrono::seconds(5));
+
+  explicit PubSubService(
+      pw::chrono::SystemClock::duration max_compact_frame_age =
+          kMaxCompactFrameAge);
+
+  /// Streams the events of `pubsub`. `boot_id` should differ each time the
+  /// device boots, so that subscribers resuming from an earlier boot are told
+  /// that they missed events. Stale compact frames are flushed on `worker`.
+  void Init(PubSub& pubsub, Worker& worker, uint32_t boot_id);
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
 
   pw::Status Publish(const pubsub_Event& request, pw_protobuf_Empty&);
-  void Subscribe(const pw_protobuf_Empty&, ServerWriter<pubsub_Event>& writer);
+  void Subscribe(const pubsub_SubscribeRequest& request,
+                 ServerWriter<pubsub_Event>& writer);
+  void SubscribeCompact(const pw_protobuf_Empty&,
+                        ServerWriter<pubsub_CompactFrame>& writer);
 
  private:
+  struct BacklogEntry {
+    uint32_t seq;
+    Event event;
+  };
+
+  /// Assigns the next sequence number to an event, records it in the backlog
+  /// and writes it to the event stream.
+  void HandleEvent(const Event& event) PW_LOCKS_EXCLUDED(stream_lock_);
+
+  /// Writes the backlogged events that follow `resume_from_seq` to the event
+  /// stream, preceded by a gap event if some have already been dropped.
+  void ReplayLocked(const pubsub_SubscribeRequest& request)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(stream_lock_);
+
+  /// An encoder for one sample channel of the compact stream.
+  struct CompactChannel {
+    SampleFrameEncoder encoder;
+    /// When the first sample of the encoder's pending frame was added.
+    pw::chrono::SystemClock::time_point frame_started;
+  };
+
+  /// Feeds sample events to the compact stream's encoders.
+  void EncodeCompact(const Event& event) PW_LOCKS_EXCLUDED(compact_lock_);
+
+  template <typename T>
+  void AddCompactSample(CompactChannel& channel, T sample)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(compact_lock_);
+
+  /// Has the worker flush stale compact frames.
+  void FlushCallback(pw::chrono::SystemClock::time_point now);
+
+  /// Sends any compact frames that have been pending for too long, and checks
+  /// again later while the compact stream is open. Runs on the worker.
+  void FlushStaleFrames(pw::chrono::SystemClock::time_point now)
+      PW_LOCKS_EXCLUDED(compact_lock_);
+
+  void WriteCompactFrame(pw::ConstByteSpan frame);
+
   PubSub* pubsub_ = nullptr;
-  ServerWriter<pubsub_Event> stream_;
+  Worker* worker_ = nullptr;
+  uint32_t boot_id_ = 0;
+
+  // Held while writing to `stream_`, so that replayed events are never
+  // interleaved with live ones.
+  pw::sync::Mutex stream_lock_;
+  ServerWriter<pubsub_Event> stream_ PW_GUARDED_BY(stream_lock_);
+  uint32_t next_seq_ PW_GUARDED_BY(stream_lock_) = 1;
+  pw::InlineDeque<BacklogEntry, kBacklogSize> backlog_
+      PW_GUARDED_BY(stream_lock_);
+
+  // Held while using the encoders, which are fed from the pubsub subscriber
+  // callback and flushed from the worker, and so while writing the frames
+  // they emit to `compact_stream_`.
+  pw::sync::Mutex compact_lock_;
+  ServerWriter<pubsub_CompactFrame> compact_stream_;
+  const pw::chrono::SystemClock::duration max_compact_frame_age_;
+  CompactChannel ambient_light_compact_ PW_GUARDED_BY(compact_lock_);
+  CompactChannel proximity_compact_ PW_GUARDED_BY(compact_lock_);
+  CompactChannel air_quality_compact_ PW_GUARDED_BY(compact_lock_);
+  pw::chrono::SystemTimer compact_flush_timer_;
+
+  RpcServiceMetrics method_metrics_{"PubSub"};
+  RpcMethodMetrics publish_metrics_{method_metrics_,
+                                    SENSE_RPC_METHOD(PubSubService, Publish)};
+  RpcMethodMetrics subscribe_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(PubSubService, Subscribe)};
+  RpcMethodMetrics subscribe_compact_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(PubSubService, SubscribeCompact)};
 };
 
 }  // namespace sense
@@ -14,6 +14,8 @@
 
 #include "modules/pubsub/service.h"
 
+#include <cstdint>
+
 #include "modules/pubsub/pubsub_events.h"
 #include "modules/worker/test_worker.h"
 #include "pw_rpc/nanopb/test_method_context.h"
@@ -25,6 +27,8 @@ namespace {
 
 using namespace std::literals::chrono_literals;
 
+constexpr uint32_t kBootId = 0x5e45e;
+
 class PubSubServiceTest : public ::testing::Test {
  protected:
   static constexpr size_t kMaxEvents = 4;
@@ -36,18 +40,38 @@ class PubSubServiceTest : public ::testing::Test {
 
   void TearDown() override { worker_.Stop(); }
 
+  /// Publishes `count` air quality events with scores 1 to `count`, and waits
+  /// until they have all been handled.
+  void PublishAndWait(size_t count) {
+    events_expected_ = count;
+    auto token = pubsub_.Subscribe([this](sense::Event) {
+      if (++events_processed_ == events_expected_) {
+        notification_.release();
+      }
+    });
+    ASSERT_TRUE(token.has_value());
+    for (size_t i = 1; i <= count; ++i) {
+      auto score = static_cast<uint16_t>(i);
+      while (!pubsub_.Publish(sense::AirQuality{.score = score})) {
+      }
+    }
+    notification_.acquire();
+    pubsub_.Unsubscribe(*token);
+  }
+
   sense::TestWorker<> worker_;
   PubSub pubsub_;
 
   pw::sync::ThreadNotification notification_;
   size_t events_processed_ = 0;
+  size_t events_expected_ = 0;
   uint16_t total_score_ = 0;
   size_t button_presses_ = 0;
 };
 
 TEST_F(PubSubServiceTest, Subscribe) {
   PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
-  ctx.service().Init(pubsub_);
+  ctx.service().Init(pubsub_, worker_, kBootId);
   ctx.call({});
 
   pw::rpc::test::WaitForPackets(ctx.output(), 3, [this] {
@@ -65,9 +89,177 @@ TEST_F(PubSubServiceTest, Subscribe) {
   EXPECT_EQ(ctx.responses()[2].type.button_y_pressed, true);
 }
 
+TEST_F(PubSubServiceTest, SubscribeStreamsProximitySampleBatches) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  ctx.call({});
+
+  sense::ProximitySampleBatch batch(5000, 100);
+  batch.push_back(10);
+  batch.push_back(2000);
+  batch.push_back(30);
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [this, &batch] {
+    EXPECT_TRUE(pubsub_.Publish(batch));
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  ASSERT_EQ(ctx.responses()[0].which_type,
+            pubsub_Event_proximity_samples_tag);
+  const pubsub_ProximitySamples& samples =
+      ctx.responses()[0].type.proximity_samples;
+  EXPECT_EQ(samples.start_ms, 5000u);
+  EXPECT_EQ(samples.interval_ms, 100u);
+  ASSERT_EQ(samples.samples_count, 3u);
+  EXPECT_EQ(samples.samples[0], 10u);
+  EXPECT_EQ(samples.samples[1], 2000u);
+  EXPECT_EQ(samples.samples[2], 30u);
+}
+
+TEST_F(PubSubServiceTest, SubscribeAssignsSequenceNumbers) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  ctx.call({});
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 2, [this] {
+    EXPECT_TRUE(pubsub_.Publish(sense::ButtonA(true)));
+    EXPECT_TRUE(pubsub_.Publish(sense::ButtonA(false)));
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 2u);
+  EXPECT_EQ(ctx.responses()[0].seq, 1u);
+  EXPECT_EQ(ctx.responses()[1].seq, 2u);
+}
+
+TEST_F(PubSubServiceTest, SubscribeResumesFromBacklog) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  PublishAndWait(5);
+
+  ctx.call({
+      .has_resume_from_seq = true,
+      .resume_from_seq = 3,
+      .has_resume_boot_id = true,
+      .resume_boot_id = kBootId,
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 2u);
+  EXPECT_EQ(ctx.responses()[0].seq, 4u);
+  EXPECT_EQ(ctx.responses()[0].boot_id, kBootId);
+  ASSERT_EQ(ctx.responses()[0].which_type, pubsub_Event_air_quality_tag);
+  EXPECT_EQ(ctx.responses()[0].type.air_quality, 4u);
+  EXPECT_EQ(ctx.responses()[1].seq, 5u);
+  EXPECT_EQ(ctx.responses()[1].type.air_quality, 5u);
+}
+
+TEST_F(PubSubServiceTest, SubscribeReportsGapAfterRestart) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  PublishAndWait(5);
+
+  // The subscriber's resume point is within this boot's sequence numbers, but
+  // it was reached in an earlier boot.
+  ctx.call({
+      .has_resume_from_seq = true,
+      .resume_from_seq = 3,
+      .has_resume_boot_id = true,
+      .resume_boot_id = kBootId + 1,
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 6u);
+  ASSERT_EQ(ctx.responses()[0].which_type, pubsub_Event_gap_tag);
+  EXPECT_EQ(ctx.responses()[0].type.gap.first_missing_seq, 1u);
+  EXPECT_EQ(ctx.responses()[0].type.gap.missed_count, 0u);
+  EXPECT_EQ(ctx.responses()[1].seq, 1u);
+  EXPECT_EQ(ctx.responses()[5].seq, 5u);
+}
+
+TEST_F(PubSubServiceTest, SubscribeFromLargestSeqReportsRestart) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Subscribe) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  PublishAndWait(2);
+
+  // More events than this boot has published, without wrapping around to the
+  // start of the sequence.
+  ctx.call({.has_resume_from_seq = true, .resume_from_seq = UINT32_MAX});
+
+  ASSERT_EQ(ctx.responses().size(), 3u);
+  ASSERT_EQ(ctx.responses()[0].which_type, pubsub_Event_gap_tag);
+  EXPECT_EQ(ctx.responses()[0].type.gap.first_missing_seq, 1u);
+  EXPECT_EQ(ctx.responses()[0].type.gap.missed_count, 0u);
+  EXPECT_EQ(ctx.responses()[1].seq, 1u);
+  EXPECT_EQ(ctx.responses()[2].seq, 2u);
+}
+
+TEST_F(PubSubServiceTest, SubscribeReportsGapWhenBacklogExceeded) {
+  constexpr size_t kBacklogSize = sense::PubSubService::kBacklogSize;
+  PW_NANOPB_TEST_METHOD_CONTEXT(
+      sense::PubSubService, Subscribe, kBacklogSize + 1, 1024)
+  ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  PublishAndWait(kBacklogSize + 10);
+
+  ctx.call({.has_resume_from_seq = true, .resume_from_seq = 0});
+
+  ASSERT_EQ(ctx.responses().size(), kBacklogSize + 1);
+  ASSERT_EQ(ctx.responses()[0].which_type, pubsub_Event_gap_tag);
+  EXPECT_EQ(ctx.responses()[0].type.gap.first_missing_seq, 1u);
+  EXPECT_EQ(ctx.responses()[0].type.gap.missed_count, 10u);
+  EXPECT_EQ(ctx.responses()[1].seq, 11u);
+  EXPECT_EQ(ctx.responses()[kBacklogSize].seq, kBacklogSize + 10);
+}
+
+TEST_F(PubSubServiceTest, SubscribeCompact) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, SubscribeCompact) ctx;
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  ctx.call({});
+
+  // Alternating between the extremes makes every delta take 3 bytes, so the
+  // 21st sample does not fit and the first frame is emitted.
+  constexpr size_t kSamples = 21;
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [this] {
+    sense::ProximitySampleBatch batch;
+    for (size_t i = 0; i < kSamples; ++i) {
+      batch.push_back((i % 2 == 0) ? 0u : 0xffffu);
+      if (batch.full() || i == kSamples - 1) {
+        while (!pubsub_.Publish(batch)) {
+        }
+        batch = sense::ProximitySampleBatch();
+      }
+    }
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  const auto& data = ctx.responses()[0].data;
+  ASSERT_EQ(data.size, sense::SampleFrameEncoder::kHeaderSize + 1 + 19 * 3);
+  EXPECT_EQ(data.bytes[0],
+            static_cast<uint8_t>(sense::SampleChannel::kProximity));
+  EXPECT_EQ(data.bytes[1], sense::SampleFrameEncoder::kKeyframeFlag);
+  EXPECT_EQ(data.bytes[3], kSamples - 1);
+}
+
+TEST_F(PubSubServiceTest, SubscribeCompactFlushesStaleFrames) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, SubscribeCompact)
+  ctx(pw::chrono::SystemClock::for_at_least(50ms));
+  ctx.service().Init(pubsub_, worker_, kBootId);
+  ctx.call({});
+
+  // A single sample is far from filling a frame, but is sent once it has
+  // waited long enough.
+  pw::rpc::test::WaitForPackets(ctx.output(), 1, [this] {
+    EXPECT_TRUE(pubsub_.Publish(sense::AirQuality{.score = 512u}));
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  const auto& data = ctx.responses()[0].data;
+  EXPECT_EQ(data.bytes[0],
+            static_cast<uint8_t>(sense::SampleChannel::kAirQuality));
+  EXPECT_EQ(data.bytes[1], sense::SampleFrameEncoder::kKeyframeFlag);
+  EXPECT_EQ(data.bytes[3], 1u);
+}
+
 TEST_F(PubSubServiceTest, Publish) {
   PW_NANOPB_TEST_METHOD_CONTEXT(sense::PubSubService, Publish) ctx;
-  ctx.service().Init(pubsub_);
+  ctx.service().Init(pubsub_, worker_, kBootId);
 
   ASSERT_TRUE(pubsub_.Subscribe([this](sense::Event event) {
     events_processed_++;
@@ -0,0 +1,123 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "RPC"
+
+#include "modules/rpc_metrics/rpc_metrics.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+#include "pw_assert/check.h"
+#include "pw_log/log.h"
+
+namespace sense {
+
+RpcMethodMetrics::RpcMethodMetrics(RpcServiceMetrics& service,
+                                   RpcMethodId method)
+    : owner_(&service),
+      service_(service.service()),
+      method_(method.name),
+      method_id_(method.id) {
+  owner_->methods_.push_back(*this);
+}
+
+RpcMethodMetrics::~RpcMethodMetrics() {
+  if (owner_ != nullptr) {
+    owner_->methods_.remove(*this);
+  }
+}
+
+RpcMethodMetrics::Snapshot RpcMethodMetrics::GetSnapshot() const {
+  std::lock_guard lock(lock_);
+  return stats_;
+}
+
+void RpcMethodMetrics::Log() const {
+  Snapshot stats = GetSnapshot();
+  uint32_t average_us =
+      stats.calls == 0
+          ? 0
+          : static_cast<uint32_t>(stats.total_handler_us / stats.calls);
+  PW_LOG_INFO("%s.%s: %u calls, %u us avg, %u us max",
+              service_,
+              method_,
+              static_cast<unsigned>(stats.calls),
+              static_cast<unsigned>(average_us),
+              static_cast<unsigned>(stats.max_handler_us));
+  if (stats.messages_written != 0 || stats.open_streams != 0) {
+    PW_LOG_INFO("%s.%s: %u open streams, %u messages, %llu bytes written",
+                service_,
+                method_,
+                static_cast<unsigned>(stats.open_streams),
+                static_cast<unsigned>(stats.messages_written),
+                static_cast<unsigned long long>(stats.bytes_written));
+  }
+}
+
+void RpcMethodMetrics::RecordCall(pw::chrono::SystemClock::duration elapsed) {
+  auto elapsed_us = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+  uint32_t clamped_us = static_cast<uint32_t>(
+      std::min<uint64_t>(elapsed_us, std::numeric_limits<uint32_t>::max()));
+
+  std::lock_guard lock(lock_);
+  ++stats_.calls;
+  stats_.total_handler_us += elapsed_us;
+  stats_.max_handler_us = std::max(stats_.max_handler_us, clamped_us);
+}
+
+void RpcMethodMetrics::RecordStreamOpened() {
+  std::lock_guard lock(lock_);
+  ++stats_.open_streams;
+}
+
+void RpcMethodMetrics::RecordStreamClosed() {
+  std::lock_guard lock(lock_);
+  if (stats_.open_streams != 0) {
+    --stats_.open_streams;
+  }
+}
+
+void RpcMethodMetrics::RecordWrite(size_t bytes) {
+  std::lock_guard lock(lock_);
+  ++stats_.messages_written;
+  stats_.bytes_written += bytes;
+}
+
+void RpcMetrics::Add(RpcServiceMetrics& service) {
+  size_t count = 0;
+  service.ForEach([&service, &count](const RpcMethodMetrics& method) {
+    ++count;
+    size_t matches = 0;
+    service.ForEach([&method, &matches](const RpcMethodMetrics& other) {
+      matches += other.method_id() == method.method_id() ? 1 : 0;
+    });
+    PW_CHECK_INT_EQ(matches,
+                    1,
+                    "%s.%s has more than one set of metrics",
+                    method.service(),
+                    method.method());
+  });
+  PW_CHECK_INT_NE(count, 0, "%s has no method metrics", service.service());
+  services_.push_back(service);
+}
+
+void RpcMetrics::Log() const {
+  PW_LOG_INFO("RPC method metrics:");
+  ForEach([](const RpcMethodMetrics& method) { method.Log(); });
+}
+
+}  // namespace sense
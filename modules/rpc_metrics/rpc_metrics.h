@@ -0,0 +1,275 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "pb_encode.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_containers/intrusive_list.h"
+#include "pw_rpc/internal/hash.h"
+#include "pw_rpc/internal/method_lookup.h"
+#include "pw_status/status.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+class RpcServiceMetrics;
+
+/// The name and ID of a method in a service's generated method table.
+struct RpcMethodId {
+  const char* name;
+  uint32_t id;
+};
+
+namespace internal {
+
+template <typename Service, uint32_t kMethodId>
+constexpr RpcMethodId CheckedRpcMethodId(const char* name) {
+  // Fails to compile if `Service` has no RPC method with this ID.
+  static_cast<void>(
+      ::pw::rpc::internal::MethodLookup::GetNanopbMethod<Service,
+                                                         kMethodId>());
+  return RpcMethodId{name, kMethodId};
+}
+
+}  // namespace internal
+
+/// Looks up `method` in the generated method table of `service`, and expands
+/// to its `RpcMethodId`. Fails to compile if `service` has no such method.
+#define SENSE_RPC_METHOD(service, method) \
+  ::sense::internal::                     \
+      CheckedRpcMethodId<service, ::pw::rpc::internal::Hash(#method)>(#method)
+
+/// Call, latency, and streaming statistics for a single RPC method.
+///
+/// Services hold one of these per method, created in the service's
+/// `RpcServiceMetrics` from the method's entry in the generated method table,
+/// and update it from their handlers. pw_rpc dispatches
+/// directly to the generated handlers, so there is no server hook to time
+/// calls from; each handler starts with `Measure()` instead, and is timed by
+/// holding the result for the duration of the handler. Streaming methods
+/// route their writes through `OpenStream()` and `Write()`, which track the
+/// number of open streams and the number of messages and encoded bytes sent on
+/// them.
+class RpcMethodMetrics : public pw::IntrusiveList<RpcMethodMetrics>::Item {
+ public:
+  struct Snapshot {
+    uint32_t calls;
+    uint64_t total_handler_us;
+    uint32_t max_handler_us;
+    uint32_t open_streams;
+    uint32_t messages_written;
+    uint64_t bytes_written;
+  };
+
+  /// Records a single handler invocation when it goes out of scope.
+  class [[nodiscard]] ScopedCall {
+   public:
+    ScopedCall(const ScopedCall&) = delete;
+    ScopedCall& operator=(const ScopedCall&) = delete;
+
+    ~ScopedCall() {
+      metrics_.RecordCall(pw::chrono::SystemClock::now() - start_);
+    }
+
+   private:
+    friend class RpcMethodMetrics;
+
+    explicit ScopedCall(RpcMethodMetrics& metrics)
+        : metrics_(metrics), start_(pw::chrono::SystemClock::now()) {}
+
+    RpcMethodMetrics& metrics_;
+    pw::chrono::SystemClock::time_point start_;
+  };
+
+  constexpr RpcMethodMetrics(const char* service, const char* method)
+      : service_(service), method_(method) {}
+
+  /// Creates metrics for `method`, and adds them to `service`. `method` comes
+  /// from `SENSE_RPC_METHOD()`.
+  RpcMethodMetrics(RpcServiceMetrics& service, RpcMethodId method);
+
+  ~RpcMethodMetrics();
+
+  RpcMethodMetrics(const RpcMethodMetrics&) = delete;
+  RpcMethodMetrics& operator=(const RpcMethodMetrics&) = delete;
+
+  const char* service() const { return service_; }
+  const char* method() const { return method_; }
+  uint32_t method_id() const { return method_id_; }
+
+  /// Starts timing a handler invocation.
+  ScopedCall Measure() { return ScopedCall(*this); }
+
+  /// Replaces the stream held in `stream` with a newly opened `writer`.
+  ///
+  /// Replacing a stream closes it, so a stream still open in `stream` is
+  /// counted as closed. Each member holding a stream adds at most one to the
+  /// count of open streams.
+  template <typename Writer>
+  void OpenStream(Writer& stream, Writer& writer) {
+    if (stream.active()) {
+      RecordStreamClosed();
+    }
+    stream = std::move(writer);
+    RecordStreamOpened();
+  }
+
+  /// Writes `response` to `writer`, recording its encoded size.
+  ///
+  /// pw_rpc encodes the response into the packet itself, without reporting
+  /// its size, so the size is only worked out once the response has been
+  /// sent. Nothing is encoded for writes to closed streams, or that fail.
+  template <typename Writer, typename Response>
+  pw::Status Write(Writer& writer,
+                   const Response& response,
+                   const pb_msgdesc_t* fields) {
+    return WriteAndRecord(writer, response, [&response, fields] {
+      size_t size = 0;
+      return pb_get_encoded_size(&size, fields, &response) ? size : 0;
+    });
+  }
+
+  /// Writes `response` to `writer`, recording `encoded_size` bytes.
+  template <typename Writer, typename Response>
+  pw::Status Write(Writer& writer,
+                   const Response& response,
+                   size_t encoded_size) {
+    return WriteAndRecord(
+        writer, response, [encoded_size] { return encoded_size; });
+  }
+
+  Snapshot GetSnapshot() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// Logs the current statistics for this method.
+  void Log() const PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  /// Writes `response` to `writer`, and records the size returned by
+  /// `encoded_size()` once it has been sent.
+  ///
+  /// Streams that were closed by the client are noticed, and no longer counted
+  /// as open, the next time a write to them is attempted. A write that fails
+  /// while the stream stays open, e.g. for lack of buffer space, leaves it
+  /// counted as open.
+  template <typename Writer, typename Response, typename SizeFunction>
+  pw::Status WriteAndRecord(Writer& writer,
+                            const Response& response,
+                            SizeFunction&& encoded_size) {
+    if (!writer.active()) {
+      RecordStreamClosed();
+      return pw::Status::FailedPrecondition();
+    }
+    pw::Status status = writer.Write(response);
+    if (status.ok()) {
+      RecordWrite(encoded_size());
+    } else if (!writer.active()) {
+      RecordStreamClosed();
+    }
+    return status;
+  }
+
+  void RecordCall(pw::chrono::SystemClock::duration elapsed)
+      PW_LOCKS_EXCLUDED(lock_);
+  void RecordStreamOpened() PW_LOCKS_EXCLUDED(lock_);
+  void RecordStreamClosed() PW_LOCKS_EXCLUDED(lock_);
+  void RecordWrite(size_t bytes) PW_LOCKS_EXCLUDED(lock_);
+
+  RpcServiceMetrics* owner_ = nullptr;
+  const char* service_;
+  const char* method_;
+  uint32_t method_id_ = 0;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  Snapshot stats_ PW_GUARDED_BY(lock_) = {};
+};
+
+/// The per-method metrics of a single service.
+///
+/// Services hold one of these, followed by an `RpcMethodMetrics` for each of
+/// their methods, and expose it through `method_metrics()` so that
+/// `RegisterService` can collect it.
+class RpcServiceMetrics : public pw::IntrusiveList<RpcServiceMetrics>::Item {
+ public:
+  explicit RpcServiceMetrics(const char* service) : service_(service) {}
+
+  ~RpcServiceMetrics() { methods_.clear(); }
+
+  RpcServiceMetrics(const RpcServiceMetrics&) = delete;
+  RpcServiceMetrics& operator=(const RpcServiceMetrics&) = delete;
+
+  const char* service() const { return service_; }
+
+  /// Invokes `callback` with each method's metrics, in declaration order.
+  template <typename Callback>
+  void ForEach(Callback&& callback) const {
+    for (const RpcMethodMetrics& method : methods_) {
+      callback(method);
+    }
+  }
+
+ private:
+  friend class RpcMethodMetrics;
+
+  const char* service_;
+  pw::IntrusiveList<RpcMethodMetrics> methods_;
+};
+
+/// Collection of per-method metrics for all instrumented services.
+class RpcMetrics {
+ public:
+  ~RpcMetrics() { services_.clear(); }
+
+  /// Adds a service's metrics to the collection. Must not be called while the
+  /// collection is being iterated.
+  ///
+  /// Crashes if the service has no method metrics, or has more than one for
+  /// the same method.
+  void Add(RpcServiceMetrics& service);
+
+  /// Invokes `callback` with each method's metrics, in registration order.
+  template <typename Callback>
+  void ForEach(Callback&& callback) const {
+    for (const RpcServiceMetrics& service : services_) {
+      service.ForEach(callback);
+    }
+  }
+
+  /// Logs the current statistics for every method.
+  void Log() const;
+
+ private:
+  pw::IntrusiveList<RpcServiceMetrics> services_;
+};
+
+/// Registers `service` with `server`, and adds the service's per-method
+/// metrics to `metrics`.
+///
+/// Every service is registered through this, so the service must provide
+/// `RpcServiceMetrics& method_metrics()`, with one `RpcMethodMetrics` for each
+/// of its methods. The metrics are checked against each other here; pw_rpc
+/// does not expose the number of methods in a service, so a method with no
+/// metrics is not caught.
+template <typename Server, typename Service>
+void RegisterService(Server& server, Service& service, RpcMetrics& metrics) {
+  metrics.Add(service.method_metrics());
+  server.RegisterService(service);
+}
+
+}  // namespace sense
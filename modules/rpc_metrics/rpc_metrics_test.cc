@@ -0,0 +1,143 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/rpc_metrics/rpc_metrics.h"
+
+#include "pw_containers/vector.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+using sense::RpcMethodMetrics;
+using sense::RpcMetrics;
+using sense::RpcServiceMetrics;
+
+/// Minimal stand-in for a pw_rpc server writer.
+struct FakeWriter {
+  bool active() const { return open; }
+
+  pw::Status Write(int) {
+    return open ? pw::OkStatus() : pw::Status::FailedPrecondition();
+  }
+
+  bool open = false;
+};
+
+TEST(RpcMethodMetricsTest, CountsCalls) {
+  RpcMethodMetrics metrics("Service", "Method");
+  for (int i = 0; i < 3; ++i) {
+    auto call = metrics.Measure();
+  }
+
+  RpcMethodMetrics::Snapshot stats = metrics.GetSnapshot();
+  EXPECT_EQ(stats.calls, 3u);
+  EXPECT_GE(stats.total_handler_us, stats.max_handler_us);
+  EXPECT_EQ(stats.open_streams, 0u);
+}
+
+TEST(RpcMethodMetricsTest, CountsStreamWrites) {
+  RpcMethodMetrics metrics("Service", "Stream");
+  FakeWriter stream;
+  FakeWriter writer{.open = true};
+
+  metrics.OpenStream(stream, writer);
+  EXPECT_EQ(metrics.GetSnapshot().open_streams, 1u);
+
+  EXPECT_EQ(metrics.Write(stream, 1, 5), pw::OkStatus());
+  EXPECT_EQ(metrics.Write(stream, 2, 7), pw::OkStatus());
+
+  RpcMethodMetrics::Snapshot stats = metrics.GetSnapshot();
+  EXPECT_EQ(stats.messages_written, 2u);
+  EXPECT_EQ(stats.bytes_written, 12u);
+}
+
+TEST(RpcMethodMetricsTest, ClosedStreamNoticedOnWrite) {
+  RpcMethodMetrics metrics("Service", "Stream");
+  FakeWriter stream;
+  FakeWriter writer{.open = true};
+  metrics.OpenStream(stream, writer);
+
+  stream.open = false;
+  EXPECT_EQ(metrics.GetSnapshot().open_streams, 1u);
+  EXPECT_EQ(metrics.Write(stream, 1, 5), pw::Status::FailedPrecondition());
+  EXPECT_EQ(metrics.Write(stream, 1, 5), pw::Status::FailedPrecondition());
+
+  RpcMethodMetrics::Snapshot stats = metrics.GetSnapshot();
+  EXPECT_EQ(stats.open_streams, 0u);
+  EXPECT_EQ(stats.messages_written, 0u);
+}
+
+TEST(RpcMethodMetricsTest, ReopenedStreamCountedOnce) {
+  RpcMethodMetrics metrics("Service", "Stream");
+  FakeWriter stream;
+  FakeWriter first{.open = true};
+  FakeWriter second{.open = true};
+
+  metrics.OpenStream(stream, first);
+  metrics.OpenStream(stream, second);
+  EXPECT_EQ(metrics.GetSnapshot().open_streams, 1u);
+}
+
+TEST(RpcMethodMetricsTest, CountsEveryOpenStream) {
+  RpcMethodMetrics metrics("Service", "Stream");
+  FakeWriter first_stream;
+  FakeWriter second_stream;
+  FakeWriter first{.open = true};
+  FakeWriter second{.open = true};
+
+  metrics.OpenStream(first_stream, first);
+  metrics.OpenStream(second_stream, second);
+  EXPECT_EQ(metrics.GetSnapshot().open_streams, 2u);
+
+  first_stream.open = false;
+  EXPECT_EQ(metrics.Write(first_stream, 1, 5),
+            pw::Status::FailedPrecondition());
+  EXPECT_EQ(metrics.GetSnapshot().open_streams, 1u);
+}
+
+TEST(RpcMetricsTest, ForEachVisitsMethodsInOrder) {
+  RpcServiceMetrics service_a("ServiceA");
+  RpcMethodMetrics first(service_a, {"First", 1});
+  RpcMethodMetrics second(service_a, {"Second", 2});
+  RpcServiceMetrics service_b("ServiceB");
+  RpcMethodMetrics third(service_b, {"Third", 3});
+  RpcMetrics metrics;
+  metrics.Add(service_a);
+  metrics.Add(service_b);
+
+  pw::Vector<const char*, 3> names;
+  metrics.ForEach([&names](const RpcMethodMetrics& method) {
+    names.push_back(method.method());
+  });
+  ASSERT_EQ(names.size(), 3u);
+  EXPECT_STREQ(names[0], "First");
+  EXPECT_STREQ(names[1], "Second");
+  EXPECT_STREQ(names[2], "Third");
+  EXPECT_STREQ(third.service(), "ServiceB");
+  EXPECT_EQ(third.method_id(), 3u);
+}
+
+TEST(RpcMetricsTest, DestroyedMethodsLeaveTheirService) {
+  RpcServiceMetrics service("Service");
+  RpcMethodMetrics first(service, {"First", 1});
+  {
+    RpcMethodMetrics second(service, {"Second", 2});
+  }
+
+  size_t count = 0;
+  service.ForEach([&count](const RpcMethodMetrics&) { ++count; });
+  EXPECT_EQ(count, 1u);
+}
+
+}  // namespace
@@ -0,0 +1,59 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "RPC"
+
+#include "modules/rpc_metrics/service.h"
+
+#include "pw_log/log.h"
+#include "pw_string/util.h"
+
+namespace sense {
+
+void RpcMetricsService::GetMethodMetrics(
+    const pw_protobuf_Empty&, ServerWriter<rpc_metrics_MethodMetrics>& writer) {
+  auto call = get_method_metrics_metrics_.Measure();
+  pw::Status status;
+  metrics_.ForEach([this, &writer, &status](const RpcMethodMetrics& method) {
+    if (!status.ok()) {
+      return;
+    }
+    RpcMethodMetrics::Snapshot stats = method.GetSnapshot();
+    rpc_metrics_MethodMetrics response = rpc_metrics_MethodMetrics_init_default;
+    pw::string::Copy(method.service(), response.service).IgnoreError();
+    pw::string::Copy(method.method(), response.method).IgnoreError();
+    response.calls = stats.calls;
+    response.total_handler_us = stats.total_handler_us;
+    response.max_handler_us = stats.max_handler_us;
+    response.open_streams = stats.open_streams;
+    response.messages_written = stats.messages_written;
+    response.bytes_written = stats.bytes_written;
+    status = get_method_metrics_metrics_.Write(
+        writer, response, rpc_metrics_MethodMetrics_fields);
+  });
+  if (!status.ok()) {
+    PW_LOG_ERROR("Failed to write method metrics: %s", status.str());
+    return;
+  }
+  writer.Finish().IgnoreError();
+}
+
+pw::Status RpcMetricsService::LogMetrics(const pw_protobuf_Empty&,
+                                         pw_protobuf_Empty&) {
+  auto call = log_metrics_metrics_.Measure();
+  metrics_.Log();
+  return pw::OkStatus();
+}
+
+}  // namespace sense
@@ -0,0 +1,45 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/rpc_metrics/rpc_metrics.rpc.pb.h"
+#include "pw_status/status.h"
+
+namespace sense {
+
+class RpcMetricsService final
+    : public ::rpc_metrics::pw_rpc::nanopb::RpcMetrics::Service<
+          RpcMetricsService> {
+ public:
+  explicit RpcMetricsService(RpcMetrics& metrics) : metrics_(metrics) {}
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  void GetMethodMetrics(const pw_protobuf_Empty&,
+                        ServerWriter<rpc_metrics_MethodMetrics>& writer);
+
+  pw::Status LogMetrics(const pw_protobuf_Empty&, pw_protobuf_Empty&);
+
+ private:
+  RpcMetrics& metrics_;
+
+  RpcServiceMetrics method_metrics_{"RpcMetrics"};
+  RpcMethodMetrics get_method_metrics_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(RpcMetricsService, GetMethodMetrics)};
+  RpcMethodMetrics log_metrics_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(RpcMetricsService, LogMetrics)};
+};
+
+}  // namespace sense
@@ -0,0 +1,107 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sample_codec/sample_codec.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include "pw_assert/assert.h"
+#include "pw_preprocessor/compiler.h"
+#include "pw_varint/varint.h"
+
+namespace sense {
+
+SampleFrameEncoder::SampleFrameEncoder(SampleChannel channel,
+                                       FrameCallback&& callback)
+    : channel_(channel),
+      encoding_(EncodingFor(channel)),
+      callback_(std::move(callback)) {}
+
+void SampleFrameEncoder::Add(uint16_t sample) {
+  PW_ASSERT(encoding_ == Encoding::kZigZagDelta);
+  AddRaw(sample);
+}
+
+void SampleFrameEncoder::Add(float sample) {
+  PW_ASSERT(encoding_ == Encoding::kXorFloat);
+  AddRaw(std::bit_cast<uint32_t>(sample));
+}
+
+void SampleFrameEncoder::Flush() {
+  if (sample_count_ == 0) {
+    return;
+  }
+  frame_[3] = static_cast<std::byte>(sample_count_);
+  callback_(pw::ConstByteSpan(frame_.data(), frame_size_));
+  ++sequence_;
+  frame_size_ = 0;
+  sample_count_ = 0;
+}
+
+void SampleFrameEncoder::Reset() {
+  frame_size_ = 0;
+  sample_count_ = 0;
+  frames_until_keyframe_ = 0;
+}
+
+void SampleFrameEncoder::AddRaw(uint32_t raw) {
+  std::array<std::byte, pw::varint::kMaxVarint32SizeBytes> varint;
+  size_t size = 0;
+
+  if (sample_count_ != 0) {
+    size = pw::varint::Encode(EncodeSample(raw), varint);
+    if (frame_size_ + size > kFrameSize ||
+        sample_count_ == std::numeric_limits<uint8_t>::max()) {
+      Flush();
+    }
+  }
+  if (sample_count_ == 0) {
+    StartFrame();
+    size = pw::varint::Encode(keyframe_ ? raw : EncodeSample(raw), varint);
+  }
+
+  std::copy_n(varint.begin(), size, frame_.begin() + frame_size_);
+  frame_size_ += size;
+  ++sample_count_;
+  previous_ = raw;
+}
+
+uint32_t SampleFrameEncoder::EncodeSample(uint32_t raw) const {
+  switch (encoding_) {
+    case Encoding::kXorFloat:
+      return raw ^ previous_;
+    case Encoding::kZigZagDelta:
+      return pw::varint::ZigZagEncode(static_cast<int32_t>(raw) -
+                                      static_cast<int32_t>(previous_));
+  }
+  PW_UNREACHABLE;
+}
+
+void SampleFrameEncoder::StartFrame() {
+  keyframe_ = frames_until_keyframe_ == 0;
+  if (keyframe_) {
+    frames_until_keyframe_ = kKeyframeInterval;
+  }
+  --frames_until_keyframe_;
+
+  frame_[0] = static_cast<std::byte>(channel_);
+  frame_[1] = static_cast<std::byte>(keyframe_ ? kKeyframeFlag : 0);
+  frame_[2] = static_cast<std::byte>(sequence_);
+  frame_[3] = std::byte{0};
+  frame_size_ = kHeaderSize;
+}
+
+}  // namespace sense
@@ -0,0 +1,117 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "pw_bytes/span.h"
+#include "pw_function/function.h"
+
+namespace sense {
+
+/// Identifies the sample stream that a compact frame belongs to.
+///
+/// This definition must be kept up to date with tools/sense/sample_codec.py.
+enum class SampleChannel : uint8_t {
+  kAmbientLight = 0,
+  kProximity = 1,
+  kAirQuality = 2,
+};
+
+/// Packs a stream of samples from a single channel into compact frames.
+///
+/// Each frame begins with a 4-byte header:
+///
+///   byte 0: the `SampleChannel`.
+///   byte 1: flags; bit 0 is set for keyframes.
+///   byte 2: sequence number, incremented for each frame of this channel.
+///   byte 3: number of samples in the frame.
+///
+/// The header is followed by one varint per sample. In a keyframe, the first
+/// sample is the raw value (or the IEEE-754 bit pattern for floats). Every
+/// other sample is encoded relative to the sample before it, even across frame
+/// boundaries: integer samples as zigzag varint deltas, and float samples as
+/// the XOR of their bit patterns. Consecutive readings from slowly changing
+/// sensors therefore usually take a single byte each.
+///
+/// Decoders that miss a frame, as indicated by a gap in sequence numbers, must
+/// discard frames until the next keyframe.
+class SampleFrameEncoder {
+ public:
+  /// Maximum size of an encoded frame, including the header.
+  static constexpr size_t kFrameSize = 64;
+  static constexpr size_t kHeaderSize = 4;
+
+  /// Every this many frames, a keyframe is emitted so that decoders can resync.
+  static constexpr uint8_t kKeyframeInterval = 8;
+
+  static constexpr uint8_t kKeyframeFlag = 0x01;
+
+  using FrameCallback = pw::Function<void(pw::ConstByteSpan frame)>;
+
+  /// Creates an encoder for the given channel. The callback is invoked with
+  /// each completed frame.
+  SampleFrameEncoder(SampleChannel channel, FrameCallback&& callback);
+
+  /// Appends an integer sample, emitting the current frame first if it is full.
+  void Add(uint16_t sample);
+
+  /// Appends a floating point sample, emitting the current frame first if it
+  /// is full.
+  void Add(float sample);
+
+  /// Emits the current frame if it holds any samples.
+  void Flush();
+
+  /// Returns the number of samples in the current, unemitted frame.
+  size_t pending_samples() const { return sample_count_; }
+
+  /// Discards any partially encoded frame and makes the next frame a keyframe,
+  /// e.g. when a new reader connects.
+  void Reset();
+
+ private:
+  enum class Encoding {
+    kZigZagDelta,
+    kXorFloat,
+  };
+
+  static constexpr Encoding EncodingFor(SampleChannel channel) {
+    return channel == SampleChannel::kAmbientLight ? Encoding::kXorFloat
+                                                   : Encoding::kZigZagDelta;
+  }
+
+  void AddRaw(uint32_t raw);
+
+  /// Returns the value that is varint-encoded for a sample.
+  uint32_t EncodeSample(uint32_t raw) const;
+
+  void StartFrame();
+
+  const SampleChannel channel_;
+  const Encoding encoding_;
+  FrameCallback callback_;
+
+  std::array<std::byte, kFrameSize> frame_;
+  size_t frame_size_ = 0;
+  uint8_t sample_count_ = 0;
+  uint8_t sequence_ = 0;
+  uint8_t frames_until_keyframe_ = 0;
+  bool keyframe_ = false;
+  uint32_t previous_ = 0;
+};
+
+}  // namespace sense
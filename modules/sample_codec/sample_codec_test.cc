@@ -0,0 +1,151 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sample_codec/sample_codec.h"
+
+#include <bit>
+#include <cstring>
+
+#include "pw_containers/vector.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+// Test fixtures.
+
+class SampleFrameEncoderTest : public ::testing::Test {
+ protected:
+  using Frame = pw::Vector<std::byte, SampleFrameEncoder::kFrameSize>;
+
+  SampleFrameEncoder::FrameCallback Capture() {
+    return [this](pw::ConstByteSpan frame) {
+      ASSERT_FALSE(frames_.full());
+      frames_.emplace_back();
+      frames_.back().assign(frame.begin(), frame.end());
+    };
+  }
+
+  static uint8_t At(const Frame& frame, size_t index) {
+    return static_cast<uint8_t>(frame[index]);
+  }
+
+  static bool IsKeyframe(const Frame& frame) {
+    return (At(frame, 1) & SampleFrameEncoder::kKeyframeFlag) != 0;
+  }
+
+  pw::Vector<Frame, 20> frames_;
+};
+
+// Unit tests.
+
+TEST_F(SampleFrameEncoderTest, FlushWithoutSamplesEmitsNothing) {
+  SampleFrameEncoder encoder(SampleChannel::kProximity, Capture());
+  encoder.Flush();
+  EXPECT_TRUE(frames_.empty());
+}
+
+TEST_F(SampleFrameEncoderTest, IntegerDeltas) {
+  SampleFrameEncoder encoder(SampleChannel::kProximity, Capture());
+  encoder.Add(uint16_t{100});
+  encoder.Add(uint16_t{101});
+  encoder.Add(uint16_t{99});
+  encoder.Add(uint16_t{99});
+  encoder.Flush();
+
+  ASSERT_EQ(frames_.size(), 1u);
+  const Frame& frame = frames_[0];
+  ASSERT_EQ(frame.size(), SampleFrameEncoder::kHeaderSize + 4);
+  EXPECT_EQ(At(frame, 0), static_cast<uint8_t>(SampleChannel::kProximity));
+  EXPECT_TRUE(IsKeyframe(frame));
+  EXPECT_EQ(At(frame, 2), 0u);
+  EXPECT_EQ(At(frame, 3), 4u);
+  EXPECT_EQ(At(frame, 4), 100u);  // Raw keyframe value.
+  EXPECT_EQ(At(frame, 5), 2u);    // zigzag(+1)
+  EXPECT_EQ(At(frame, 6), 3u);    // zigzag(-2)
+  EXPECT_EQ(At(frame, 7), 0u);    // zigzag(0)
+}
+
+TEST_F(SampleFrameEncoderTest, FloatXor) {
+  SampleFrameEncoder encoder(SampleChannel::kAmbientLight, Capture());
+  encoder.Add(250.f);
+  encoder.Add(250.f);
+  encoder.Flush();
+
+  ASSERT_EQ(frames_.size(), 1u);
+  const Frame& frame = frames_[0];
+  EXPECT_TRUE(IsKeyframe(frame));
+  EXPECT_EQ(At(frame, 3), 2u);
+
+  // The keyframe value is the float's bit pattern as a 5-byte varint.
+  uint32_t bits = std::bit_cast<uint32_t>(250.f);
+  uint32_t decoded = 0;
+  size_t offset = SampleFrameEncoder::kHeaderSize;
+  for (int shift = 0; shift < 35; shift += 7) {
+    uint8_t byte = At(frame, offset++);
+    decoded |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  EXPECT_EQ(decoded, bits);
+
+  // An identical reading XORs to zero, which takes a single byte.
+  ASSERT_EQ(frame.size(), offset + 1);
+  EXPECT_EQ(At(frame, offset), 0u);
+}
+
+TEST_F(SampleFrameEncoderTest, FramesAreBoundedAndSequenced) {
+  SampleFrameEncoder encoder(SampleChannel::kAirQuality, Capture());
+  for (uint16_t i = 0; i < 1000; ++i) {
+    encoder.Add(static_cast<uint16_t>(768 + (i % 2)));
+  }
+  encoder.Flush();
+
+  ASSERT_GT(frames_.size(), 1u);
+  size_t total_samples = 0;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    EXPECT_LE(frames_[i].size(), SampleFrameEncoder::kFrameSize);
+    EXPECT_EQ(At(frames_[i], 2), i);
+    EXPECT_EQ(IsKeyframe(frames_[i]),
+              i % SampleFrameEncoder::kKeyframeInterval == 0);
+    total_samples += At(frames_[i], 3);
+  }
+  EXPECT_EQ(total_samples, 1000u);
+}
+
+TEST_F(SampleFrameEncoderTest, ResetForcesKeyframe) {
+  SampleFrameEncoder encoder(SampleChannel::kProximity, Capture());
+  encoder.Add(uint16_t{1});
+  encoder.Flush();
+  encoder.Add(uint16_t{2});
+  encoder.Flush();
+  encoder.Add(uint16_t{3});
+  encoder.Reset();
+  encoder.Add(uint16_t{4});
+  encoder.Flush();
+
+  ASSERT_EQ(frames_.size(), 3u);
+  EXPECT_TRUE(IsKeyframe(frames_[0]));
+  EXPECT_FALSE(IsKeyframe(frames_[1]));
+  EXPECT_EQ(At(frames_[1], 4), 2u);  // zigzag(+1)
+
+  // The discarded sample is not emitted, and the next frame starts over.
+  EXPECT_TRUE(IsKeyframe(frames_[2]));
+  EXPECT_EQ(At(frames_[2], 3), 1u);
+  EXPECT_EQ(At(frames_[2], 4), 4u);
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,51 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/adaptive_period.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pw_assert/check.h"
+
+namespace sense {
+
+AdaptivePeriod::AdaptivePeriod(const Config& config)
+    : config_(config), period_(config.min_period) {
+  PW_CHECK(config_.min_period > Clock::duration::zero());
+  PW_CHECK(config_.max_period >= config_.min_period);
+  PW_CHECK(config_.steady_samples > 0);
+}
+
+bool AdaptivePeriod::Update(float value) {
+  if (!has_reference_ || std::abs(value - reference_) >= config_.threshold) {
+    reference_ = value;
+    has_reference_ = true;
+    Reset();
+    return true;
+  }
+  if (++steady_count_ < config_.steady_samples) {
+    return false;
+  }
+  steady_count_ = 0;
+  period_ = std::min(period_ * 2, config_.max_period);
+  return false;
+}
+
+void AdaptivePeriod::Reset() {
+  period_ = config_.min_period;
+  steady_count_ = 0;
+}
+
+}  // namespace sense
@@ -0,0 +1,75 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "pw_chrono/system_clock.h"
+
+namespace sense {
+
+/// Sampling period that backs off while a signal is steady, and returns to its
+/// shortest as soon as the signal changes.
+///
+/// A sample is a significant change if it differs by at least `threshold` from
+/// the sample at the last significant change. Comparing against that rather
+/// than the previous sample means a slow drift is noticed too, once it adds
+/// up. After every `steady_samples` samples in a row without a significant
+/// change, the period doubles, up to `max_period`.
+class AdaptivePeriod {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  struct Config {
+    /// Period while the signal is changing. Must be positive.
+    Clock::duration min_period;
+    /// Longest period to back off to. Must be at least `min_period`.
+    Clock::duration max_period;
+    /// Smallest change that is significant.
+    float threshold;
+    /// Number of samples without a significant change after which the period
+    /// doubles. Must be positive.
+    uint16_t steady_samples;
+  };
+
+  /// Returns the config for a period that never changes.
+  static constexpr Config Fixed(Clock::duration period) {
+    return {
+        .min_period = period,
+        .max_period = period,
+        .threshold = 0.f,
+        .steady_samples = 1,
+    };
+  }
+
+  explicit AdaptivePeriod(const Config& config);
+
+  Clock::duration period() const { return period_; }
+
+  /// Adjusts the period for a new sample. Returns whether the sample was a
+  /// significant change.
+  bool Update(float value);
+
+  /// Returns to the shortest period.
+  void Reset();
+
+ private:
+  const Config config_;
+  Clock::duration period_;
+  float reference_ = 0.f;
+  bool has_reference_ = false;
+  uint16_t steady_count_ = 0;
+};
+
+}  // namespace sense
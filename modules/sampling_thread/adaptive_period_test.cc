@@ -0,0 +1,107 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/adaptive_period.h"
+
+#include <chrono>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using ::pw::chrono::SystemClock;
+
+using namespace std::chrono_literals;
+
+constexpr AdaptivePeriod::Config kConfig = {
+    .min_period = SystemClock::for_at_least(100ms),
+    .max_period = SystemClock::for_at_least(800ms),
+    .threshold = 10.f,
+    .steady_samples = 3,
+};
+
+/// Feeds `count` samples of `value`.
+void UpdateRepeatedly(AdaptivePeriod& period, float value, int count) {
+  for (int i = 0; i < count; ++i) {
+    period.Update(value);
+  }
+}
+
+// Unit tests.
+
+TEST(AdaptivePeriodTest, StartsAtMinimum) {
+  AdaptivePeriod period(kConfig);
+  EXPECT_EQ(period.period(), kConfig.min_period);
+}
+
+TEST(AdaptivePeriodTest, BacksOffWhileSteady) {
+  AdaptivePeriod period(kConfig);
+  period.Update(50.f);
+
+  UpdateRepeatedly(period, 55.f, 3);
+  EXPECT_EQ(period.period(), kConfig.min_period * 2);
+  UpdateRepeatedly(period, 45.f, 3);
+  EXPECT_EQ(period.period(), kConfig.min_period * 4);
+
+  // Never backs off past the maximum.
+  UpdateRepeatedly(period, 50.f, 30);
+  EXPECT_EQ(period.period(), kConfig.max_period);
+}
+
+TEST(AdaptivePeriodTest, SnapsBackOnSignificantChange) {
+  AdaptivePeriod period(kConfig);
+  EXPECT_TRUE(period.Update(50.f));
+  UpdateRepeatedly(period, 50.f, 6);
+  ASSERT_EQ(period.period(), kConfig.min_period * 4);
+
+  EXPECT_FALSE(period.Update(55.f));
+  EXPECT_TRUE(period.Update(60.f));
+  EXPECT_EQ(period.period(), kConfig.min_period);
+
+  // The count of steady samples starts over too.
+  UpdateRepeatedly(period, 60.f, 2);
+  EXPECT_EQ(period.period(), kConfig.min_period);
+}
+
+TEST(AdaptivePeriodTest, NoticesSlowDrift) {
+  AdaptivePeriod period(kConfig);
+  period.Update(0.f);
+
+  // No sample differs from the previous one by the threshold, but together
+  // they drift past it.
+  for (int i = 1; i <= 6; ++i) {
+    period.Update(static_cast<float>(i) * 2.f);
+  }
+  EXPECT_EQ(period.period(), kConfig.min_period);
+}
+
+TEST(AdaptivePeriodTest, Reset) {
+  AdaptivePeriod period(kConfig);
+  period.Update(50.f);
+  UpdateRepeatedly(period, 50.f, 3);
+  ASSERT_EQ(period.period(), kConfig.min_period * 2);
+
+  period.Reset();
+  EXPECT_EQ(period.period(), kConfig.min_period);
+}
+
+TEST(AdaptivePeriodTest, Fixed) {
+  AdaptivePeriod period(AdaptivePeriod::Fixed(kConfig.min_period));
+  UpdateRepeatedly(period, 50.f, 10);
+  EXPECT_EQ(period.period(), kConfig.min_period);
+}
+
+}  // namespace
+}  // namespace sense
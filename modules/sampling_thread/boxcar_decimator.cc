@@ -12,21 +12,29 @@
 // License for the specific language governing permissions and limitations under
 // the License.
 
-#include "apps/production/threads.h"
-#include "pw_thread_freertos/context.h"
-#include "pw_thread_freertos/options.h"
+#include "modules/sampling_thread/boxcar_decimator.h"
+
+#include "pw_assert/check.h"
 
 namespace sense {
 
-pw::thread::freertos::StaticContextWithStack<1024> sensor_thread_context;
+BoxcarDecimator::BoxcarDecimator(uint16_t factor) : factor_(factor) {
+  PW_CHECK(factor_ > 0);
+}
+
+std::optional<uint16_t> BoxcarDecimator::Add(uint16_t sample) {
+  sum_ += sample;
+  if (++count_ < factor_) {
+    return std::nullopt;
+  }
+  const auto mean = static_cast<uint16_t>((sum_ + factor_ / 2) / factor_);
+  Reset();
+  return mean;
+}
 
-const pw::thread::Options& SamplingThreadOptions() {
-  static constexpr auto kOptions =
-      pw::thread::freertos::Options()
-          .set_name("SensorThread")
-          .set_static_context(sensor_thread_context)
-          .set_priority(tskIDLE_PRIORITY + 1);
-  return kOptions;
+void BoxcarDecimator::Reset() {
+  count_ = 0;
+  sum_ = 0;
 }
 
 }  // namespace sense
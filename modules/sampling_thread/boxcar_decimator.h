@@ -0,0 +1,50 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace sense {
+
+/// Integer boxcar filter that decimates a stream of samples.
+///
+/// Each run of `factor` samples is averaged into one output sample, which
+/// both rejects noise above the output rate and reduces the rate samples are
+/// handled at. This is the simplest cascaded integrator-comb filter, with a
+/// single stage. Averaging 16-bit samples keeps the fraction bits of the mean
+/// that are available below the input's resolution, so an input scaled up from
+/// fewer bits gains precision.
+class BoxcarDecimator {
+ public:
+  /// @param factor Number of input samples per output sample. Must be
+  ///               positive.
+  explicit BoxcarDecimator(uint16_t factor);
+
+  uint16_t factor() const { return factor_; }
+
+  /// Adds a sample. Returns the rounded mean of the last `factor` samples
+  /// when this completes a run of them.
+  std::optional<uint16_t> Add(uint16_t sample);
+
+  /// Discards the samples of the run in progress.
+  void Reset();
+
+ private:
+  const uint16_t factor_;
+  uint16_t count_ = 0;
+  uint32_t sum_ = 0;
+};
+
+}  // namespace sense
@@ -0,0 +1,74 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/boxcar_decimator.h"
+
+#include <optional>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+TEST(BoxcarDecimatorTest, OutputsMeanOfEachRun) {
+  BoxcarDecimator decimator(4);
+  EXPECT_EQ(decimator.Add(100), std::nullopt);
+  EXPECT_EQ(decimator.Add(200), std::nullopt);
+  EXPECT_EQ(decimator.Add(300), std::nullopt);
+  EXPECT_EQ(decimator.Add(400), std::optional<uint16_t>(250));
+
+  // Runs don't overlap.
+  EXPECT_EQ(decimator.Add(1000), std::nullopt);
+  EXPECT_EQ(decimator.Add(1000), std::nullopt);
+  EXPECT_EQ(decimator.Add(1000), std::nullopt);
+  EXPECT_EQ(decimator.Add(1000), std::optional<uint16_t>(1000));
+}
+
+TEST(BoxcarDecimatorTest, RoundsToNearest) {
+  BoxcarDecimator decimator(4);
+  decimator.Add(0);
+  decimator.Add(0);
+  decimator.Add(1);
+  EXPECT_EQ(decimator.Add(1), std::optional<uint16_t>(1));
+
+  decimator.Add(0);
+  decimator.Add(0);
+  decimator.Add(0);
+  EXPECT_EQ(decimator.Add(1), std::optional<uint16_t>(0));
+}
+
+TEST(BoxcarDecimatorTest, DoesNotOverflow) {
+  BoxcarDecimator decimator(8);
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(decimator.Add(0xffff), std::nullopt);
+  }
+  EXPECT_EQ(decimator.Add(0xffff), std::optional<uint16_t>(0xffff));
+}
+
+TEST(BoxcarDecimatorTest, FactorOfOnePassesThrough) {
+  BoxcarDecimator decimator(1);
+  EXPECT_EQ(decimator.Add(7), std::optional<uint16_t>(7));
+  EXPECT_EQ(decimator.Add(9), std::optional<uint16_t>(9));
+}
+
+TEST(BoxcarDecimatorTest, Reset) {
+  BoxcarDecimator decimator(2);
+  decimator.Add(5000);
+  decimator.Reset();
+  EXPECT_EQ(decimator.Add(10), std::nullopt);
+  EXPECT_EQ(decimator.Add(20), std::optional<uint16_t>(15));
+}
+
+}  // namespace
+}  // namespace sense
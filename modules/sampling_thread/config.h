@@ -0,0 +1,26 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+/// The number of proximity readings averaged into each proximity sample.
+///
+/// When greater than 1, the proximity sensor is read this many times faster
+/// than proximity samples are published, and each run of readings is
+/// decimated by a boxcar filter. This smooths out the sensor's noise, so edges
+/// are detected more cleanly, at the cost of more I2C traffic.
+#ifndef SENSE_SAMPLING_THREAD_CONFIG_PROXIMITY_OVERSAMPLING
+#define SENSE_SAMPLING_THREAD_CONFIG_PROXIMITY_OVERSAMPLING 1
+#endif  // SENSE_SAMPLING_THREAD_CONFIG_PROXIMITY_OVERSAMPLING
+
+static_assert(SENSE_SAMPLING_THREAD_CONFIG_PROXIMITY_OVERSAMPLING >= 1);
@@ -0,0 +1,52 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/duration_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <mutex>
+
+namespace sense {
+
+size_t DurationHistogram::BucketFor(uint32_t duration_us) {
+  auto index =
+      static_cast<size_t>(std::bit_width(duration_us / kFirstBucketUs));
+  return std::min(index, kNumBuckets - 1);
+}
+
+void DurationHistogram::Add(Clock::duration duration) {
+  int64_t us =
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  auto duration_us = static_cast<uint32_t>(std::clamp<int64_t>(
+      us, 0, std::numeric_limits<uint32_t>::max()));
+
+  std::lock_guard lock(lock_);
+  if (stats_.count == 0 || duration_us < stats_.min_us) {
+    stats_.min_us = duration_us;
+  }
+  stats_.max_us = std::max(stats_.max_us, duration_us);
+  stats_.total_us += duration_us;
+  ++stats_.count;
+  ++stats_.buckets[BucketFor(duration_us)];
+}
+
+DurationHistogram::Snapshot DurationHistogram::GetSnapshot() const {
+  std::lock_guard lock(lock_);
+  return stats_;
+}
+
+}  // namespace sense
@@ -0,0 +1,65 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "pw_chrono/system_clock.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Distribution of a recurring duration, such as how late a task wakes.
+///
+/// Durations are counted in buckets whose bounds double, so a handful of them
+/// cover everything from a fraction of a millisecond to a quarter second.
+/// Bucket `i` counts durations shorter than `kFirstBucketUs << i` microseconds
+/// that don't fit in an earlier bucket, and the last bucket counts everything
+/// longer too. May be added to and read from different threads.
+class DurationHistogram {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  static constexpr uint32_t kFirstBucketUs = 128;
+  static constexpr size_t kNumBuckets = 13;
+
+  struct Snapshot {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    std::array<uint32_t, kNumBuckets> buckets;
+
+    uint32_t mean_us() const {
+      return count == 0 ? 0 : static_cast<uint32_t>(total_us / count);
+    }
+  };
+
+  /// Returns the index of the bucket that counts `duration_us`.
+  static size_t BucketFor(uint32_t duration_us);
+
+  /// Counts a duration. Negative durations are counted as zero.
+  void Add(Clock::duration duration) PW_LOCKS_EXCLUDED(lock_);
+
+  Snapshot GetSnapshot() const PW_LOCKS_EXCLUDED(lock_);
+
+ private:
+  mutable pw::sync::InterruptSpinLock lock_;
+  Snapshot stats_ PW_GUARDED_BY(lock_) = {};
+};
+
+}  // namespace sense
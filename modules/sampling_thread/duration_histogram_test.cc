@@ -0,0 +1,82 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/duration_histogram.h"
+
+#include <chrono>
+
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using ::pw::chrono::SystemClock;
+
+using namespace std::chrono_literals;
+
+// Unit tests.
+
+TEST(DurationHistogramTest, BucketBounds) {
+  EXPECT_EQ(DurationHistogram::BucketFor(0), 0u);
+  EXPECT_EQ(DurationHistogram::BucketFor(127), 0u);
+  EXPECT_EQ(DurationHistogram::BucketFor(128), 1u);
+  EXPECT_EQ(DurationHistogram::BucketFor(255), 1u);
+  EXPECT_EQ(DurationHistogram::BucketFor(256), 2u);
+  EXPECT_EQ(DurationHistogram::BucketFor(1000), 3u);
+  EXPECT_EQ(DurationHistogram::BucketFor(1024), 4u);
+
+  // Everything past the last bound shares the last bucket.
+  EXPECT_EQ(DurationHistogram::BucketFor(128u << 11),
+            DurationHistogram::kNumBuckets - 1);
+  EXPECT_EQ(DurationHistogram::BucketFor(UINT32_MAX),
+            DurationHistogram::kNumBuckets - 1);
+}
+
+TEST(DurationHistogramTest, Empty) {
+  DurationHistogram histogram;
+  DurationHistogram::Snapshot stats = histogram.GetSnapshot();
+  EXPECT_EQ(stats.count, 0u);
+  EXPECT_EQ(stats.min_us, 0u);
+  EXPECT_EQ(stats.max_us, 0u);
+  EXPECT_EQ(stats.mean_us(), 0u);
+}
+
+TEST(DurationHistogramTest, Add) {
+  DurationHistogram histogram;
+  histogram.Add(std::chrono::microseconds(100));
+  histogram.Add(std::chrono::microseconds(2000));
+  histogram.Add(std::chrono::microseconds(600));
+
+  DurationHistogram::Snapshot stats = histogram.GetSnapshot();
+  EXPECT_EQ(stats.count, 3u);
+  EXPECT_EQ(stats.min_us, 100u);
+  EXPECT_EQ(stats.max_us, 2000u);
+  EXPECT_EQ(stats.mean_us(), 900u);
+  EXPECT_EQ(stats.buckets[0], 1u);
+  EXPECT_EQ(stats.buckets[3], 1u);
+  EXPECT_EQ(stats.buckets[4], 1u);
+}
+
+TEST(DurationHistogramTest, NegativeCountsAsZero) {
+  DurationHistogram histogram;
+  histogram.Add(-SystemClock::for_at_least(1ms));
+
+  DurationHistogram::Snapshot stats = histogram.GetSnapshot();
+  EXPECT_EQ(stats.count, 1u);
+  EXPECT_EQ(stats.max_us, 0u);
+  EXPECT_EQ(stats.buckets[0], 1u);
+}
+
+}  // namespace
+}  // namespace sense
@@ -0,0 +1,121 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/periodic_sampler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+namespace sense {
+
+using ::pw::async2::Context;
+using ::pw::async2::Pending;
+using ::pw::async2::Poll;
+using ::pw::async2::Waker;
+
+uint32_t PeriodicDeadline::Advance(Clock::time_point now) {
+  deadline_ += period_;
+  if (deadline_ > now) {
+    return 0;
+  }
+  auto missed = static_cast<uint32_t>((now - deadline_) / period_) + 1;
+  deadline_ += missed * period_;
+  return missed;
+}
+
+PeriodicSampler::PeriodicSampler(const char* name,
+                                 const AdaptivePeriod::Config& period,
+                                 Clock::duration phase)
+    : name_(name),
+      phase_(phase),
+      period_(period),
+      deadline_(period_.period()),
+      stats_{.samples = 0, .overruns = 0, .period = period_.period()} {}
+
+PeriodicSampler::Stats PeriodicSampler::stats() const {
+  std::lock_guard lock(lock_);
+  return stats_;
+}
+
+void PeriodicSampler::SpeedUp() {
+  Waker waker;
+  {
+    std::lock_guard lock(lock_);
+    speed_up_ = true;
+    waker = std::move(speed_up_waker_);
+  }
+  std::move(waker).Wake();
+}
+
+bool PeriodicSampler::TakeSpeedUp() {
+  std::lock_guard lock(lock_);
+  return std::exchange(speed_up_, false);
+}
+
+Poll<> PeriodicSampler::DoPend(Context& cx) {
+  if (!started_) {
+    deadline_.Start(Clock::now() + phase_);
+    started_ = true;
+  }
+
+  while (true) {
+    if (!sampling_) {
+      if (TakeSpeedUp()) {
+        period_.Reset();
+        deadline_.set_period(period_.period());
+        if (sampled_) {
+          // Sample no sooner than the shortest period allows, and without
+          // counting the deadlines this skips as missed.
+          Clock::time_point sooner = std::max(last_sample_ + period_.period(),
+                                              Clock::now());
+          deadline_.Start(std::min(deadline_.deadline(), sooner));
+          wait_.reset();
+        }
+      }
+      if (!wait_.has_value()) {
+        wait_.emplace(timer_.WaitUntil(deadline_.deadline()));
+      }
+      if (wait_->Pend(cx).IsPending()) {
+        std::lock_guard lock(lock_);
+        if (speed_up_) {
+          continue;
+        }
+        speed_up_waker_ = cx.GetWaker(pw::async2::WaitReason::Unspecified());
+        return Pending();
+      }
+      wait_.reset();
+      sampling_ = true;
+      sampled_ = true;
+      last_sample_ = Clock::now();
+      wake_lateness_.Add(last_sample_ - deadline_.deadline());
+    }
+
+    if (DoSample(cx).IsPending()) {
+      return Pending();
+    }
+    sampling_ = false;
+    const Clock::time_point now = Clock::now();
+    read_duration_.Add(now - last_sample_);
+    deadline_.set_period(period_.period());
+    const uint32_t overruns = deadline_.Advance(now);
+
+    std::lock_guard lock(lock_);
+    ++stats_.samples;
+    stats_.overruns += overruns;
+    stats_.period = period_.period();
+  }
+}
+
+}  // namespace sense
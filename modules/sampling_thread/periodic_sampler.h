@@ -0,0 +1,149 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "modules/sampling_thread/adaptive_period.h"
+#include "modules/sampling_thread/duration_histogram.h"
+#include "modules/timer_future/timer_future.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+
+namespace sense {
+
+/// Deadlines of a periodic activity, which skips any deadlines it misses.
+class PeriodicDeadline {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  explicit constexpr PeriodicDeadline(Clock::duration period)
+      : period_(period) {}
+
+  Clock::duration period() const { return period_; }
+  Clock::time_point deadline() const { return deadline_; }
+
+  /// Sets the period from the next deadline on.
+  void set_period(Clock::duration period) { period_ = period; }
+
+  /// Sets the next deadline.
+  void Start(Clock::time_point first) { deadline_ = first; }
+
+  /// Moves to the next deadline once the activity for the current one has
+  /// finished at `now`.
+  ///
+  /// Rather than running back to back to catch up, deadlines that have already
+  /// passed are skipped. Returns the number skipped.
+  uint32_t Advance(Clock::time_point now);
+
+ private:
+  Clock::duration period_;
+  Clock::time_point deadline_;
+};
+
+/// Async task that takes a sample periodically.
+///
+/// The first sample is taken `phase` after the task is first run, which can be
+/// used to keep samplers sharing a resource from coming due together. A sample
+/// that is still being taken, or hasn't started, by the time the next one is
+/// due has overrun, and the samples it displaced are skipped.
+///
+/// The period may adapt to the signal being sampled, if the sampler reports
+/// each value it reads to `Observe`.
+class PeriodicSampler : public pw::async2::Task {
+ public:
+  using Clock = pw::chrono::SystemClock;
+
+  struct Stats {
+    uint32_t samples;
+    uint32_t overruns;
+    Clock::duration period;
+  };
+
+  const char* name() const { return name_; }
+
+  /// Returns the number of samples taken and skipped, and the period as of the
+  /// last sample.
+  Stats stats() const PW_LOCKS_EXCLUDED(lock_);
+
+  /// How long after each deadline sampling started, whether because the
+  /// dispatcher was busy or the timer was late.
+  const DurationHistogram& wake_lateness() const { return wake_lateness_; }
+
+  /// How long each sample took to read.
+  const DurationHistogram& read_duration() const { return read_duration_; }
+
+  /// Returns the current sampling period. Must only be called from the
+  /// dispatcher's thread; other threads can use `stats`.
+  Clock::duration period() const { return period_.period(); }
+
+  /// Returns to the shortest period, and brings the next sample forward to
+  /// match. May be called from any thread.
+  void SpeedUp() PW_LOCKS_EXCLUDED(lock_);
+
+ protected:
+  /// @param name   Name of what is sampled, for reporting.
+  /// @param period How often to sample. Must be positive.
+  /// @param phase  Delay before the first sample.
+  PeriodicSampler(const char* name,
+                  Clock::duration period,
+                  Clock::duration phase)
+      : PeriodicSampler(name, AdaptivePeriod::Fixed(period), phase) {}
+
+  /// @param name   Name of what is sampled, for reporting.
+  /// @param period Bounds of the sampling period, and how it adapts.
+  /// @param phase  Delay before the first sample.
+  PeriodicSampler(const char* name,
+                  const AdaptivePeriod::Config& period,
+                  Clock::duration phase);
+
+  /// Adapts the period to a value that was sampled. Should be called from
+  /// `DoSample`. Returns whether the value was a significant change.
+  bool Observe(float value) { return period_.Update(value); }
+
+ private:
+  /// Takes a sample.
+  ///
+  /// Returns `Pending` while waiting on the sensor, after arranging for the
+  /// task to be woken, and `Ready` once the sample has been taken.
+  virtual pw::async2::Poll<> DoSample(pw::async2::Context& cx) = 0;
+
+  pw::async2::Poll<> DoPend(pw::async2::Context& cx) final;
+
+  /// Returns whether `SpeedUp` has been called since this was last called.
+  bool TakeSpeedUp() PW_LOCKS_EXCLUDED(lock_);
+
+  const char* const name_;
+  const Clock::duration phase_;
+  AdaptivePeriod period_;
+  PeriodicDeadline deadline_;
+  AsyncTimer timer_;
+  std::optional<TimerFuture> wait_;
+  Clock::time_point last_sample_;
+  bool started_ = false;
+  bool sampling_ = false;
+  bool sampled_ = false;
+  DurationHistogram wake_lateness_;
+  DurationHistogram read_duration_;
+
+  mutable pw::sync::InterruptSpinLock lock_;
+  Stats stats_ PW_GUARDED_BY(lock_) = {};
+  bool speed_up_ PW_GUARDED_BY(lock_) = false;
+  pw::async2::Waker speed_up_waker_ PW_GUARDED_BY(lock_);
+};
+
+}  // namespace sense
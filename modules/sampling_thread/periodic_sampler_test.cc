@@ -0,0 +1,217 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/sampling_thread/periodic_sampler.h"
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "pw_async2/dispatcher.h"
+#include "pw_thread/sleep.h"
+#include "pw_unit_test/framework.h"
+
+namespace sense {
+namespace {
+
+using ::pw::async2::Context;
+using ::pw::async2::Dispatcher;
+using ::pw::async2::Pending;
+using ::pw::async2::Poll;
+using ::pw::async2::Ready;
+using ::pw::async2::Waker;
+using ::pw::chrono::SystemClock;
+
+using namespace std::chrono_literals;
+
+// Test fixtures.
+
+/// Sampler that counts samples, and optionally holds each one pending until
+/// released.
+class CountingSampler final : public PeriodicSampler {
+ public:
+  CountingSampler(SystemClock::duration period, SystemClock::duration phase)
+      : PeriodicSampler("counting", period, phase) {}
+
+  void set_hold(bool hold) { hold_ = hold; }
+
+  void Release() {
+    hold_ = false;
+    std::move(waker_).Wake();
+  }
+
+ private:
+  Poll<> DoSample(Context& cx) override {
+    if (hold_) {
+      waker_ = cx.GetWaker(pw::async2::WaitReason::Unspecified());
+      return Pending();
+    }
+    return Ready();
+  }
+
+  bool hold_ = false;
+  Waker waker_;
+};
+
+/// Sampler whose signal never changes, so it backs off as far as it can.
+class SteadySampler final : public PeriodicSampler {
+ public:
+  static constexpr AdaptivePeriod::Config kConfig = {
+      .min_period = SystemClock::for_at_least(10ms),
+      .max_period = SystemClock::for_at_least(160ms),
+      .threshold = 1.f,
+      .steady_samples = 4,
+  };
+
+  SteadySampler() : PeriodicSampler("steady", kConfig, 0ms) {}
+
+ private:
+  Poll<> DoSample(Context&) override {
+    Observe(0.f);
+    return Ready();
+  }
+};
+
+/// Runs the dispatcher until `duration` has elapsed.
+void RunFor(Dispatcher& dispatcher, SystemClock::duration duration) {
+  const SystemClock::time_point end = SystemClock::now() + duration;
+  while (SystemClock::now() < end) {
+    dispatcher.RunUntilStalled().IgnorePoll();
+    pw::this_thread::sleep_for(SystemClock::for_at_least(1ms));
+  }
+}
+
+SystemClock::time_point At(SystemClock::duration offset) {
+  return SystemClock::time_point(offset);
+}
+
+// Unit tests.
+
+TEST(PeriodicDeadlineTest, AdvancesByPeriod) {
+  PeriodicDeadline deadline(SystemClock::for_at_least(100ms));
+  deadline.Start(At(0ms));
+  EXPECT_EQ(deadline.Advance(At(5ms)), 0u);
+  EXPECT_EQ(deadline.deadline(), At(100ms));
+  EXPECT_EQ(deadline.Advance(At(199ms)), 0u);
+  EXPECT_EQ(deadline.deadline(), At(200ms));
+}
+
+TEST(PeriodicDeadlineTest, SkipsMissedDeadlines) {
+  PeriodicDeadline deadline(SystemClock::for_at_least(100ms));
+  deadline.Start(At(10ms));
+
+  // Finishing at 250 ms misses the deadlines at 110 and 210 ms.
+  EXPECT_EQ(deadline.Advance(At(250ms)), 2u);
+  EXPECT_EQ(deadline.deadline(), At(310ms));
+
+  // Finishing exactly on a deadline misses it.
+  EXPECT_EQ(deadline.Advance(At(410ms)), 1u);
+  EXPECT_EQ(deadline.deadline(), At(510ms));
+}
+
+TEST(PeriodicSamplerTest, SamplesEachPeriod) {
+  Dispatcher dispatcher;
+  CountingSampler sampler(SystemClock::for_at_least(10ms), 0ms);
+  dispatcher.Post(sampler);
+
+  RunFor(dispatcher, SystemClock::for_at_least(105ms));
+  EXPECT_GE(sampler.stats().samples, 8u);
+  EXPECT_LE(sampler.stats().samples, 11u);
+  sampler.Deregister();
+}
+
+TEST(PeriodicSamplerTest, WaitsForPhase) {
+  Dispatcher dispatcher;
+  CountingSampler sampler(SystemClock::for_at_least(10ms),
+                          SystemClock::for_at_least(50ms));
+  dispatcher.Post(sampler);
+
+  RunFor(dispatcher, SystemClock::for_at_least(30ms));
+  EXPECT_EQ(sampler.stats().samples, 0u);
+  RunFor(dispatcher, SystemClock::for_at_least(40ms));
+  EXPECT_GT(sampler.stats().samples, 0u);
+  sampler.Deregister();
+}
+
+TEST(PeriodicSamplerTest, CountsOverruns) {
+  Dispatcher dispatcher;
+  CountingSampler sampler(SystemClock::for_at_least(10ms), 0ms);
+  sampler.set_hold(true);
+  dispatcher.Post(sampler);
+
+  // A pending sample holds up the ones after it.
+  RunFor(dispatcher, SystemClock::for_at_least(35ms));
+  EXPECT_EQ(sampler.stats().samples, 0u);
+
+  sampler.Release();
+  dispatcher.RunUntilStalled().IgnorePoll();
+  EXPECT_EQ(sampler.stats().samples, 1u);
+  EXPECT_GE(sampler.stats().overruns, 2u);
+  sampler.Deregister();
+}
+
+TEST(PeriodicSamplerTest, RecordsTiming) {
+  Dispatcher dispatcher;
+  CountingSampler sampler(SystemClock::for_at_least(10ms), 0ms);
+  sampler.set_hold(true);
+  dispatcher.Post(sampler);
+
+  RunFor(dispatcher, SystemClock::for_at_least(25ms));
+  sampler.Release();
+  dispatcher.RunUntilStalled().IgnorePoll();
+
+  DurationHistogram::Snapshot lateness = sampler.wake_lateness().GetSnapshot();
+  EXPECT_EQ(lateness.count, 1u);
+  EXPECT_LT(lateness.max_us, 10'000u);
+
+  DurationHistogram::Snapshot read = sampler.read_duration().GetSnapshot();
+  EXPECT_EQ(read.count, 1u);
+  EXPECT_GE(read.min_us, 20'000u);
+  sampler.Deregister();
+}
+
+TEST(PeriodicSamplerTest, BacksOffWhileSteady) {
+  Dispatcher dispatcher;
+  SteadySampler sampler;
+  dispatcher.Post(sampler);
+
+  // Four samples at each of 10, 20, 40 and 80 ms take 600 ms.
+  RunFor(dispatcher, SystemClock::for_at_least(700ms));
+  EXPECT_EQ(sampler.period(), SteadySampler::kConfig.max_period);
+  EXPECT_EQ(sampler.stats().period, SteadySampler::kConfig.max_period);
+  EXPECT_LE(sampler.stats().samples, 20u);
+  EXPECT_EQ(sampler.stats().overruns, 0u);
+  sampler.Deregister();
+}
+
+TEST(PeriodicSamplerTest, SpeedUp) {
+  Dispatcher dispatcher;
+  SteadySampler sampler;
+  dispatcher.Post(sampler);
+  RunFor(dispatcher, SystemClock::for_at_least(700ms));
+  ASSERT_EQ(sampler.period(), SteadySampler::kConfig.max_period);
+  const uint32_t samples = sampler.stats().samples;
+
+  // Sampling resumes at the shortest period rather than waiting out the
+  // longest.
+  sampler.SpeedUp();
+  RunFor(dispatcher, SystemClock::for_at_least(25ms));
+  EXPECT_EQ(sampler.period(), SteadySampler::kConfig.min_period);
+  EXPECT_GE(sampler.stats().samples, samples + 2);
+  EXPECT_EQ(sampler.stats().overruns, 0u);
+  sampler.Deregister();
+}
+
+}  // namespace
+}  // namespace sense
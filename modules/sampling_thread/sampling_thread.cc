@@ -15,52 +15,273 @@
 #include "modules/sampling_thread/sampling_thread.h"
 
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
 
+#include "modules/air_sensor/air_sensor.h"
+#include "modules/edge_detector/hysteresis_edge_detector.h"
+#include "modules/light/sensor.h"
+#include "modules/proximity/config.h"
+#include "modules/proximity/sensor.h"
+#include "modules/sampling_thread/adaptive_period.h"
+#include "modules/sampling_thread/boxcar_decimator.h"
+#include "modules/sampling_thread/config.h"
+#include "modules/sampling_thread/periodic_sampler.h"
 #include "pw_assert/check.h"
 #include "pw_chrono/system_clock.h"
 #include "pw_log/log.h"
-#include "pw_thread/sleep.h"
+#include "pw_metric/global.h"
+#include "pw_metric/metric.h"
 #include "system/pubsub.h"
 #include "system/system.h"
 
 namespace sense {
 namespace {
 
-using pw::chrono::SystemClock;
+using ::pw::async2::Context;
+using ::pw::async2::Pending;
+using ::pw::async2::Poll;
+using ::pw::async2::Ready;
+using ::pw::chrono::SystemClock;
 
-constexpr SystemClock::duration kPeriod = std::chrono::milliseconds(250);
+using namespace std::chrono_literals;
 
-void ReadProximity() {
-  pw::Result<uint16_t> sample = system::ProximitySensor().ReadSample();
-  if (!sample.ok()) {
-    PW_LOG_WARN("Failed to read proximity sensor sample: %s",
-                sample.status().str());
-    return;
-  }
-  std::ignore = system::PubSub().Publish(ProximitySample{*sample});
+// Proximity is sampled quickly for gestures, while the air sensor is read at a
+// rate its heater can sustain. Each backs off while its readings are steady.
+// The phases keep reads from coinciding on the shared I2C bus.
+constexpr AdaptivePeriod::Config kProximityPeriod = {
+    .min_period = 100ms,
+    .max_period = 400ms,
+    // Half the far threshold, in the sensor's unspecified units.
+    .threshold = 256.f,
+    .steady_samples = 20,
+};
+constexpr SystemClock::duration kProximityPhase = 0ms;
+constexpr uint16_t kProximityOversampling =
+    SENSE_SAMPLING_THREAD_CONFIG_PROXIMITY_OVERSAMPLING;
+constexpr AdaptivePeriod::Config kAmbientLightPeriod = {
+    .min_period = 250ms,
+    .max_period = 2s,
+    // Ambient light is observed as log2(lux), so this is a change of about a
+    // fifth, however bright it is.
+    .threshold = 0.25f,
+    .steady_samples = 8,
+};
+constexpr SystemClock::duration kAmbientLightPhase = 25ms;
+constexpr AdaptivePeriod::Config kAirSensorPeriod = {
+    .min_period = 1s,
+    .max_period = 8s,
+    // Out of a score of 1023.
+    .threshold = 32.f,
+    .steady_samples = 5,
+};
+constexpr SystemClock::duration kAirSensorPhase = 75ms;
+
+PW_METRIC_GROUP_GLOBAL(sampling_metrics, "sampling");
+PW_METRIC(sampling_metrics, proximity_rate, "proximity rate hz", 0.f);
+PW_METRIC(sampling_metrics, ambient_light_rate, "ambient light rate hz", 0.f);
+PW_METRIC(sampling_metrics, air_sensor_rate, "air sensor rate hz", 0.f);
+
+float RateHz(SystemClock::duration period) {
+  return 1.f / std::chrono::duration<float>(period).count();
 }
 
-void ReadAmbientLight() {
-  pw::Result<float> sample = system::AmbientLightSensor().ReadSampleLux();
-  if (!sample.ok()) {
-    PW_LOG_WARN("Failed to read ambient light sensor sample: %s",
-                sample.status().str());
-    return;
-  }
-  std::ignore = system::PubSub().Publish(AmbientLightSample{*sample});
+// Returns the period to read at for each sample to average `factor` readings.
+constexpr AdaptivePeriod::Config Oversampled(AdaptivePeriod::Config config,
+                                             uint16_t factor) {
+  config.min_period /= factor;
+  config.max_period /= factor;
+  return config;
 }
 
-void ReadAirSensor() {
-  auto& air_sensor = system::AirSensor();
+uint32_t Milliseconds(SystemClock::duration duration) {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+
+// Proximity readings may be oversampled and decimated, in which case only the
+// filtered samples are observed and published.
+//
+// Samples are published in batches, to spare subscribers handling an event for
+// each one. A batch is published early if the sample crosses the near or far
+// threshold, or changes significantly, so that edges are reported promptly, or
+// if the samples would no longer be evenly spaced.
+class ProximitySampler final : public PeriodicSampler {
+ public:
+  ProximitySampler()
+      : PeriodicSampler("proximity",
+                        Oversampled(kProximityPeriod, kProximityOversampling),
+                        kProximityPhase),
+        decimator_(kProximityOversampling),
+        edges_(SENSE_PROXIMITY_CONFIG_FAR_THRESHOLD,
+               SENSE_PROXIMITY_CONFIG_NEAR_THRESHOLD) {}
+
+ private:
+  Poll<> DoSample(Context& cx) override {
+    // Await the read, so the bus is waited on without blocking the other
+    // samplers.
+    if (!reading_.has_value()) {
+      reading_.emplace(system::ProximitySensor().ReadSampleAsync());
+    }
+    Poll<pw::Result<uint16_t>> reading = reading_->Pend(cx);
+    if (reading.IsPending()) {
+      return Pending();
+    }
+    reading_.reset();
+
+    if (!reading->ok()) {
+      PW_LOG_WARN("Failed to read proximity sensor sample: %s",
+                  reading->status().str());
+      // Start over, so each sample averages readings from an equal span.
+      decimator_.Reset();
+      return Ready();
+    }
+    std::optional<uint16_t> sample = decimator_.Add(**reading);
+    if (!sample.has_value()) {
+      return Ready();
+    }
+    Add(*sample, Milliseconds(SystemClock::now().time_since_epoch()));
+    // Track edges as the proximity manager will, since a gradual approach may
+    // cross a threshold without any one sample changing significantly.
+    const bool edge = edges_.Update(*sample) != Edge::kNone;
+    const bool changed = Observe(static_cast<float>(*sample));
+    if (edge || changed || batch_.full() ||
+        Milliseconds(sample_period()) != batch_.interval_ms()) {
+      PublishBatch();
+    }
+    proximity_rate.Set(RateHz(period()));
+
+    // Have the sensor measure as often as it is read, so the decimator averages
+    // distinct measurements rather than repeats of the same one.
+    if (period() != sensor_period_) {
+      sensor_period_ = period();
+      std::ignore = system::ProximitySensor().SetSamplePeriod(period());
+    }
+    return Ready();
+  }
+
+  // Time between samples, once decimated.
+  SystemClock::duration sample_period() const {
+    return period() * decimator_.factor();
+  }
+
+  // Adds a sample taken at `now_ms`, first publishing the pending batch if
+  // the sample is out of step with it, e.g. because the sampler overran or
+  // was sped up.
+  void Add(uint16_t sample, uint32_t now_ms) {
+    if (!batch_.empty()) {
+      const auto offset =
+          static_cast<int32_t>(now_ms - batch_.sample_ms(batch_.size()));
+      if (std::abs(offset) > batch_.interval_ms() / 2) {
+        PublishBatch();
+      }
+    }
+    if (batch_.empty()) {
+      batch_ = ProximitySampleBatch(
+          now_ms, static_cast<uint16_t>(Milliseconds(sample_period())));
+    }
+    batch_.push_back(sample);
+  }
+
+  void PublishBatch() {
+    std::ignore = system::PubSub().Publish(batch_);
+    batch_ = ProximitySampleBatch();
+  }
+
+  std::optional<ProximitySampleFuture> reading_;
+  BoxcarDecimator decimator_;
+  HysteresisEdgeDetector<uint16_t> edges_;
+  ProximitySampleBatch batch_;
+  SystemClock::duration sensor_period_ = SystemClock::duration::zero();
+};
+
+class AmbientLightSampler final : public PeriodicSampler {
+ public:
+  AmbientLightSampler()
+      : PeriodicSampler(
+            "ambient light", kAmbientLightPeriod, kAmbientLightPhase) {}
+
+ private:
+  Poll<> DoSample(Context& cx) override {
+    if (!reading_.has_value()) {
+      reading_.emplace(system::AmbientLightSensor().ReadSampleLuxAsync());
+    }
+    Poll<pw::Result<float>> sample = reading_->Pend(cx);
+    if (sample.IsPending()) {
+      return Pending();
+    }
+    reading_.reset();
+
+    if (!sample->ok()) {
+      PW_LOG_WARN("Failed to read ambient light sensor sample: %s",
+                  sample->status().str());
+      return Ready();
+    }
+    std::ignore = system::PubSub().Publish(AmbientLightSample{**sample});
+    Observe(std::log2(**sample + 1.f));
+    ambient_light_rate.Set(RateHz(period()));
 
-  // Read the sensor synchronously to avoid conflicting with other I2C sensors.
-  pw::Result<uint16_t> score = air_sensor.MeasureSync();
-  if (!score.ok()) {
-    PW_LOG_WARN("Failed to read air sensor score: %s", score.status().str());
-    return;
+    // Let the sensor keep its readings as fresh as they are sampled.
+    if (period() != sensor_period_) {
+      sensor_period_ = period();
+      std::ignore = system::AmbientLightSensor().SetSamplePeriod(period());
+    }
+    return Ready();
   }
 
-  std::ignore = system::PubSub().Publish(AirQuality{*score});
+  std::optional<AmbientLightSampleFuture> reading_;
+  SystemClock::duration sensor_period_ = SystemClock::duration::zero();
+};
+
+class AirSampler final : public PeriodicSampler {
+ public:
+  AirSampler()
+      : PeriodicSampler("air sensor", kAirSensorPeriod, kAirSensorPhase) {}
+
+ private:
+  Poll<> DoSample(Context& cx) override {
+    // Await the measurement, so the other samplers can run meanwhile.
+    if (!measurement_.has_value()) {
+      // Have a pipelined sensor convert only as often as it is sampled, rather
+      // than heating continuously.
+      if (period() != sensor_period_) {
+        sensor_period_ = period();
+        std::ignore = system::AirSensor().SetSamplePeriod(period());
+      }
+      measurement_.emplace(system::AirSensor().MeasureAsync());
+    }
+    Poll<pw::Result<uint16_t>> score = measurement_->Pend(cx);
+    if (score.IsPending()) {
+      return Pending();
+    }
+    measurement_.reset();
+
+    if (!score->ok()) {
+      PW_LOG_WARN("Failed to read air sensor score: %s",
+                  score->status().str());
+      return Ready();
+    }
+    std::ignore = system::PubSub().Publish(AirQuality{**score});
+    Observe(static_cast<float>(**score));
+    air_sensor_rate.Set(RateHz(period()));
+    return Ready();
+  }
+
+  std::optional<AirSensorMeasureFuture> measurement_;
+  SystemClock::duration sensor_period_ = SystemClock::duration::zero();
+};
+
+struct Samplers {
+  AmbientLightSampler ambient_light;
+  ProximitySampler proximity;
+  AirSampler air;
+};
+
+Samplers& SamplerTasks() {
+  static Samplers samplers;
+  return samplers;
 }
 
 [[nodiscard]] bool LogInit(const char* type, pw::Status init_result) {
@@ -72,30 +293,40 @@ void ReadAirSensor() {
 
 }  // namespace
 
-// Reads sensor samples in a loop and publishes PubSub events for them.
-void SamplingLoop() {
-  const bool ambient_light_enabled =
-      LogInit("Ambient light", system::AmbientLightSensor().Enable());
-  const bool prox_enabled =
-      LogInit("Proximity", system::ProximitySensor().Enable());
-  const bool air_enabled = LogInit("Air", system::AirSensor().Init());
-
-  SystemClock::time_point deadline = SystemClock::now();
-
-  while (true) {
-    deadline += kPeriod;
-    pw::this_thread::sleep_until(deadline);
-
-    if (ambient_light_enabled) {
-      ReadAmbientLight();
+void StartSampling(pw::async2::Dispatcher& dispatcher, Worker& worker) {
+  worker.RunOnce([&dispatcher]() {
+    Samplers& samplers = SamplerTasks();
+    if (LogInit("Ambient light", system::AmbientLightSensor().Enable())) {
+      dispatcher.Post(samplers.ambient_light);
     }
-    if (prox_enabled) {
-      ReadProximity();
+    // When interrupt driven, the sensor watches its own thresholds, so it is
+    // enabled but not polled.
+    if (LogInit("Proximity", system::ProximitySensor().Enable()) &&
+        !SENSE_PROXIMITY_CONFIG_INTERRUPT_DRIVEN) {
+      dispatcher.Post(samplers.proximity);
     }
-    if (air_enabled) {
-      ReadAirSensor();
+    if (LogInit("Air", system::AirSensor().Init())) {
+      dispatcher.Post(samplers.air);
     }
-  }
+
+    // Someone arriving or leaving is when readings are most likely to change.
+    PW_CHECK(system::PubSub().SubscribeTo<ProximityStateChange>(
+        [](ProximityStateChange) {
+          Samplers& samplers = SamplerTasks();
+          samplers.ambient_light.SpeedUp();
+          samplers.proximity.SpeedUp();
+          samplers.air.SpeedUp();
+        }));
+  });
+}
+
+pw::span<const PeriodicSampler* const> GetSamplers() {
+  static const PeriodicSampler* const samplers[] = {
+      &SamplerTasks().proximity,
+      &SamplerTasks().ambient_light,
+      &SamplerTasks().air,
+  };
+  return samplers;
 }
 
 }  // namespace sense
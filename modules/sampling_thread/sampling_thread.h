@@ -11,9 +11,22 @@
 // WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
 // License for the specific language governing permissions and limitations under
 // the License.
+#pragma once
+
+#include "modules/sampling_thread/periodic_sampler.h"
+#include "modules/worker/worker.h"
+#include "pw_async2/dispatcher.h"
+#include "pw_span/span.h"
+
 namespace sense {
 
-// Reads sensor samples in a loop and publishes PubSub events for them.
-[[noreturn]] void SamplingLoop();
+/// Enables the sensors, then samples each of them from its own task on
+/// `dispatcher` and publishes PubSub events for the samples.
+///
+/// Sensors are enabled on `worker`, since enabling them may block.
+void StartSampling(pw::async2::Dispatcher& dispatcher, Worker& worker);
+
+/// Returns the sampler of each sensor, whether or not it was started.
+pw::span<const PeriodicSampler* const> GetSamplers();
 
 }  // namespace sense
@@ -0,0 +1,74 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "SAMPLING"
+
+#include "modules/sampling_thread/service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "modules/sampling_thread/duration_histogram.h"
+#include "pw_log/log.h"
+#include "pw_string/util.h"
+
+namespace sense {
+namespace {
+
+void ToProto(const DurationHistogram& histogram,
+             sampling_DurationStats& proto) {
+  DurationHistogram::Snapshot stats = histogram.GetSnapshot();
+  proto.count = stats.count;
+  proto.min_us = stats.min_us;
+  proto.max_us = stats.max_us;
+  proto.mean_us = stats.mean_us();
+
+  constexpr size_t kMaxBuckets =
+      sizeof(proto.buckets) / sizeof(proto.buckets[0]);
+  static_assert(kMaxBuckets == DurationHistogram::kNumBuckets);
+  std::copy(stats.buckets.begin(), stats.buckets.end(), proto.buckets);
+  proto.buckets_count = kMaxBuckets;
+}
+
+}  // namespace
+
+void SamplingService::GetSamplerStats(
+    const pw_protobuf_Empty&, ServerWriter<sampling_SamplerStats>& writer) {
+  auto call = get_sampler_stats_metrics_.Measure();
+  for (const PeriodicSampler* sampler : samplers_) {
+    PeriodicSampler::Stats stats = sampler->stats();
+    sampling_SamplerStats response = sampling_SamplerStats_init_default;
+    pw::string::Copy(sampler->name(), response.name).IgnoreError();
+    response.samples = stats.samples;
+    response.deadline_misses = stats.overruns;
+    response.period_ms = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(stats.period)
+            .count());
+    response.has_wake_lateness = true;
+    ToProto(sampler->wake_lateness(), response.wake_lateness);
+    response.has_read_duration = true;
+    ToProto(sampler->read_duration(), response.read_duration);
+
+    if (const auto status = get_sampler_stats_metrics_.Write(
+            writer, response, sampling_SamplerStats_fields);
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write sampler stats: %s", status.str());
+      return;
+    }
+  }
+  writer.Finish().IgnoreError();
+}
+
+}  // namespace sense
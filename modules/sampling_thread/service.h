@@ -0,0 +1,43 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/sampling_thread/periodic_sampler.h"
+#include "modules/sampling_thread/sampling.rpc.pb.h"
+#include "pw_span/span.h"
+
+namespace sense {
+
+/// Reports how well the sensors are keeping to their sampling schedules.
+class SamplingService final
+    : public ::sampling::pw_rpc::nanopb::Sampling::Service<SamplingService> {
+ public:
+  explicit SamplingService(pw::span<const PeriodicSampler* const> samplers)
+      : samplers_(samplers) {}
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  void GetSamplerStats(const pw_protobuf_Empty&,
+                       ServerWriter<sampling_SamplerStats>& writer);
+
+ private:
+  pw::span<const PeriodicSampler* const> samplers_;
+
+  RpcServiceMetrics method_metrics_{"Sampling"};
+  RpcMethodMetrics get_sampler_stats_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(SamplingService, GetSamplerStats)};
+};
+
+}  // namespace sense
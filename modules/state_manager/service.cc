@@ -15,21 +15,42 @@
 #include "modules/state_manager/service.h"
 
 #include <mutex>
+#include <string_view>
 
 #include "pw_assert/check.h"
+#include "pw_log/log.h"
 #include "pw_string/util.h"
 
 namespace sense {
+namespace {
 
-StateManagerService::StateManagerService(PubSub& pubsub) : pubsub_(&pubsub) {
+pw::Status StateToProto(const SenseState& state, state_manager_State& proto) {
+  proto.alarm_active = state.alarm;
+  proto.alarm_threshold = state.alarm_threshold;
+  proto.aq_score = state.air_quality;
+  return pw::string::Copy(state.air_quality_description, proto.aq_description)
+      .status();
+}
+
+}  // namespace
+
+StateManagerService::StateManagerService(PubSub& pubsub, Worker& worker)
+    : pubsub_(&pubsub),
+      worker_(&worker),
+      heartbeat_timer_(
+          pw::bind_member<&StateManagerService::HeartbeatCallback>(this)) {
   PW_CHECK(pubsub_->SubscribeTo<SenseState>([this](SenseState event) {
-    std::lock_guard lock(current_state_lock_);
-    current_state_ = event;
+    {
+      std::lock_guard lock(current_state_lock_);
+      current_state_ = event;
+    }
+    HandleState(event);
   }));
 }
 
 pw::Status StateManagerService::ChangeThreshold(
     const state_manager_ChangeThresholdRequest& request, pw_protobuf_Empty&) {
+  auto call = change_threshold_metrics_.Measure();
   bool success;
 
   if (request.increment) {
@@ -45,6 +66,7 @@ pw::Status StateManagerService::ChangeThreshold(
 
 pw::Status StateManagerService::SilenceAlarm(const pw_protobuf_Empty&,
                                              pw_protobuf_Empty&) {
+  auto call = silence_alarm_metrics_.Measure();
   bool success = pubsub_->Publish(
       StateManagerControl(StateManagerControl::kSilenceAlarms));
   return success ? pw::OkStatus() : pw::Status::Unavailable();
@@ -52,19 +74,127 @@ pw::Status StateManagerService::SilenceAlarm(const pw_protobuf_Empty&,
 
 pw::Status StateManagerService::GetState(const pw_protobuf_Empty&,
                                          state_manager_State& response) {
+  auto call = get_state_metrics_.Measure();
   std::lock_guard lock(current_state_lock_);
 
   if (!current_state_.has_value()) {
     return pw::Status::Unavailable();
   }
 
-  const auto& current_state = current_state_.value();
-  response.alarm_active = current_state.alarm;
-  response.alarm_threshold = current_state.alarm_threshold;
-  response.aq_score = current_state.air_quality;
-  return pw::string::Copy(current_state.air_quality_description,
-                          response.aq_description)
-      .status();
+  return StateToProto(current_state_.value(), response);
+}
+
+void StateManagerService::WatchState(
+    const state_manager_WatchStateRequest& request,
+    ServerWriter<state_manager_State>& writer) {
+  auto call = watch_state_metrics_.Measure();
+  if (request.heartbeat_interval_ms != 0 &&
+      request.heartbeat_interval_ms < kMinHeartbeatIntervalMs) {
+    if (const auto status = writer.Finish(pw::Status::InvalidArgument());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+
+  auto heartbeat_interval = pw::chrono::SystemClock::duration::zero();
+  if (request.heartbeat_interval_ms != 0) {
+    heartbeat_interval = pw::chrono::SystemClock::for_at_least(
+        std::chrono::milliseconds(request.heartbeat_interval_ms));
+  }
+
+  std::optional<SenseState> current_state;
+  {
+    std::lock_guard lock(current_state_lock_);
+    current_state = current_state_;
+  }
+
+  heartbeat_timer_.Cancel();
+  {
+    std::lock_guard lock(watch_lock_);
+    watch_state_metrics_.OpenStream(watch_writer_, writer);
+    heartbeat_interval_ = heartbeat_interval;
+    last_watched_.reset();
+    if (current_state.has_value() && !WriteWatchLocked(*current_state)) {
+      return;
+    }
+  }
+  RestartHeartbeat(heartbeat_interval);
+}
+
+bool StateManagerService::IsWatchedChange(const SenseState& before,
+                                          const SenseState& after) {
+  return before.alarm != after.alarm ||
+         before.alarm_threshold != after.alarm_threshold ||
+         before.air_quality / AirQuality::kScoreBucketSize !=
+             after.air_quality / AirQuality::kScoreBucketSize ||
+         std::string_view(before.air_quality_description) !=
+             std::string_view(after.air_quality_description);
+}
+
+void StateManagerService::HandleState(const SenseState& state) {
+  pw::chrono::SystemClock::duration heartbeat_interval;
+  {
+    std::lock_guard lock(watch_lock_);
+    if (!watch_writer_.active()) {
+      return;
+    }
+    if (last_watched_.has_value() && !IsWatchedChange(*last_watched_, state)) {
+      return;
+    }
+    if (!WriteWatchLocked(state)) {
+      return;
+    }
+    heartbeat_interval = heartbeat_interval_;
+  }
+  RestartHeartbeat(heartbeat_interval);
+}
+
+void StateManagerService::HeartbeatCallback(
+    pw::chrono::SystemClock::time_point) {
+  // Writing the state to the stream is too slow for the timer thread.
+  worker_->RunOnce([this]() { SendHeartbeat(); });
+}
+
+void StateManagerService::SendHeartbeat() {
+  std::optional<SenseState> current_state;
+  {
+    std::lock_guard lock(current_state_lock_);
+    current_state = current_state_;
+  }
+
+  pw::chrono::SystemClock::duration heartbeat_interval;
+  {
+    std::lock_guard lock(watch_lock_);
+    if (!watch_writer_.active()) {
+      return;
+    }
+    if (current_state.has_value() && !WriteWatchLocked(*current_state)) {
+      return;
+    }
+    heartbeat_interval = heartbeat_interval_;
+  }
+  RestartHeartbeat(heartbeat_interval);
+}
+
+bool StateManagerService::WriteWatchLocked(const SenseState& state) {
+  state_manager_State proto = state_manager_State_init_default;
+  StateToProto(state, proto).IgnoreError();
+  if (!watch_state_metrics_
+           .Write(watch_writer_, proto, state_manager_State_fields)
+           .ok()) {
+    PW_LOG_INFO("State watch stream closed");
+    return false;
+  }
+  last_watched_ = state;
+  return true;
+}
+
+void StateManagerService::RestartHeartbeat(
+    pw::chrono::SystemClock::duration interval) {
+  if (interval != pw::chrono::SystemClock::duration::zero()) {
+    heartbeat_timer_.InvokeAfter(interval);
+  }
 }
 
 }  // namespace sense
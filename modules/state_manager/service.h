@@ -13,12 +13,18 @@
 // the License.
 #pragma once
 
+#include <cstdint>
 #include <optional>
 
 #include "modules/pubsub/pubsub_events.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
 #include "modules/state_manager/state_manager.rpc.pb.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
 #include "pw_sync/interrupt_spin_lock.h"
 #include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
 
 namespace sense {
 
@@ -26,18 +32,66 @@ class StateManagerService final
     : public ::state_manager::pw_rpc::nanopb::StateManager::Service<
           StateManagerService> {
  public:
-  StateManagerService(PubSub& pubsub);
+  static constexpr uint32_t kMinHeartbeatIntervalMs = 1000;
+
+  /// Heartbeats are sent from `worker`.
+  StateManagerService(PubSub& pubsub, Worker& worker);
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
 
   pw::Status ChangeThreshold(
       const state_manager_ChangeThresholdRequest& request,
       pw_protobuf_Empty& response);
   pw::Status SilenceAlarm(const pw_protobuf_Empty&, pw_protobuf_Empty&);
   pw::Status GetState(const pw_protobuf_Empty&, state_manager_State& response);
+  void WatchState(const state_manager_WatchStateRequest& request,
+                  ServerWriter<state_manager_State>& writer);
 
  private:
+  /// Returns true if watchers should be told about the change from `before`
+  /// to `after`. Score changes within the same bucket are not reported.
+  static bool IsWatchedChange(const SenseState& before,
+                              const SenseState& after);
+
+  /// Pushes `state` to the watch stream if it differs from the last state sent.
+  void HandleState(const SenseState& state) PW_LOCKS_EXCLUDED(watch_lock_);
+
+  /// Has the worker send a heartbeat.
+  void HeartbeatCallback(pw::chrono::SystemClock::time_point);
+
+  /// Resends the current state, and schedules the next heartbeat. Runs on the
+  /// worker.
+  void SendHeartbeat() PW_LOCKS_EXCLUDED(watch_lock_);
+
+  /// Writes `state` to the watch stream. Returns false if the stream is closed.
+  bool WriteWatchLocked(const SenseState& state)
+      PW_EXCLUSIVE_LOCKS_REQUIRED(watch_lock_);
+
+  void RestartHeartbeat(pw::chrono::SystemClock::duration interval);
+
   PubSub* pubsub_;
+  Worker* worker_;
   pw::sync::InterruptSpinLock current_state_lock_;
   std::optional<SenseState> current_state_ PW_GUARDED_BY(current_state_lock_);
+
+  // Held while writing to `watch_writer_`, from RPC handlers, the pubsub
+  // subscriber and heartbeats.
+  pw::sync::Mutex watch_lock_;
+  ServerWriter<state_manager_State> watch_writer_ PW_GUARDED_BY(watch_lock_);
+  std::optional<SenseState> last_watched_ PW_GUARDED_BY(watch_lock_);
+  pw::chrono::SystemClock::duration heartbeat_interval_
+      PW_GUARDED_BY(watch_lock_) = pw::chrono::SystemClock::duration::zero();
+  pw::chrono::SystemTimer heartbeat_timer_;
+
+  RpcServiceMetrics method_metrics_{"StateManager"};
+  RpcMethodMetrics change_threshold_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(StateManagerService, ChangeThreshold)};
+  RpcMethodMetrics silence_alarm_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(StateManagerService, SilenceAlarm)};
+  RpcMethodMetrics get_state_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(StateManagerService, GetState)};
+  RpcMethodMetrics watch_state_metrics_{
+      method_metrics_, SENSE_RPC_METHOD(StateManagerService, WatchState)};
 };
 
 }  // namespace sense
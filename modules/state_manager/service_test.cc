@@ -0,0 +1,109 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/state_manager/service.h"
+
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_rpc/nanopb/test_method_context.h"
+#include "pw_rpc/test_helpers.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+class StateManagerServiceTest : public ::testing::Test {
+ protected:
+  // Enough for every event a test publishes, so that none is dropped.
+  static constexpr size_t kMaxEvents = 8;
+  static constexpr size_t kMaxSubscribers = 4;
+  using PubSub =
+      sense::GenericPubSubBuffer<sense::Event, kMaxEvents, kMaxSubscribers>;
+
+  StateManagerServiceTest() : ::testing::Test(), pubsub_(worker_) {}
+
+  void TearDown() override { worker_.Stop(); }
+
+  void PublishState(bool alarm, uint16_t threshold, uint16_t score) {
+    ASSERT_TRUE(pubsub_.Publish(sense::SenseState{
+        .alarm = alarm,
+        .alarm_threshold = threshold,
+        .air_quality = score,
+        .air_quality_description = score < 768 ? "VERY GOOD" : "EXCELLENT",
+    }));
+  }
+
+  sense::TestWorker<> worker_;
+  PubSub pubsub_;
+  pw::sync::ThreadNotification notification_;
+};
+
+TEST_F(StateManagerServiceTest, WatchStateRejectsShortHeartbeat) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, WatchState)
+  ctx(pubsub_, worker_);
+  ctx.call({.heartbeat_interval_ms = 10});
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::Status::InvalidArgument());
+}
+
+TEST_F(StateManagerServiceTest, WatchStateSendsOnlyChanges) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, WatchState)
+  ctx(pubsub_, worker_);
+  ctx.call({});
+  EXPECT_EQ(ctx.responses().size(), 0u);
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 4, [this] {
+    PublishState(false, 384, 700);
+    // Same score bucket; not sent.
+    PublishState(false, 384, 710);
+    PublishState(false, 384, 900);
+    PublishState(false, 512, 900);
+    // Unchanged; not sent.
+    PublishState(false, 512, 900);
+    PublishState(true, 512, 900);
+  });
+
+  ASSERT_EQ(ctx.responses().size(), 4u);
+  EXPECT_EQ(ctx.responses()[0].aq_score, 700u);
+  EXPECT_STREQ(ctx.responses()[0].aq_description, "VERY GOOD");
+  EXPECT_EQ(ctx.responses()[1].aq_score, 900u);
+  EXPECT_STREQ(ctx.responses()[1].aq_description, "EXCELLENT");
+  EXPECT_EQ(ctx.responses()[2].alarm_threshold, 512u);
+  EXPECT_FALSE(ctx.responses()[2].alarm_active);
+  EXPECT_TRUE(ctx.responses()[3].alarm_active);
+}
+
+TEST_F(StateManagerServiceTest, WatchStateSendsCurrentStateOnOpen) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::StateManagerService, WatchState)
+  ctx(pubsub_, worker_);
+
+  // Subscribers are notified in order, so once this one has seen the state,
+  // so has the service.
+  auto token = pubsub_.Subscribe([this](sense::Event) {
+    notification_.release();
+  });
+  ASSERT_TRUE(token.has_value());
+  PublishState(true, 384, 700);
+  notification_.acquire();
+  pubsub_.Unsubscribe(*token);
+
+  ctx.call({});
+  ASSERT_EQ(ctx.responses().size(), 1u);
+  EXPECT_TRUE(ctx.responses()[0].alarm_active);
+  EXPECT_EQ(ctx.responses()[0].alarm_threshold, 384u);
+  EXPECT_EQ(ctx.responses()[0].aq_score, 700u);
+}
+
+}  // namespace
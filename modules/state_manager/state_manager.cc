@@ -84,9 +84,10 @@ void StateManager::Update(Event event) {
     case kAirQuality:
       UpdateAirQuality(std::get<AirQuality>(event).score);
       break;
+    case kGasScan:
     case kTimerRequest:
     case kMorseEncodeRequest:
-    case kProximitySample:
+    case kProximitySampleBatch:
     case kProximityStateChange:
     case kSenseState:
       break;  // ignore these events
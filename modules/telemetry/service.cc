@@ -0,0 +1,175 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#define PW_LOG_MODULE_NAME "TELEM"
+
+#include "modules/telemetry/service.h"
+
+#include <mutex>
+
+#include "pw_assert/check.h"
+#include "pw_log/log.h"
+
+namespace sense {
+namespace {
+
+bool IsDue(uint32_t divider, uint32_t tick) {
+  return divider != 0 && tick % divider == 0;
+}
+
+}  // namespace
+
+void TelemetryService::Init(PubSub& pubsub,
+                            Worker& worker,
+                            AirSensor& air_sensor,
+                            Board& board) {
+  pubsub_ = &pubsub;
+  worker_ = &worker;
+  air_sensor_ = &air_sensor;
+  board_ = &board;
+
+  PW_CHECK(pubsub_->Subscribe([this](Event event) { HandleEvent(event); }));
+}
+
+void TelemetryService::Stream(const telemetry_StreamRequest& request,
+                              ServerWriter<telemetry_Frame>& writer) {
+  auto call = stream_metrics_.Measure();
+  if (request.tick_interval_ms < kMinTickIntervalMs) {
+    if (const auto status = writer.Finish(pw::Status::InvalidArgument());
+        !status.ok()) {
+      PW_LOG_ERROR("Failed to write response: %s", status.str());
+    }
+    return;
+  }
+
+  tick_timer_.Cancel();
+  std::lock_guard writer_lock(writer_lock_);
+  stream_metrics_.OpenStream(writer_, writer);
+  writer_.set_on_error([this](pw::Status) { tick_timer_.Cancel(); });
+
+  {
+    std::lock_guard lock(lock_);
+    config_ = request;
+    tick_interval_ = pw::chrono::SystemClock::for_at_least(
+        std::chrono::milliseconds(request.tick_interval_ms));
+    tick_ = 0;
+    next_tick_ = pw::chrono::SystemClock::now() + tick_interval_;
+  }
+  ScheduleTick();
+}
+
+void TelemetryService::HandleEvent(const Event& event) {
+  std::lock_guard lock(lock_);
+  if (std::holds_alternative<AmbientLightSample>(event)) {
+    latest_.has_lux = true;
+    latest_.lux = std::get<AmbientLightSample>(event).sample_lux;
+  } else if (std::holds_alternative<ProximitySampleBatch>(event)) {
+    latest_.has_proximity = true;
+    latest_.proximity = std::get<ProximitySampleBatch>(event).back();
+  } else if (std::holds_alternative<SenseState>(event)) {
+    const auto& state = std::get<SenseState>(event);
+    latest_.has_state = true;
+    latest_.alarm_active = state.alarm;
+    latest_.alarm_threshold = state.alarm_threshold;
+  }
+}
+
+void TelemetryService::TickCallback(pw::chrono::SystemClock::time_point) {
+  worker_->RunOnce([this]() { Tick(); });
+}
+
+void TelemetryService::Tick() {
+  std::lock_guard writer_lock(writer_lock_);
+  telemetry_StreamRequest config;
+  uint32_t tick;
+  LatestValues latest;
+  {
+    std::lock_guard lock(lock_);
+    // A tick queued for a stream that has since been replaced is dropped. The
+    // new stream has already scheduled its own.
+    const pw::chrono::SystemClock::time_point now =
+        pw::chrono::SystemClock::now();
+    if (now < next_tick_) {
+      return;
+    }
+    config = config_;
+    tick = tick_++;
+    latest = latest_;
+
+    // Ticks are scheduled against a fixed timeline, so that time spent
+    // sampling does not accumulate as drift. Ticks that were missed entirely
+    // are skipped rather than sent late.
+    next_tick_ += tick_interval_;
+    while (next_tick_ <= now) {
+      next_tick_ += tick_interval_;
+      ++tick_;
+    }
+  }
+
+  telemetry_Frame frame = Sample(config, tick, latest);
+  if (!stream_metrics_.Write(writer_, frame, telemetry_Frame_fields).ok()) {
+    PW_LOG_INFO("Telemetry stream closed; ending periodic sampling");
+    return;
+  }
+  ScheduleTick();
+}
+
+void TelemetryService::ScheduleTick() {
+  pw::chrono::SystemClock::time_point next_tick;
+  {
+    std::lock_guard lock(lock_);
+    next_tick = next_tick_;
+  }
+  tick_timer_.InvokeAt(next_tick);
+}
+
+telemetry_Frame TelemetryService::Sample(const telemetry_StreamRequest& config,
+                                         uint32_t tick,
+                                         const LatestValues& latest) {
+  telemetry_Frame frame = telemetry_Frame_init_default;
+  frame.tick = tick;
+
+  AirSensor::Reading reading = air_sensor_->Snapshot();
+  if (IsDue(config.air_divider, tick)) {
+    frame.channels |= telemetry_Channel_AIR;
+    frame.temperature = reading.temperature;
+    frame.pressure = reading.pressure;
+    frame.humidity = reading.humidity;
+    frame.gas_resistance = reading.gas_resistance;
+  }
+  if (IsDue(config.score_divider, tick)) {
+    frame.channels |= telemetry_Channel_SCORE;
+    frame.score = reading.score;
+  }
+  if (IsDue(config.light_divider, tick) && latest.has_lux) {
+    frame.channels |= telemetry_Channel_LIGHT;
+    frame.lux = latest.lux;
+  }
+  if (IsDue(config.proximity_divider, tick) && latest.has_proximity) {
+    frame.channels |= telemetry_Channel_PROXIMITY;
+    frame.proximity = latest.proximity;
+  }
+  if (IsDue(config.core_temperature_divider, tick)) {
+    frame.channels |= telemetry_Channel_CORE_TEMPERATURE;
+    frame.core_temperature = board_->ReadInternalTemperature();
+  }
+  if (IsDue(config.state_divider, tick) && latest.has_state) {
+    frame.channels |= telemetry_Channel_STATE;
+    frame.alarm_active = latest.alarm_active;
+    frame.alarm_threshold = latest.alarm_threshold;
+  }
+  return frame;
+}
+
+}  // namespace sense
@@ -0,0 +1,110 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+#pragma once
+
+#include <cstdint>
+
+#include "modules/air_sensor/air_sensor.h"
+#include "modules/board/board.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/rpc_metrics/rpc_metrics.h"
+#include "modules/telemetry/telemetry.rpc.pb.h"
+#include "modules/worker/worker.h"
+#include "pw_chrono/system_clock.h"
+#include "pw_chrono/system_timer.h"
+#include "pw_sync/interrupt_spin_lock.h"
+#include "pw_sync/lock_annotations.h"
+#include "pw_sync/mutex.h"
+
+namespace sense {
+
+/// Streams readings from several sensors in a single frame per tick.
+///
+/// All channels share one timer. Each channel has a rate divider, so slow
+/// channels can be included only every few ticks. Ambient light, proximity
+/// and alarm state are not read directly; the most recent values published by
+/// the samplers and state manager are reported instead.
+///
+/// The timer only schedules ticks. Each frame is sampled and written on the
+/// worker, since reading the sensors blocks.
+class TelemetryService final
+    : public ::telemetry::pw_rpc::nanopb::Telemetry::Service<
+          TelemetryService> {
+ public:
+  static constexpr uint32_t kMinTickIntervalMs = 100;
+
+  TelemetryService()
+      : tick_timer_(pw::bind_member<&TelemetryService::TickCallback>(this)) {}
+
+  void Init(PubSub& pubsub,
+            Worker& worker,
+            AirSensor& air_sensor,
+            Board& board);
+
+  RpcServiceMetrics& method_metrics() { return method_metrics_; }
+
+  void Stream(const telemetry_StreamRequest& request,
+              ServerWriter<telemetry_Frame>& writer);
+
+ private:
+  struct LatestValues {
+    bool has_lux = false;
+    float lux = 0.f;
+    bool has_proximity = false;
+    uint16_t proximity = 0;
+    bool has_state = false;
+    bool alarm_active = false;
+    uint16_t alarm_threshold = 0;
+  };
+
+  void HandleEvent(const Event& event) PW_LOCKS_EXCLUDED(lock_);
+
+  void TickCallback(pw::chrono::SystemClock::time_point);
+
+  /// Sends the frame for the current tick, and schedules the next one.
+  void Tick() PW_LOCKS_EXCLUDED(writer_lock_, lock_);
+
+  /// Arms the timer for the next tick.
+  void ScheduleTick() PW_LOCKS_EXCLUDED(lock_);
+
+  /// Builds the frame for `tick` from the channels that are due.
+  telemetry_Frame Sample(const telemetry_StreamRequest& config,
+                         uint32_t tick,
+                         const LatestValues& latest);
+
+  PubSub* pubsub_ = nullptr;
+  Worker* worker_ = nullptr;
+  AirSensor* air_sensor_ = nullptr;
+  Board* board_ = nullptr;
+  pw::chrono::SystemTimer tick_timer_;
+
+  // Held while a tick is sent, so that opening a stream waits for one in
+  // progress before replacing the writer. The timer is cancelled when the
+  // client closes the stream.
+  pw::sync::Mutex writer_lock_;
+  ServerWriter<telemetry_Frame> writer_ PW_GUARDED_BY(writer_lock_);
+
+  pw::sync::InterruptSpinLock lock_;
+  telemetry_StreamRequest config_ PW_GUARDED_BY(lock_) = {};
+  pw::chrono::SystemClock::duration tick_interval_ PW_GUARDED_BY(lock_);
+  pw::chrono::SystemClock::time_point next_tick_ PW_GUARDED_BY(lock_);
+  uint32_t tick_ PW_GUARDED_BY(lock_) = 0;
+  LatestValues latest_ PW_GUARDED_BY(lock_);
+
+  RpcServiceMetrics method_metrics_{"Telemetry"};
+  RpcMethodMetrics stream_metrics_{method_metrics_,
+                                   SENSE_RPC_METHOD(TelemetryService, Stream)};
+};
+
+}  // namespace sense
@@ -0,0 +1,124 @@
+// Copyright 2024 The Pigweed Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not
+// use this file except in compliance with the License. You may obtain a copy of
+// the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+// License for the specific language governing permissions and limitations under
+// the License.
+
+#include "modules/telemetry/service.h"
+
+#include "modules/air_sensor/air_sensor_fake.h"
+#include "modules/board/board_fake.h"
+#include "modules/pubsub/pubsub_events.h"
+#include "modules/worker/test_worker.h"
+#include "pw_rpc/nanopb/test_method_context.h"
+#include "pw_rpc/test_helpers.h"
+#include "pw_sync/thread_notification.h"
+#include "pw_unit_test/framework.h"
+
+namespace {
+
+class TelemetryServiceTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kMaxEvents = 4;
+  static constexpr size_t kMaxSubscribers = 4;
+  using PubSub =
+      sense::GenericPubSubBuffer<sense::Event, kMaxEvents, kMaxSubscribers>;
+
+  TelemetryServiceTest() : ::testing::Test(), pubsub_(worker_) {}
+
+  void TearDown() override { worker_.Stop(); }
+
+  /// Publishes an event and waits until subscribers have handled it.
+  void PublishAndWait(sense::Event event) {
+    auto token = pubsub_.Subscribe([this](sense::Event) {
+      notification_.release();
+    });
+    ASSERT_TRUE(token.has_value());
+    EXPECT_TRUE(pubsub_.Publish(event));
+    notification_.acquire();
+    pubsub_.Unsubscribe(*token);
+  }
+
+  /// Waits until the worker has finished everything queued so far.
+  void Flush() {
+    worker_.RunOnce([this]() { notification_.release(); });
+    notification_.acquire();
+  }
+
+  sense::TestWorker<> worker_;
+  PubSub pubsub_;
+  sense::AirSensorFake air_sensor_;
+  sense::BoardFake board_;
+  pw::sync::ThreadNotification notification_;
+};
+
+TEST_F(TelemetryServiceTest, RejectsShortTickInterval) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::TelemetryService, Stream) ctx;
+  ctx.service().Init(pubsub_, worker_, air_sensor_, board_);
+  ctx.call({.tick_interval_ms = 50});
+
+  ASSERT_TRUE(ctx.done());
+  EXPECT_EQ(ctx.status(), pw::Status::InvalidArgument());
+}
+
+TEST_F(TelemetryServiceTest, AppliesRateDividers) {
+  PW_NANOPB_TEST_METHOD_CONTEXT(sense::TelemetryService, Stream) ctx;
+  ctx.service().Init(pubsub_, worker_, air_sensor_, board_);
+  board_.set_internal_temperature(27.5f);
+  sense::ProximitySampleBatch proximity(0, 100);
+  proximity.push_back(1000);
+  proximity.push_back(1234);
+  PublishAndWait(proximity);
+
+  pw::rpc::test::WaitForPackets(ctx.output(), 3, [&ctx] {
+    ctx.call({
+        .tick_interval_ms = sense::TelemetryService::kMinTickIntervalMs,
+        .air_divider = 2,
+        .light_divider = 1,
+        .proximity_divider = 1,
+        .core_temperature_divider = 3,
+    });
+  });
+  ctx.SendClientError(pw::Status::Cancelled());
+  Flush();
+
+  // Ticks run in real time, so one may have been skipped. The channels follow
+  // from each frame's tick number either way.
+  ASSERT_GE(ctx.responses().size(), 3u);
+  const telemetry_Frame& first = ctx.responses()[0];
+  EXPECT_EQ(first.tick, 0u);
+  EXPECT_EQ(first.temperature, sense::AirSensor::kDefaultTemperature);
+  EXPECT_EQ(first.proximity, 1234u);
+  EXPECT_EQ(first.core_temperature, 27.5f);
+
+  uint32_t last_tick = 0;
+  for (size_t i = 0; i < ctx.responses().size(); ++i) {
+    const telemetry_Frame& frame = ctx.responses()[i];
+    if (i != 0) {
+      EXPECT_GT(frame.tick, last_tick);
+    }
+    last_tick = frame.tick;
+
+    // No ambient light sample has been published, so that channel is omitted.
+    uint32_t channels = telemetry_Channel_PROXIMITY;
+    if (frame.tick % 2 == 0) {
+      channels |= telemetry_Channel_AIR;
+    } else {
+      EXPECT_EQ(frame.temperature, 0.f);
+    }
+    if (frame.tick % 3 == 0) {
+      channels |= telemetry_Channel_CORE_TEMPERATURE;
+    }
+    EXPECT_EQ(frame.channels, channels);
+  }
+}
+
+}  // namespace
@@ -13,13 +13,17 @@
 // the License.
 #pragma once
 
+#include <cstdint>
+
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/board/board.h"
 #include "modules/buttons/manager.h"
+#include "modules/i2c_bus/scheduler.h"
 #include "modules/led/monochrome_led.h"
 #include "modules/led/polychrome_led.h"
 #include "modules/light/sensor.h"
 #include "modules/proximity/sensor.h"
+#include "pw_digital_io/digital_io.h"
 
 // The functions in this file return specific implementations of singleton types
 // provided by the system.
@@ -32,10 +36,19 @@ void Init();
 /// Starts the main system scheduler. This function never returns.
 [[noreturn]] void Start();
 
+/// Returns an identifier that is chosen anew each time the device boots.
+uint32_t BootId();
+
 AirSensor& AirSensor();
 
+/// Shares the bus that the sensors are attached to between their drivers.
+I2cBusScheduler& I2cBus();
+
 ProximitySensor& ProximitySensor();
 
+/// Signals when a proximity sample crosses the sensor's interrupt thresholds.
+pw::digital_io::DigitalInterrupt& ProximityInterrupt();
+
 AmbientLightSensor& AmbientLightSensor();
 
 Board& Board();
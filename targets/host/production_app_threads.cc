@@ -1,25 +0,0 @@
-// Copyright 2024 The Pigweed Authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License"); you may not
-// use this file except in compliance with the License. You may obtain a copy of
-// the License at
-//
-//     https://www.apache.org/licenses/LICENSE-2.0
-//
-// Unless required by applicable law or agreed to in writing, software
-// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
-// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
-// License for the specific language governing permissions and limitations under
-// the License.
-
-#include "apps/production/threads.h"
-#include "pw_thread_stl/options.h"
-
-namespace sense {
-
-const pw::thread::Options& SamplingThreadOptions() {
-  static constexpr pw::thread::stl::Options kOptions;
-  return kOptions;
-}
-
-}  // namespace sense
@@ -17,9 +17,14 @@
 #include <signal.h>
 #include <stdio.h>
 
-#include "modules/air_sensor/air_sensor_fake.h"
+#include <random>
+
+#include "device/bme688.h"
+#include "device/bme688_simulator.h"
 #include "modules/board/board_fake.h"
+#include "modules/i2c_bus/scheduler.h"
 #include "modules/light/fake_sensor.h"
+#include "modules/proximity/fake_interrupt.h"
 #include "modules/proximity/fake_sensor.h"
 #include "pw_assert/check.h"
 #include "pw_channel/stream_channel.h"
@@ -28,6 +33,8 @@
 #include "pw_system/io.h"
 #include "pw_system/system.h"
 #include "pw_thread_stl/options.h"
+#include "system/pubsub.h"
+#include "system/worker.h"
 
 using ::pw::channel::StreamChannel;
 using ::pw::digital_io::DigitalIn;
@@ -101,8 +108,30 @@ void Start() {
   PW_UNREACHABLE;
 }
 
+uint32_t BootId() {
+  static const uint32_t boot_id = std::random_device()();
+  return boot_id;
+}
+
+// The simulated air sensor is the only device on the bus.
+I2cBusScheduler& I2cBus() {
+  static Bme688Simulator simulator;
+  static I2cBusScheduler scheduler(simulator);
+  return scheduler;
+}
+
 sense::AirSensor& AirSensor() {
-  static AirSensorFake air_sensor;
+  static Bme688& air_sensor = []() -> Bme688& {
+    // Run the real driver against a simulated sensor, so the host exercises
+    // the same I2C traffic and timing as the device.
+    static I2cBusScheduler::Client client(
+        I2cBus(), "bme688", I2cBusScheduler::Priority::kNormal);
+    static Bme688 sensor(
+        client, sense::system::GetWorker(), Bme688::Mode::kPipelined);
+    sensor.SetScanCallback(
+        [](const GasScan& scan) { std::ignore = PubSub().Publish(scan); });
+    return sensor;
+  }();
   return air_sensor;
 }
 
@@ -126,4 +155,9 @@ sense::ProximitySensor& ProximitySensor() {
   return fake_prox;
 }
 
+pw::digital_io::DigitalInterrupt& ProximityInterrupt() {
+  static ::sense::FakeDigitalInterrupt fake_interrupt;
+  return fake_interrupt;
+}
+
 }  // namespace sense::system
@@ -23,7 +23,6 @@ load("@pigweed//targets/rp2040:transition.bzl", "RP2_SYSTEM_FLAGS")
 _COMMON_FLAGS = merge_flags_for_transition_impl(
     base = RP2_SYSTEM_FLAGS,
     override = {
-        "//apps/production:threads": "//targets/rp2:production_app_threads",
         "//system:system": "//targets/rp2:system",
         "@freertos//:freertos_config": "//targets/rp2:freertos_config",
         "@pico-sdk//bazel/config:PICO_CLIB": "llvm_libc",
@@ -38,10 +37,12 @@ _COMMON_FLAGS = merge_flags_for_transition_impl(
 
 _RP2040_FLAGS = {
     "//command_line_option:platforms": "//targets/rp2:rp2040",
+    "//modules/air_sensor:config_override": "//targets/rp2:air_sensor_config_overrides",
 }
 
 _RP2350_FLAGS = {
     "//command_line_option:platforms": "//targets/rp2:rp2350",
+    "//modules/air_sensor:config_override": "@pigweed//pw_build:default_module_config",
 }
 
 def _rp2_transition(device_specific_flags):
@@ -17,10 +17,13 @@
 #include "device/bme688.h"
 #include "device/ltr559_light_and_prox_sensor.h"
 #include "device/pico_board.h"
+#include "device/pico_digital_interrupt.h"
 #include "hardware/adc.h"
 #include "hardware/exception.h"
 #include "modules/air_sensor/air_sensor.h"
 #include "modules/buttons/manager.h"
+#include "modules/i2c_bus/scheduler.h"
+#include "pico/rand.h"
 #include "pico/stdlib.h"
 #include "pw_channel/rp2_stdio_channel.h"
 #include "pw_cpu_exception/entry.h"
@@ -60,7 +63,10 @@ pw::i2c::Initiator& I2cInitiator() {
 }
 
 Ltr559ProxAndLightSensorImpl& Ltr559() {
-  static Ltr559ProxAndLightSensorImpl sensor(I2cInitiator());
+  // Proximity drives the UI, so it goes ahead of the slower air sensor.
+  static I2cBusScheduler::Client client(
+      I2cBus(), "ltr559", I2cBusScheduler::Priority::kHigh);
+  static Ltr559ProxAndLightSensorImpl sensor(client);
   return sensor;
 }
 
@@ -92,6 +98,13 @@ Rp2040DigitalIn io_sw_y({
 });
 }  // namespace
 
+// The LTR559 and BME688 share I2C0. Each has its own client of a scheduler
+// that takes turns at the bus on the calling thread.
+I2cBusScheduler& I2cBus() {
+  static I2cBusScheduler scheduler(I2cInitiator());
+  return scheduler;
+}
+
 void Init() {
   // PICO_SDK inits.
   SystemInit();
@@ -112,8 +125,24 @@ void Start() {
   PW_UNREACHABLE;
 }
 
+uint32_t BootId() {
+  // Seeded from the ring oscillator and other per-boot entropy.
+  static const uint32_t boot_id = get_rand_32();
+  return boot_id;
+}
+
 sense::AirSensor& AirSensor() {
-  static Bme688 air_sensor(I2cInitiator(), sense::system::GetWorker());
+  static Bme688& air_sensor = []() -> Bme688& {
+    // Keep conversions running, so the sampling loop doesn't wait on the
+    // heater.
+    static I2cBusScheduler::Client client(
+        I2cBus(), "bme688", I2cBusScheduler::Priority::kNormal);
+    static Bme688 sensor(
+        client, sense::system::GetWorker(), Bme688::Mode::kPipelined);
+    sensor.SetScanCallback(
+        [](const GasScan& scan) { std::ignore = PubSub().Publish(scan); });
+    return sensor;
+  }();
   return air_sensor;
 }
 
@@ -131,4 +160,14 @@ sense::AmbientLightSensor& AmbientLightSensor() { return Ltr559(); }
 
 sense::ProximitySensor& ProximitySensor() { return Ltr559(); }
 
+pw::digital_io::DigitalInterrupt& ProximityInterrupt() {
+  static constexpr PicoDigitalInterrupt::GpioConfig kConfig{
+      .pin = board::kEnviroLtr550Int,
+      .polarity = pw::digital_io::Polarity::kActiveLow,
+      .enable_pull_up = true,
+  };
+  static PicoDigitalInterrupt interrupt(kConfig);
+  return interrupt;
+}
+
 }  // namespace sense::system
@@ -31,12 +31,19 @@ from pw_system.device_connection import (
     create_device_serial_or_socket_connection,
 )
 
+from sense.sample_codec import SampleFrameDecoder
+
 from blinky_pb import blinky_pb2
-from modules.air_sensor import air_sensor_pb2
 from modules.board import board_pb2
+from modules.telemetry import telemetry_pb2
 from factory_pb import factory_pb2
 from pubsub_pb import pubsub_pb2
+import air_sensor_pb2
+import history_pb2
+import i2c_bus_pb2
 import morse_code_pb2
+import rpc_metrics_pb2
+import sampling_pb2
 import state_manager_pb2
 
 
@@ -61,6 +68,10 @@ class Device(PwSystemDevice):
         super().__init__(*args, **kwargs)
         self.pubsub_call_ = None
         self.pubsub_sensor_values: dict[str, Any] = {}
+        self.last_pubsub_seq_: None | int = None
+        self.last_pubsub_boot_id_: None | int = None
+        self.compact_call_ = None
+        self.telemetry_call_ = None
 
     def _log_last_pubsub_sensor_values(self) -> None:
         log_line = ''
@@ -68,12 +79,14 @@ class Device(PwSystemDevice):
             log_line += f'{event_type}: {event_value:.2f}  '
         _PUBSUB_LOG.info(log_line)
 
-    def log_pubsub_events(self, filter: None | str = None):
+    def log_pubsub_events(self, filter: None | str = None, resume: bool = True):
         """Logs pubsub events.
 
         Args:
           filter: If provided, only events containing the `filter` string will
             be logged.
+          resume: If True and events were logged before, first replays events
+            that the device published since the last one that was received.
         """
         self.stop_logging_pubsub_events()
 
@@ -81,6 +94,16 @@ class Device(PwSystemDevice):
         _PUBSUB_LOG.propagate = False
 
         def log_event(event: pubsub_pb2.Event) -> None:
+            if event.WhichOneof('type') == 'gap':
+                _PUBSUB_LOG.warning(
+                    'Missed %s events starting at #%d',
+                    event.gap.missed_count or 'an unknown number of',
+                    event.gap.first_missing_seq,
+                )
+                return
+            self.last_pubsub_seq_ = event.seq
+            self.last_pubsub_boot_id_ = event.boot_id
+
             event_str = str(event)
             if filter is not None and filter not in event_str:
                 return
@@ -88,6 +111,11 @@ class Device(PwSystemDevice):
             event_value = getattr(event, event_type)
             prefix = ''
 
+            if event_type == 'proximity_samples':
+                # Only the most recent of a batch of samples is logged.
+                event_type = 'proximity_level'
+                event_value = event_value.samples[-1]
+
             if event_type in [
                 'air_quality',
                 'ambient_light_lux',
@@ -104,8 +132,13 @@ class Device(PwSystemDevice):
 
             _PUBSUB_LOG.info("%s %s", prefix, str(event).replace('\n', ' '))
 
+        request = pubsub_pb2.SubscribeRequest()
+        if resume and self.last_pubsub_seq_ is not None:
+            request.resume_from_seq = self.last_pubsub_seq_
+            request.resume_boot_id = self.last_pubsub_boot_id_
+
         self.pubsub_call_ = self.rpcs.pubsub.PubSub.Subscribe.invoke(
-            on_next=lambda call_, event: log_event(event)
+            request, on_next=lambda call_, event: log_event(event)
         )
 
     def stop_logging_pubsub_events(self):
@@ -114,10 +147,134 @@ class Device(PwSystemDevice):
             self.pubsub_call_.cancel()
             self.pubsub_call_ = None
 
+    def log_compact_samples(self):
+        """Logs sensor samples received through the compact sample stream."""
+        self.stop_logging_compact_samples()
+        _PUBSUB_LOG.propagate = False
+        decoder = SampleFrameDecoder()
+
+        def log_frame(frame: pubsub_pb2.CompactFrame) -> None:
+            for sample in decoder.decode(frame.data):
+                name = sample.channel.name.lower()
+                self.pubsub_sensor_values[name] = sample.value
+            self._log_last_pubsub_sensor_values()
+
+        self.compact_call_ = self.rpcs.pubsub.PubSub.SubscribeCompact.invoke(
+            on_next=lambda call_, frame: log_frame(frame)
+        )
+
+    def stop_logging_compact_samples(self):
+        """Stops a `log_compact_samples` call if one was started."""
+        if self.compact_call_ is not None:
+            self.compact_call_.cancel()
+            self.compact_call_ = None
+
+    def log_telemetry(self, tick_interval_ms: int = 1000, **dividers: int):
+        """Logs frames from the telemetry stream.
+
+        Args:
+          tick_interval_ms: Interval between frames. Minimum 100ms.
+          dividers: Per-channel rate dividers, e.g. `air_divider=5`. Channels
+            without a divider are sampled on every tick.
+        """
+        self.stop_logging_telemetry()
+        request = telemetry_pb2.StreamRequest(
+            tick_interval_ms=tick_interval_ms,
+            air_divider=1,
+            score_divider=1,
+            light_divider=1,
+            proximity_divider=1,
+            core_temperature_divider=1,
+            state_divider=1,
+        )
+        for name, divider in dividers.items():
+            setattr(request, name, divider)
+
+        def log_frame(frame: telemetry_pb2.Frame) -> None:
+            _PUBSUB_LOG.info(str(frame).replace('\n', ' '))
+
+        self.telemetry_call_ = self.rpcs.telemetry.Telemetry.Stream.invoke(
+            request, on_next=lambda call_, frame: log_frame(frame)
+        )
+
+    def stop_logging_telemetry(self):
+        """Stops a `log_telemetry` call if one was started."""
+        if self.telemetry_call_ is not None:
+            self.telemetry_call_.cancel()
+            self.telemetry_call_ = None
+
     def get_air_measurement(self) -> air_sensor_pb2.Measurement:
         """Fetches an air measurement from the device."""
         return self.rpcs.air_sensor.AirSensor.Measure().unwrap_or_raise()
 
+    def set_heater_profile(
+        self,
+        steps: list[tuple[int, int]],
+        mode: int = air_sensor_pb2.HEATER_MODE_FORCED,
+    ):
+        """Sets the gas sensor's heater profile.
+
+        Each step is a heater temperature in degrees Celsius and a duration in
+        milliseconds. Forced mode takes exactly one step, and the sequential
+        and parallel modes up to 10.
+        """
+        profile = air_sensor_pb2.HeaterProfile(
+            mode=mode,
+            steps=[
+                air_sensor_pb2.HeaterStep(
+                    temperature_c=temperature_c, duration_ms=duration_ms
+                )
+                for temperature_c, duration_ms in steps
+            ],
+        )
+        self.rpcs.air_sensor.AirSensor.SetHeaterProfile(
+            profile
+        ).unwrap_or_raise()
+
+    def get_history(
+        self, tier: int = 0, since_s: int = 0
+    ) -> list[history_pb2.Bucket]:
+        """Fetches closed history buckets, oldest first.
+
+        Tier 0 has 1 second buckets, tier 1 has 5 minute buckets, and tier 2
+        has 1 hour buckets. Tier 0 buckets only have means. Only buckets
+        starting at or after `since_s` seconds since boot are returned.
+        """
+        response = self.rpcs.history.History.GetHistory(
+            tier=tier, since_s=since_s
+        )
+        if not response.status.ok():
+            raise RuntimeError(f'GetHistory failed: {response.status}')
+        return [
+            bucket for batch in response.responses for bucket in batch.buckets
+        ]
+
+    def get_rpc_metrics(self) -> list[rpc_metrics_pb2.MethodMetrics]:
+        """Fetches per-method call and streaming statistics."""
+        rpc_metrics = self.rpcs.rpc_metrics.RpcMetrics
+        response = rpc_metrics.GetMethodMetrics()
+        if not response.status.ok():
+            raise RuntimeError(f'GetMethodMetrics failed: {response.status}')
+        return list(response.responses)
+
+    def log_rpc_metrics(self):
+        """Writes per-method call and streaming statistics to the device log."""
+        self.rpcs.rpc_metrics.RpcMetrics.LogMetrics()
+
+    def get_sampler_stats(self) -> list[sampling_pb2.SamplerStats]:
+        """Fetches each sensor's sample counts, misses and timing histograms."""
+        response = self.rpcs.sampling.Sampling.GetSamplerStats()
+        if not response.status.ok():
+            raise RuntimeError(f'GetSamplerStats failed: {response.status}')
+        return list(response.responses)
+
+    def get_i2c_bus_stats(self) -> list[i2c_bus_pb2.ClientStats]:
+        """Fetches each I2C client's transaction counts and bus utilization."""
+        response = self.rpcs.i2c_bus.I2cBus.GetClientStats()
+        if not response.status.ok():
+            raise RuntimeError(f'GetClientStats failed: {response.status}')
+        return list(response.responses)
+
     def toggle_led(self):
         """Toggles the onboard (non-RGB) LED."""
         self.rpcs.blinky.Blinky.ToggleLed()
@@ -150,9 +307,14 @@ def get_all_protos() -> list[ModuleType]:
         common_pb2,
         echo_pb2,
         factory_pb2,
+        history_pb2,
+        i2c_bus_pb2,
         morse_code_pb2,
         pubsub_pb2,
+        rpc_metrics_pb2,
+        sampling_pb2,
         state_manager_pb2,
+        telemetry_pb2,
     ]
 
 
@@ -0,0 +1,117 @@
+# Copyright 2024 The Pigweed Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+"""Decoder for compact sample frames streamed by PubSub.SubscribeCompact.
+
+This must be kept up to date with modules/sample_codec/sample_codec.h.
+"""
+
+import enum
+import struct
+from typing import Iterator, NamedTuple
+
+KEYFRAME_FLAG = 0x01
+HEADER_SIZE = 4
+
+
+class SampleChannel(enum.IntEnum):
+    AMBIENT_LIGHT = 0
+    PROXIMITY = 1
+    AIR_QUALITY = 2
+
+
+_FLOAT_CHANNELS = frozenset([SampleChannel.AMBIENT_LIGHT])
+
+
+class Sample(NamedTuple):
+    channel: SampleChannel
+    value: float | int
+
+
+def _read_varints(data: bytes) -> Iterator[int]:
+    value = 0
+    shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            yield value
+            value = 0
+            shift = 0
+    if shift != 0:
+        raise ValueError('Truncated varint in compact frame')
+
+
+def _zigzag_decode(value: int) -> int:
+    return (value >> 1) ^ -(value & 1)
+
+
+def _bits_to_float(bits: int) -> float:
+    return struct.unpack('<f', struct.pack('<I', bits))[0]
+
+
+class _ChannelState:
+    def __init__(self) -> None:
+        self.synced = False
+        self.sequence = 0
+        self.previous = 0
+
+
+class SampleFrameDecoder:
+    """Decodes compact frames from one or more channels into samples.
+
+    Frames that follow a lost frame are dropped until the next keyframe.
+    """
+
+    def __init__(self) -> None:
+        self._channels: dict[SampleChannel, _ChannelState] = {}
+        self.dropped_frames = 0
+
+    def decode(self, frame: bytes) -> list[Sample]:
+        if len(frame) < HEADER_SIZE:
+            raise ValueError(f'Compact frame too short: {len(frame)} bytes')
+
+        channel = SampleChannel(frame[0])
+        keyframe = bool(frame[1] & KEYFRAME_FLAG)
+        sequence = frame[2]
+        count = frame[3]
+
+        state = self._channels.setdefault(channel, _ChannelState())
+        if state.synced and sequence != (state.sequence + 1) % 256:
+            state.synced = False
+        state.sequence = sequence
+        if not keyframe and not state.synced:
+            self.dropped_frames += 1
+            return []
+
+        values = list(_read_varints(frame[HEADER_SIZE:]))
+        if len(values) != count:
+            raise ValueError(
+                f'Compact frame holds {len(values)} samples, expected {count}'
+            )
+
+        samples = []
+        is_float = channel in _FLOAT_CHANNELS
+        for i, encoded in enumerate(values):
+            if keyframe and i == 0:
+                raw = encoded
+            elif is_float:
+                raw = state.previous ^ encoded
+            else:
+                raw = (state.previous + _zigzag_decode(encoded)) & 0xFFFF
+            state.previous = raw
+            value = _bits_to_float(raw) if is_float else raw
+            samples.append(Sample(channel, value))
+
+        state.synced = True
+        return samples
@@ -23,7 +23,10 @@ import {
   MeasureStreamRequest,
   Measurement,
 } from "../../protos/collection/air_sensor/air_sensor_pb";
-import { State } from "../../protos/collection/state_manager/state_manager_pb";
+import {
+  State,
+  WatchStateRequest,
+} from "../../protos/collection/state_manager/state_manager_pb";
 class RPCService {
   transport;
   decoder;
@@ -35,6 +38,7 @@ class RPCService {
   boardTempService;
   measureService;
   stateService;
+  watchStateService;
   constructor(rpcAddress = 82) {
     this.transport = new WebSerial.WebSerialTransport();
     this.decoder = new pw_hdlc.Decoder();
@@ -61,6 +65,9 @@ class RPCService {
     this.stateService = this.client
       .channel()
       .methodStub("state_manager.StateManager.GetState");
+    this.watchStateService = this.client
+      .channel()
+      .methodStub("state_manager.StateManager.WatchState");
   }
 
   async connect() {
@@ -133,6 +140,24 @@ class RPCService {
     const [status, response] = await this.stateService.call();
     return response;
   }
+
+  async watchState(onState: (state: State) => void) {
+    // The device only sends the state when it changes, plus a periodic
+    // heartbeat, so there is no need to poll getState().
+    const req = new WatchStateRequest();
+    req.setHeartbeatIntervalMs(10000);
+    await this.watchStateService.invoke(
+      req,
+      (state: State) => {
+        console.log("StateManager.WatchState", state.toObject());
+        onState(state);
+      },
+      undefined,
+      (err) => {
+        console.error(err);
+      },
+    );
+  }
 }
 
 // We keep a singleton of this service.
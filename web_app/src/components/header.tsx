@@ -15,6 +15,7 @@
 import React, { useEffect, useState } from 'react'
 import { getRpcService } from '../common/rpcService';
 import { useAppState } from '../common/state';
+import { State } from '../../protos/collection/state_manager/state_manager_pb';
 
 function formatDate() {
     const date = new Date();
@@ -61,10 +62,14 @@ export function Header(){
                 {!connected && <button className='header-button' onClick={async ()=> {
                     await rpc.connect();
                     try{
+                        let watchedState: State | undefined;
+                        await rpc.watchState((state)=>{
+                            watchedState = state;
+                        });
                         await rpc.streamMeasure(async (reading)=>{
-                        const state = await rpc.getState();
+                        // Devices without WatchState fall back to polling.
+                        const state = watchedState ?? await rpc.getState();
                         console.log("AirSensor.MeasureStream", reading.toObject())
-                        console.log("StateManager.GetState", state.toObject())
                         appState.addReading({
                             temperature: reading.getTemperature(),
                             score: Math.round((reading.getScore() / 1024) * 100),